@@ -0,0 +1,639 @@
+/**
+ * @file llanim_libtest.cpp
+ * @brief Headless benchmark of avatar animation updates
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+#include "linden_common.h"
+#include "llframetimer.h"
+#include "lltimer.h"
+#include "parallelfor.h"
+#include "threadpool.h"
+
+// Linden library includes
+#include "llcharacter.h"
+#include "lldatapacker.h"
+#include "llkeyframemotion.h"
+#include "llquantize.h"
+
+// system libraries
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <thread>
+
+// doc string provided when invoking the program with --help
+static const char USAGE[] = "\n"
+"usage:\tllanim_libtest [options] [file.anim ...]\n"
+"\n"
+"Animates avatars with the given .anim assets, or with synthesized looping\n"
+"animations if none are given, once with every pose evaluated on the main\n"
+"thread and once with poses evaluated as parallel jobs, and checks both\n"
+"produce the same skeletons. Also checks and times the compiled keyframe\n"
+"curves against evaluating each curve on its own.\n"
+"\n"
+" -h, --help\n"
+"        Print this help\n"
+" -a, --avatars <n>\n"
+"        Number of avatars animated. Default is 80.\n"
+" -f, --frames <n>\n"
+"        Number of 1/60 second frames per mode. Default is 600.\n"
+" -m, --motions <n>\n"
+"        Motions playing on each avatar. Default is 3.\n"
+" -s, --seed <n>\n"
+"        Seed for synthesized animations and avatar setup. Default is 1.\n"
+" -t, --threads <n>\n"
+"        Worker threads helping the main thread. Default is one less than\n"
+"        the number of hardware threads.\n"
+"\n";
+
+static const F64 FRAME_STEP = 1.0 / 60.0;
+
+// Advances the frame time every LLFrameTimer reads, so motion controllers
+// step by exactly FRAME_STEP whatever the machine is doing
+class BenchFrameClock : public LLFrameTimer
+{
+public:
+	static void step(F64 seconds)
+	{
+		sFrameTime += seconds;
+		sTotalSeconds += seconds;
+	}
+};
+
+struct JointDef
+{
+	const char* mName;
+	S32 mParent;
+	F32 mPosition[3];
+};
+
+// The base avatar skeleton, offsets from avatar_skeleton.xml
+static const JointDef SKELETON[] =
+{
+	{ "mPelvis",		-1,	{ 0.f, 0.f, 1.067f } },
+	{ "mTorso",			0,	{ 0.f, 0.f, 0.084f } },
+	{ "mChest",			1,	{ -0.015f, 0.f, 0.205f } },
+	{ "mNeck",			2,	{ -0.01f, 0.f, 0.251f } },
+	{ "mHead",			3,	{ 0.f, 0.f, 0.076f } },
+	{ "mSkull",			4,	{ 0.f, 0.f, 0.079f } },
+	{ "mEyeRight",		4,	{ 0.098f, -0.036f, 0.079f } },
+	{ "mEyeLeft",		4,	{ 0.098f, 0.036f, 0.079f } },
+	{ "mCollarLeft",	2,	{ -0.021f, 0.085f, 0.165f } },
+	{ "mShoulderLeft",	8,	{ 0.f, 0.079f, 0.f } },
+	{ "mElbowLeft",		9,	{ 0.f, 0.248f, 0.f } },
+	{ "mWristLeft",		10,	{ 0.f, 0.205f, 0.f } },
+	{ "mCollarRight",	2,	{ -0.021f, -0.085f, 0.165f } },
+	{ "mShoulderRight",	12,	{ 0.f, -0.079f, 0.f } },
+	{ "mElbowRight",	13,	{ 0.f, -0.248f, 0.f } },
+	{ "mWristRight",	14,	{ 0.f, -0.205f, 0.f } },
+	{ "mHipRight",		0,	{ 0.034f, -0.129f, -0.041f } },
+	{ "mKneeRight",		16,	{ -0.001f, 0.049f, -0.491f } },
+	{ "mAnkleRight",	17,	{ -0.029f, 0.f, -0.468f } },
+	{ "mFootRight",		18,	{ 0.112f, 0.f, -0.061f } },
+	{ "mToeRight",		19,	{ 0.109f, 0.f, 0.f } },
+	{ "mHipLeft",		0,	{ 0.034f, 0.127f, -0.041f } },
+	{ "mKneeLeft",		21,	{ -0.001f, -0.046f, -0.491f } },
+	{ "mAnkleLeft",		22,	{ -0.029f, 0.001f, -0.468f } },
+	{ "mFootLeft",		23,	{ 0.112f, 0.f, -0.061f } },
+	{ "mToeLeft",		24,	{ 0.109f, 0.f, 0.f } },
+};
+static const S32 NUM_JOINTS = LL_ARRAY_SIZE(SKELETON);
+
+struct VolumeDef
+{
+	const char* mName;
+	S32 mJoint;
+};
+
+// Collision volumes constraints in recorded animations may refer to
+static const VolumeDef COLLISION_VOLUMES[] =
+{
+	{ "PELVIS",			0 },
+	{ "BELLY",			1 },
+	{ "CHEST",			2 },
+	{ "NECK",			3 },
+	{ "HEAD",			4 },
+	{ "L_CLAVICLE",		8 },
+	{ "L_UPPER_ARM",	9 },
+	{ "L_LOWER_ARM",	10 },
+	{ "L_HAND",			11 },
+	{ "R_CLAVICLE",		12 },
+	{ "R_UPPER_ARM",	13 },
+	{ "R_LOWER_ARM",	14 },
+	{ "R_HAND",			15 },
+	{ "R_UPPER_LEG",	16 },
+	{ "R_LOWER_LEG",	17 },
+	{ "R_FOOT",			18 },
+	{ "L_UPPER_LEG",	21 },
+	{ "L_LOWER_LEG",	22 },
+	{ "L_FOOT",			23 },
+};
+static const S32 NUM_VOLUMES = LL_ARRAY_SIZE(COLLISION_VOLUMES);
+
+// The parts of LLVOAvatar the motion controller and keyframe motions use:
+// a skeleton, collision volumes and flat ground at z = 0
+class BenchCharacter final : public LLCharacter
+{
+public:
+	BenchCharacter(const LLVector3& position)
+	{
+		mID.generate();
+
+		for (S32 i = 0; i < NUM_JOINTS; i++)
+		{
+			const JointDef& def = SKELETON[i];
+			LLJoint* parent = def.mParent >= 0 ? mJoints[def.mParent].get() : nullptr;
+			mJoints.emplace_back(std::make_unique<LLJoint>(def.mName, parent));
+			LLJoint* joint = mJoints.back().get();
+			joint->setJointNum(i);
+			joint->mUpdateXform = TRUE;
+			joint->setPosition(i == 0 ? position + LLVector3(def.mPosition) : LLVector3(def.mPosition));
+		}
+
+		for (S32 i = 0; i < NUM_VOLUMES; i++)
+		{
+			const VolumeDef& def = COLLISION_VOLUMES[i];
+			mVolumes.emplace_back(std::make_unique<LLJoint>(def.mName, mJoints[def.mJoint].get()));
+			mVolumes.back()->mUpdateXform = TRUE;
+		}
+
+		mJoints[0]->updateWorldMatrixChildren();
+	}
+
+	~BenchCharacter()
+	{
+		// motions still hold joint states pointing into the skeleton
+		deactivateAllMotions();
+	}
+
+	const char* getAnimationPrefix() override { return "avatar"; }
+	LLJoint* getRootJoint() override { return mJoints[0].get(); }
+
+	LLJoint* getJoint(const std::string& name) override
+	{
+		for (const auto& joint : mJoints)
+		{
+			if (joint->getName() == name)
+			{
+				return joint.get();
+			}
+		}
+		// joints this skeleton lacks are evaluated but not applied
+		return nullptr;
+	}
+
+	LLVector3 getCharacterPosition() override { return mJoints[0]->getWorldPosition(); }
+	LLQuaternion getCharacterRotation() override { return LLQuaternion::DEFAULT; }
+	LLVector3 getCharacterVelocity() override { return LLVector3::zero; }
+	LLVector3 getCharacterAngularVelocity() override { return LLVector3::zero; }
+
+	void getGround(const LLVector3& in_pos, LLVector3& out_pos, LLVector3& out_norm) override
+	{
+		out_pos.set(in_pos.mV[VX], in_pos.mV[VY], 0.f);
+		out_norm.set(0.f, 0.f, 1.f);
+	}
+
+	LLJoint* getCharacterJoint(U32 i) override { return i < mJoints.size() ? mJoints[i].get() : nullptr; }
+	F32 getTimeDilation() override { return 1.f; }
+	// close enough for every motion to play at full detail
+	F32 getPixelArea() const override { return 500000.f; }
+	LLPolyMesh* getHeadMesh() override { return nullptr; }
+	LLPolyMesh* getUpperBodyMesh() override { return nullptr; }
+	LLVector3d getPosGlobalFromAgent(const LLVector3& position) override { return LLVector3d(position); }
+	LLVector3 getPosAgentFromGlobal(const LLVector3d& position) override { return LLVector3(position); }
+	void addDebugText(const std::string& text) override {}
+	const LLUUID& getID() const override { return mID; }
+
+	LLVector3 getVolumePos(S32 joint_index, LLVector3& volume_offset) override
+	{
+		if (joint_index < 0 || joint_index >= NUM_VOLUMES)
+		{
+			return LLVector3::zero;
+		}
+		// same as LLAvatarJointCollisionVolume::getVolumePos
+		LLJoint* volume = mVolumes[joint_index].get();
+		LLVector3 result = volume_offset;
+		result.scaleVec(volume->getScale());
+		result.rotVec(volume->getWorldRotation());
+		return result + volume->getWorldPosition();
+	}
+
+	LLJoint* findCollisionVolume(S32 volume_id) override
+	{
+		return (volume_id >= 0 && volume_id < NUM_VOLUMES) ? mVolumes[volume_id].get() : nullptr;
+	}
+
+	S32 getCollisionVolumeID(std::string_view name) override
+	{
+		for (S32 i = 0; i < NUM_VOLUMES; i++)
+		{
+			if (name == COLLISION_VOLUMES[i].mName)
+			{
+				return i;
+			}
+		}
+		return -1;
+	}
+
+	// The work LLVOAvatar::updatePose() does on a worker
+	void updatePose()
+	{
+		if (mMotionController.hasDeferredPose())
+		{
+			mMotionController.applyDeferredPose();
+		}
+		mJoints[0]->updateWorldMatrixChildren();
+	}
+
+	bool sameSkeleton(const BenchCharacter& other) const
+	{
+		for (S32 i = 0; i < NUM_JOINTS; i++)
+		{
+			if (memcmp(mJoints[i]->getWorldMatrix().mMatrix, other.mJoints[i]->getWorldMatrix().mMatrix, sizeof(LLMatrix4)))
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+private:
+	LLUUID mID;
+	std::vector<std::unique_ptr<LLJoint> > mJoints;
+	std::vector<std::unique_ptr<LLJoint> > mVolumes;
+};
+
+// A looping animation in the .anim asset format with roughly the key
+// density of a BVH upload, standing in for recorded data
+static std::vector<U8> synthesize_anim(std::mt19937& rng, S32 priority)
+{
+	std::uniform_real_distribution<F32> unit(0.f, 1.f);
+	const F32 duration = 1.f + 3.f * unit(rng);
+	const S32 max_keys = (S32)(duration * 30.f) + 1;
+
+	std::vector<S32> joints;
+	for (S32 i = 0; i < NUM_JOINTS; i++)
+	{
+		if (i == 0 || unit(rng) < 0.7f)
+		{
+			joints.push_back(i);
+		}
+	}
+
+	std::vector<U8> buffer(64 + joints.size() * (32 + 2 * (4 + max_keys * 8)));
+	LLDataPackerBinaryBuffer dp(buffer.data(), (S32)buffer.size());
+
+	dp.packU16(KEYFRAME_MOTION_VERSION, "version");
+	dp.packU16(KEYFRAME_MOTION_SUBVERSION, "sub_version");
+	dp.packS32(priority, "base_priority");
+	dp.packF32(duration, "duration");
+	dp.packString(std::string(), "emote_name");
+	dp.packF32(0.f, "loop_in_point");
+	dp.packF32(duration, "loop_out_point");
+	dp.packS32(1, "loop");
+	dp.packF32(0.5f, "ease_in_duration");
+	dp.packF32(0.5f, "ease_out_duration");
+	dp.packU32(0, "hand_pose");
+	dp.packU32((U32)joints.size(), "num_joints");
+
+	for (S32 joint : joints)
+	{
+		dp.packString(SKELETON[joint].mName, "joint_name");
+		dp.packS32(priority, "joint_priority");
+
+		const S32 num_keys = llmax(2, (S32)(max_keys * (0.25f + 0.75f * unit(rng))));
+		LLVector3 axis(unit(rng) - 0.5f, unit(rng) - 0.5f, unit(rng) - 0.5f);
+		axis.normVec();
+		const F32 amplitude = 0.2f + unit(rng);
+		const F32 phase = F_TWO_PI * unit(rng);
+
+		dp.packS32(num_keys, "num_rot_keys");
+		for (S32 k = 0; k < num_keys; k++)
+		{
+			F32 time = duration * k / (num_keys - 1);
+			LLQuaternion rot(amplitude * sinf(phase + F_TWO_PI * time / duration), axis);
+			LLVector3 rot_angles = rot.packToVector3();
+			dp.packU16(F32_to_U16(time, 0.f, duration), "time");
+			dp.packU16(F32_to_U16(rot_angles.mV[VX], -1.f, 1.f), "rot_angle_x");
+			dp.packU16(F32_to_U16(rot_angles.mV[VY], -1.f, 1.f), "rot_angle_y");
+			dp.packU16(F32_to_U16(rot_angles.mV[VZ], -1.f, 1.f), "rot_angle_z");
+		}
+
+		// only the pelvis moves
+		const S32 num_pos_keys = joint == 0 ? num_keys : 0;
+		dp.packS32(num_pos_keys, "num_pos_keys");
+		for (S32 k = 0; k < num_pos_keys; k++)
+		{
+			F32 time = duration * k / (num_keys - 1);
+			LLVector3 pos(0.f, 0.f, 0.05f * sinf(phase + 2.f * F_TWO_PI * time / duration));
+			dp.packU16(F32_to_U16(time, 0.f, duration), "time");
+			dp.packU16(F32_to_U16(pos.mV[VX], -LL_MAX_PELVIS_OFFSET, LL_MAX_PELVIS_OFFSET), "pos_x");
+			dp.packU16(F32_to_U16(pos.mV[VY], -LL_MAX_PELVIS_OFFSET, LL_MAX_PELVIS_OFFSET), "pos_y");
+			dp.packU16(F32_to_U16(pos.mV[VZ], -LL_MAX_PELVIS_OFFSET, LL_MAX_PELVIS_OFFSET), "pos_z");
+		}
+	}
+
+	dp.packS32(0, "num_constraints");
+
+	buffer.resize(dp.getCurrentSize());
+	return buffer;
+}
+
+static bool read_file(const char* filename, std::vector<U8>& data)
+{
+	std::ifstream file(filename, std::ios::binary);
+	if (!file)
+	{
+		return false;
+	}
+	data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+	return !data.empty();
+}
+
+// Parses an asset into LLKeyframeDataCache, where LLKeyframeMotion::onInitialize()
+// finds it without going through the asset system
+static bool load_anim(std::vector<U8>& data, const LLUUID& id, LLCharacter* character)
+{
+	LLKeyframeMotion loader(id);
+	loader.setCharacter(character);
+	LLDataPackerBinaryBuffer dp(data.data(), (S32)data.size());
+	return loader.deserialize(dp, id);
+}
+
+// Plays every animation through its compiled curves and through
+// JointMotion::update() side by side, returns how many samples differ
+static S32 check_compiled_curves(const std::vector<LLUUID>& anims, S32 frames)
+{
+	S32 mismatches = 0;
+	F64 per_curve = 0.0;
+	F64 compiled = 0.0;
+	LLTimer timer;
+	for (const LLUUID& id : anims)
+	{
+		LLKeyframeMotion::JointMotionList* list = LLKeyframeDataCache::getKeyframeData(id);
+		if (!list || !list->mCompiledCurves)
+		{
+			continue;
+		}
+
+		const U32 num_joints = list->getNumJointMotions();
+		std::vector<LLPointer<LLJointState> > curve_states;
+		std::vector<LLPointer<LLJointState> > compiled_states;
+		for (U32 i = 0; i < num_joints; i++)
+		{
+			for (auto* states : { &curve_states, &compiled_states })
+			{
+				states->push_back(new LLJointState);
+				states->back()->setUsage(list->getJointMotion(i)->mUsage);
+			}
+		}
+		std::vector<U32> cursors(list->mCompiledCurves->getNumChannels(), 0);
+
+		// a little past the end to cover the last key, looping twice
+		const F32 length = list->mDuration + (F32)FRAME_STEP;
+		for (S32 frame = 0; frame < frames; frame++)
+		{
+			const F32 time = fmodf((F32)(frame * FRAME_STEP), length);
+
+			timer.reset();
+			for (U32 i = 0; i < num_joints; i++)
+			{
+				list->getJointMotion(i)->update(curve_states[i], time, list->mDuration);
+			}
+			per_curve += timer.getElapsedTimeF64();
+
+			timer.reset();
+			list->mCompiledCurves->evaluate(compiled_states.data(), time, cursors.data());
+			compiled += timer.getElapsedTimeF64();
+
+			for (U32 i = 0; i < num_joints; i++)
+			{
+				const LLJointState* a = curve_states[i];
+				const LLJointState* b = compiled_states[i];
+				if (dist_vec(a->getPosition(), b->getPosition()) > 1e-5f
+					|| dist_vec(a->getScale(), b->getScale()) > 1e-5f
+					|| !is_approx_equal_fraction(a->getRotation().mQ[VX], b->getRotation().mQ[VX], 16)
+					|| !is_approx_equal_fraction(a->getRotation().mQ[VY], b->getRotation().mQ[VY], 16)
+					|| !is_approx_equal_fraction(a->getRotation().mQ[VZ], b->getRotation().mQ[VZ], 16)
+					|| !is_approx_equal_fraction(a->getRotation().mQ[VW], b->getRotation().mQ[VW], 16))
+				{
+					mismatches++;
+				}
+			}
+		}
+	}
+
+	std::cout << "curves: per curve " << per_curve * 1000000.0 / (frames * anims.size()) << " us/motion"
+		<< "  compiled " << compiled * 1000000.0 / (frames * anims.size()) << " us/motion"
+		<< "  speedup " << (compiled > 0.0 ? per_curve / compiled : 0.0) << "x" << std::endl;
+
+	return mismatches;
+}
+
+int main(int argc, char** argv)
+{
+	S32 num_avatars = 80;
+	S32 frames = 600;
+	S32 motions_per_avatar = 3;
+	U32 seed = 1;
+	S32 threads = llmax((S32)std::thread::hardware_concurrency() - 1, 1);
+	std::vector<const char*> anim_files;
+
+	// Analyze command line arguments
+	for (int arg = 1; arg < argc; ++arg)
+	{
+		if (!strcmp(argv[arg], "--help") || !strcmp(argv[arg], "-h"))
+		{
+			std::cout << USAGE << std::endl;
+			return 0;
+		}
+		else if ((!strcmp(argv[arg], "--avatars") || !strcmp(argv[arg], "-a")) && arg < argc-1)
+		{
+			num_avatars = llmax(atoi(argv[++arg]), 1);
+		}
+		else if ((!strcmp(argv[arg], "--frames") || !strcmp(argv[arg], "-f")) && arg < argc-1)
+		{
+			frames = llmax(atoi(argv[++arg]), 1);
+		}
+		else if ((!strcmp(argv[arg], "--motions") || !strcmp(argv[arg], "-m")) && arg < argc-1)
+		{
+			motions_per_avatar = llmax(atoi(argv[++arg]), 1);
+		}
+		else if ((!strcmp(argv[arg], "--seed") || !strcmp(argv[arg], "-s")) && arg < argc-1)
+		{
+			seed = (U32)atoi(argv[++arg]);
+		}
+		else if ((!strcmp(argv[arg], "--threads") || !strcmp(argv[arg], "-t")) && arg < argc-1)
+		{
+			threads = llmax(atoi(argv[++arg]), 1);
+		}
+		else
+		{
+			anim_files.push_back(argv[arg]);
+		}
+	}
+
+	std::mt19937 rng(seed);
+	std::vector<LLUUID> anims;
+	{
+		BenchCharacter loader_character(LLVector3::zero);
+		for (const char* filename : anim_files)
+		{
+			std::vector<U8> data;
+			LLUUID id;
+			id.generate(filename);
+			if (read_file(filename, data) && load_anim(data, id, &loader_character))
+			{
+				anims.push_back(id);
+			}
+			else
+			{
+				std::cout << "Skipping " << filename << ", not a usable .anim file" << std::endl;
+			}
+		}
+
+		if (anim_files.empty())
+		{
+			for (S32 i = 0; i < 8; i++)
+			{
+				std::vector<U8> data = synthesize_anim(rng, LLJoint::LOW_PRIORITY + i % 4);
+				LLUUID id;
+				id.generate(llformat("synthesized %d", i));
+				if (load_anim(data, id, &loader_character))
+				{
+					anims.push_back(id);
+				}
+			}
+		}
+	}
+
+	if (anims.empty())
+	{
+		std::cout << "ERROR: no animations to play" << std::endl;
+		return 1;
+	}
+
+	if (S32 mismatches = check_compiled_curves(anims, frames))
+	{
+		std::cout << "ERROR: compiled curves differ from the keyframe curves in "
+			<< mismatches << " joint samples" << std::endl;
+		LLKeyframeDataCache::clear();
+		return 1;
+	}
+
+	// Two identical crowds, one updated serially and one with deferred
+	// poses, stepped in lockstep so both see the same frame times
+	std::vector<std::unique_ptr<BenchCharacter> > serial_avatars;
+	std::vector<std::unique_ptr<BenchCharacter> > parallel_avatars;
+	std::uniform_int_distribution<size_t> pick(0, anims.size() - 1);
+	std::uniform_real_distribution<F32> offset(0.f, 4.f);
+	const S32 row = (S32)ceilf(sqrtf((F32)num_avatars));
+	for (S32 i = 0; i < num_avatars; i++)
+	{
+		LLVector3 position(2.f * (i % row), 2.f * (i / row), 0.f);
+		serial_avatars.emplace_back(std::make_unique<BenchCharacter>(position));
+		parallel_avatars.emplace_back(std::make_unique<BenchCharacter>(position));
+
+		for (S32 m = 0; m < motions_per_avatar; m++)
+		{
+			const LLUUID& id = anims[pick(rng)];
+			F32 start_offset = offset(rng);
+			for (BenchCharacter* avatarp : { serial_avatars.back().get(), parallel_avatars.back().get() })
+			{
+				avatarp->registerMotion(id, LLKeyframeMotion::create);
+				avatarp->startMotion(id, start_offset);
+			}
+		}
+	}
+
+	std::cout << num_avatars << " avatars playing " << motions_per_avatar << " of " << anims.size()
+		<< " animations for " << frames << " frames" << std::endl;
+
+	LL::ThreadPool pool(LL::JOB_POOL_NAME, threads);
+	pool.start();
+
+	F64 serial = 0.0;
+	F64 parallel = 0.0;
+	S32 mismatched_frames = 0;
+	LLTimer timer;
+	for (S32 frame = 0; frame < frames; frame++)
+	{
+		BenchFrameClock::step(FRAME_STEP);
+
+		// as LLVOAvatar::updateCharacter() does without AvatarParallelAnimation
+		timer.reset();
+		for (auto& avatarp : serial_avatars)
+		{
+			avatarp->updateMotions(LLCharacter::NORMAL_UPDATE);
+			avatarp->updatePose();
+		}
+		serial += timer.getElapsedTimeF64();
+
+		// bookkeeping on the main thread, then the join in
+		// LLVOAvatar::updatePendingPoses()
+		timer.reset();
+		for (auto& avatarp : parallel_avatars)
+		{
+			avatarp->getMotionController().setDeferPose(true);
+			avatarp->updateMotions(LLCharacter::NORMAL_UPDATE);
+			avatarp->getMotionController().setDeferPose(false);
+		}
+		LL::parallel_for(parallel_avatars.size(), 1, [&parallel_avatars](size_t begin, size_t end)
+			{
+				for (size_t i = begin; i < end; ++i)
+				{
+					parallel_avatars[i]->updatePose();
+				}
+			});
+		parallel += timer.getElapsedTimeF64();
+
+		for (S32 i = 0; i < num_avatars; i++)
+		{
+			if (!serial_avatars[i]->sameSkeleton(*parallel_avatars[i]))
+			{
+				mismatched_frames++;
+				break;
+			}
+		}
+	}
+
+	pool.close();
+
+	std::cout << "serial " << serial * 1000.0 / frames << " ms/frame"
+		<< "  parallel (" << threads << " helpers) " << parallel * 1000.0 / frames << " ms/frame"
+		<< "  speedup " << (parallel > 0.0 ? serial / parallel : 0.0) << "x" << std::endl;
+
+	serial_avatars.clear();
+	parallel_avatars.clear();
+	LLKeyframeDataCache::clear();
+
+	if (mismatched_frames)
+	{
+		std::cout << "ERROR: parallel pose evaluation gave different skeletons in "
+			<< mismatched_frames << " frames" << std::endl;
+		return 1;
+	}
+
+	return 0;
+}
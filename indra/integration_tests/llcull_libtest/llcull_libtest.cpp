@@ -0,0 +1,431 @@
+/** 
+ * @file llcull_libtest.cpp
+ * @brief Headless benchmark of octree frustum culling
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ * 
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ * 
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ * 
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+#include "linden_common.h"
+#include "lltimer.h"
+
+// Linden library includes
+#include "llcamera.h"
+#include "lloctreecull.h"
+#include "llsdserialize.h"
+#include "llrand.h"
+#include "llsdutil.h"
+#include "llsdutil_math.h"
+
+// system libraries
+#include <iostream>
+#include <fstream>
+#include <memory>
+
+// doc string provided when invoking the program with --help 
+static const char USAGE[] = "\n"
+"usage:\tllcull_libtest [options]\n"
+"\n"
+" -h, --help\n"
+"        Print this help\n"
+" -i, --input <file>\n"
+"        Cull snapshot to load, as written by the viewer to the logs folder\n"
+"        (cull_snapshot.llsd) when the RenderCullSnapshot debug setting is set.\n"
+"        Default is a generated scene.\n"
+" -n, --iterations <n>\n"
+"        Number of times each partition is culled per mode. Default is 200.\n"
+"\n";
+
+// One octree node of a snapshot, bounds as in LLViewerOctreeGroup::mBounds
+struct CullNode
+{
+	LLVector4a mCenter;
+	LLVector4a mRadius;
+	std::vector<U32> mChildren;
+};
+
+typedef std::vector<CullNode> cull_tree_t;
+
+// The trees are rebuilt as octrees without elements, so this only has to
+// satisfy LLOctreeNode
+class CullElement : public LLRefCount
+{
+public:
+	const LLVector4a& getPositionGroup() const	{ return mPosition; }
+	F32 getBinRadius() const					{ return 0.f; }
+	S32 getBinIndex() const						{ return -1; }
+	void setBinIndex(S32 index)					{ }
+
+	LLVector4a mPosition;
+};
+
+typedef LLOctreeNode<CullElement, CullElement*> cull_octree_t;
+
+// Stands in for LLViewerOctreeGroup, holding the snapshot bounds of a node
+class alignas(16) CullGroup final : public LLOctreeListener<CullElement, CullElement*>
+{
+	LL_ALIGN_NEW
+public:
+	CullGroup(const CullNode& node, U32 index)
+	:	mIndex(index)
+	{
+		mBounds[0] = node.mCenter;
+		mBounds[1] = node.mRadius;
+	}
+
+	virtual void handleChildAddition(const cull_octree_t* parent, cull_octree_t* child) { }
+	virtual void handleChildRemoval(const cull_octree_t* parent, const cull_octree_t* child) { }
+	virtual void handleStateChange(const LLTreeNode<CullElement>* node) { }
+	virtual void handleInsertion(const LLTreeNode<CullElement>* node, CullElement* data) { }
+	virtual void handleRemoval(const LLTreeNode<CullElement>* node, CullElement* data) { }
+	virtual void handleDestruction(const LLTreeNode<CullElement>* node) { }
+
+	LL_ALIGN_16(LLVector4a mBounds[2]);
+	U32 mIndex;
+};
+
+static const CullGroup* get_group(const cull_octree_t* node)
+{
+	return (const CullGroup*) node->getListener(0);
+}
+
+// Node centers and sizes only have to be consistent, culling uses the
+// group bounds
+static cull_octree_t* build_octree(const cull_tree_t& tree, U32 index, const LLVector4a& center, F32 size,
+								   cull_octree_t* parent, U8 octant)
+{
+	LLVector4a half;
+	half.splat(size * 0.5f);
+	cull_octree_t* node = new cull_octree_t(center, half, parent, octant);
+	node->addListener(new CullGroup(tree[index], index));
+
+	const std::vector<U32>& children = tree[index].mChildren;
+	for (U32 i = 0; i < children.size() && i < 8; i++)
+	{
+		LLVector4a offset;
+		offset.set((i & 1) ? size * 0.25f : -size * 0.25f,
+				   (i & 2) ? size * 0.25f : -size * 0.25f,
+				   (i & 4) ? size * 0.25f : -size * 0.25f);
+		offset.add(center);
+		node->addChild(build_octree(tree, children[i], offset, size * 0.5f, node, (U8) i), TRUE);
+	}
+	return node;
+}
+
+// The cull traversal LLViewerOctreeCull runs, without occlusion, recording
+// every node visited
+class CullTraversal : public LLOctreeCullTraveler<CullElement, CullElement*>
+{
+public:
+	CullTraversal(LLCamera& camera, bool far_clip, bool batched)
+	:	mCamera(camera), mFarClip(far_clip)
+	{
+		mBatchFrustumCheck = batched;
+	}
+
+	void run(const cull_octree_t* root)
+	{
+		mVisited.clear();
+		mRes = 0;
+		traverse(root);
+	}
+
+	virtual void visit(const cull_octree_t* node)
+	{
+		mVisited.push_back(get_group(node)->mIndex);
+	}
+
+	std::vector<U32> mVisited;
+
+protected:
+	virtual S32 frustumCheckNode(const cull_octree_t* node)
+	{
+		const LLVector4a* bounds = get_group(node)->mBounds;
+		return mFarClip ? mCamera.AABBInFrustum(bounds[0], bounds[1]) :
+			mCamera.AABBInFrustumNoFarClip(bounds[0], bounds[1]);
+	}
+
+	virtual void frustumCheckNodes(const cull_octree_t* const* nodes, U32 count, S32* results)
+	{
+		const LLVector4a* bounds[8];
+		for (U32 i = 0; i < count; i++)
+		{
+			bounds[i] = get_group(nodes[i])->mBounds;
+		}
+		ll_aabb_test_batch(bounds, count, results, [this](const LLVector4a* centers, const LLVector4a* radii, S32* res)
+			{
+				if (mFarClip)
+				{
+					mCamera.AABBInFrustum4(centers, radii, res);
+				}
+				else
+				{
+					mCamera.AABBInFrustumNoFarClip4(centers, radii, res);
+				}
+			});
+	}
+
+	LLCamera& mCamera;
+	bool mFarClip;
+};
+
+static bool load_snapshot(const std::string& filename, LLCamera& camera, std::vector<cull_tree_t>& trees)
+{
+	std::ifstream file(filename.c_str(), std::ios::in | std::ios::binary);
+	LLSD snapshot;
+	if (!file.is_open() || !LLSDSerialize::deserialize(snapshot, file, LLSDSerialize::SIZE_UNLIMITED))
+	{
+		std::cout << "Unable to read " << filename << std::endl;
+		return false;
+	}
+
+	if (snapshot["frustum"].size() != LLCamera::AGENT_FRUSTRUM_NUM)
+	{
+		std::cout << filename << " is not a cull snapshot" << std::endl;
+		return false;
+	}
+
+	LLVector3 frust[LLCamera::AGENT_FRUSTRUM_NUM];
+	for (U32 i = 0; i < LLCamera::AGENT_FRUSTRUM_NUM; i++)
+	{
+		frust[i] = ll_vector3_from_sd(snapshot["frustum"][i]);
+	}
+	camera.calcAgentFrustumPlanes(frust);
+
+	if (snapshot.has("user_clip"))
+	{
+		const LLSD& plane = snapshot["user_clip"];
+		LLVector3 normal(plane[0].asReal(), plane[1].asReal(), plane[2].asReal());
+		camera.setUserClipPlane(LLPlane(normal, (F32) plane[3].asReal()));
+	}
+
+	for (const LLSD& partition : llsd::inArray(snapshot["partitions"]))
+	{
+		cull_tree_t tree(partition.size());
+		for (U32 i = 0; i < tree.size(); i++)
+		{
+			const LLSD& node = partition[i];
+			tree[i].mCenter.set(node[0].asReal(), node[1].asReal(), node[2].asReal());
+			tree[i].mRadius.set(node[3].asReal(), node[4].asReal(), node[5].asReal());
+			S32 parent = node[6].asInteger();
+			if (parent >= 0 && parent < (S32)i)
+			{
+				tree[parent].mChildren.push_back(i);
+			}
+		}
+
+		if (!tree.empty())
+		{
+			trees.push_back(tree);
+		}
+	}
+
+	return true;
+}
+
+// Random objects in a 256m region under a loose octree
+static S32 generate_node(cull_tree_t& tree, const LLVector4a& center, F32 size, S32 depth)
+{
+	S32 index = (S32)tree.size();
+	tree.emplace_back();
+
+	LLVector4a min, max;
+	min.splat(FLT_MAX);
+	max.splat(-FLT_MAX);
+
+	// a few objects in every node, more towards the leaves
+	S32 num_objects = (S32)(ll_frand() * (depth + 1) * 2.f);
+	for (S32 i = 0; i < num_objects; i++)
+	{
+		LLVector4a pos, extent, obj_min, obj_max;
+		pos.set(ll_frand(size) - size * 0.5f, ll_frand(size) - size * 0.5f, ll_frand(size) - size * 0.5f);
+		pos.add(center);
+		extent.splat(0.1f + ll_frand(size * 0.1f));
+		obj_min.setSub(pos, extent);
+		obj_max.setAdd(pos, extent);
+		min.setMin(min, obj_min);
+		max.setMax(max, obj_max);
+	}
+
+	if (depth < 5)
+	{
+		F32 child_size = size * 0.5f;
+		for (S32 i = 0; i < 8; i++)
+		{
+			if (ll_frand() > 0.6f)
+			{
+				continue;
+			}
+
+			LLVector4a offset;
+			offset.set((i & 1) ? child_size * 0.5f : -child_size * 0.5f,
+					   (i & 2) ? child_size * 0.5f : -child_size * 0.5f,
+					   (i & 4) ? child_size * 0.5f : -child_size * 0.5f);
+			offset.add(center);
+			S32 child = generate_node(tree, offset, child_size, depth + 1);
+			tree[index].mChildren.push_back(child);
+
+			LLVector4a child_min, child_max;
+			child_min.setSub(tree[child].mCenter, tree[child].mRadius);
+			child_max.setAdd(tree[child].mCenter, tree[child].mRadius);
+			min.setMin(min, child_min);
+			max.setMax(max, child_max);
+		}
+	}
+
+	if (min[0] > max[0])
+	{
+		// empty, use the node box
+		LLVector4a half;
+		half.splat(size * 0.5f);
+		min.setSub(center, half);
+		max.setAdd(center, half);
+	}
+
+	tree[index].mCenter.setAdd(min, max);
+	tree[index].mCenter.mul(0.5f);
+	tree[index].mRadius.setSub(max, min);
+	tree[index].mRadius.mul(0.5f);
+	return index;
+}
+
+static void generate_scene(LLCamera& camera, std::vector<cull_tree_t>& trees)
+{
+	// Camera standing in the middle of the region looking along +X, corners
+	// in the same order LLViewerCamera::updateFrustumPlanes uses
+	const F32 near_dist = 0.5f;
+	const F32 far_dist = 128.f;
+	const F32 half_height = near_dist * tanf(F_PI / 6.f);
+	const F32 half_width = half_height * 16.f / 9.f;
+	LLVector3 origin(128.f, 128.f, 25.f);
+	LLVector3 at(1.f, 0.f, 0.f);
+	LLVector3 left(0.f, 1.f, 0.f);
+	LLVector3 up(0.f, 0.f, 1.f);
+
+	LLVector3 frust[LLCamera::AGENT_FRUSTRUM_NUM];
+	LLVector3 near_center = origin + at * near_dist;
+	frust[0] = near_center + left * half_width - up * half_height;
+	frust[1] = near_center - left * half_width - up * half_height;
+	frust[2] = near_center - left * half_width + up * half_height;
+	frust[3] = near_center + left * half_width + up * half_height;
+	for (U32 i = 0; i < 4; i++)
+	{
+		frust[i + 4] = origin + (frust[i] - origin) * (far_dist / near_dist);
+	}
+	camera.calcAgentFrustumPlanes(frust);
+
+	for (S32 i = 0; i < 8; i++)
+	{
+		cull_tree_t tree;
+		LLVector4a center;
+		center.set(128.f, 128.f, 128.f);
+		generate_node(tree, center, 256.f, 0);
+		trees.push_back(tree);
+	}
+}
+
+int main(int argc, char** argv)
+{
+	std::string input_filename;
+	S32 iterations = 200;
+
+	// Analyze command line arguments
+	for (int arg = 1; arg < argc; ++arg)
+	{
+		if (!strcmp(argv[arg], "--help") || !strcmp(argv[arg], "-h"))
+		{
+			std::cout << USAGE << std::endl;
+			return 0;
+		}
+		else if ((!strcmp(argv[arg], "--input") || !strcmp(argv[arg], "-i")) && arg < argc-1)
+		{
+			input_filename = argv[++arg];
+		}
+		else if ((!strcmp(argv[arg], "--iterations") || !strcmp(argv[arg], "-n")) && arg < argc-1)
+		{
+			iterations = llmax(atoi(argv[++arg]), 1);
+		}
+	}
+
+	LLCamera camera;
+	std::vector<cull_tree_t> trees;
+	if (input_filename.empty())
+	{
+		generate_scene(camera, trees);
+	}
+	else if (!load_snapshot(input_filename, camera, trees))
+	{
+		return 1;
+	}
+
+	size_t num_nodes = 0;
+	std::vector<std::unique_ptr<cull_octree_t>> octrees;
+	for (const cull_tree_t& tree : trees)
+	{
+		num_nodes += tree.size();
+		LLVector4a center;
+		center.set(128.f, 128.f, 128.f);
+		octrees.emplace_back(build_octree(tree, 0, center, 256.f, nullptr, cull_octree_t::NO_CHILD_NODES));
+	}
+	std::cout << trees.size() << " partitions, " << num_nodes << " octree nodes" << std::endl;
+
+	bool mismatch = false;
+	for (bool far_clip : { false, true })
+	{
+		F64 elapsed[2] = { 0.0, 0.0 };
+		size_t visited[2] = { 0, 0 };
+		for (const auto& octree : octrees)
+		{
+			CullTraversal single(camera, far_clip, false);
+			CullTraversal batched(camera, far_clip, true);
+			CullTraversal* traversals[2] = { &single, &batched };
+
+			for (U32 mode = 0; mode < 2; mode++)
+			{
+				LLTimer timer;
+				for (S32 i = 0; i < iterations; i++)
+				{
+					traversals[mode]->run(octree.get());
+				}
+				elapsed[mode] += timer.getElapsedTimeF64();
+				visited[mode] += traversals[mode]->mVisited.size();
+			}
+
+			if (single.mVisited != batched.mVisited)
+			{
+				mismatch = true;
+			}
+		}
+
+		std::cout << (far_clip ? "shadow (far clip)  " : "camera (no far clip)")
+			<< " visited " << visited[0]
+			<< "  single " << elapsed[0] * 1000.0 / iterations << " ms"
+			<< "  batched " << elapsed[1] * 1000.0 / iterations << " ms"
+			<< "  speedup " << (elapsed[1] > 0.0 ? elapsed[0] / elapsed[1] : 0.0) << "x" << std::endl;
+	}
+
+	if (mismatch)
+	{
+		std::cout << "ERROR: batched culling visited different nodes" << std::endl;
+		return 1;
+	}
+
+	return 0;
+}
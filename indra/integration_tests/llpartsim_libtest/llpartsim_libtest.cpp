@@ -0,0 +1,617 @@
+/**
+ * @file llpartsim_libtest.cpp
+ * @brief Headless benchmark of particle group simulation and billboard generation
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+#include "linden_common.h"
+#include "lltimer.h"
+#include "parallelfor.h"
+#include "threadpool.h"
+
+// Linden library includes
+#include "lldatapacker.h"
+#include "llmath.h"
+#include "llpartdata.h"
+#include "llvector4a.h"
+#include "llviewerpartarrays.h"
+#include "v4coloru.h"
+
+// system libraries
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <random>
+#include <thread>
+#include <tuple>
+
+// doc string provided when invoking the program with --help
+static const char USAGE[] = "\n"
+"usage:\tllpartsim_libtest [options] [psblock ...]\n"
+"\n"
+"Replays particle sources given as PSBlock dumps (the raw PSBlock field of an\n"
+"ObjectUpdate), or synthesized ones if none are given, once simulating the\n"
+"particle groups and generating their billboards on the main thread and once\n"
+"as parallel jobs, one per group, and checks both produce the same vertices.\n"
+"\n"
+" -h, --help\n"
+"        Print this help\n"
+" -n, --sources <n>\n"
+"        Number of particle sources placed in the scene. Dumps are reused\n"
+"        round robin when there are fewer. Default is 300.\n"
+" -f, --frames <n>\n"
+"        Number of 1/60 second frames per mode. Default is 600.\n"
+" -s, --seed <n>\n"
+"        Seed for synthesized sources, their placement and emission.\n"
+"        Default is 1.\n"
+" -t, --threads <n>\n"
+"        Worker threads helping the main thread. Default is one less than\n"
+"        the number of hardware threads.\n"
+"\n";
+
+static const F32 FRAME_STEP = 1.f / 60.f;
+
+// Same as LLViewerPartSim
+static const F32 PART_SIM_BOX_SIDE = 16.f;
+static const S32 MAX_PART_COUNT = LL_MAX_PARTICLE_COUNT;
+
+// Same as llpartdata.cpp
+static const S32 PS_SYS_DATA_BLOCK_SIZE = 68;
+static const S32 PS_LEGACY_PART_DATA_BLOCK_SIZE = 18;
+static const S32 PS_LEGACY_DATA_BLOCK_SIZE = PS_SYS_DATA_BLOCK_SIZE + PS_LEGACY_PART_DATA_BLOCK_SIZE;
+static const S32 PS_MAX_DATA_BLOCK_SIZE = PS_LEGACY_DATA_BLOCK_SIZE + 2 + 2 + 8;
+
+// Stands in for the region wind field LLViewerPartGroup samples
+static const LLVector3 WIND(2.f, 1.f, 0.f);
+
+// What LLViewerPart keeps that the group update reads or writes
+struct Particle : public LLPartData
+{
+	LLVector3 mPosAgent;
+	LLVector3 mVelocity;
+	LLVector3 mAccel;
+	LLColor4 mColor;
+	LLVector2 mScale;
+	LLColor4U mGlow;
+	F32 mLastUpdateTime;
+	F32 mSkipOffset;
+	U32 mSource;
+};
+
+struct Source
+{
+	LLPartSysData mData;
+	LLVector3 mPos;
+	LLVector3 mTargetPos;
+	F32 mAge;
+	F32 mLastPartTime;
+	std::mt19937 mRNG;
+};
+
+typedef std::tuple<S32, S32, S32> cell_t;
+
+// A LLViewerPartGroup and the billboards its LLVOPartGroup generates
+struct Group
+{
+	cell_t mCell;
+	std::vector<Particle> mParticles;
+	LLViewerPartArrays mArrays;
+	std::vector<LLVector4a> mVertices;
+	std::vector<LLColor4U> mColors;
+	std::vector<LLColor4U> mGlow;
+};
+
+struct Scene
+{
+	std::vector<Source> mSources;
+	std::vector<Group> mGroups;
+	std::map<cell_t, size_t> mGroupIndex;
+	S32 mParticleCount = 0;
+};
+
+static cell_t cell_of(const LLVector3& pos)
+{
+	return cell_t(llfloor(pos.mV[VX] / PART_SIM_BOX_SIDE),
+				  llfloor(pos.mV[VY] / PART_SIM_BOX_SIDE),
+				  llfloor(pos.mV[VZ] / PART_SIM_BOX_SIDE));
+}
+
+// LLViewerPartSim::put(), without the desired size test
+static void add_part(Scene& scene, const Particle& part)
+{
+	const cell_t cell = cell_of(part.mPosAgent);
+	auto it = scene.mGroupIndex.find(cell);
+	if (it == scene.mGroupIndex.end())
+	{
+		it = scene.mGroupIndex.emplace(cell, scene.mGroups.size()).first;
+		scene.mGroups.emplace_back();
+		scene.mGroups.back().mCell = cell;
+	}
+	Group& group = scene.mGroups[it->second];
+	group.mParticles.push_back(part);
+	group.mArrays.push_back(part);
+	scene.mParticleCount++;
+}
+
+// Roughly what LLViewerPartSourceScript::update() does for a source on an
+// unrotated object
+static void emit(Scene& scene, U32 source_idx, F32 dt)
+{
+	Source& source = scene.mSources[source_idx];
+	const LLPartSysData& data = source.mData;
+
+	source.mAge += dt;
+	if (data.mMaxAge > 0.f && source.mAge > data.mMaxAge)
+	{
+		return;
+	}
+
+	std::uniform_real_distribution<F32> unit(0.f, 1.f);
+	while (source.mAge - source.mLastPartTime >= data.mBurstRate)
+	{
+		source.mLastPartTime += data.mBurstRate;
+
+		for (S32 i = 0; i < data.mBurstPartCount && scene.mParticleCount < MAX_PART_COUNT; i++)
+		{
+			LLVector3 dir;
+			if (data.mPattern & LLPartSysData::LL_PART_SRC_PATTERN_EXPLODE)
+			{
+				dir.set(unit(source.mRNG) - 0.5f, unit(source.mRNG) - 0.5f, unit(source.mRNG) - 0.5f);
+				dir.normVec();
+			}
+			else if (data.mPattern & (LLPartSysData::LL_PART_SRC_PATTERN_ANGLE | LLPartSysData::LL_PART_SRC_PATTERN_ANGLE_CONE))
+			{
+				const F32 theta = data.mInnerAngle + unit(source.mRNG) * (data.mOuterAngle - data.mInnerAngle);
+				const F32 phi = (data.mPattern & LLPartSysData::LL_PART_SRC_PATTERN_ANGLE) ? 0.f : F_TWO_PI * unit(source.mRNG);
+				dir.set(sinf(theta) * cosf(phi), sinf(theta) * sinf(phi), cosf(theta));
+			}
+
+			const F32 speed = data.mBurstSpeedMin + unit(source.mRNG) * (data.mBurstSpeedMax - data.mBurstSpeedMin);
+
+			Particle part;
+			part.mFlags = data.mPartData.mFlags;
+			part.mMaxAge = llmax(data.mPartData.mMaxAge, FRAME_STEP);
+			part.mStartColor = data.mPartData.mStartColor;
+			part.mEndColor = data.mPartData.mEndColor;
+			part.mStartScale = data.mPartData.mStartScale;
+			part.mEndScale = data.mPartData.mEndScale;
+			part.mPosOffset.setZero();
+			part.mStartGlow = data.mPartData.mStartGlow;
+			part.mEndGlow = data.mPartData.mEndGlow;
+			part.mPosAgent = source.mPos + dir * data.mBurstRadius;
+			part.mVelocity = dir * speed;
+			part.mAccel = data.mPartAccel;
+			part.mColor = data.mPartData.mStartColor;
+			part.mScale = data.mPartData.mStartScale;
+			part.mGlow = LLColor4U(0, 0, 0, (U8)ll_round(part.mStartGlow * 255.f));
+			part.mLastUpdateTime = 0.f;
+			part.mSkipOffset = 0.f;
+			part.mSource = source_idx;
+			add_part(scene, part);
+		}
+	}
+}
+
+// LLViewerPartGroup::simulate() for particles without callbacks, with the
+// constant WIND standing in for the region wind field
+static void simulate_group(Group& group, const std::vector<Source>& sources, F32 dt)
+{
+	LLViewerPartArrays& arrays = group.mArrays;
+
+	const U32 source_mask = LLPartData::LL_PART_FOLLOW_SRC_MASK | LLPartData::LL_PART_TARGET_POS_MASK |
+							LLPartData::LL_PART_TARGET_LINEAR_MASK | LLPartData::LL_PART_BOUNCE_MASK;
+	for (U32 i = 0; i < arrays.size(); i++)
+	{
+		if (arrays.mFlags[i] & source_mask)
+		{
+			const Source& source = sources[group.mParticles[i].mSource];
+			for (U32 c = 0; c < 3; c++)
+			{
+				arrays.mSourcePos[c][i] = source.mPos.mV[c];
+				arrays.mTargetPos[c][i] = source.mTargetPos.mV[c];
+			}
+		}
+	}
+
+	arrays.beginUpdate(dt);
+
+	for (U32 i = 0; i < arrays.size(); i++)
+	{
+		if (arrays.mFlags[i] & LLPartData::LL_PART_WIND_MASK)
+		{
+			for (U32 c = 0; c < 3; c++)
+			{
+				arrays.mWind[c][i] = WIND.mV[c];
+			}
+		}
+	}
+
+	arrays.integrate();
+
+	for (U32 i = 0; i < arrays.size(); i++)
+	{
+		Particle& part = group.mParticles[i];
+		arrays.store(i, part);
+
+		// Do glow interpolation
+		const F32 frac = part.mLastUpdateTime / part.mMaxAge;
+		part.mGlow.mV[3] = (U8) ll_round(ll_lerp(part.mStartGlow, part.mEndGlow, frac)*255.f);
+	}
+}
+
+// LLViewerPartGroup::finishUpdate(): kill old particles, move the ones that
+// left their box to the group they're in now
+static void finish_groups(Scene& scene)
+{
+	std::vector<Particle> transfers;
+	for (Group& group : scene.mGroups)
+	{
+		for (U32 i = 0; i < (U32)group.mParticles.size();)
+		{
+			Particle& part = group.mParticles[i];
+			const bool dead = part.mLastUpdateTime > part.mMaxAge;
+			if (dead || cell_of(part.mPosAgent) != group.mCell)
+			{
+				if (!dead)
+				{
+					transfers.push_back(part);
+				}
+				part = group.mParticles.back();
+				group.mParticles.pop_back();
+				group.mArrays.replaceWithLast(i);
+				scene.mParticleCount--;
+			}
+			else
+			{
+				i++;
+			}
+		}
+	}
+
+	for (const Particle& part : transfers)
+	{
+		add_part(scene, part);
+	}
+}
+
+// LLVOPartGroup::generateBillboards() for particles that aren't ribbons
+static void generate_billboards(Group& group, const LLVector4a& camera_agent)
+{
+	const size_t count = group.mParticles.size();
+	group.mVertices.resize(count * 4);
+	group.mColors.resize(count * 4);
+	group.mGlow.resize(count * 4);
+
+	for (size_t i = 0; i < count; i++)
+	{
+		const Particle& part = group.mParticles[i];
+		ll_part_billboard(&group.mVertices[i * 4], part.mPosAgent, part.mVelocity, part.mScale, part.mFlags, camera_agent);
+
+		const LLColor4U color = part.mColor;
+		for (size_t v = i * 4; v < i * 4 + 4; v++)
+		{
+			group.mColors[v] = color;
+			group.mGlow[v] = part.mGlow;
+		}
+	}
+}
+
+// A particle system block in the ObjectUpdate PSBlock format, with a mix of
+// the flags and patterns scripts use, standing in for recorded data
+static std::vector<U8> synthesize_block(std::mt19937& rng)
+{
+	std::uniform_real_distribution<F32> unit(0.f, 1.f);
+
+	static const U8 patterns[] = {
+		LLPartSysData::LL_PART_SRC_PATTERN_DROP,
+		LLPartSysData::LL_PART_SRC_PATTERN_EXPLODE,
+		LLPartSysData::LL_PART_SRC_PATTERN_ANGLE,
+		LLPartSysData::LL_PART_SRC_PATTERN_ANGLE_CONE
+	};
+
+	U32 part_flags = LLPartData::LL_PART_INTERP_COLOR_MASK | LLPartData::LL_PART_INTERP_SCALE_MASK;
+	if (unit(rng) < 0.5f) part_flags |= LLPartData::LL_PART_EMISSIVE_MASK;
+	if (unit(rng) < 0.3f) part_flags |= LLPartData::LL_PART_WIND_MASK;
+	if (unit(rng) < 0.2f) part_flags |= LLPartData::LL_PART_BOUNCE_MASK;
+	if (unit(rng) < 0.2f) part_flags |= LLPartData::LL_PART_FOLLOW_VELOCITY_MASK;
+	if (unit(rng) < 0.1f) part_flags |= LLPartData::LL_PART_TARGET_POS_MASK;
+	else if (unit(rng) < 0.05f) part_flags |= LLPartData::LL_PART_TARGET_LINEAR_MASK;
+	const bool glow = unit(rng) < 0.3f;
+	if (glow)
+	{
+		part_flags |= LLPartData::LL_PART_DATA_GLOW;
+	}
+
+	std::vector<U8> buffer(PS_MAX_DATA_BLOCK_SIZE);
+	LLDataPackerBinaryBuffer dp(buffer.data(), (S32)buffer.size());
+
+	const F32 speed_min = 0.2f + unit(rng);
+	const F32 inner_angle = unit(rng) * 0.5f;
+
+	dp.packS32(PS_SYS_DATA_BLOCK_SIZE, "syssize");
+	dp.packU32((U32)rng() | 1, "pscrc");
+	dp.packU32(0, "psflags");
+	dp.packU8(patterns[rng() % LL_ARRAY_SIZE(patterns)], "pspattern");
+	dp.packFixed(0.f, "psmaxage", FALSE, 8, 8);
+	dp.packFixed(0.f, "psstartage", FALSE, 8, 8);
+	dp.packFixed(inner_angle, "psinnerangle", FALSE, 3, 5);
+	dp.packFixed(inner_angle + unit(rng), "psouterangle", FALSE, 3, 5);
+	dp.packFixed(0.05f + 0.45f * unit(rng), "psburstrate", FALSE, 8, 8);
+	dp.packFixed(unit(rng), "psburstradius", FALSE, 8, 8);
+	dp.packFixed(speed_min, "psburstspeedmin", FALSE, 8, 8);
+	dp.packFixed(speed_min + 2.f * unit(rng), "psburstspeedmax", FALSE, 8, 8);
+	dp.packU8((U8)(1 + rng() % 10), "psburstpartcount");
+	dp.packFixed(0.f, "psangvelx", TRUE, 8, 7);
+	dp.packFixed(0.f, "psangvely", TRUE, 8, 7);
+	dp.packFixed(0.f, "psangvelz", TRUE, 8, 7);
+	dp.packFixed(0.5f * (unit(rng) - 0.5f), "psaccelx", TRUE, 8, 7);
+	dp.packFixed(0.5f * (unit(rng) - 0.5f), "psaccely", TRUE, 8, 7);
+	dp.packFixed(-1.f + 1.5f * unit(rng), "psaccelz", TRUE, 8, 7);
+	dp.packUUID(LLUUID::null, "psuuid");
+	dp.packUUID(LLUUID::null, "pstargetuuid");
+
+	dp.packS32(PS_LEGACY_PART_DATA_BLOCK_SIZE + (glow ? 2 : 0), "partsize");
+	dp.packU32(part_flags, "pdflags");
+	dp.packFixed(1.f + 7.f * unit(rng), "pdmaxage", FALSE, 8, 8);
+	dp.packColor4U(LLColor4U((U8)rng(), (U8)rng(), (U8)rng(), 255), "pdstartcolor");
+	dp.packColor4U(LLColor4U((U8)rng(), (U8)rng(), (U8)rng(), (U8)(rng() % 128)), "pdendcolor");
+	dp.packFixed(0.1f + 1.9f * unit(rng), "pdstartscalex", FALSE, 3, 5);
+	dp.packFixed(0.1f + 1.9f * unit(rng), "pdstartscaley", FALSE, 3, 5);
+	dp.packFixed(0.1f + 1.9f * unit(rng), "pdendscalex", FALSE, 3, 5);
+	dp.packFixed(0.1f + 1.9f * unit(rng), "pdendscaley", FALSE, 3, 5);
+	if (glow)
+	{
+		dp.packU8((U8)rng(), "pdstartglow");
+		dp.packU8(0, "pdendglow");
+	}
+
+	buffer.resize(dp.getCurrentSize());
+	return buffer;
+}
+
+static bool read_file(const char* filename, std::vector<U8>& data)
+{
+	std::ifstream file(filename, std::ios::binary);
+	if (!file)
+	{
+		return false;
+	}
+	data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+	return !data.empty();
+}
+
+// Same size dispatch as LLPartSysData::unpackBlock()
+static bool unpack_block(std::vector<U8> data, LLPartSysData& sys_data)
+{
+	if (data.size() > (size_t)PS_MAX_DATA_BLOCK_SIZE)
+	{
+		return false;
+	}
+
+	LLDataPackerBinaryBuffer dp(data.data(), (S32)data.size());
+	const bool unpacked = data.size() == (size_t)PS_LEGACY_DATA_BLOCK_SIZE ? sys_data.unpackLegacy(dp) : sys_data.unpack(dp);
+
+	// a zero CRC is how the simulator says there is no particle system
+	return unpacked && sys_data.mCRC != 0;
+}
+
+// One mode: every frame emit serially, simulate every group, sort particles
+// into groups serially, then generate billboards for every group. Returns
+// the seconds spent simulating and generating billboards.
+static F64 run(Scene& scene, S32 frames, bool parallel)
+{
+	F64 elapsed = 0.0;
+	LLTimer timer;
+	for (S32 frame = 0; frame < frames; frame++)
+	{
+		for (U32 i = 0; i < (U32)scene.mSources.size(); i++)
+		{
+			emit(scene, i, FRAME_STEP);
+		}
+
+		timer.reset();
+		if (parallel)
+		{
+			LL::parallel_for(scene.mGroups.size(), 1, [&scene](size_t begin, size_t end)
+				{
+					for (size_t j = begin; j < end; ++j)
+					{
+						simulate_group(scene.mGroups[j], scene.mSources, FRAME_STEP);
+					}
+				});
+		}
+		else
+		{
+			for (Group& group : scene.mGroups)
+			{
+				simulate_group(group, scene.mSources, FRAME_STEP);
+			}
+		}
+		elapsed += timer.getElapsedTimeF64();
+
+		finish_groups(scene);
+
+		// orbit the scene
+		const F32 angle = frame * 0.01f;
+		LLVector4a camera(128.f + 96.f * cosf(angle), 128.f + 96.f * sinf(angle), 40.f);
+
+		timer.reset();
+		if (parallel)
+		{
+			LL::parallel_for(scene.mGroups.size(), 1, [&scene, &camera](size_t begin, size_t end)
+				{
+					for (size_t j = begin; j < end; ++j)
+					{
+						generate_billboards(scene.mGroups[j], camera);
+					}
+				});
+		}
+		else
+		{
+			for (Group& group : scene.mGroups)
+			{
+				generate_billboards(group, camera);
+			}
+		}
+		elapsed += timer.getElapsedTimeF64();
+	}
+	return elapsed;
+}
+
+static bool same_billboards(const Scene& a, const Scene& b)
+{
+	if (a.mGroups.size() != b.mGroups.size())
+	{
+		return false;
+	}
+
+	for (size_t i = 0; i < a.mGroups.size(); i++)
+	{
+		const Group& ga = a.mGroups[i];
+		const Group& gb = b.mGroups[i];
+		if (ga.mVertices.size() != gb.mVertices.size() ||
+			memcmp(ga.mVertices.data(), gb.mVertices.data(), ga.mVertices.size() * sizeof(LLVector4a)) ||
+			memcmp(ga.mColors.data(), gb.mColors.data(), ga.mColors.size() * sizeof(LLColor4U)) ||
+			memcmp(ga.mGlow.data(), gb.mGlow.data(), ga.mGlow.size() * sizeof(LLColor4U)))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+int main(int argc, char** argv)
+{
+	S32 num_sources = 300;
+	S32 frames = 600;
+	U32 seed = 1;
+	S32 threads = llmax((S32)std::thread::hardware_concurrency() - 1, 1);
+	std::vector<const char*> block_files;
+
+	// Analyze command line arguments
+	for (int arg = 1; arg < argc; ++arg)
+	{
+		if (!strcmp(argv[arg], "--help") || !strcmp(argv[arg], "-h"))
+		{
+			std::cout << USAGE << std::endl;
+			return 0;
+		}
+		else if ((!strcmp(argv[arg], "--sources") || !strcmp(argv[arg], "-n")) && arg < argc-1)
+		{
+			num_sources = llmax(atoi(argv[++arg]), 1);
+		}
+		else if ((!strcmp(argv[arg], "--frames") || !strcmp(argv[arg], "-f")) && arg < argc-1)
+		{
+			frames = llmax(atoi(argv[++arg]), 1);
+		}
+		else if ((!strcmp(argv[arg], "--seed") || !strcmp(argv[arg], "-s")) && arg < argc-1)
+		{
+			seed = (U32)atoi(argv[++arg]);
+		}
+		else if ((!strcmp(argv[arg], "--threads") || !strcmp(argv[arg], "-t")) && arg < argc-1)
+		{
+			threads = llmax(atoi(argv[++arg]), 1);
+		}
+		else
+		{
+			block_files.push_back(argv[arg]);
+		}
+	}
+
+	std::mt19937 rng(seed);
+	std::vector<LLPartSysData> systems;
+	for (const char* filename : block_files)
+	{
+		std::vector<U8> data;
+		LLPartSysData sys_data;
+		if (read_file(filename, data) && unpack_block(data, sys_data))
+		{
+			systems.push_back(sys_data);
+		}
+		else
+		{
+			std::cout << "Skipping " << filename << ", not a usable PSBlock dump" << std::endl;
+		}
+	}
+
+	if (block_files.empty())
+	{
+		for (S32 i = 0; i < 32; i++)
+		{
+			LLPartSysData sys_data;
+			if (unpack_block(synthesize_block(rng), sys_data))
+			{
+				systems.push_back(sys_data);
+			}
+		}
+	}
+
+	if (systems.empty())
+	{
+		std::cout << "ERROR: no particle systems to replay" << std::endl;
+		return 1;
+	}
+
+	// sources spread over a region, a few clustered the way busy sims are
+	std::uniform_real_distribution<F32> unit(0.f, 1.f);
+	Scene initial;
+	initial.mSources.resize(num_sources);
+	for (S32 i = 0; i < num_sources; i++)
+	{
+		Source& source = initial.mSources[i];
+		source.mData = systems[i % systems.size()];
+		const F32 spread = (i % 4) ? 24.f : 256.f;
+		source.mPos.set(128.f + spread * (unit(rng) - 0.5f), 128.f + spread * (unit(rng) - 0.5f), 20.f + 10.f * unit(rng));
+		source.mTargetPos = source.mPos + LLVector3(4.f * (unit(rng) - 0.5f), 4.f * (unit(rng) - 0.5f), 2.f + 4.f * unit(rng));
+		source.mAge = 0.f;
+		source.mLastPartTime = 0.f;
+		source.mRNG.seed(seed + i);
+	}
+
+	std::cout << systems.size() << " particle systems on " << num_sources << " sources, "
+		<< frames << " frames" << std::endl;
+
+	// serial, as LLViewerPartSim does without RenderParallelParticles
+	Scene serial_scene = initial;
+	F64 serial = run(serial_scene, frames, false);
+
+	LL::ThreadPool pool(LL::JOB_POOL_NAME, threads);
+	pool.start();
+
+	Scene parallel_scene = initial;
+	F64 parallel = run(parallel_scene, frames, true);
+
+	pool.close();
+
+	std::cout << serial_scene.mParticleCount << " particles in " << serial_scene.mGroups.size() << " groups at the end" << std::endl;
+	std::cout << "serial " << serial * 1000.0 / frames << " ms"
+		<< "  parallel (" << threads << " helpers) " << parallel * 1000.0 / frames << " ms"
+		<< "  speedup " << (parallel > 0.0 ? serial / parallel : 0.0) << "x" << std::endl;
+
+	if (!same_billboards(serial_scene, parallel_scene))
+	{
+		std::cout << "ERROR: parallel update generated different billboards" << std::endl;
+		return 1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,335 @@
+/**
+ * @file llvertexgen_libtest.cpp
+ * @brief Headless benchmark of the vertex generation stage of geometry rebuilds
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+#include "linden_common.h"
+#include "lltimer.h"
+#include "parallelfor.h"
+#include "threadpool.h"
+
+// Linden library includes
+#include "llmath.h"
+#include "llmatrix4a.h"
+#include "llrand.h"
+#include "llvolume.h"
+#include "llvolumegeometry.h"
+
+// system libraries
+#include <iostream>
+#include <thread>
+
+// doc string provided when invoking the program with --help
+static const char USAGE[] = "\n"
+"usage:\tllvertexgen_libtest [options]\n"
+"\n"
+" -h, --help\n"
+"        Print this help\n"
+" -o, --objects <n>\n"
+"        Number of prims rebuilt per iteration. Default is 2000.\n"
+" -n, --iterations <n>\n"
+"        Number of rebuilds per mode. Default is 20.\n"
+" -t, --threads <n>\n"
+"        Worker threads helping the main thread. Default is one less than\n"
+"        the number of hardware threads.\n"
+"\n";
+
+// Same as LLVolumeGeometryManager
+static const size_t GEOMETRY_JOB_GRAIN = 4;
+static const U32 MAX_BUFFER_VERTICES = 65535;
+
+// Staging memory laid out like one LLVertexBuffer, one stream per
+// attribute. Texture coordinates and colors are packed two and four to a
+// vector so every stream is 16 byte aligned like the real buffers.
+struct StagingBuffer
+{
+	std::vector<LLVector4a> mPositions;
+	std::vector<LLVector4a> mNormals;
+	std::vector<LLVector4a> mTangents;
+	std::vector<LLVector4a> mTexCoords;
+	std::vector<LLVector4a> mColors;
+	std::vector<U16> mIndices;
+};
+
+// One face of a prim, placed in a buffer the way genDrawInfo places it
+struct FaceJob
+{
+	const LLVolumeFace* mFace;
+	const LLMatrix4a* mMatVert;
+	const LLMatrix4a* mMatNormal;
+	bool mTexXform;
+	U32 mColor;
+	U32 mBuffer;
+	U32 mGeomIndex;
+	U32 mGeomCount;
+	U32 mIndicesIndex;
+};
+
+struct Prim
+{
+	LLPointer<LLVolume> mVolume;
+	LLMatrix4a mMatVert;
+	LLMatrix4a mMatNormal;
+};
+
+// The CPU side of LLFace::getGeometryVolume for a full rebuild of a
+// non-rigged face, through the same routines
+static void generate_face(const FaceJob& job, std::vector<StagingBuffer>& buffers)
+{
+	const LLVolumeFace& vf = *job.mFace;
+	StagingBuffer& buffer = buffers[job.mBuffer];
+
+	ll_volume_face_indices(&buffer.mIndices[job.mIndicesIndex], vf, (U16)job.mGeomIndex);
+
+	F32* tex_coords = (F32*) &buffer.mTexCoords[job.mGeomIndex / 2];
+	if (job.mTexXform)
+	{
+		ll_volume_face_tex_coords(tex_coords, vf, 0.5f, 0.866f, 0.25f, -0.125f, 2.f, 0.5f);
+	}
+	else
+	{
+		ll_volume_face_tex_coords(tex_coords, vf);
+	}
+
+	ll_volume_face_positions((F32*) &buffer.mPositions[job.mGeomIndex], job.mGeomCount, vf, *job.mMatVert, 0);
+	ll_volume_face_normals((F32*) &buffer.mNormals[job.mGeomIndex], vf, *job.mMatNormal);
+	ll_volume_face_tangents((F32*) &buffer.mTangents[job.mGeomIndex], vf, *job.mMatNormal);
+	ll_volume_face_colors((F32*) &buffer.mColors[job.mGeomIndex / 4], vf.mNumVertices, job.mColor);
+}
+
+static LLVolume* make_volume(U8 profile, U8 path, F32 ratio_y, F32 detail)
+{
+	LLVolumeParams params;
+	params.setType(profile, path);
+	params.setRatio(1.f, ratio_y);
+	return new LLVolume(params, detail);
+}
+
+// Random prims sharing volumes the way LLVolumeMgr shares them, packed
+// into buffers of at most MAX_BUFFER_VERTICES
+static void generate_scene(S32 num_objects, std::vector<Prim>& prims, std::vector<StagingBuffer>& buffers, std::vector<FaceJob>& jobs)
+{
+	const F32 details[] = { 1.f, 1.5f, 2.5f, 4.f };
+	std::vector<LLPointer<LLVolume> > volumes;
+	for (F32 detail : details)
+	{
+		volumes.push_back(make_volume(LL_PCODE_PROFILE_SQUARE, LL_PCODE_PATH_LINE, 1.f, detail));
+		volumes.push_back(make_volume(LL_PCODE_PROFILE_CIRCLE, LL_PCODE_PATH_LINE, 1.f, detail));
+		volumes.push_back(make_volume(LL_PCODE_PROFILE_CIRCLE_HALF, LL_PCODE_PATH_CIRCLE, 1.f, detail));
+		volumes.push_back(make_volume(LL_PCODE_PROFILE_CIRCLE, LL_PCODE_PATH_CIRCLE, 0.25f, detail));
+	}
+
+	// genTangents() runs on the main thread before a face is queued, so
+	// generate them up front rather than inside the timed loops
+	for (LLVolume* volume : volumes)
+	{
+		for (S32 f = 0; f < volume->getNumVolumeFaces(); f++)
+		{
+			volume->genTangents(f);
+		}
+	}
+
+	prims.resize(num_objects);
+	for (Prim& prim : prims)
+	{
+		prim.mVolume = volumes[ll_rand((S32)volumes.size())];
+
+		LLQuaternion rot(ll_frand(F_TWO_PI), LLVector3(ll_frand() - 0.5f, ll_frand() - 0.5f, ll_frand() - 0.5f));
+		LLMatrix4 mat(rot, LLVector4(ll_frand(256.f), ll_frand(256.f), ll_frand(64.f), 1.f));
+		LLVector3 scale(0.1f + ll_frand(4.f), 0.1f + ll_frand(4.f), 0.1f + ll_frand(4.f));
+		LLMatrix4 scale_mat;
+		scale_mat.initScale(scale);
+		scale_mat *= mat;
+		prim.mMatVert.loadu(scale_mat);
+
+		// inverse transpose of a rotation and scale
+		LLMatrix4 norm_mat;
+		norm_mat.initScale(LLVector3(1.f / scale.mV[0], 1.f / scale.mV[1], 1.f / scale.mV[2]));
+		norm_mat *= LLMatrix4(rot, LLVector4(0.f, 0.f, 0.f, 1.f));
+		prim.mMatNormal.loadu(norm_mat);
+	}
+
+	std::vector<std::pair<U32, U32> > sizes;
+	buffers.clear();
+	jobs.clear();
+	U32 geom_count = MAX_BUFFER_VERTICES;
+	for (Prim& prim : prims)
+	{
+		for (S32 f = 0; f < prim.mVolume->getNumVolumeFaces(); f++)
+		{
+			const LLVolumeFace& vf = prim.mVolume->getVolumeFace(f);
+			// LLFace::setSize() pads faces to a multiple of four vertices
+			U32 num_vertices = (vf.mNumVertices + 3) & ~3;
+			if (geom_count + num_vertices > MAX_BUFFER_VERTICES)
+			{
+				sizes.emplace_back(0, 0);
+				geom_count = 0;
+			}
+
+			FaceJob job;
+			job.mFace = &vf;
+			job.mMatVert = &prim.mMatVert;
+			job.mMatNormal = &prim.mMatNormal;
+			job.mTexXform = ll_frand() < 0.5f;
+			job.mColor = ll_rand();
+			job.mBuffer = (U32)sizes.size() - 1;
+			job.mGeomIndex = sizes.back().first;
+			job.mGeomCount = num_vertices;
+			job.mIndicesIndex = sizes.back().second;
+			jobs.push_back(job);
+
+			sizes.back().first += num_vertices;
+			sizes.back().second += vf.mNumIndices;
+			geom_count += num_vertices;
+		}
+	}
+
+	buffers.resize(sizes.size());
+	for (size_t i = 0; i < sizes.size(); i++)
+	{
+		buffers[i].mPositions.resize(sizes[i].first);
+		buffers[i].mNormals.resize(sizes[i].first);
+		buffers[i].mTangents.resize(sizes[i].first);
+		buffers[i].mTexCoords.resize(sizes[i].first / 2);
+		buffers[i].mColors.resize(sizes[i].first / 4);
+		buffers[i].mIndices.resize(sizes[i].second);
+	}
+}
+
+static bool same_stream(const std::vector<LLVector4a>& a, const std::vector<LLVector4a>& b)
+{
+	return !memcmp(a.data(), b.data(), a.size() * sizeof(LLVector4a));
+}
+
+static bool same_buffers(const std::vector<StagingBuffer>& a, const std::vector<StagingBuffer>& b)
+{
+	for (size_t i = 0; i < a.size(); i++)
+	{
+		if (!same_stream(a[i].mPositions, b[i].mPositions) ||
+			!same_stream(a[i].mNormals, b[i].mNormals) ||
+			!same_stream(a[i].mTangents, b[i].mTangents) ||
+			!same_stream(a[i].mTexCoords, b[i].mTexCoords) ||
+			!same_stream(a[i].mColors, b[i].mColors) ||
+			memcmp(a[i].mIndices.data(), b[i].mIndices.data(), a[i].mIndices.size() * sizeof(U16)))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+int main(int argc, char** argv)
+{
+	S32 num_objects = 2000;
+	S32 iterations = 20;
+	S32 threads = llmax((S32)std::thread::hardware_concurrency() - 1, 1);
+
+	// Analyze command line arguments
+	for (int arg = 1; arg < argc; ++arg)
+	{
+		if (!strcmp(argv[arg], "--help") || !strcmp(argv[arg], "-h"))
+		{
+			std::cout << USAGE << std::endl;
+			return 0;
+		}
+		else if ((!strcmp(argv[arg], "--objects") || !strcmp(argv[arg], "-o")) && arg < argc-1)
+		{
+			num_objects = llmax(atoi(argv[++arg]), 1);
+		}
+		else if ((!strcmp(argv[arg], "--iterations") || !strcmp(argv[arg], "-n")) && arg < argc-1)
+		{
+			iterations = llmax(atoi(argv[++arg]), 1);
+		}
+		else if ((!strcmp(argv[arg], "--threads") || !strcmp(argv[arg], "-t")) && arg < argc-1)
+		{
+			threads = llmax(atoi(argv[++arg]), 1);
+		}
+	}
+
+	std::vector<Prim> prims;
+	std::vector<StagingBuffer> buffers;
+	std::vector<FaceJob> jobs;
+	generate_scene(num_objects, prims, buffers, jobs);
+
+	size_t num_vertices = 0;
+	for (const StagingBuffer& buffer : buffers)
+	{
+		num_vertices += buffer.mPositions.size();
+	}
+	std::cout << prims.size() << " prims, " << jobs.size() << " faces, " << num_vertices
+		<< " vertices in " << buffers.size() << " buffers" << std::endl;
+
+	// serial, as genDrawInfo does without RenderParallelGeometry
+	LLTimer timer;
+	for (S32 i = 0; i < iterations; i++)
+	{
+		for (const FaceJob& job : jobs)
+		{
+			generate_face(job, buffers);
+		}
+	}
+	F64 serial = timer.getElapsedTimeF64();
+	std::vector<StagingBuffer> serial_buffers = buffers;
+
+	for (StagingBuffer& buffer : buffers)
+	{
+		LLVector4a zero;
+		zero.clear();
+		std::fill(buffer.mPositions.begin(), buffer.mPositions.end(), zero);
+		std::fill(buffer.mNormals.begin(), buffer.mNormals.end(), zero);
+		std::fill(buffer.mTangents.begin(), buffer.mTangents.end(), zero);
+		std::fill(buffer.mTexCoords.begin(), buffer.mTexCoords.end(), zero);
+		std::fill(buffer.mColors.begin(), buffer.mColors.end(), zero);
+		std::fill(buffer.mIndices.begin(), buffer.mIndices.end(), 0);
+	}
+
+	LL::ThreadPool pool(LL::JOB_POOL_NAME, threads);
+	pool.start();
+
+	timer.reset();
+	for (S32 i = 0; i < iterations; i++)
+	{
+		LL::parallel_for(jobs.size(), GEOMETRY_JOB_GRAIN, [&jobs, &buffers](size_t begin, size_t end)
+			{
+				for (size_t j = begin; j < end; ++j)
+				{
+					generate_face(jobs[j], buffers);
+				}
+			});
+	}
+	F64 parallel = timer.getElapsedTimeF64();
+
+	pool.close();
+
+	std::cout << "serial " << serial * 1000.0 / iterations << " ms"
+		<< "  parallel (" << threads << " helpers) " << parallel * 1000.0 / iterations << " ms"
+		<< "  speedup " << (parallel > 0.0 ? serial / parallel : 0.0) << "x" << std::endl;
+
+	if (!same_buffers(serial_buffers, buffers))
+	{
+		std::cout << "ERROR: parallel generation wrote different vertex data" << std::endl;
+		return 1;
+	}
+
+	return 0;
+}
@@ -207,7 +207,9 @@ BOOL LLVorbisDecodeState::initDecode()
 	LL_DEBUGS("AudioEngine") << "Initing decode from vfile: " << mUUID << LL_ENDL;
 
 	mInFilep = new LLFileSystem(mUUID, LLAssetType::AT_SOUND);
-	if (!mInFilep || !mInFilep->getSize())
+	// Map the sound once up front so the vorbis read/seek callbacks are
+	// served from memory instead of reopening the cache file per chunk.
+	if (!mInFilep || mInFilep->getMappedData().empty() || !mInFilep->getSize())
 	{
 		LL_WARNS("AudioEngine") << "unable to open vorbis source vfile for reading" << LL_ENDL;
 		delete mInFilep;
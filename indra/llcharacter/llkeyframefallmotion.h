@@ -63,6 +63,7 @@ class LLKeyframeFallMotion final :
 	virtual BOOL onActivate();
 	virtual F32 getEaseInDuration();
 	virtual BOOL onUpdate(F32 activeTime, U8* joint_mask);
+	virtual BOOL canDeferPose() { return FALSE; }
 
 protected:
 	//-------------------------------------------------------------------------
@@ -121,6 +121,11 @@ U32 LLKeyframeMotion::JointMotionList::dumpDiagInfo()
 	return total_size;
 }
 
+void LLKeyframeMotion::JointMotionList::compileCurves()
+{
+	mCompiledCurves = std::make_unique<CompiledCurves>(*this);
+}
+
 //-----------------------------------------------------------------------------
 //-----------------------------------------------------------------------------
 // JointMotion class
@@ -167,6 +172,274 @@ void LLKeyframeMotion::JointMotion::update(LLJointState* joint_state, F32 time,
 }
 
 
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+// CompiledCurves class
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+
+namespace
+{
+	void load_key_value(LLVector4a& dst, const LLQuaternion& value)
+	{
+		dst.loadua(value.mQ);
+	}
+
+	void load_key_value(LLVector4a& dst, const LLVector3& value)
+	{
+		dst.load3(value.mV);
+	}
+
+	inline LLQuad select_quad(const LLQuad& mask, const LLQuad& if_true, const LLQuad& if_false)
+	{
+		return _mm_or_ps(_mm_and_ps(mask, if_true), _mm_andnot_ps(mask, if_false));
+	}
+}
+
+//-----------------------------------------------------------------------------
+// CompiledCurves()
+//-----------------------------------------------------------------------------
+LLKeyframeMotion::CompiledCurves::CompiledCurves(const JointMotionList& list)
+	: mNumRotChannels(0),
+	  mNumPosChannels(0)
+{
+	const U32 num_joints = list.getNumJointMotions();
+	for (U32 i = 0; i < num_joints; i++)
+	{
+		addChannel(i, list.getJointMotion(i)->mRotationCurve);
+	}
+	mNumRotChannels = (U32)mChannels.size();
+
+	for (U32 i = 0; i < num_joints; i++)
+	{
+		addChannel(i, list.getJointMotion(i)->mPositionCurve);
+	}
+	mNumPosChannels = (U32)mChannels.size() - mNumRotChannels;
+
+	for (U32 i = 0; i < num_joints; i++)
+	{
+		addChannel(i, list.getJointMotion(i)->mScaleCurve);
+	}
+}
+
+//-----------------------------------------------------------------------------
+// addChannel()
+//-----------------------------------------------------------------------------
+template<typename T>
+void LLKeyframeMotion::CompiledCurves::addChannel(U32 joint, const Curve<T>& curve)
+{
+	// JointMotion::update() leaves curves without keys alone
+	if (!curve.mNumKeys)
+	{
+		return;
+	}
+
+	Channel channel;
+	channel.mJoint = joint;
+	channel.mFirstKey = (U32)mTimes.size();
+	channel.mStep = curve.mInterpolationType == IT_STEP;
+
+	if (curve.mKeys.empty())
+	{
+		// Curve::getValue() falls back to a default value
+		mTimes.push_back(0.f);
+		mValues.emplace_back();
+		load_key_value(mValues.back(), T());
+	}
+
+	for (const auto& key : curve.mKeys)
+	{
+		// Curve::getValue() searches on the sorted vector's keys, not Key::mTime
+		mTimes.push_back(key.first);
+		mValues.emplace_back();
+		load_key_value(mValues.back(), key.second.mValue);
+	}
+
+	channel.mNumKeys = (U32)mTimes.size() - channel.mFirstKey;
+	mChannels.push_back(channel);
+}
+
+//-----------------------------------------------------------------------------
+// findKeys()
+// Finds the keys to interpolate at time and the weight of the later one,
+// same as Curve::getValue() does. On a key, before the first key or past the
+// last one, both keys are the same and the weight is 0.
+//-----------------------------------------------------------------------------
+void LLKeyframeMotion::CompiledCurves::findKeys(const Channel& channel, F32 time, U32& cursor, U32& before, U32& after, F32& u) const
+{
+	const F32* times = &mTimes[channel.mFirstKey];
+	const U32 last = channel.mNumKeys - 1;
+
+	U32 key = llmin(cursor, last);
+	if (times[key] > time)
+	{
+		// looped or jumped back
+		key = (U32)(std::upper_bound(times, times + key, time) - times);
+		key = key ? key - 1 : 0;
+	}
+	else
+	{
+		// playing forward moves a key or two per frame, search on bigger jumps
+		for (U32 steps = 0; key < last && times[key + 1] <= time; ++steps)
+		{
+			if (steps == 4)
+			{
+				key = (U32)(std::upper_bound(times + key, times + last + 1, time) - times) - 1;
+				break;
+			}
+			++key;
+		}
+	}
+	cursor = key;
+
+	before = channel.mFirstKey + key;
+	if (key == last || times[key] >= time || channel.mStep)
+	{
+		after = before;
+		u = 0.f;
+	}
+	else
+	{
+		after = before + 1;
+		u = (time - times[key]) / (times[key + 1] - times[key]);
+	}
+}
+
+//-----------------------------------------------------------------------------
+// evaluate()
+//-----------------------------------------------------------------------------
+void LLKeyframeMotion::CompiledCurves::evaluate(const LLPointer<LLJointState>* joint_states, F32 time, U32* cursors) const
+{
+	const LLQuad zero = _mm_setzero_ps();
+	const LLQuad one = _mm_set1_ps(1.f);
+	const LLQuad abs_mask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+	const LLQuad mag_threshold = _mm_set1_ps(FP_MAG_THRESHOLD);
+	const LLQuad unit_threshold = _mm_set1_ps(ONE_PART_IN_A_MILLION);
+
+	// Rotations four channels at a time, transposed to one register per
+	// component and interpolated the way nlerp() and LLQuaternion::normalize()
+	// do it, so results match the curves exactly
+	for (U32 first = 0; first < mNumRotChannels; first += 4)
+	{
+		const U32 count = llmin(mNumRotChannels - first, (U32)4);
+
+		U32 before[4];
+		U32 after[4];
+		LL_ALIGN_16(F32 weights[4]);
+		LLQuad b[4];
+		LLQuad a[4];
+		for (U32 i = 0; i < 4; i++)
+		{
+			if (i < count)
+			{
+				const U32 c = first + i;
+				findKeys(mChannels[c], time, cursors[c], before[i], after[i], weights[i]);
+			}
+			else
+			{
+				// pad with the last channel
+				before[i] = before[count - 1];
+				after[i] = after[count - 1];
+				weights[i] = weights[count - 1];
+			}
+			b[i] = mValues[before[i]];
+			a[i] = mValues[after[i]];
+		}
+
+		_MM_TRANSPOSE4_PS(b[0], b[1], b[2], b[3]);
+		_MM_TRANSPOSE4_PS(a[0], a[1], a[2], a[3]);
+
+		const LLQuad t = _mm_load_ps(weights);
+		const LLQuad inv_t = _mm_sub_ps(one, t);
+		LLQuad r[4];
+		LLQuad dot = zero;
+		LLQuad mag = zero;
+		for (U32 c = 0; c < 4; c++)
+		{
+			r[c] = _mm_add_ps(_mm_mul_ps(t, a[c]), _mm_mul_ps(inv_t, b[c]));
+			dot = _mm_add_ps(dot, _mm_mul_ps(b[c], a[c]));
+			mag = _mm_add_ps(mag, _mm_mul_ps(r[c], r[c]));
+		}
+		mag = _mm_sqrt_ps(mag);
+
+		// rescale unless already within a millionth of unit length,
+		// degenerate results become the identity
+		const LLQuad valid = _mm_cmpgt_ps(mag, mag_threshold);
+		const LLQuad rescale = _mm_and_ps(valid, _mm_cmpgt_ps(_mm_and_ps(_mm_sub_ps(one, mag), abs_mask), unit_threshold));
+		const LLQuad oomag = _mm_div_ps(one, mag);
+		const LLQuad on_key = _mm_cmpeq_ps(t, zero);
+		for (U32 c = 0; c < 4; c++)
+		{
+			LLQuad q = select_quad(rescale, _mm_mul_ps(r[c], oomag), r[c]);
+			q = select_quad(valid, q, c == VW ? one : zero);
+			r[c] = select_quad(on_key, b[c], q);
+		}
+
+		_MM_TRANSPOSE4_PS(r[0], r[1], r[2], r[3]);
+
+		// keys in opposite hemispheres go through slerp() in nlerp(),
+		// rare enough to leave to the scalar code
+		const S32 slerp_lanes = _mm_movemask_ps(_mm_andnot_ps(on_key, _mm_cmplt_ps(dot, zero)));
+
+		for (U32 i = 0; i < count; i++)
+		{
+			LLJointState* joint_state = joint_states[mChannels[first + i].mJoint];
+			if (!joint_state || !(joint_state->getUsage() & LLJointState::ROT))
+			{
+				continue;
+			}
+
+			LLQuaternion rot;
+			if (slerp_lanes & (1 << i))
+			{
+				LLQuaternion rot_before;
+				LLQuaternion rot_after;
+				_mm_storeu_ps(rot_before.mQ, mValues[before[i]]);
+				_mm_storeu_ps(rot_after.mQ, mValues[after[i]]);
+				rot = nlerp(weights[i], rot_before, rot_after);
+			}
+			else
+			{
+				_mm_storeu_ps(rot.mQ, r[i]);
+			}
+			joint_state->setRotation(rot);
+		}
+	}
+
+	// positions and scales, one channel per register
+	const U32 num_channels = (U32)mChannels.size();
+	for (U32 c = mNumRotChannels; c < num_channels; c++)
+	{
+		const Channel& channel = mChannels[c];
+		const U32 usage = c < mNumRotChannels + mNumPosChannels ? LLJointState::POS : LLJointState::SCALE;
+		LLJointState* joint_state = joint_states[channel.mJoint];
+		if (!joint_state || !(joint_state->getUsage() & usage))
+		{
+			continue;
+		}
+
+		U32 before;
+		U32 after;
+		F32 u;
+		findKeys(channel, time, cursors[c], before, after, u);
+
+		LLVector4a value;
+		value.setSub(mValues[after], mValues[before]);
+		value.mul(u);
+		value.add(mValues[before]);
+
+		if (usage == LLJointState::POS)
+		{
+			joint_state->setPosition(LLVector3(value.getF32ptr()));
+		}
+		else
+		{
+			joint_state->setScale(LLVector3(value.getF32ptr()));
+		}
+	}
+}
+
+
 //-----------------------------------------------------------------------------
 //-----------------------------------------------------------------------------
 // LLKeyframeMotion class
@@ -185,6 +458,7 @@ LLKeyframeMotion::LLKeyframeMotion(const LLUUID &id)
 		mLastSkeletonSerialNum(0),
 		mLastUpdateTime(0.f),
 		mLastLoopedTime(0.f),
+		mDeferredUpdateTime(0.f),
 		mAssetStatus(ASSET_UNDEFINED)
 {
 
@@ -436,6 +710,81 @@ BOOL LLKeyframeMotion::onUpdate(F32 time, U8* joint_mask)
 	// llassert(time >= 0.f);		// This will fire
 	time = llmax(0.f, time);
 
+	BOOL result = updateLoopedTime(time);
+
+	applyKeyframes(mLastLoopedTime);
+
+	applyHandPose();
+
+	applyConstraints(mLastLoopedTime, joint_mask);
+
+	mLastUpdateTime = time;
+
+	return result;
+}
+
+//-----------------------------------------------------------------------------
+// LLKeyframeMotion::canDeferPose()
+// Ground constraints look up the ground through the agent and the world,
+// which belong to the main thread, so motions with any stay there.
+//-----------------------------------------------------------------------------
+BOOL LLKeyframeMotion::canDeferPose()
+{
+	for (JointConstraint* constraintp : mConstraints)
+	{
+		if (constraintp->mSharedData->mConstraintTargetType == CONSTRAINT_TARGET_TYPE_GROUND)
+		{
+			return FALSE;
+		}
+	}
+	return TRUE;
+}
+
+//-----------------------------------------------------------------------------
+// LLKeyframeMotion::onDeferredUpdate()
+// Same as onUpdate() minus the joint states, which evaluateDeferredPose()
+// fills in. The hand pose is still set here as LLHandMotion reads it later
+// in the same update.
+//-----------------------------------------------------------------------------
+BOOL LLKeyframeMotion::onDeferredUpdate(F32 time, U8* joint_mask)
+{
+	time = llmax(0.f, time);
+
+	BOOL result = updateLoopedTime(time);
+
+	applyHandPose();
+
+	mDeferredUpdateTime = time;
+	if (!mConstraints.empty())
+	{
+		// joint_mask lives on the caller's stack
+		memcpy(mDeferredJointMask, joint_mask, sizeof(mDeferredJointMask));
+	}
+
+	return result;
+}
+
+//-----------------------------------------------------------------------------
+// LLKeyframeMotion::evaluateDeferredPose()
+// Only touches this motion's joint states and its character's skeleton,
+// see canDeferPose().
+//-----------------------------------------------------------------------------
+void LLKeyframeMotion::evaluateDeferredPose()
+{
+    LL_PROFILE_ZONE_SCOPED_CATEGORY_AVATAR;
+	applyKeyframes(mLastLoopedTime);
+
+	applyConstraints(mLastLoopedTime, mDeferredJointMask);
+
+	mLastUpdateTime = mDeferredUpdateTime;
+}
+
+//-----------------------------------------------------------------------------
+// updateLoopedTime()
+// Advances mLastLoopedTime; time is reset for zero length looped motions.
+//-----------------------------------------------------------------------------
+BOOL LLKeyframeMotion::updateLoopedTime(F32& time)
+{
 	if (mJointMotionList->mLoop)
 	{
 		if (mJointMotionList->mDuration == 0.0f)
@@ -470,12 +819,6 @@ BOOL LLKeyframeMotion::onUpdate(F32 time, U8* joint_mask)
 		mLastLoopedTime = time;
 	}
 
-	applyKeyframes(mLastLoopedTime);
-
-	applyConstraints(mLastLoopedTime, joint_mask);
-
-	mLastUpdateTime = time;
-
 	return mLastLoopedTime <= mJointMotionList->mDuration;
 }
 
@@ -485,13 +828,29 @@ BOOL LLKeyframeMotion::onUpdate(F32 time, U8* joint_mask)
 void LLKeyframeMotion::applyKeyframes(F32 time)
 {
 	llassert_always (mJointMotionList->getNumJointMotions() <= mJointStates.size());
+	if (const CompiledCurves* curves = mJointMotionList->mCompiledCurves.get())
+	{
+		if (mCurveCursors.size() != curves->getNumChannels())
+		{
+			mCurveCursors.assign(curves->getNumChannels(), 0);
+		}
+		curves->evaluate(mJointStates.data(), time, mCurveCursors.data());
+		return;
+	}
+
 	for (U32 i=0; i<mJointMotionList->getNumJointMotions(); i++)
 	{
 		mJointMotionList->getJointMotion(i)->update(mJointStates[i],
 													  time, 
 													  mJointMotionList->mDuration );
 	}
+}
 
+//-----------------------------------------------------------------------------
+// applyHandPose()
+//-----------------------------------------------------------------------------
+void LLKeyframeMotion::applyHandPose()
+{
 	LLJoint::JointPriority* pose_priority = (LLJoint::JointPriority* )mCharacter->getAnimationData("Hand Pose Priority");
 	if (pose_priority)
 	{
@@ -784,14 +1143,16 @@ void LLKeyframeMotion::applyConstraint(JointConstraint* constraint, F32 time, U8
 		target_pos = keyframe_source_pos + (norm * ((target_pos - keyframe_source_pos) * norm));
 	}
 
+	// Uncached, as filling the shared interpolant cache is not thread safe
+	// and this can run on a worker, see evaluateDeferredPose()
 	if (constraint->mSharedData->mChainLength != 0 &&
 		dist_vec_squared(root_pos, target_pos) * 0.95f > constraint->mTotalLength * constraint->mTotalLength)
 	{
-		constraint->mWeight = LLSmoothInterpolation::lerp(constraint->mWeight, 0.f, 0.1f);
+		constraint->mWeight = LLSmoothInterpolation::lerp(constraint->mWeight, 0.f, 0.1f, false);
 	}
 	else
 	{
-		constraint->mWeight = LLSmoothInterpolation::lerp(constraint->mWeight, 1.f, 0.3f);
+		constraint->mWeight = LLSmoothInterpolation::lerp(constraint->mWeight, 1.f, 0.3f, false);
 	}
 
 	F32 weight = constraint->mWeight * ((shared_data->mEaseOutStopTime == 0.f) ? 1.f : 
@@ -2138,14 +2499,25 @@ void LLKeyframeMotion::onLoadComplete(const LLUUID& asset_uuid,
 				return;
 			}
 			LLFileSystem file(asset_uuid, type, LLFileSystem::READ);
-			S32 size = file.getSize();
-			
-			U8* buffer = new U8[size];
-			file.read((U8*)buffer, size);	/*Flawfinder: ignore*/
+
+			// Deserialize straight from the mapped cache file when possible.
+			// The packer is only ever read from, so handing it the read-only
+			// mapping is safe.
+			std::unique_ptr<U8[]> buffer;
+			std::span<const U8> mapped = file.getMappedData();
+			U8* data = const_cast<U8*>(mapped.data());
+			S32 size = (S32)mapped.size();
+			if (!data)
+			{
+				size = file.getSize();
+				buffer.reset(new U8[size]);
+				file.read(buffer.get(), size);	/*Flawfinder: ignore*/
+				data = buffer.get();
+			}
 
 			LL_DEBUGS("Animation") << "Loading keyframe data for: " << motionp->getName() << ":" << motionp->getID() << " (" << size << " bytes)" << LL_ENDL;
 			
-			LLDataPackerBinaryBuffer dp(buffer, size);
+			LLDataPackerBinaryBuffer dp(data, size);
 			if (motionp->deserialize(dp, asset_uuid))
 			{
 				motionp->mAssetStatus = ASSET_LOADED;
@@ -2155,8 +2527,6 @@ void LLKeyframeMotion::onLoadComplete(const LLUUID& asset_uuid,
 				LL_WARNS() << "Failed to decode asset for animation " << motionp->getName() << ":" << motionp->getID() << LL_ENDL;
 				motionp->mAssetStatus = ASSET_FETCH_FAILED;
 			}
-			
-			delete[] buffer;
 		}
 		else
 		{
@@ -2211,6 +2581,10 @@ void LLKeyframeDataCache::dumpDiagInfo()
 //--------------------------------------------------------------------
 void LLKeyframeDataCache::addKeyframeData(const LLUUID& id, LLKeyframeMotion::JointMotionList* joint_motion_listp)
 {
+	if (joint_motion_listp && !joint_motion_listp->mCompiledCurves)
+	{
+		joint_motion_listp->compileCurves();
+	}
 	sKeyframeDataMap[id] = joint_motion_listp;
 }
 
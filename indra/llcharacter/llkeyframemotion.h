@@ -31,6 +31,7 @@
 // Header files
 //-----------------------------------------------------------------------------
 
+#include <memory>
 #include <string>
 
 #include "llassetstorage.h"
@@ -39,6 +40,7 @@
 #include "lljointstate.h"
 #include "llmotion.h"
 #include "llquaternion.h"
+#include "llvector4a.h"
 #include "v3dmath.h"
 #include "v3math.h"
 #include "llbvhconsts.h"
@@ -163,6 +165,11 @@ class LLKeyframeMotion :
 	// must return FALSE when the motion is completed.
 	virtual BOOL onUpdate(F32 time, U8* joint_mask);
 
+	// subclasses that override onUpdate() must return FALSE here
+	virtual BOOL canDeferPose();
+	virtual BOOL onDeferredUpdate(F32 time, U8* joint_mask);
+	virtual void evaluateDeferredPose();
+
 	// called when a motion is deactivated
 	virtual void onDeactivate();
 
@@ -278,8 +285,12 @@ class LLKeyframeMotion :
 		F32							mFixupDistanceRMS;
 	};
 
+	BOOL updateLoopedTime(F32& time);
+
 	void applyKeyframes(F32 time);
 
+	void applyHandPose();
+
 	void applyConstraints(F32 time, U8* joint_mask);
 
 	void activateConstraint(JointConstraint* constraintp);
@@ -391,7 +402,50 @@ class LLKeyframeMotion :
 
 		void update(LLJointState* joint_state, F32 time, F32 duration);
 	};
-	
+
+	class JointMotionList;
+
+	//-------------------------------------------------------------------------
+	// CompiledCurves
+	// Every curve of a JointMotionList flattened into one array of key times
+	// and one of packed key values, evaluated for all joints in one pass.
+	// Playback keeps a key cursor per channel so finding the keys around the
+	// current time is usually a step or two instead of a search.
+	//-------------------------------------------------------------------------
+	class CompiledCurves
+	{
+	public:
+		CompiledCurves(const JointMotionList& list);
+
+		// Sets the joint states to the value of every curve at time, same as
+		// JointMotion::update() on each joint. cursors holds getNumChannels()
+		// key indices that only speed up the search, any values are valid.
+		void evaluate(const LLPointer<LLJointState>* joint_states, F32 time, U32* cursors) const;
+
+		U32 getNumChannels() const { return (U32)mChannels.size(); }
+
+	private:
+		struct Channel
+		{
+			U32		mJoint;		// index into the joint motion and joint state arrays
+			U32		mFirstKey;	// index into mTimes and mValues
+			U32		mNumKeys;
+			BOOL	mStep;
+		};
+
+		template<typename T>
+		void addChannel(U32 joint, const Curve<T>& curve);
+
+		void findKeys(const Channel& channel, F32 time, U32& cursor, U32& before, U32& after, F32& u) const;
+
+		// rotation channels first, then positions, then scales
+		std::vector<Channel>	mChannels;
+		U32						mNumRotChannels;
+		U32						mNumPosChannels;
+		std::vector<F32>		mTimes;
+		std::vector<LLVector4a>	mValues;
+	};
+
 	//-------------------------------------------------------------------------
 	// JointMotionList
 	//-------------------------------------------------------------------------
@@ -414,11 +468,16 @@ class LLKeyframeMotion :
 		// mEmoteName is a facial motion, but it's necessary to appear here so that it's cached.
 		// TODO: LLKeyframeDataCache::getKeyframeData should probably return a class containing 
 		// JointMotionList and mEmoteName, see LLKeyframeMotion::onInitialize.
-		std::string				mEmoteName; 
+		std::string				mEmoteName;
+		std::unique_ptr<CompiledCurves>	mCompiledCurves;
 	public:
 		JointMotionList();
 		~JointMotionList();
 		U32 dumpDiagInfo();
+		// flattens the curves for playback, curves edited in place afterwards
+		// must be recompiled or released
+		void compileCurves();
+		void releaseCompiledCurves() { mCompiledCurves.reset(); }
 		JointMotion* getJointMotion(U32 index) const { llassert(index < mJointMotionArray.size()); return mJointMotionArray[index]; }
 		U32 getNumJointMotions() const { return mJointMotionArray.size(); }
 	};
@@ -433,6 +492,9 @@ class LLKeyframeMotion :
 	U32								mLastSkeletonSerialNum;
 	F32								mLastUpdateTime;
 	F32								mLastLoopedTime;
+	F32								mDeferredUpdateTime;
+	U8								mDeferredJointMask[LL_CHARACTER_MAX_ANIMATED_JOINTS];
+	std::vector<U32>				mCurveCursors;
 	AssetStatus						mAssetStatus;
 
 public:
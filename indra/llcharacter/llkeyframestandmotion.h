@@ -66,6 +66,7 @@ class LLKeyframeStandMotion final :
 	virtual BOOL onActivate();
 	void	onDeactivate();
 	virtual BOOL onUpdate(F32 time, U8* joint_mask);
+	virtual BOOL canDeferPose() { return FALSE; }
 
 public:
 	//-------------------------------------------------------------------------
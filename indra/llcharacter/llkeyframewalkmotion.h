@@ -68,6 +68,7 @@ class LLKeyframeWalkMotion final :
 	virtual BOOL onActivate();
 	virtual void onDeactivate();
 	virtual BOOL onUpdate(F32 time, U8* joint_mask);
+	virtual BOOL canDeferPose() { return FALSE; }
 
 public:
 	//-------------------------------------------------------------------------
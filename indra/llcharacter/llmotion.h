@@ -156,6 +156,15 @@ class LLMotion
 	// must return FALSE when the motion is completed.
 	virtual BOOL onUpdate(F32 activeTime, U8* joint_mask) = 0;
 
+	// Motions whose pose only depends on their own joint states and the
+	// character's skeleton can split onUpdate() in two:
+	// onDeferredUpdate() does the timing and returns what onUpdate() would,
+	// evaluateDeferredPose() fills in the joint states later, possibly on
+	// a worker thread. Used by the motion controller when pose deferral is on.
+	virtual BOOL canDeferPose() { return FALSE; }
+	virtual BOOL onDeferredUpdate(F32 activeTime, U8* joint_mask) { return onUpdate(activeTime, joint_mask); }
+	virtual void evaluateDeferredPose() {}
+
 	// called when a motion is deactivated
 	virtual void onDeactivate() = 0;
 
@@ -130,6 +130,8 @@ LLMotionController::LLMotionController()
 	  mTimeStepCount(0),
 	  mLastInterp(0.f),
 	  mIsSelf(FALSE),
+	  mDeferPose(false),
+	  mPoseDeferred(false),
 	  mLastCountAfterPurge(0)
 {
 }
@@ -158,6 +160,7 @@ void LLMotionController::incMotionCounts(S32& num_motions, S32& num_loading_moti
 //-----------------------------------------------------------------------------
 void LLMotionController::deleteAllMotions()
 {
+	mDeferredPoseMotions.clear();
 	mLoadingMotions.clear();
 	mLoadedMotions.clear();
 	mActiveMotions.clear();
@@ -326,6 +329,7 @@ void LLMotionController::removeMotionInstance(LLMotion* motionp)
 		mLoadingMotions.erase(motionp);
 		mLoadedMotions.erase(motionp);
 		mActiveMotions.remove(motionp);
+		std::erase(mDeferredPoseMotions, motionp);
 		delete motionp;
 	}
 }
@@ -651,7 +655,7 @@ void LLMotionController::updateMotionsByType(LLMotion::LLMotionBlendType anim_ty
 				// if not, let's stop it this time through and deactivate it the next
 
 				posep->setWeight(motionp->getFadeWeight());
-				motionp->onUpdate(motionp->getStopTime() - motionp->mActivationTimestamp, last_joint_signature);
+				updateMotion(motionp, motionp->getStopTime() - motionp->mActivationTimestamp, last_joint_signature);
 			}
 			else
 			{
@@ -683,7 +687,7 @@ void LLMotionController::updateMotionsByType(LLMotion::LLMotionBlendType anim_ty
 			}
 
 			// perform motion update
-			update_result = motionp->onUpdate(mAnimTime - motionp->mActivationTimestamp, last_joint_signature);
+			update_result = updateMotion(motionp, mAnimTime - motionp->mActivationTimestamp, last_joint_signature);
 		}
 
 		//**********************
@@ -707,7 +711,7 @@ void LLMotionController::updateMotionsByType(LLMotion::LLMotionBlendType anim_ty
 
 			// perform motion update
 			{
-				update_result = motionp->onUpdate(mAnimTime - motionp->mActivationTimestamp, last_joint_signature);
+				update_result = updateMotion(motionp, mAnimTime - motionp->mActivationTimestamp, last_joint_signature);
 			}
 		}
 
@@ -730,12 +734,12 @@ void LLMotionController::updateMotionsByType(LLMotion::LLMotionBlendType anim_ty
 				posep->setWeight(motionp->getFadeWeight() * motionp->mResidualWeight + (1.f - motionp->mResidualWeight) * cubic_step((mAnimTime - motionp->mActivationTimestamp) / motionp->getEaseInDuration()));
 			}
 			// perform motion update
-			update_result = motionp->onUpdate(mAnimTime - motionp->mActivationTimestamp, last_joint_signature);
+			update_result = updateMotion(motionp, mAnimTime - motionp->mActivationTimestamp, last_joint_signature);
 		}
 		else
 		{
 			posep->setWeight(0.f);
-			update_result = motionp->onUpdate(0.f, last_joint_signature);
+			update_result = updateMotion(motionp, 0.f, last_joint_signature);
 		}
 		
 		// allow motions to deactivate themselves 
@@ -757,6 +761,38 @@ void LLMotionController::updateMotionsByType(LLMotion::LLMotionBlendType anim_ty
 	}
 }
 
+//-----------------------------------------------------------------------------
+// updateMotion()
+// onUpdate() for a single motion, leaving its pose for applyDeferredPose()
+// when deferral is on and the motion supports it
+//-----------------------------------------------------------------------------
+BOOL LLMotionController::updateMotion(LLMotion* motionp, F32 time, U8* joint_mask)
+{
+	if (mPoseDeferred && motionp->canDeferPose())
+	{
+		mDeferredPoseMotions.push_back(motionp);
+		return motionp->onDeferredUpdate(time, joint_mask);
+	}
+	return motionp->onUpdate(time, joint_mask);
+}
+
+//-----------------------------------------------------------------------------
+// applyDeferredPose()
+//-----------------------------------------------------------------------------
+void LLMotionController::applyDeferredPose()
+{
+    LL_PROFILE_ZONE_SCOPED_CATEGORY_AVATAR;
+	// same order onUpdate() would have run them in
+	for (LLMotion* motionp : mDeferredPoseMotions)
+	{
+		motionp->evaluateDeferredPose();
+	}
+	mDeferredPoseMotions.clear();
+
+	mPoseBlender.blendAndApply();
+	mPoseDeferred = false;
+}
+
 //-----------------------------------------------------------------------------
 // updateLoadingMotions()
 //-----------------------------------------------------------------------------
@@ -823,6 +859,12 @@ void LLMotionController::updateMotions(bool force_update)
 	mPrevTimerElapsed = cur_time;
 	mLastTime = mAnimTime;
 
+	// nobody picked up last frame's pose
+	if (mPoseDeferred)
+	{
+		applyDeferredPose();
+	}
+
 	// Always cap the number of loaded motions
 	purgeExcessMotions();
 		
@@ -876,6 +918,8 @@ void LLMotionController::updateMotions(bool force_update)
 	}
 	else
 	{
+		mPoseDeferred = mDeferPose && !use_quantum;
+
 		// update additive motions
 		updateAdditiveMotions();
 				
@@ -888,7 +932,7 @@ void LLMotionController::updateMotions(bool force_update)
 		{
 			mPoseBlender.blendAndCache(TRUE);
 		}
-		else
+		else if (!mPoseDeferred)
 		{
 			mPoseBlender.blendAndApply();
 		}
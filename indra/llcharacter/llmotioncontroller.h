@@ -33,6 +33,7 @@
 #include <string>
 #include <map>
 #include <deque>
+#include <vector>
 
 #include "llmotion.h"
 #include "llpose.h"
@@ -139,6 +140,15 @@ class LLMotionController
 	// minimal update (e.g. while hidden)
 	void updateMotionsMinimal();
 
+	// When set, updateMotions() leaves keyframe evaluation and the pose
+	// blend to applyDeferredPose(), which only touches this controller's
+	// motions and its character's skeleton and so can run on a worker.
+	// Must be called before the next updateMotions(), which otherwise
+	// applies the pending pose itself.
+	void setDeferPose(bool defer) { mDeferPose = defer; }
+	bool hasDeferredPose() const { return mPoseDeferred; }
+	void applyDeferredPose();
+
 	void clearBlenders() { mPoseBlender.clearBlenders(); }
 
 	// flush motions
@@ -191,6 +201,7 @@ class LLMotionController
 	void updateAdditiveMotions();
 	void resetJointSignatures();
 	void updateMotionsByType(LLMotion::LLMotionBlendType motion_type);
+	BOOL updateMotion(LLMotion* motionp, F32 time, U8* joint_mask);
 	void updateIdleMotion(LLMotion* motionp);
 	void updateIdleActiveMotions();
 	void purgeExcessMotions();
@@ -232,6 +243,10 @@ class LLMotionController
 	F32					mLastInterp;
 
 	U8					mJointSignature[2][LL_CHARACTER_MAX_ANIMATED_JOINTS];
+
+	bool				mDeferPose;
+	bool				mPoseDeferred;
+	std::vector<LLMotion*>	mDeferredPoseMotions;
 private:
 	U32					mLastCountAfterPurge; //for logging and debugging purposes
 };
@@ -2262,98 +2262,104 @@ LLUZipHelper::EZipRresult LLUZipHelper::unzip_llsd(LLSD& data, std::istream& is,
 
 LLUZipHelper::EZipRresult LLUZipHelper::unzip_llsd(LLSD& data, const U8* in, S32 size)
 {
-	U8* result = NULL;
-	llssize cur_size = 0;
-	z_stream strm;
-
-	constexpr llssize CHUNK = (1024 * 1024) * 10;
-
-	static thread_local std::vector<U8, boost::alignment::aligned_allocator<U8, 16>> out;
-	if (out.empty())
+	static thread_local std::vector<U8> result;
+	EZipRresult ret = unzip(result, in, size);
+	if (ret == ZR_OK)
 	{
-		out.resize(CHUNK);
-	}
+		//result now holds the decompressed LLSD block
+		llssize cur_size = result.size();
+		char* result_ptr = strip_deprecated_header((char*)result.data(), cur_size);
+
+		boost::iostreams::stream<boost::iostreams::array_source> istrm(result_ptr, cur_size);
 		
+		if (!LLSDSerialize::fromBinary(data, istrm, cur_size, UNZIP_LLSD_MAX_DEPTH))
+		{
+			ret = ZR_PARSE_ERROR;
+		}
+	}
+
+	releaseOversized(result);
+	return ret;
+}
+
+LLUZipHelper::EZipRresult LLUZipHelper::unzip(std::vector<U8>& data, const U8* in, S32 size, size_t max_size)
+{
+	constexpr size_t MIN_CHUNK = 64 * 1024;
+
+	z_stream strm;
 	strm.zalloc = Z_NULL;
 	strm.zfree = Z_NULL;
 	strm.opaque = Z_NULL;
 	strm.avail_in = size;
 	strm.next_in = const_cast<U8*>(in);
 
-	S32 ret = inflateInit2(&strm, MAX_WBITS);
-	do
+	if (inflateInit2(&strm, MAX_WBITS) != Z_OK)
 	{
-		strm.avail_out = CHUNK;
-		strm.next_out = out.data();
-		ret = inflate(&strm, Z_NO_FLUSH);
-		switch (ret)
-		{
-		case Z_NEED_DICT:
-		case Z_DATA_ERROR:
-		{
-			inflateEnd(&strm);
-			free(result);
-			return ZR_DATA_ERROR;
-		}
-		case Z_STREAM_ERROR:
-		{
-			inflateEnd(&strm);
-			free(result);
-			return ZR_BUFFER_ERROR;
-		}
-
-		case Z_MEM_ERROR:
-		{
-			inflateEnd(&strm);
-			free(result);
-			return ZR_MEM_ERROR;
-		}
-		}
+		return ZR_MEM_ERROR;
+	}
 
-		llssize have = CHUNK-strm.avail_out;
-		if (have > 0)
+	size_t have = 0;
+	S32 ret = Z_OK;
+	bool too_big = false;
+	try
+	{
+		data.resize(std::min(std::max(data.capacity(), std::max((size_t)size * 4, MIN_CHUNK)), max_size));
+		do
 		{
-			U8* new_result = (U8*)realloc(result, cur_size + have);
-			if (new_result == NULL)
+			if (have == data.size())
 			{
-				inflateEnd(&strm);
-				if (result)
+				if (have >= max_size)
 				{
-					free(result);
+					too_big = true;
+					break;
 				}
-				return ZR_MEM_ERROR;
+				data.resize(std::min(data.size() * 2, max_size));
 			}
-			result = new_result;
-			memcpy(result + cur_size, out.data(), have);
-			cur_size += have;
-		}
-
-	} while (strm.avail_out == 0 && ret != Z_STREAM_END);
+			strm.avail_out = (uInt)(data.size() - have);
+			strm.next_out = data.data() + have;
+			ret = inflate(&strm, Z_NO_FLUSH);
+			have = data.size() - strm.avail_out;
+		} while (ret == Z_OK);
+	}
+	catch (const std::bad_alloc&)
+	{
+		ret = Z_MEM_ERROR;
+	}
 
 	inflateEnd(&strm);
 
-	if (ret != Z_STREAM_END)
+	if (too_big)
 	{
-		free(result);
-		return ZR_DATA_ERROR;
+		data.clear();
+		return ZR_SIZE_ERROR;
 	}
 
-	//result now points to the decompressed LLSD block
+	switch (ret)
 	{
-		char* result_ptr = strip_deprecated_header((char*)result, cur_size);
-
-		boost::iostreams::stream<boost::iostreams::array_source> istrm(result_ptr, cur_size);
-		
-		if (!LLSDSerialize::fromBinary(data, istrm, cur_size, UNZIP_LLSD_MAX_DEPTH))
-		{
-			free(result);
-			return ZR_PARSE_ERROR;
-		}
+	case Z_STREAM_END:
+		data.resize(have);
+		return ZR_OK;
+	case Z_MEM_ERROR:
+		data.clear();
+		return ZR_MEM_ERROR;
+	case Z_STREAM_ERROR:
+		data.clear();
+		return ZR_BUFFER_ERROR;
+	default:
+		// Z_NEED_DICT, Z_DATA_ERROR or a truncated stream (Z_BUF_ERROR)
+		data.clear();
+		return ZR_DATA_ERROR;
 	}
+}
 
-	free(result);
-	return ZR_OK;
+void LLUZipHelper::releaseOversized(std::vector<U8>& data)
+{
+	if (data.capacity() > UNZIP_KEEP_SIZE)
+	{
+		std::vector<U8>().swap(data);
+	}
 }
+
 //This unzip function will only work with a gzip header and trailer - while the contents
 //of the actual compressed data is the same for either format (gzip vs zlib ), the headers
 //and trailers are different for the formats.
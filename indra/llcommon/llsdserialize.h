@@ -865,6 +865,15 @@ class LL_COMMON_API LLUZipHelper : public LLRefCount
     // return OK or reason for failure
     static EZipRresult unzip_llsd(LLSD& data, std::istream& is, S32 size);
 	static EZipRresult unzip_llsd(LLSD& data, const U8* in, S32 size);
+	// inflate a zlib block into data without parsing it, reusing the
+	// capacity data already has. Fails with ZR_SIZE_ERROR rather than
+	// inflating more than max_size bytes.
+	static constexpr size_t UNZIP_MAX_SIZE = 256 * 1024 * 1024;
+	static EZipRresult unzip(std::vector<U8>& data, const U8* in, S32 size, size_t max_size = UNZIP_MAX_SIZE);
+	// free a buffer kept around for unzip() if it has grown past
+	// UNZIP_KEEP_SIZE, so one large block doesn't pin its peak size
+	static constexpr size_t UNZIP_KEEP_SIZE = 4 * 1024 * 1024;
+	static void releaseOversized(std::vector<U8>& data);
 };
 
 //dirty little zip functions -- yell at davep
@@ -0,0 +1,99 @@
+/**
+ * @file   parallelfor.cpp
+ * @date   2024-06-03
+ * @brief  Implementation for parallelfor.
+ * 
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Copyright (c) 2024, Linden Research, Inc.
+ * $/LicenseInfo$
+ */
+
+// Precompiled header
+#include "linden_common.h"
+// associated header
+#include "parallelfor.h"
+// STL headers
+// std headers
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <thread>
+// external library headers
+// other Linden headers
+#include "threadpool.h"
+#include "workqueue.h"
+
+const char* const LL::JOB_POOL_NAME = "Jobs";
+
+namespace
+{
+    // Shared by the caller and the helpers it posted. Helpers that only
+    // get to run after the caller returned find no range left to claim,
+    // so they never touch mFunc.
+    struct ParallelFor
+    {
+        const std::function<void(size_t, size_t)>* mFunc;
+        size_t mCount;
+        size_t mGrain;
+        size_t mRanges;
+        std::atomic<size_t> mNext{ 0 };
+        std::atomic<size_t> mDone{ 0 };
+
+        void run()
+        {
+            for (size_t range = mNext++; range < mRanges; range = mNext++)
+            {
+                size_t begin = range * mGrain;
+                (*mFunc)(begin, std::min(begin + mGrain, mCount));
+                mDone.fetch_add(1, std::memory_order_release);
+            }
+        }
+    };
+} // anonymous namespace
+
+void LL::parallel_for(size_t count, size_t grain,
+                      const std::function<void(size_t, size_t)>& func)
+{
+    grain = std::max(grain, size_t(1));
+    size_t ranges = (count + grain - 1) / grain;
+    if (ranges <= 1)
+    {
+        if (count)
+        {
+            func(0, count);
+        }
+        return;
+    }
+
+    auto queue = WorkQueue::getInstance(JOB_POOL_NAME);
+    size_t helpers = queue? std::min(ranges - 1, ThreadPoolBase::getWidth(JOB_POOL_NAME, 0)) : 0;
+    if (! helpers)
+    {
+        func(0, count);
+        return;
+    }
+
+    auto state = std::make_shared<ParallelFor>();
+    state->mFunc = &func;
+    state->mCount = count;
+    state->mGrain = grain;
+    state->mRanges = ranges;
+
+    for (size_t i = 0; i < helpers; ++i)
+    {
+        if (! queue->post([state](){ state->run(); }))
+        {
+            // closed, we'll do the rest ourselves
+            break;
+        }
+    }
+
+    state->run();
+
+    // Only ranges a helper already claimed can still be running, and those
+    // are short
+    while (state->mDone.load(std::memory_order_acquire) < ranges)
+    {
+        std::this_thread::yield();
+    }
+}
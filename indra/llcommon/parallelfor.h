@@ -0,0 +1,39 @@
+/**
+ * @file   parallelfor.h
+ * @date   2024-06-03
+ * @brief  Split a loop over a short lived burst of CPU work across the
+ *         "Jobs" ThreadPool and wait for it to finish.
+ * 
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Copyright (c) 2024, Linden Research, Inc.
+ * $/LicenseInfo$
+ */
+
+#if ! defined(LL_PARALLELFOR_H)
+#define LL_PARALLELFOR_H
+
+#include <cstddef>
+#include <functional>
+
+namespace LL
+{
+    /// Name of the ThreadPool parallel_for() spreads its work over. The
+    /// application decides whether to start one and how wide it is.
+    extern const char* const JOB_POOL_NAME;
+
+    /**
+     * Call func(begin, end) over consecutive ranges of at most grain items
+     * covering [0, count), and return once every range is done.
+     *
+     * The calling thread works through ranges itself while any idle
+     * workers of the JOB_POOL_NAME pool help out. If that pool doesn't
+     * exist, is closed or is busy, the loop simply runs on the caller, so
+     * this is safe to call from anywhere, including from within func.
+     *
+     * Ranges may run concurrently and in any order. func must not throw.
+     */
+    void parallel_for(size_t count, size_t grain,
+                      const std::function<void(size_t begin, size_t end)>& func);
+} // namespace LL
+
+#endif /* ! defined(LL_PARALLELFOR_H) */
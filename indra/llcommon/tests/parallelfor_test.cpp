@@ -0,0 +1,76 @@
+/**
+ * @file   parallelfor_test.cpp
+ * @date   2024-06-03
+ * @brief  Test for parallelfor.
+ * 
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Copyright (c) 2024, Linden Research, Inc.
+ * $/LicenseInfo$
+ */
+
+// Precompiled header
+#include "linden_common.h"
+// associated header
+#include "parallelfor.h"
+// STL headers
+// std headers
+#include <atomic>
+#include <vector>
+// external library headers
+// other Linden headers
+#include "../test/lltut.h"
+#include "threadpool.h"
+
+/*****************************************************************************
+*   TUT
+*****************************************************************************/
+namespace tut
+{
+    struct parallelfor_data
+    {
+        // every index should be visited exactly once
+        void check(size_t count, size_t grain)
+        {
+            std::vector<std::atomic<int>> visits(count);
+            LL::parallel_for(count, grain,
+                             [&visits](size_t begin, size_t end)
+                             {
+                                 for (size_t i = begin; i < end; ++i)
+                                 {
+                                     ++visits[i];
+                                 }
+                             });
+            for (size_t i = 0; i < count; ++i)
+            {
+                ensure_equals("visits", visits[i].load(), 1);
+            }
+        }
+    };
+    typedef test_group<parallelfor_data> parallelfor_group;
+    typedef parallelfor_group::object object;
+    parallelfor_group parallelforgrp("parallelfor");
+
+    template<> template<>
+    void object::test<1>()
+    {
+        set_test_name("no pool");
+        check(0, 16);
+        check(1, 16);
+        check(1000, 16);
+        check(1000, 0);
+    }
+
+    template<> template<>
+    void object::test<2>()
+    {
+        set_test_name("pool");
+        LL::ThreadPool pool(LL::JOB_POOL_NAME, 3);
+        pool.start();
+        check(7, 1);
+        check(1000, 16);
+        check(1001, 1000);
+        pool.close();
+        // closed pool falls back to the caller
+        check(100, 8);
+    }
+} // namespace tut
@@ -36,17 +36,62 @@
 #include "lldir.h"
 #include <boost/filesystem.hpp>
 #include <boost/range/iterator_range.hpp>
+#include <algorithm>
 #include <chrono>
 
 #include "lldiskcache.h"
+#include "lldiskcachepack.h"
 
 const std::string DISK_CACHE_DIR_NAME = "cache";
 
+// Files holding the persistent cache index, in the root of the cache dir
+const std::string DISK_CACHE_INDEX_NAME = "index.dat";
+const std::string DISK_CACHE_JOURNAL_NAME = "index.journal";
+const std::string DISK_CACHE_DIRTY_NAME = "index.dirty";
+
+// Segment files and index of the pack backend, see LLDiskCachePack
+const std::string DISK_CACHE_PACK_DIR_NAME = "pack";
+
+constexpr U32 INDEX_MAGIC = 0x49434c53; // "SLCI"
+constexpr U32 INDEX_VERSION = 1;
+
+// Journal record operations
+constexpr U8 JOURNAL_WRITE = 1;
+constexpr U8 JOURNAL_ACCESS = 2;
+constexpr U8 JOURNAL_REMOVE = 3;
+
+/**
+ * Threshold in time_t units that is used to decide if a read access is
+ * journaled or not. The in-memory LRU order is always exact; this only
+ * bounds how stale the access times are after a restart. It used to limit
+ * how often a file's mtime was rewritten (see SL-14582 about frequent
+ * writes on older SSDs) and the same hour works fine for the journal.
+ */
+constexpr std::time_t ACCESS_JOURNAL_THRESHOLD = 1 * 60 * 60;
+
+// The journal is folded into a new snapshot once it holds more records than
+// the index itself, but never more often than this.
+constexpr size_t JOURNAL_COMPACT_MIN_RECORDS = 16384;
+
 LLDiskCache::LLDiskCache()
 {
 }
 
-void LLDiskCache::init(ELLPath location, const uintmax_t max_size_bytes, const bool enable_cache_debug_info, const bool cache_version_mismatch)
+LLDiskCache::~LLDiskCache()
+{
+    if (!mReadOnly && !mCacheDir.empty() && mIndexValid)
+    {
+        // A clean shutdown leaves a fresh snapshot and no journal behind so
+        // that the next session starts without replaying or rescanning.
+        flushIndex(true);
+        LLFile::remove(mCacheDir + gDirUtilp->getDirDelimiter() + DISK_CACHE_DIRTY_NAME, ENOENT);
+    }
+
+    // Saves the pack index
+    mPackCache.reset();
+}
+
+void LLDiskCache::init(ELLPath location, const uintmax_t max_size_bytes, const bool enable_cache_debug_info, const bool cache_version_mismatch, const bool use_pack_cache)
 {
     mMaxSizeBytes = max_size_bytes;
     mEnableCacheDebugInfo = enable_cache_debug_info;
@@ -58,6 +103,35 @@ void LLDiskCache::init(ELLPath location, const uintmax_t max_size_bytes, const b
     }
 
     createCache();
+
+    const std::string pack_dir = mCacheDir + gDirUtilp->getDirDelimiter() + DISK_CACHE_PACK_DIR_NAME;
+    if (use_pack_cache)
+    {
+        mPackCache = std::make_unique<LLDiskCachePack>(pack_dir, mReadOnly);
+    }
+    else if (!mReadOnly && LLFile::isdir(pack_dir))
+    {
+        // Left over from a session that used the pack backend. Nothing can
+        // read it now and eviction would never get to it.
+        LL_INFOS() << "Removing unused disk cache pack in " << pack_dir << LL_ENDL;
+        gDirUtilp->deleteDirAndContents(pack_dir);
+    }
+
+    mIndexValid = loadIndex();
+    if (!mIndexValid)
+    {
+        LL_INFOS() << "Disk cache index needs rebuilding, it will be reconciled in the background" << LL_ENDL;
+    }
+
+    if (!mReadOnly)
+    {
+        // Marks the index as in use; removed again on clean shutdown
+        LLFILE* dirty_file = LLFile::fopen(mCacheDir + gDirUtilp->getDirDelimiter() + DISK_CACHE_DIRTY_NAME, "wb");
+        if (dirty_file)
+        {
+            LLFile::close(dirty_file);
+        }
+    }
 }
 
 
@@ -71,8 +145,12 @@ void LLDiskCache::createCache()
     }
 }
 
-// WARNING: purge() is called by LLPurgeDiskCacheThread. As such it must
-// NOT touch any LLDiskCache data without introducing and locking a mutex!
+// purge() is called by LLPurgeDiskCacheThread and, on request, from the
+// general thread pool. Both only ever pick victims under mIndexMutex and
+// delete the files afterwards. Each victim is deleted with mIndexMutex held
+// again and only if it is still in mPurgeVictims: beginWrite() takes it out
+// before a writer touches the file, so whichever of the two gets the lock
+// first wins and a fresh write is never deleted.
 
 // Interaction through the filesystem itself should be safe. Let’s say thread
 // A is accessing the cache file for reading/writing and thread B is trimming
@@ -100,20 +178,352 @@ void LLDiskCache::createCache()
 // gone before A finally gets to open it, this operation will fail and the
 // asset will have to be re-requested.
 void LLDiskCache::purge()
+{
+    if (mReadOnly || mCacheDir.empty()) return;
+
+    LLMutexLock purge_lock(&mPurgeMutex);
+
+    if (!mIndexValid)
+    {
+        rebuildIndex();
+        if (!LLApp::isRunning())
+        {
+            return;
+        }
+        mIndexValid = true;
+        flushIndex(true);
+    }
+
+    auto start_time = std::chrono::high_resolution_clock::now();
+
+    typedef std::pair<LLUUID, uintmax_t> victim_t;
+    std::vector<victim_t> victims;
+    uintmax_t indexed_bytes = 0;
+    {
+        LLMutexLock lock(&mIndexMutex);
+        while (mIndexedBytes > mMaxSizeBytes && !mLRU.empty())
+        {
+            const LLUUID id = mLRU.back();
+            victims.emplace_back(id, mIndex[id].mSize);
+            mPurgeVictims.insert(id);
+            eraseEntry(id);
+            appendJournal(JOURNAL_REMOVE, id, 0, 0);
+        }
+        indexed_bytes = mIndexedBytes;
+    }
+
+    if (!victims.empty())
+    {
+        LL_INFOS() << "Purging " << victims.size() << " files from cache to a maximum of " << mMaxSizeBytes << " bytes" << LL_ENDL;
+    }
+
+    boost::system::error_code ec;
+    for (const victim_t& victim : victims)
+    {
+        if (!LLApp::isRunning())
+        {
+            break;
+        }
+
+        LLMutexLock lock(&mIndexMutex);
+        if (!mPurgeVictims.erase(victim.first))
+        {
+            // Written again since it was picked
+            continue;
+        }
+
+        if (mPackCache)
+        {
+            // Files written before the pack backend was turned on are
+            // evicted the usual way, so no warning if there is none.
+            mPackCache->removeAllTypes(victim.first);
+            boost::filesystem::remove(metaDataToFilepath(victim.first, LLAssetType::AT_UNKNOWN), ec);
+            if (mEnableCacheDebugInfo)
+            {
+                LL_INFOS() << "DELETE:  " << victim.second << "  " << victim.first << " (" << indexed_bytes << "/" << mMaxSizeBytes << ")" << LL_ENDL;
+            }
+            continue;
+        }
+
+        const boost::filesystem::path file_path = metaDataToFilepath(victim.first, LLAssetType::AT_UNKNOWN);
+        boost::filesystem::remove(file_path, ec);
+        if (ec.failed())
+        {
+            LL_WARNS() << "Failed to delete cache file " << file_path << ": " << ec.message() << LL_ENDL;
+        }
+        else if (mEnableCacheDebugInfo)
+        {
+            LL_INFOS() << "DELETE:  " << victim.second << "  " << file_path << " (" << indexed_bytes << "/" << mMaxSizeBytes << ")" << LL_ENDL;
+        }
+    }
+
+    if (!LLApp::isRunning())
+    {
+        LLMutexLock lock(&mIndexMutex);
+        mPurgeVictims.clear();
+    }
+
+    flushIndex(false);
+
+    if (mPackCache && LLApp::isRunning())
+    {
+        mPackCache->compact();
+    }
+
+    if (mEnableCacheDebugInfo && !victims.empty())
+    {
+        auto end_time = std::chrono::high_resolution_clock::now();
+        auto execute_time = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time).count();
+        LL_INFOS() << "Cache purge took " << execute_time << " ms to evict " << victims.size() << " files" << LL_ENDL;
+    }
+}
+
+void LLDiskCache::notifyRead(const LLUUID& id)
 {
     if (mReadOnly) return;
 
+    const std::time_t cur_time = std::time(nullptr);
+
+    LLMutexLock lock(&mIndexMutex);
+    index_map_t::iterator iter = mIndex.find(id);
+    if (iter == mIndex.end())
+    {
+        // Not cached, or not indexed yet - the rebuild will pick it up
+        return;
+    }
+
+    touchEntry(id, 0, cur_time, false);
+    IndexEntry& entry = iter->second;
+    if (cur_time - entry.mLastJournaled > ACCESS_JOURNAL_THRESHOLD)
+    {
+        entry.mLastJournaled = cur_time;
+        appendJournal(JOURNAL_ACCESS, id, 0, cur_time);
+    }
+}
+
+void LLDiskCache::notifyWrite(const LLUUID& id, uintmax_t file_size)
+{
+    if (mReadOnly) return;
+
+    const std::time_t cur_time = std::time(nullptr);
+
+    LLMutexLock lock(&mIndexMutex);
+    touchEntry(id, file_size, cur_time, true);
+    mIndex[id].mLastJournaled = cur_time;
+    appendJournal(JOURNAL_WRITE, id, file_size, cur_time);
+}
+
+void LLDiskCache::beginWrite(const LLUUID& id)
+{
+    if (mReadOnly) return;
+
+    LLMutexLock lock(&mIndexMutex);
+    mPurgeVictims.erase(id);
+
+    // Keep the next purge from picking it before notifyWrite() gets here
+    if (mIndex.find(id) != mIndex.end())
+    {
+        touchEntry(id, 0, std::time(nullptr), false);
+    }
+}
+
+void LLDiskCache::notifyRemove(const LLUUID& id)
+{
+    if (mReadOnly) return;
+
+    LLMutexLock lock(&mIndexMutex);
+    if (mIndex.find(id) != mIndex.end())
+    {
+        eraseEntry(id);
+        appendJournal(JOURNAL_REMOVE, id, 0, 0);
+    }
+}
+
+void LLDiskCache::notifyRename(const LLUUID& old_id, const LLUUID& new_id)
+{
+    if (mReadOnly || old_id == new_id) return;
+
+    const std::time_t cur_time = std::time(nullptr);
+
+    LLMutexLock lock(&mIndexMutex);
+    index_map_t::iterator iter = mIndex.find(old_id);
+    if (iter == mIndex.end())
+    {
+        return;
+    }
+
+    const uintmax_t file_size = iter->second.mSize;
+    eraseEntry(old_id);
+    appendJournal(JOURNAL_REMOVE, old_id, 0, 0);
+
+    // rename() replaces whatever was cached under the new id
+    eraseEntry(new_id);
+    touchEntry(new_id, file_size, cur_time, true);
+    mIndex[new_id].mLastJournaled = cur_time;
+    appendJournal(JOURNAL_WRITE, new_id, file_size, cur_time);
+}
+
+void LLDiskCache::touchEntry(const LLUUID& id, uintmax_t file_size, std::time_t access_time, bool update_size)
+{
+    index_map_t::iterator iter = mIndex.find(id);
+    if (iter == mIndex.end())
+    {
+        if (!update_size)
+        {
+            return;
+        }
+
+        mLRU.push_front(id);
+        IndexEntry& entry = mIndex[id];
+        entry.mSize = file_size;
+        entry.mLastAccess = access_time;
+        entry.mLRUIter = mLRU.begin();
+        mIndexedBytes += file_size;
+        return;
+    }
+
+    IndexEntry& entry = iter->second;
+    if (update_size)
+    {
+        mIndexedBytes -= entry.mSize;
+        mIndexedBytes += file_size;
+        entry.mSize = file_size;
+    }
+    entry.mLastAccess = llmax(entry.mLastAccess, access_time);
+    mLRU.splice(mLRU.begin(), mLRU, entry.mLRUIter);
+}
+
+void LLDiskCache::eraseEntry(const LLUUID& id)
+{
+    index_map_t::iterator iter = mIndex.find(id);
+    if (iter != mIndex.end())
+    {
+        mIndexedBytes -= iter->second.mSize;
+        mLRU.erase(iter->second.mLRUIter);
+        mIndex.erase(iter);
+    }
+}
+
+void LLDiskCache::appendJournal(U8 op, const LLUUID& id, uintmax_t file_size, std::time_t access_time)
+{
+    JournalRecord record;
+    record.mOp = op;
+    record.mID = id;
+    record.mSize = (U64)file_size;
+    record.mTime = (S64)access_time;
+    mPendingJournal.push_back(record);
+}
+
+void LLDiskCache::clearIndex()
+{
+    mIndex.clear();
+    mLRU.clear();
+    mIndexedBytes = 0;
+    mPendingJournal.clear();
+    mJournalRecords = 0;
+}
+
+bool LLDiskCache::loadIndex()
+{
+    const std::string& dirdelim = gDirUtilp->getDirDelimiter();
+    const std::string index_path = mCacheDir + dirdelim + DISK_CACHE_INDEX_NAME;
+    const std::string journal_path = mCacheDir + dirdelim + DISK_CACHE_JOURNAL_NAME;
+    const bool clean_shutdown = !LLFile::isfile(mCacheDir + dirdelim + DISK_CACHE_DIRTY_NAME);
+
+    auto replay = [this](const JournalRecord& record)
+    {
+        switch (record.mOp)
+        {
+        case JOURNAL_WRITE:
+            touchEntry(record.mID, (uintmax_t)record.mSize, (std::time_t)record.mTime, true);
+            mIndex[record.mID].mLastJournaled = (std::time_t)record.mTime;
+            break;
+        case JOURNAL_ACCESS:
+            touchEntry(record.mID, 0, (std::time_t)record.mTime, false);
+            break;
+        case JOURNAL_REMOVE:
+            eraseEntry(record.mID);
+            break;
+        default:
+            break;
+        }
+    };
+
+    LLMutexLock lock(&mIndexMutex);
+    clearIndex();
+
+    bool snapshot_ok = false;
+    LLFILE* index_file = LLFile::fopen(index_path, "rb");
+    if (index_file)
+    {
+        U32 header[2] = { 0, 0 };
+        U64 count = 0;
+        if (fread(header, sizeof(U32), 2, index_file) == 2 &&
+            header[0] == INDEX_MAGIC && header[1] == INDEX_VERSION &&
+            fread(&count, sizeof(U64), 1, index_file) == 1)
+        {
+            JournalRecord record;
+            U64 read_count = 0;
+            while (read_count < count && fread(&record, sizeof(JournalRecord), 1, index_file) == 1)
+            {
+                replay(record);
+                ++read_count;
+            }
+            snapshot_ok = (read_count == count);
+        }
+        LLFile::close(index_file);
+    }
+
+    if (!snapshot_ok)
+    {
+        // Whatever was loaded is still useful as a source of access times
+        // while the rebuild reconciles it with the directory contents.
+        LL_INFOS() << "No usable disk cache index found at " << index_path << LL_ENDL;
+    }
+
+    LLFILE* journal_file = LLFile::fopen(journal_path, "rb");
+    if (journal_file)
+    {
+        // A torn record at the end (crash mid-write) is simply dropped
+        JournalRecord record;
+        while (fread(&record, sizeof(JournalRecord), 1, journal_file) == 1)
+        {
+            replay(record);
+            ++mJournalRecords;
+        }
+        LLFile::close(journal_file);
+    }
+
+    // Anything still in the index refers to the last access recorded on
+    // disk, so none of it needs journaling again until it is touched.
+    for (auto& entry : mIndex)
+    {
+        entry.second.mLastJournaled = entry.second.mLastAccess;
+    }
+
     if (mEnableCacheDebugInfo)
     {
-        LL_INFOS() << "Total dir size before purge is " << dirFileSize(mCacheDir) << LL_ENDL;
+        LL_INFOS() << "Loaded disk cache index with " << mIndex.size() << " entries (" << mIndexedBytes
+                   << " bytes) and " << mJournalRecords << " journal records" << LL_ENDL;
     }
 
-    boost::system::error_code ec;
+    return snapshot_ok && clean_shutdown;
+}
+
+void LLDiskCache::rebuildIndex()
+{
     auto start_time = std::chrono::high_resolution_clock::now();
+    const std::time_t scan_start = std::time(nullptr);
 
-    typedef std::pair<std::time_t, std::pair<uintmax_t, boost::filesystem::path>> file_info_t;
-    std::vector<file_info_t> file_info;
+    struct scanned_t
+    {
+        LLUUID mID;
+        uintmax_t mSize;
+        std::time_t mTime;
+    };
+    std::vector<scanned_t> scanned;
 
+    boost::system::error_code ec;
 #if LL_WINDOWS
     boost::filesystem::path cache_path(ll_convert_string_to_wide(mCacheDir));
 #else
@@ -126,108 +536,199 @@ void LLDiskCache::purge()
         {
             for (auto& entry : boost::make_iterator_range(dir_iter, {}))
             {
-                if(!LLApp::isRunning())
+                if (!LLApp::isRunning())
                 {
                     return;
                 }
 
                 if (boost::filesystem::is_regular_file(entry, ec) && !ec.failed())
                 {
-                    if (entry.path().string().rfind(mCacheFilenameExt) != std::string::npos)
+                    if (entry.path().extension().string() != mCacheFilenameExt)
                     {
-                        const uintmax_t file_size = boost::filesystem::file_size(entry, ec);
-                        if (ec.failed())
-                        {
-                            LL_WARNS() << "Failed to read file size for cache file " << entry.path().string() << ": " << ec.message() << LL_ENDL;
-                            continue;
-                        }
-                        const std::time_t file_time = boost::filesystem::last_write_time(entry, ec);
-                        if (ec.failed())
-                        {
-                            LL_WARNS() << "Failed to read last write time for cache file " << entry.path().string() << ": " << ec.message() << LL_ENDL;
-                            continue;
-                        }
+                        continue;
+                    }
+
+                    const std::string stem = entry.path().stem().string();
+                    if (!LLUUID::validate(stem))
+                    {
+                        continue;
+                    }
 
-                        file_info.push_back(file_info_t(file_time, { file_size, entry.path() }));
+                    const uintmax_t file_size = boost::filesystem::file_size(entry, ec);
+                    if (ec.failed())
+                    {
+                        LL_WARNS() << "Failed to read file size for cache file " << entry.path().string() << ": " << ec.message() << LL_ENDL;
+                        continue;
+                    }
+                    const std::time_t file_time = boost::filesystem::last_write_time(entry, ec);
+                    if (ec.failed())
+                    {
+                        LL_WARNS() << "Failed to read last write time for cache file " << entry.path().string() << ": " << ec.message() << LL_ENDL;
+                        continue;
                     }
+
+                    scanned.push_back({ LLUUID(stem), file_size, file_time });
                 }
             }
         }
     }
 
-    std::sort(file_info.begin(), file_info.end(), [](const file_info_t& x, const file_info_t& y)
+    if (mPackCache)
     {
-        return x.first > y.first;
-    });
+        // The pack keeps no access times, treat its contents as oldest
+        std::vector<std::pair<LLUUID, uintmax_t>> entries;
+        mPackCache->getEntries(entries);
+        for (const auto& entry : entries)
+        {
+            scanned.push_back({ entry.first, entry.second, 0 });
+        }
+    }
 
-    LL_INFOS() << "Purging cache to a maximum of " << mMaxSizeBytes << " bytes" << LL_ENDL;
+    LLMutexLock lock(&mIndexMutex);
 
-    // Extra accounting to track the retention of static assets
-    std::vector<bool> file_removed;
-    if (mEnableCacheDebugInfo)
+    boost::unordered_flat_set<LLUUID> seen;
+    seen.reserve(scanned.size());
+    for (const scanned_t& file : scanned)
     {
-        file_removed.reserve(file_info.size());
+        seen.insert(file.mID);
+        index_map_t::iterator iter = mIndex.find(file.mID);
+        if (iter == mIndex.end())
+        {
+            touchEntry(file.mID, file.mSize, file.mTime, true);
+            mIndex[file.mID].mLastJournaled = 0;
+        }
+        else if (iter->second.mLastAccess < scan_start)
+        {
+            // Known access time wins over mtime, the disk wins on size
+            touchEntry(file.mID, file.mSize, iter->second.mLastAccess, true);
+        }
     }
 
-    uintmax_t file_size_total = 0;
-    for (const file_info_t& entry : file_info)
+    // Drop entries whose files are gone, unless they were written while
+    // the scan was running.
+    std::vector<LLUUID> stale;
+    for (const auto& entry : mIndex)
     {
-		if (!LLApp::isRunning())
-		{
-			return;
-		}
-
-        file_size_total += entry.second.first;
-
-        bool should_remove = file_size_total > mMaxSizeBytes;
-        if (mEnableCacheDebugInfo)
+        if (entry.second.mLastAccess < scan_start && !seen.contains(entry.first))
         {
-            file_removed.push_back(should_remove);
+            stale.push_back(entry.first);
         }
+    }
+    for (const LLUUID& id : stale)
+    {
+        eraseEntry(id);
+    }
 
-        if (should_remove)
-        {
-            boost::filesystem::remove(entry.second.second, ec);
-            if (ec.failed())
-            {
-                LL_WARNS() << "Failed to delete cache file " << entry.second.second << ": " << ec.message() << LL_ENDL;
-                continue;
-            }
-        }
+    // Re-establish the recency order from the merged access times
+    std::vector<std::pair<std::time_t, LLUUID>> order;
+    order.reserve(mIndex.size());
+    for (const auto& entry : mIndex)
+    {
+        order.emplace_back(entry.second.mLastAccess, entry.first);
+    }
+    std::sort(order.begin(), order.end(), [](const auto& x, const auto& y)
+    {
+        return x.first > y.first;
+    });
+    mLRU.clear();
+    for (const auto& item : order)
+    {
+        mLRU.push_back(item.second);
+        mIndex[item.second].mLRUIter = std::prev(mLRU.end());
     }
 
     if (mEnableCacheDebugInfo)
     {
         auto end_time = std::chrono::high_resolution_clock::now();
         auto execute_time = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time).count();
+        LL_INFOS() << "Disk cache index rebuild took " << execute_time << " ms for " << scanned.size() << " files, dropped "
+                   << stale.size() << " stale entries" << LL_ENDL;
+    }
+}
 
-        // Log afterward so it doesn't affect the time measurement
-        // Logging thousands of file results can take hundreds of milliseconds
-        for (size_t i = 0; i < file_info.size(); ++i)
+void LLDiskCache::flushIndex(bool force_snapshot)
+{
+    std::vector<JournalRecord> records;
+    bool snapshot = false;
+    {
+        LLMutexLock lock(&mIndexMutex);
+        snapshot = force_snapshot ||
+            (mJournalRecords + mPendingJournal.size() > llmax(JOURNAL_COMPACT_MIN_RECORDS, mIndex.size()));
+        if (snapshot)
         {
-			if (!LLApp::isRunning())
-			{
-				return;
-			}
-
-            const file_info_t& entry = file_info[i];
-            const bool removed = file_removed[i];
-            const std::string action = removed ? "DELETE:" : "KEEP:";
-
-            // have to do this because of LL_INFO/LL_END weirdness
-            std::ostringstream line;
-
-            line << action << "  ";
-            line << entry.first << "  ";
-            line << entry.second.first << "  ";
-            line << entry.second.second;
-            line << " (" << file_size_total << "/" << mMaxSizeBytes << ")";
-            LL_INFOS() << line.str() << LL_ENDL;
+            // Least recently used first, so that replaying the snapshot
+            // rebuilds the same LRU order.
+            records.reserve(mIndex.size());
+            for (lru_list_t::reverse_iterator iter = mLRU.rbegin(); iter != mLRU.rend(); ++iter)
+            {
+                const IndexEntry& entry = mIndex[*iter];
+                JournalRecord record;
+                record.mOp = JOURNAL_WRITE;
+                record.mID = *iter;
+                record.mSize = (U64)entry.mSize;
+                record.mTime = (S64)entry.mLastAccess;
+                records.push_back(record);
+            }
+            mPendingJournal.clear();
         }
+        else
+        {
+            records.swap(mPendingJournal);
+        }
+    }
 
-        LL_INFOS() << "Total dir size after purge is " << dirFileSize(mCacheDir) << LL_ENDL;
-        LL_INFOS() << "Cache purge took " << execute_time << " ms to execute for " << file_info.size() << " files" << LL_ENDL;
+    if (snapshot)
+    {
+        writeIndexSnapshot(records);
+        return;
     }
+
+    if (records.empty())
+    {
+        return;
+    }
+
+    LLFILE* journal_file = LLFile::fopen(mCacheDir + gDirUtilp->getDirDelimiter() + DISK_CACHE_JOURNAL_NAME, "ab");
+    if (!journal_file)
+    {
+        LL_WARNS() << "Unable to open disk cache index journal for writing" << LL_ENDL;
+        return;
+    }
+    mJournalRecords += fwrite(records.data(), sizeof(JournalRecord), records.size(), journal_file);
+    LLFile::close(journal_file);
+}
+
+bool LLDiskCache::writeIndexSnapshot(const std::vector<JournalRecord>& records)
+{
+    const std::string& dirdelim = gDirUtilp->getDirDelimiter();
+    const std::string index_path = mCacheDir + dirdelim + DISK_CACHE_INDEX_NAME;
+    const std::string temp_path = index_path + ".tmp";
+
+    LLFILE* index_file = LLFile::fopen(temp_path, "wb");
+    if (!index_file)
+    {
+        LL_WARNS() << "Unable to open " << temp_path << " for writing" << LL_ENDL;
+        return false;
+    }
+
+    const U32 header[2] = { INDEX_MAGIC, INDEX_VERSION };
+    const U64 count = records.size();
+    bool success = fwrite(header, sizeof(U32), 2, index_file) == 2 &&
+                   fwrite(&count, sizeof(U64), 1, index_file) == 1 &&
+                   fwrite(records.data(), sizeof(JournalRecord), records.size(), index_file) == records.size();
+    LLFile::close(index_file);
+
+    // Swap in the new snapshot atomically, then drop the journal it replaces
+    if (!success || LLFile::rename(temp_path, index_path) != 0)
+    {
+        LL_WARNS() << "Failed to write disk cache index " << index_path << LL_ENDL;
+        LLFile::remove(temp_path, ENOENT);
+        return false;
+    }
+
+    LLFile::remove(mCacheDir + dirdelim + DISK_CACHE_JOURNAL_NAME, ENOENT);
+    mJournalRecords = 0;
+    return true;
 }
 
 //static
@@ -292,52 +793,19 @@ const boost::filesystem::path LLDiskCache::metaDataToFilepath(const LLUUID& id,
 #endif
 }
 
-// static
-void LLDiskCache::updateFileAccessTime(const boost::filesystem::path& file_path)
+const std::string LLDiskCache::getCacheInfo()
 {
-    /**
-     * Threshold in time_t units that is used to decide if the last access time
-     * time of the file is updated or not. Added as a precaution for the concern
-     * outlined in SL-14582  about frequent writes on older SSDs reducing their
-     * lifespan. I think this is the right place for the threshold value - rather
-     * than it being a pref - do comment on that Jira if you disagree...
-     *
-     * Let's start with 1 hour in time_t units and see how that unfolds
-     */
-    static const std::time_t time_threshold = 1 * 60 * 60;
-
-    // current time
-    const std::time_t cur_time = std::time(nullptr);
-
-    boost::system::error_code ec;
-
-    // file last write time
-    const std::time_t last_write_time = boost::filesystem::last_write_time(file_path, ec);
-    if (ec.failed())
+    uintmax_t cache_used_bytes = 0;
+    if (mIndexValid)
     {
-        LL_WARNS() << "Failed to read last write time for cache file " << file_path << ": " << ec.message() << LL_ENDL;
-        return;
+        LLMutexLock lock(&mIndexMutex);
+        cache_used_bytes = mIndexedBytes;
     }
-
-    // delta between cur time and last time the file was written
-    const std::time_t delta_time = cur_time - last_write_time;
-
-    // we only write the new value if the time in time_threshold has elapsed
-    // before the last one
-    if (delta_time > time_threshold)
+    else
     {
-        boost::filesystem::last_write_time(file_path, cur_time, ec);
+        cache_used_bytes = dirFileSize(mCacheDir);
     }
-
-    if (ec.failed())
-    {
-        LL_WARNS() << "Failed to update last write time for cache file " << file_path << ": " << ec.message() << LL_ENDL;
-    }
-}
-
-const std::string LLDiskCache::getCacheInfo()
-{
-    uintmax_t cache_used_mb = dirFileSize(mCacheDir) / (1024U * 1024U);
+    uintmax_t cache_used_mb = cache_used_bytes / (1024U * 1024U);
 
     uintmax_t max_in_mb = mMaxSizeBytes / (1024U * 1024U);
     F64 percent_used = ((F64)cache_used_mb / (F64)max_in_mb) * 100.0;
@@ -367,9 +835,24 @@ void LLDiskCache::clearCache(ELLPath location, bool recreate_cache)
 #endif
         }
         gDirUtilp->deleteFilesInDir(disk_cache_dir, mask);
+
+        const bool had_pack_cache = mPackCache != nullptr;
+        mPackCache.reset();
+        gDirUtilp->deleteDirAndContents(disk_cache_dir + delem + DISK_CACHE_PACK_DIR_NAME);
+
+        // The index files lived in disk_cache_dir and are gone too
+        {
+            LLMutexLock lock(&mIndexMutex);
+            clearIndex();
+        }
+
         if (recreate_cache)
         {
             createCache();
+            if (had_pack_cache)
+            {
+                mPackCache = std::make_unique<LLDiskCachePack>(disk_cache_dir + delem + DISK_CACHE_PACK_DIR_NAME, mReadOnly);
+            }
         }
     }
 }
@@ -462,7 +945,9 @@ LLPurgeDiskCacheThread::LLPurgeDiskCacheThread() :
 
 void LLPurgeDiskCacheThread::run()
 {
-    constexpr std::chrono::seconds CHECK_INTERVAL{60};
+    // Eviction works straight off the index, so checking often is cheap and
+    // keeps the cache close to its budget as writes come in.
+    constexpr std::chrono::seconds CHECK_INTERVAL{1};
 
     while (LLApp::instance()->sleep(CHECK_INTERVAL))
     {
@@ -22,15 +22,22 @@
                     that identifies the type of asset being stored.
         .asset      A file extension of .asset is used to help
                     identify this as a Viewer asset file
- * 2/ The time of last access for a file can be updated instantly
- *    for file reads and automatically as part of the file writes.
- * 3/ The purge algorithm collects a list of all files in the
- *    directory, sorts them by date of last access (write) and then
- *    deletes any files based on age until the total size of all
- *    the files is less than the maximum size specified.
- * 4/ An LLSingleton idiom is used since there will only ever be
+ * 2/ The size and time of last access of every file are kept in an
+ *    in-memory index ordered by recency (LRU). Reads and writes only
+ *    touch the index - no file metadata is written on a read.
+ * 3/ The index is persisted as a snapshot (index.dat) plus an append-only
+ *    journal (index.journal) of writes, accesses and removals. The journal
+ *    is flushed and compacted into the snapshot by the purge thread, so
+ *    startup never has to walk the cache directory. A full directory scan
+ *    only happens once, in the background, when the snapshot is missing
+ *    or the previous session did not shut down cleanly.
+ * 4/ The purge algorithm evicts the least recently used entries straight
+ *    from the index until the total size of all the files is less than
+ *    the maximum size specified. It runs frequently and only does work
+ *    when writes have pushed the cache over budget.
+ * 5/ An LLSingleton idiom is used since there will only ever be
  *    a single cache and we want to access it from numerous places.
- * 5/ Performance on my modest system seems very acceptable. For
+ * 6/ Performance on my modest system seems very acceptable. For
  *    example, in testing, I was able to purge a directory of
  *    10,000 files, deleting about half of them in ~ 1700ms. For
  *    the same sized directory of files, writing the last updated
@@ -66,8 +73,16 @@
 #include "lluuid.h"
 #include "lldir.h"
 
+#include "llmutex.h"
+
+#include "boost/unordered/unordered_flat_map.hpp"
 #include "boost/unordered/unordered_flat_set.hpp"
 
+#include <list>
+#include <memory>
+
+class LLDiskCachePack;
+
 class LLDiskCache final :
     public LLSimpleton<LLDiskCache>
 {
@@ -80,7 +95,7 @@ class LLDiskCache final :
          * the class via a call in LLAppViewer.
          */
         LLDiskCache();
-        virtual ~LLDiskCache() = default;
+        virtual ~LLDiskCache();
 public:
         void init(                    
             /**
@@ -101,7 +116,19 @@ class LLDiskCache final :
             /**
              * Cache version mismatch purge
              */
-            const bool cache_version_mismatch);
+            const bool cache_version_mismatch,
+            /**
+             * Store assets in large segment files (see LLDiskCachePack)
+             * instead of one file per asset. Based on the setting at
+             * 'DiskCachePackBackend'
+             */
+            const bool use_pack_cache = false);
+
+        /**
+         * The pack store assets go to, or nullptr when the cache uses
+         * one file per asset
+         */
+        LLDiskCachePack* getPackCache() const { return mPackCache.get(); }
 
         /**
          * Construct a filename and path to it based on the file meta data
@@ -114,22 +141,45 @@ class LLDiskCache final :
                                              LLAssetType::EType at);
 
         /**
-         * Update the "last write time" of a file to "now". This must be called whenever a
-         * file in the cache is read (not written) so that the last time the file was
-         * accessed is up to date (This is used in the mechanism for purging the cache)
+         * Record that the cache file for an asset was opened for reading. This
+         * must be called whenever a file in the cache is read (not written) so
+         * that the index knows when the asset was last used (This is used in
+         * the mechanism for purging the cache). Only the in-memory index is
+         * updated; the access is journaled in batches by the purge thread.
          */
-        static void updateFileAccessTime(const boost::filesystem::path& file_path);
+        void notifyRead(const LLUUID& id);
 
         /**
-         * Purge the oldest items in the cache so that the combined size of all files
-         * is no bigger than mMaxSizeBytes.
-         *
-         * WARNING: purge() is called by LLPurgeDiskCacheThread. As such it must
-         * NOT touch any LLDiskCache data without introducing and locking a mutex!
+         * Record that the cache file for an asset was written and is now
+         * file_size bytes long. Counts as an access.
+         */
+        void notifyWrite(const LLUUID& id, uintmax_t file_size);
+
+        /**
+         * Must be called before the cache file for an asset is written or
+         * renamed over, so that a purge that picked it as a victim leaves
+         * the new contents alone.
+         */
+        void beginWrite(const LLUUID& id);
+
+        /**
+         * Record that the cache file for an asset was deleted
+         */
+        void notifyRemove(const LLUUID& id);
+
+        /**
+         * Record that the cache file for an asset was renamed to new_id
+         */
+        void notifyRename(const LLUUID& old_id, const LLUUID& new_id);
+
+        /**
+         * Evict the least recently used items in the cache so that the combined
+         * size of all files is no bigger than mMaxSizeBytes, then flush the
+         * index journal to disk.
          *
-         * Purging the disk cache involves nontrivial work on the viewer's
-         * filesystem. If called on the main thread, this causes a noticeable
-         * freeze.
+         * purge() is called by LLPurgeDiskCacheThread at a short interval. Victims
+         * are picked under mIndexMutex and deleted one at a time afterwards,
+         * each only if beginWrite() has not been called for it since.
          */
         void purge();
 
@@ -157,6 +207,42 @@ class LLDiskCache final :
          */
         uintmax_t dirFileSize(const std::string dir);
 
+        /**
+         * Load the index snapshot and replay the journal on top of it.
+         * Returns false if the snapshot is missing or unusable, or if the
+         * previous session left the index dirty, in which case the index
+         * has to be reconciled with a directory scan.
+         */
+        bool loadIndex();
+
+        /**
+         * Walk the cache directory once and merge what is found into the
+         * index. Access times already known to the index win over the file
+         * modification times. Runs on the purge thread.
+         */
+        void rebuildIndex();
+
+        /**
+         * Append the pending journal records to the journal file and, if the
+         * journal has grown large enough, fold it into a new snapshot.
+         */
+        void flushIndex(bool force_snapshot);
+
+        /**
+         * Write records (least recently used first) to the snapshot file
+         * and drop the journal. Called by flushIndex() only.
+         */
+        struct JournalRecord;
+        bool writeIndexSnapshot(const std::vector<JournalRecord>& records);
+
+        /**
+         * Index helpers. All must be called with mIndexMutex held.
+         */
+        void touchEntry(const LLUUID& id, uintmax_t file_size, std::time_t access_time, bool update_size);
+        void eraseEntry(const LLUUID& id);
+        void appendJournal(U8 op, const LLUUID& id, uintmax_t file_size, std::time_t access_time);
+        void clearIndex();
+
         /**
          * Utility function to convert an LLAssetType enum into a
          * string that we use as part of the cache file filename
@@ -202,6 +288,62 @@ class LLDiskCache final :
         bool mEnableCacheDebugInfo = false;
 
         bool mReadOnly = false;
+
+        std::unique_ptr<LLDiskCachePack> mPackCache;
+
+        /**
+         * The in-memory index of the cache. mLRU holds the IDs ordered from
+         * most to least recently used and every index entry keeps an
+         * iterator into it, so touching and evicting are both O(1).
+         */
+        typedef std::list<LLUUID> lru_list_t;
+        struct IndexEntry
+        {
+            uintmax_t mSize = 0;
+            std::time_t mLastAccess = 0;
+            std::time_t mLastJournaled = 0;
+            lru_list_t::iterator mLRUIter;
+        };
+        typedef boost::unordered_flat_map<LLUUID, IndexEntry> index_map_t;
+
+        /**
+         * One journal record. Written to disk as-is, so keep it packed and
+         * bump INDEX_VERSION whenever it changes.
+         */
+#pragma pack(push, 1)
+        struct JournalRecord
+        {
+            U8 mOp;
+            LLUUID mID;
+            U64 mSize;
+            S64 mTime;
+        };
+#pragma pack(pop)
+
+        LLMutex mIndexMutex;
+        index_map_t mIndex;
+        lru_list_t mLRU;
+        uintmax_t mIndexedBytes = 0;
+        std::vector<JournalRecord> mPendingJournal;
+
+        /**
+         * Victims picked by purge() that have not been deleted yet. An ID is
+         * dropped from here by beginWrite(), which tells purge() to skip it.
+         */
+        boost::unordered_flat_set<LLUUID> mPurgeVictims;
+        size_t mJournalRecords = 0;
+
+        /**
+         * False until the index has been either loaded from a clean snapshot
+         * or rebuilt by the purge thread. Eviction is disabled until then.
+         */
+        std::atomic<bool> mIndexValid = false;
+
+        /**
+         * Serializes purge() between the purge thread and manual purges
+         * requested from the UI.
+         */
+        LLMutex mPurgeMutex;
 };
 
 class LLPurgeDiskCacheThread : public LLThread
@@ -0,0 +1,1004 @@
+/**
+ * @file lldiskcachepack.cpp
+ * @brief Packed, segment based storage backend for the disk cache.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "lldiskcachepack.h"
+
+#include "llapp.h"
+#include "lldir.h"
+
+#include <boost/filesystem.hpp>
+#include <boost/unordered/unordered_flat_set.hpp>
+
+// Segments are sealed once they grow past this size
+constexpr U64 SEGMENT_MAX_BYTES = 256ull * 1024ull * 1024ull;
+
+// Sealed segments with more garbage than this get compacted
+constexpr F64 COMPACT_GARBAGE_RATIO = 0.5;
+
+const std::string PACK_SEGMENT_PREFIX = "segment_";
+const std::string PACK_SEGMENT_EXT = ".pack";
+const std::string PACK_INDEX_NAME = "pack.idx";
+
+constexpr U32 RECORD_MAGIC = 0x4b505343; // "CSPK"
+constexpr U32 INDEX_MAGIC = 0x49505343;  // "CSPI"
+constexpr U32 INDEX_VERSION = 1;
+
+// Record operations
+constexpr U32 RECORD_FULL = 1;   // payload is the whole asset
+constexpr U32 RECORD_APPEND = 2; // payload extends the asset
+constexpr U32 RECORD_RENAME = 3; // payload is a RenamePayload
+constexpr U32 RECORD_REMOVE = 4; // no payload
+constexpr U32 RECORD_PATCH = 5;  // payload is a U32 offset into the asset and the bytes to put there
+
+#pragma pack(push, 1)
+struct RecordHeader
+{
+    U32 mMagic;
+    U32 mOp;
+    S32 mType;
+    U32 mSize;
+    LLUUID mID;
+};
+
+struct RenamePayload
+{
+    LLUUID mID;
+    S32 mType;
+};
+
+struct IndexExtent
+{
+    U32 mSegment;
+    U32 mSize;
+    U64 mOffset;
+};
+#pragma pack(pop)
+
+// Calls func for every intact record of a segment, with the payload of
+// rename records. Stops at the first damaged one.
+template <typename FUNC>
+static bool for_each_record(LLFILE* file, U64 size, FUNC func)
+{
+    RecordHeader header;
+    U64 offset = 0;
+    while (offset + sizeof(RecordHeader) <= size)
+    {
+        if (fseek(file, (long)offset, SEEK_SET) != 0 ||
+            fread(&header, sizeof(RecordHeader), 1, file) != 1 ||
+            header.mMagic != RECORD_MAGIC ||
+            offset + sizeof(RecordHeader) + header.mSize > size)
+        {
+            return false;
+        }
+
+        RenamePayload payload;
+        if (header.mOp == RECORD_RENAME &&
+            (header.mSize != sizeof(RenamePayload) || fread(&payload, sizeof(RenamePayload), 1, file) != 1))
+        {
+            return false;
+        }
+        func(header, payload);
+
+        offset += sizeof(RecordHeader) + header.mSize;
+    }
+    return true;
+}
+
+LLDiskCachePack::Segment::~Segment()
+{
+    if (mFile)
+    {
+        LLFile::close(mFile);
+    }
+}
+
+LLDiskCachePack::LLDiskCachePack(const std::string& pack_dir, bool read_only)
+:   mPackDir(pack_dir),
+    mReadOnly(read_only)
+{
+    LLFile::mkdir(mPackDir);
+
+    // Find the segments on disk
+    boost::system::error_code ec;
+#if LL_WINDOWS
+    boost::filesystem::path pack_path(ll_convert_string_to_wide(mPackDir));
+#else
+    boost::filesystem::path pack_path(mPackDir);
+#endif
+    std::vector<U32> segment_ids;
+    boost::filesystem::directory_iterator iter(pack_path, ec);
+    while (!ec.failed() && iter != boost::filesystem::directory_iterator())
+    {
+        const std::string name = iter->path().filename().string();
+        if (name.rfind(PACK_SEGMENT_PREFIX, 0) == 0 && iter->path().extension().string() == PACK_SEGMENT_EXT)
+        {
+            segment_ids.push_back((U32)strtoul(name.c_str() + PACK_SEGMENT_PREFIX.size(), nullptr, 10));
+        }
+        iter.increment(ec);
+    }
+    std::sort(segment_ids.begin(), segment_ids.end());
+
+    LLMutexLock lock(&mMutex);
+
+    for (U32 segment_id : segment_ids)
+    {
+        openSegment(segment_id);
+    }
+
+    // Segments have to be replayed oldest first, so a snapshot that lost
+    // track of a segment (i.e. compaction ran after it was saved) is only
+    // good for a full rescan.
+    std::map<U32, U64> scanned_sizes;
+    bool index_ok = loadIndex(scanned_sizes);
+    for (const auto& scanned : scanned_sizes)
+    {
+        if (mSegments.find(scanned.first) == mSegments.end())
+        {
+            index_ok = false;
+            break;
+        }
+    }
+    if (!index_ok)
+    {
+        mIndex.clear();
+        scanned_sizes.clear();
+    }
+
+    for (auto& segment : mSegments)
+    {
+        auto scanned = scanned_sizes.find(segment.first);
+        scanSegment(*segment.second, scanned != scanned_sizes.end() ? scanned->second : 0);
+    }
+
+    for (auto& segment : mSegments)
+    {
+        segment.second->mLiveBytes = 0;
+    }
+    for (const auto& entry : mIndex)
+    {
+        for (const Extent& extent : entry.second.mExtents)
+        {
+            mSegments[extent.mSegment]->mLiveBytes += extent.mSize;
+        }
+    }
+
+    mActiveSegment = mSegments.empty() ? 1 : mSegments.rbegin()->first;
+    if (!mReadOnly && mSegments.empty())
+    {
+        openSegment(mActiveSegment);
+    }
+
+    LL_INFOS() << "Opened pack cache in " << mPackDir << " with " << mIndex.size() << " entries in "
+               << mSegments.size() << " segments" << (index_ok ? "" : " (full scan)") << LL_ENDL;
+}
+
+LLDiskCachePack::~LLDiskCachePack()
+{
+    saveIndex();
+}
+
+std::string LLDiskCachePack::getSegmentPath(U32 segment_id) const
+{
+    return fmt::format("{}{}{}{:08d}{}", mPackDir, gDirUtilp->getDirDelimiter(), PACK_SEGMENT_PREFIX, segment_id, PACK_SEGMENT_EXT);
+}
+
+LLDiskCachePack::Segment* LLDiskCachePack::openSegment(U32 segment_id)
+{
+    const std::string path = getSegmentPath(segment_id);
+    // "a+b" appends every write to the end of the file but still reads from
+    // anywhere, which is exactly how segments are used.
+    LLFILE* file = LLFile::fopen(path, mReadOnly ? "rb" : "a+b");
+    if (!file)
+    {
+        LL_WARNS() << "Unable to open pack cache segment " << path << LL_ENDL;
+        return nullptr;
+    }
+
+    auto segment = std::make_unique<Segment>();
+    segment->mID = segment_id;
+    segment->mFile = file;
+    fseek(file, 0, SEEK_END);
+    segment->mSize = (U64)ftell(file);
+
+    Segment* segmentp = segment.get();
+    mSegments[segment_id] = std::move(segment);
+    return segmentp;
+}
+
+void LLDiskCachePack::scanSegment(Segment& segment, U64 offset)
+{
+    RecordHeader header;
+    while (offset + sizeof(RecordHeader) <= segment.mSize)
+    {
+        if (fseek(segment.mFile, (long)offset, SEEK_SET) != 0 ||
+            fread(&header, sizeof(RecordHeader), 1, segment.mFile) != 1 ||
+            header.mMagic != RECORD_MAGIC ||
+            offset + sizeof(RecordHeader) + header.mSize > segment.mSize)
+        {
+            break;
+        }
+
+        const U64 payload_offset = offset + sizeof(RecordHeader);
+        const Key key{ header.mID, header.mType };
+        switch (header.mOp)
+        {
+        case RECORD_FULL:
+        {
+            Entry entry;
+            entry.mExtents.push_back({ segment.mID, header.mSize, payload_offset });
+            entry.mSize = header.mSize;
+            mIndex[key] = std::move(entry);
+            break;
+        }
+        case RECORD_APPEND:
+        {
+            Entry& entry = mIndex[key];
+            entry.mExtents.push_back({ segment.mID, header.mSize, payload_offset });
+            entry.mSize += header.mSize;
+            break;
+        }
+        case RECORD_PATCH:
+        {
+            U32 patch_offset = 0;
+            if (header.mSize < sizeof(U32) || fread(&patch_offset, sizeof(U32), 1, segment.mFile) != 1)
+            {
+                break;
+            }
+            Entry& entry = mIndex[key];
+            if (patch_offset <= entry.mSize)
+            {
+                entry.splice(patch_offset, { segment.mID, header.mSize - (U32)sizeof(U32), payload_offset + sizeof(U32) });
+            }
+            break;
+        }
+        case RECORD_RENAME:
+        {
+            RenamePayload payload;
+            if (header.mSize != sizeof(RenamePayload) || fread(&payload, sizeof(RenamePayload), 1, segment.mFile) != 1)
+            {
+                break;
+            }
+            index_map_t::iterator iter = mIndex.find(key);
+            if (iter != mIndex.end())
+            {
+                Entry entry = std::move(iter->second);
+                mIndex.erase(iter);
+                mIndex[Key{ payload.mID, payload.mType }] = std::move(entry);
+            }
+            break;
+        }
+        case RECORD_REMOVE:
+            mIndex.erase(key);
+            break;
+        default:
+            break;
+        }
+
+        offset = payload_offset + header.mSize;
+    }
+
+    if (offset < segment.mSize)
+    {
+        // A torn record from a crash mid-write. Cut it off, or the records
+        // appended after it would never be found again.
+        LL_WARNS() << "Pack cache segment " << segment.mID << " is damaged at offset " << offset << LL_ENDL;
+        if (!mReadOnly)
+        {
+            LLFile::close(segment.mFile);
+            segment.mFile = nullptr;
+
+            boost::system::error_code ec;
+            boost::filesystem::resize_file(getSegmentPath(segment.mID), offset, ec);
+            segment.mFile = LLFile::fopen(getSegmentPath(segment.mID), "a+b");
+        }
+        segment.mSize = offset;
+    }
+}
+
+bool LLDiskCachePack::loadIndex(std::map<U32, U64>& scanned_sizes)
+{
+    LLFILE* file = LLFile::fopen(mPackDir + gDirUtilp->getDirDelimiter() + PACK_INDEX_NAME, "rb");
+    if (!file)
+    {
+        return false;
+    }
+
+    bool success = false;
+    U32 header[4] = { 0, 0, 0, 0 };
+    if (fread(header, sizeof(U32), 4, file) == 4 && header[0] == INDEX_MAGIC && header[1] == INDEX_VERSION)
+    {
+        const U32 segment_count = header[2];
+        const U32 entry_count = header[3];
+
+        success = true;
+        for (U32 i = 0; i < segment_count && success; ++i)
+        {
+            U32 segment_id = 0;
+            U64 scanned_size = 0;
+            success = fread(&segment_id, sizeof(U32), 1, file) == 1 &&
+                      fread(&scanned_size, sizeof(U64), 1, file) == 1;
+            scanned_sizes[segment_id] = scanned_size;
+        }
+
+        for (U32 i = 0; i < entry_count && success; ++i)
+        {
+            Key key;
+            U32 extent_count = 0;
+            success = fread(&key.mID, sizeof(LLUUID), 1, file) == 1 &&
+                      fread(&key.mType, sizeof(S32), 1, file) == 1 &&
+                      fread(&extent_count, sizeof(U32), 1, file) == 1;
+
+            Entry entry;
+            for (U32 j = 0; j < extent_count && success; ++j)
+            {
+                IndexExtent extent;
+                success = fread(&extent, sizeof(IndexExtent), 1, file) == 1;
+                entry.mExtents.push_back({ extent.mSegment, extent.mSize, extent.mOffset });
+                entry.mSize += extent.mSize;
+            }
+            if (success)
+            {
+                mIndex[key] = std::move(entry);
+            }
+        }
+    }
+    LLFile::close(file);
+
+    return success;
+}
+
+void LLDiskCachePack::saveIndex()
+{
+    if (mReadOnly)
+    {
+        return;
+    }
+
+    // Serialize under the lock, write without it
+    std::vector<U8> buffer;
+    auto put = [&buffer](const void* data, size_t size)
+    {
+        const U8* bytes = (const U8*)data;
+        buffer.insert(buffer.end(), bytes, bytes + size);
+    };
+
+    {
+        LLMutexLock lock(&mMutex);
+        const U32 header[4] = { INDEX_MAGIC, INDEX_VERSION, (U32)mSegments.size(), (U32)mIndex.size() };
+        put(header, sizeof(header));
+        for (const auto& segment : mSegments)
+        {
+            put(&segment.first, sizeof(U32));
+            put(&segment.second->mSize, sizeof(U64));
+        }
+        for (const auto& entry : mIndex)
+        {
+            const U32 extent_count = (U32)entry.second.mExtents.size();
+            put(&entry.first.mID, sizeof(LLUUID));
+            put(&entry.first.mType, sizeof(S32));
+            put(&extent_count, sizeof(U32));
+            for (const Extent& extent : entry.second.mExtents)
+            {
+                const IndexExtent index_extent{ extent.mSegment, extent.mSize, extent.mOffset };
+                put(&index_extent, sizeof(IndexExtent));
+            }
+        }
+    }
+
+    const std::string index_path = mPackDir + gDirUtilp->getDirDelimiter() + PACK_INDEX_NAME;
+    const std::string temp_path = index_path + ".tmp";
+    LLFILE* file = LLFile::fopen(temp_path, "wb");
+    if (!file)
+    {
+        LL_WARNS() << "Unable to write pack cache index " << temp_path << LL_ENDL;
+        return;
+    }
+    const bool success = fwrite(buffer.data(), buffer.size(), 1, file) == 1;
+    LLFile::close(file);
+
+    if (!success || LLFile::rename(temp_path, index_path) != 0)
+    {
+        LLFile::remove(temp_path, ENOENT);
+    }
+}
+
+bool LLDiskCachePack::appendRecord(U32 op, const Key& key, const U8* data, U32 size, Extent& extent)
+{
+    if (mReadOnly)
+    {
+        return false;
+    }
+
+    Segment* segment = mSegments[mActiveSegment].get();
+    if (!segment || !segment->mFile || segment->mSize >= SEGMENT_MAX_BYTES)
+    {
+        if (segment && segment->mFile)
+        {
+            ++mActiveSegment;
+        }
+        segment = openSegment(mActiveSegment);
+        if (!segment)
+        {
+            return false;
+        }
+    }
+
+    RecordHeader header;
+    header.mMagic = RECORD_MAGIC;
+    header.mOp = op;
+    header.mType = key.mType;
+    header.mSize = size;
+    header.mID = key.mID;
+
+    // Switching from reading to writing needs a positioning call in between
+    fseek(segment->mFile, 0, SEEK_END);
+    bool success = fwrite(&header, sizeof(RecordHeader), 1, segment->mFile) == 1 &&
+                   (size == 0 || fwrite(data, size, 1, segment->mFile) == 1);
+    success = (fflush(segment->mFile) == 0) && success;
+    if (!success)
+    {
+        // Whatever made it to disk is treated as a torn record on the next scan
+        LL_WARNS() << "Failed to append to pack cache segment " << segment->mID << LL_ENDL;
+        fseek(segment->mFile, 0, SEEK_END);
+        segment->mSize = (U64)ftell(segment->mFile);
+        return false;
+    }
+
+    extent.mSegment = segment->mID;
+    extent.mSize = size;
+    extent.mOffset = segment->mSize + sizeof(RecordHeader);
+    segment->mSize += sizeof(RecordHeader) + size;
+    return true;
+}
+
+bool LLDiskCachePack::readEntry(const Entry& entry, U8* data)
+{
+    for (const Extent& extent : entry.mExtents)
+    {
+        segment_map_t::iterator iter = mSegments.find(extent.mSegment);
+        if (iter == mSegments.end() || !iter->second->mFile ||
+            fseek(iter->second->mFile, (long)extent.mOffset, SEEK_SET) != 0 ||
+            (extent.mSize > 0 && fread(data, extent.mSize, 1, iter->second->mFile) != 1))
+        {
+            return false;
+        }
+        data += extent.mSize;
+    }
+    return true;
+}
+
+void LLDiskCachePack::releaseExtents(const Entry& entry)
+{
+    for (const Extent& extent : entry.mExtents)
+    {
+        segment_map_t::iterator iter = mSegments.find(extent.mSegment);
+        if (iter != mSegments.end())
+        {
+            iter->second->mLiveBytes -= llmin((U64)extent.mSize, iter->second->mLiveBytes);
+        }
+    }
+}
+
+void LLDiskCachePack::setEntry(const Key& key, Entry&& entry)
+{
+    index_map_t::iterator iter = mIndex.find(key);
+    if (iter != mIndex.end())
+    {
+        releaseExtents(iter->second);
+    }
+    for (const Extent& extent : entry.mExtents)
+    {
+        mSegments[extent.mSegment]->mLiveBytes += extent.mSize;
+    }
+    mIndex[key] = std::move(entry);
+}
+
+void LLDiskCachePack::eraseEntry(const Key& key)
+{
+    index_map_t::iterator iter = mIndex.find(key);
+    if (iter != mIndex.end())
+    {
+        releaseExtents(iter->second);
+        mIndex.erase(iter);
+    }
+}
+
+bool LLDiskCachePack::exists(const LLUUID& id, LLAssetType::EType type)
+{
+    LLMutexLock lock(&mMutex);
+    return mIndex.find(Key{ id, type }) != mIndex.end();
+}
+
+S32 LLDiskCachePack::getSize(const LLUUID& id, LLAssetType::EType type)
+{
+    LLMutexLock lock(&mMutex);
+    index_map_t::iterator iter = mIndex.find(Key{ id, type });
+    return iter != mIndex.end() ? (S32)iter->second.mSize : 0;
+}
+
+bool LLDiskCachePack::read(const LLUUID& id, LLAssetType::EType type, std::vector<U8>& data)
+{
+    LLMutexLock lock(&mMutex);
+    index_map_t::iterator iter = mIndex.find(Key{ id, type });
+    if (iter == mIndex.end())
+    {
+        return false;
+    }
+
+    data.resize(iter->second.mSize);
+    if (!readEntry(iter->second, data.data()))
+    {
+        LL_WARNS() << "Failed to read " << id << " from pack cache, dropping it" << LL_ENDL;
+        eraseEntry(iter->first);
+        data.clear();
+        return false;
+    }
+    return true;
+}
+
+bool LLDiskCachePack::write(const LLUUID& id, LLAssetType::EType type, const U8* data, S32 size)
+{
+    LLMutexLock lock(&mMutex);
+    const Key key{ id, type };
+    Entry entry;
+    Extent extent;
+    if (!appendRecord(RECORD_FULL, key, data, (U32)size, extent))
+    {
+        return false;
+    }
+    entry.mExtents.push_back(extent);
+    entry.mSize = (U32)size;
+    setEntry(key, std::move(entry));
+    return true;
+}
+
+bool LLDiskCachePack::append(const LLUUID& id, LLAssetType::EType type, const U8* data, S32 size)
+{
+    LLMutexLock lock(&mMutex);
+    const Key key{ id, type };
+    Extent extent;
+    if (!appendRecord(RECORD_APPEND, key, data, (U32)size, extent))
+    {
+        return false;
+    }
+    Entry& entry = mIndex[key];
+    entry.mExtents.push_back(extent);
+    entry.mSize += (U32)size;
+    mSegments[extent.mSegment]->mLiveBytes += extent.mSize;
+    return true;
+}
+
+bool LLDiskCachePack::patch(const LLUUID& id, LLAssetType::EType type, S32 offset, const U8* data, S32 size)
+{
+    LLMutexLock lock(&mMutex);
+    const Key key{ id, type };
+    index_map_t::iterator iter = mIndex.find(key);
+    if (offset < 0 || (U32)offset > (iter != mIndex.end() ? iter->second.mSize : 0))
+    {
+        return false;
+    }
+
+    std::vector<U8> payload(sizeof(U32) + size);
+    const U32 patch_offset = (U32)offset;
+    memcpy(payload.data(), &patch_offset, sizeof(U32));
+    memcpy(payload.data() + sizeof(U32), data, size);
+
+    Extent extent;
+    if (!appendRecord(RECORD_PATCH, key, payload.data(), (U32)payload.size(), extent))
+    {
+        return false;
+    }
+    extent.mOffset += sizeof(U32);
+    extent.mSize -= sizeof(U32);
+
+    Entry entry;
+    if (iter != mIndex.end())
+    {
+        entry = iter->second;
+    }
+    entry.splice(patch_offset, extent);
+    setEntry(key, std::move(entry));
+    return true;
+}
+
+void LLDiskCachePack::Entry::splice(U32 offset, const Extent& extent)
+{
+    const U32 splice_end = offset + extent.mSize;
+    std::vector<Extent> extents;
+    extents.reserve(mExtents.size() + 2);
+
+    bool inserted = false;
+    U32 pos = 0;
+    for (const Extent& old : mExtents)
+    {
+        const U32 end = pos + old.mSize;
+        if (pos < offset && old.mSize > 0)
+        {
+            // Kept up to the spliced bytes
+            extents.push_back({ old.mSegment, llmin(end, offset) - pos, old.mOffset });
+        }
+        if (end > splice_end)
+        {
+            if (!inserted)
+            {
+                extents.push_back(extent);
+                inserted = true;
+            }
+            // Kept from the end of the spliced bytes
+            const U32 start = llmax(pos, splice_end);
+            extents.push_back({ old.mSegment, end - start, old.mOffset + (start - pos) });
+        }
+        pos = end;
+    }
+    if (!inserted)
+    {
+        extents.push_back(extent);
+    }
+
+    mExtents = std::move(extents);
+    mSize = llmax(mSize, splice_end);
+}
+
+bool LLDiskCachePack::rename(const LLUUID& old_id, LLAssetType::EType old_type,
+                             const LLUUID& new_id, LLAssetType::EType new_type)
+{
+    LLMutexLock lock(&mMutex);
+    const Key old_key{ old_id, old_type };
+    const Key new_key{ new_id, new_type };
+    index_map_t::iterator iter = mIndex.find(old_key);
+    if (iter == mIndex.end() || old_key == new_key)
+    {
+        return iter != mIndex.end();
+    }
+
+    const RenamePayload payload{ new_id, new_type };
+    Extent extent;
+    if (!appendRecord(RECORD_RENAME, old_key, (const U8*)&payload, sizeof(RenamePayload), extent))
+    {
+        return false;
+    }
+
+    Entry entry = std::move(iter->second);
+    mIndex.erase(iter);
+    eraseEntry(new_key);
+    mIndex[new_key] = std::move(entry);
+    return true;
+}
+
+bool LLDiskCachePack::remove(const LLUUID& id, LLAssetType::EType type)
+{
+    LLMutexLock lock(&mMutex);
+    const Key key{ id, type };
+    if (mIndex.find(key) == mIndex.end())
+    {
+        return false;
+    }
+
+    Extent extent;
+    appendRecord(RECORD_REMOVE, key, nullptr, 0, extent);
+    eraseEntry(key);
+    return true;
+}
+
+uintmax_t LLDiskCachePack::removeAllTypes(const LLUUID& id)
+{
+    LLMutexLock lock(&mMutex);
+    uintmax_t released = 0;
+    for (S32 type = 0; type <= LLAssetType::AT_COUNT; ++type)
+    {
+        // AT_COUNT doubles as the slot for AT_UNKNOWN
+        const Key key{ id, type < LLAssetType::AT_COUNT ? type : (S32)LLAssetType::AT_UNKNOWN };
+        index_map_t::iterator iter = mIndex.find(key);
+        if (iter != mIndex.end())
+        {
+            released += iter->second.mSize;
+            Extent extent;
+            appendRecord(RECORD_REMOVE, key, nullptr, 0, extent);
+            eraseEntry(key);
+        }
+    }
+    return released;
+}
+
+void LLDiskCachePack::compact()
+{
+    if (mReadOnly)
+    {
+        return;
+    }
+
+    // Pick the sealed segment with the most garbage
+    U32 victim = 0;
+    {
+        LLMutexLock lock(&mMutex);
+        F64 worst_ratio = COMPACT_GARBAGE_RATIO;
+        for (const auto& segment : mSegments)
+        {
+            if (segment.first == mActiveSegment || segment.second->mSize == 0)
+            {
+                continue;
+            }
+            const F64 garbage_ratio = 1.0 - (F64)segment.second->mLiveBytes / (F64)segment.second->mSize;
+            if (garbage_ratio > worst_ratio)
+            {
+                worst_ratio = garbage_ratio;
+                victim = segment.first;
+            }
+        }
+    }
+
+    if (!victim)
+    {
+        return;
+    }
+
+    LL_INFOS() << "Compacting pack cache segment " << victim << LL_ENDL;
+
+    // Collect the keys that still live in the victim, then move them one
+    // at a time so nobody waits on the lock for long.
+    std::vector<Key> keys;
+    {
+        LLMutexLock lock(&mMutex);
+        for (const auto& entry : mIndex)
+        {
+            for (const Extent& extent : entry.second.mExtents)
+            {
+                if (extent.mSegment == victim)
+                {
+                    keys.push_back(entry.first);
+                    break;
+                }
+            }
+        }
+    }
+
+    std::vector<U8> data;
+    for (const Key& key : keys)
+    {
+        if (!LLApp::isRunning())
+        {
+            return;
+        }
+
+        LLMutexLock lock(&mMutex);
+        index_map_t::iterator iter = mIndex.find(key);
+        if (iter == mIndex.end())
+        {
+            continue;
+        }
+
+        // Rewritten as a single extent, which also merges appended assets
+        data.resize(iter->second.mSize);
+        Extent extent;
+        if (!readEntry(iter->second, data.data()) ||
+            !appendRecord(RECORD_FULL, key, data.data(), (U32)data.size(), extent))
+        {
+            LL_WARNS() << "Pack cache compaction of segment " << victim << " failed" << LL_ENDL;
+            return;
+        }
+
+        Entry entry;
+        entry.mExtents.push_back(extent);
+        entry.mSize = extent.mSize;
+        setEntry(key, std::move(entry));
+    }
+
+    std::vector<Key> removed;
+    std::vector<Key> renamed;
+    if (!findTombstones(victim, removed, renamed))
+    {
+        LL_WARNS() << "Pack cache compaction of segment " << victim << " failed to read its removals" << LL_ENDL;
+        return;
+    }
+
+    {
+        LLMutexLock lock(&mMutex);
+        for (const auto& entry : mIndex)
+        {
+            for (const Extent& extent : entry.second.mExtents)
+            {
+                if (extent.mSegment == victim)
+                {
+                    // Cannot happen as sealed segments are never written to,
+                    // but never delete data that is still referenced.
+                    LL_WARNS() << "Pack cache segment " << victim << " still in use after compaction" << LL_ENDL;
+                    return;
+                }
+            }
+        }
+        if (!carryTombstones(victim, removed, renamed))
+        {
+            LL_WARNS() << "Pack cache compaction of segment " << victim << " failed to keep its removals" << LL_ENDL;
+            return;
+        }
+        mSegments.erase(victim);
+    }
+    LLFile::remove(getSegmentPath(victim));
+
+    // The saved index refers to the deleted segment now
+    saveIndex();
+}
+
+bool LLDiskCachePack::findTombstones(U32 victim, std::vector<Key>& removed, std::vector<Key>& renamed)
+{
+    // Sealed segments never change, so their sizes are all that needs the
+    // lock. Scanning them can take a while and is done without it.
+    std::vector<std::pair<U32, U64>> segments;
+    {
+        LLMutexLock lock(&mMutex);
+        for (const auto& segment : mSegments)
+        {
+            if (segment.first > victim)
+            {
+                break;
+            }
+            segments.emplace_back(segment.first, segment.second->mSize);
+        }
+    }
+    if (segments.empty() || segments.back().first != victim)
+    {
+        return false;
+    }
+
+    auto scan = [this](const std::pair<U32, U64>& segment, auto func)
+    {
+        LLFILE* file = LLFile::fopen(getSegmentPath(segment.first), "rb");
+        if (!file)
+        {
+            return false;
+        }
+        const bool success = for_each_record(file, segment.second, func);
+        LLFile::close(file);
+        return success;
+    };
+
+    // Removals and renames recorded in the victim still shadow the records
+    // of older segments on a rescan, so they have to outlive it.
+    std::vector<Key> victim_removed;
+    if (!scan(segments.back(),
+            [&](const RecordHeader& header, const RenamePayload& payload)
+            {
+                if (header.mOp == RECORD_REMOVE || header.mOp == RECORD_RENAME)
+                {
+                    victim_removed.push_back(Key{ header.mID, header.mType });
+                }
+                if (header.mOp == RECORD_RENAME)
+                {
+                    renamed.push_back(Key{ payload.mID, payload.mType });
+                }
+            }))
+    {
+        return false;
+    }
+    segments.pop_back();
+
+    if (victim_removed.empty())
+    {
+        return true;
+    }
+
+    // Keys that older segments would bring back, renames included
+    boost::unordered_flat_set<Key, boost::hash<Key>> older_keys;
+    for (const auto& segment : segments)
+    {
+        if (!scan(segment,
+                [&](const RecordHeader& header, const RenamePayload& payload)
+                {
+                    older_keys.insert(Key{ header.mID, header.mType });
+                    if (header.mOp == RECORD_RENAME)
+                    {
+                        older_keys.insert(Key{ payload.mID, payload.mType });
+                    }
+                }))
+        {
+            return false;
+        }
+    }
+
+    for (const Key& key : victim_removed)
+    {
+        if (older_keys.count(key))
+        {
+            removed.push_back(key);
+        }
+    }
+    return true;
+}
+
+bool LLDiskCachePack::carryTombstones(U32 victim, const std::vector<Key>& removed, const std::vector<Key>& renamed)
+{
+    // A key that is gone for good only needs a fresh tombstone. Later
+    // records of a key that was written again already override the old ones.
+    Extent extent;
+    for (const Key& key : removed)
+    {
+        if (mIndex.find(key) == mIndex.end() &&
+            !appendRecord(RECORD_REMOVE, key, nullptr, 0, extent))
+        {
+            return false;
+        }
+    }
+
+    // A rename target reaches its data in older segments only through the
+    // dropped rename record, so give it a record of its own.
+    std::vector<U8> data;
+    for (const Key& key : renamed)
+    {
+        index_map_t::iterator iter = mIndex.find(key);
+        if (iter == mIndex.end())
+        {
+            continue;
+        }
+
+        bool from_older = false;
+        for (const Extent& entry_extent : iter->second.mExtents)
+        {
+            from_older |= entry_extent.mSegment < victim;
+        }
+        if (!from_older)
+        {
+            continue;
+        }
+
+        data.resize(iter->second.mSize);
+        if (!readEntry(iter->second, data.data()) ||
+            !appendRecord(RECORD_FULL, key, data.data(), (U32)data.size(), extent))
+        {
+            return false;
+        }
+
+        Entry entry;
+        entry.mExtents.push_back(extent);
+        entry.mSize = extent.mSize;
+        setEntry(key, std::move(entry));
+    }
+    return true;
+}
+
+void LLDiskCachePack::getEntries(std::vector<std::pair<LLUUID, uintmax_t>>& entries)
+{
+    LLMutexLock lock(&mMutex);
+    boost::unordered_flat_map<LLUUID, uintmax_t> sizes;
+    for (const auto& entry : mIndex)
+    {
+        sizes[entry.first.mID] += entry.second.mSize;
+    }
+    entries.assign(sizes.begin(), sizes.end());
+}
+
+void LLDiskCachePack::getUsage(uintmax_t& total_bytes, uintmax_t& live_bytes)
+{
+    LLMutexLock lock(&mMutex);
+    total_bytes = 0;
+    live_bytes = 0;
+    for (const auto& segment : mSegments)
+    {
+        total_bytes += segment.second->mSize;
+        live_bytes += segment.second->mLiveBytes;
+    }
+}
@@ -0,0 +1,206 @@
+/**
+ * @file lldiskcachepack.h
+ * @brief Packed, segment based storage backend for the disk cache.
+ *
+ * @Description:
+ * Instead of one file per asset, assets are stored as records in a small
+ * number of large segment files and located through an in-memory hash
+ * index keyed by asset ID and asset type.
+ * 1/ Every change is a record appended to the active segment: a full copy
+ *    of an asset, an extension of an asset (LLFileSystem::APPEND writes),
+ *    an overwrite of part of an asset (LLFileSystem::READ_WRITE writes), a
+ *    rename or a removal. Bytes already written are never modified.
+ * 2/ Once the active segment reaches SEGMENT_MAX_BYTES it is sealed and a
+ *    new one is started.
+ * 3/ The index is saved together with how far into each segment it is
+ *    valid. On startup only records appended after that point are scanned;
+ *    without a usable index every record header is scanned once.
+ * 4/ Superseded records are garbage. compact() copies the live data out of
+ *    the sparsest sealed segment into the active one and deletes it.
+ *
+ * All public functions are thread safe.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLDISKCACHEPACK_H
+#define LL_LLDISKCACHEPACK_H
+
+#include "llassettype.h"
+#include "llfile.h"
+#include "llmutex.h"
+#include "lluuid.h"
+
+#include "boost/unordered/unordered_flat_map.hpp"
+
+#include <map>
+#include <memory>
+
+class LLDiskCachePack
+{
+public:
+    /**
+     * Open (or create) the pack store in pack_dir. A read only store never
+     * writes, truncates or compacts anything.
+     */
+    LLDiskCachePack(const std::string& pack_dir, bool read_only);
+    ~LLDiskCachePack();
+
+    bool exists(const LLUUID& id, LLAssetType::EType type);
+    S32 getSize(const LLUUID& id, LLAssetType::EType type);
+
+    /**
+     * Read the whole asset into data. Returns false if it is not stored.
+     */
+    bool read(const LLUUID& id, LLAssetType::EType type, std::vector<U8>& data);
+
+    /**
+     * Replace the asset with size bytes from data
+     */
+    bool write(const LLUUID& id, LLAssetType::EType type, const U8* data, S32 size);
+
+    /**
+     * Add size bytes from data to the end of the asset, creating it if
+     * needed. Does not copy what is already stored.
+     */
+    bool append(const LLUUID& id, LLAssetType::EType type, const U8* data, S32 size);
+
+    /**
+     * Overwrite the asset with size bytes from data starting at offset,
+     * which must not be past its end, creating or extending it as needed.
+     * Does not copy the rest of the asset.
+     */
+    bool patch(const LLUUID& id, LLAssetType::EType type, S32 offset, const U8* data, S32 size);
+
+    bool rename(const LLUUID& old_id, LLAssetType::EType old_type,
+                const LLUUID& new_id, LLAssetType::EType new_type);
+    bool remove(const LLUUID& id, LLAssetType::EType type);
+
+    /**
+     * Remove the asset under every type it is stored as. Used for eviction,
+     * which only knows asset IDs. Returns the number of bytes released.
+     */
+    uintmax_t removeAllTypes(const LLUUID& id);
+
+    /**
+     * Reclaim space from the sealed segment with the most garbage, if it
+     * has more than COMPACT_GARBAGE_RATIO of it. Moves one record at a
+     * time and scans segments through handles of its own, so readers and
+     * writers are only held up briefly.
+     */
+    void compact();
+
+    /**
+     * Save the index so the next session can skip scanning the segments
+     */
+    void saveIndex();
+
+    /**
+     * Report every stored asset and its size, summed over types.
+     */
+    void getEntries(std::vector<std::pair<LLUUID, uintmax_t>>& entries);
+
+    /**
+     * Total bytes in segment files and the part of it still referenced
+     */
+    void getUsage(uintmax_t& total_bytes, uintmax_t& live_bytes);
+
+private:
+    struct Key
+    {
+        LLUUID mID;
+        S32 mType;
+
+        bool operator==(const Key& other) const { return mID == other.mID && mType == other.mType; }
+        friend std::size_t hash_value(const Key& key)
+        {
+            std::size_t seed = hash_value(key.mID);
+            boost::hash_combine(seed, key.mType);
+            return seed;
+        }
+    };
+
+    // A run of asset bytes inside a segment
+    struct Extent
+    {
+        U32 mSegment;
+        U32 mSize;
+        U64 mOffset;
+    };
+
+    // Most assets are written in one go; xfers append one extent per packet
+    // and in-place updates split extents until the asset is compacted.
+    struct Entry
+    {
+        std::vector<Extent> mExtents;
+        U32 mSize = 0;
+
+        // Make extent the bytes at offset, which must not be past mSize
+        void splice(U32 offset, const Extent& extent);
+    };
+
+    struct Segment
+    {
+        ~Segment();
+
+        U32 mID = 0;
+        LLFILE* mFile = nullptr;
+        U64 mSize = 0;
+        U64 mLiveBytes = 0;
+    };
+
+    typedef boost::unordered_flat_map<Key, Entry, boost::hash<Key>> index_map_t;
+    typedef std::map<U32, std::unique_ptr<Segment>> segment_map_t;
+
+    std::string getSegmentPath(U32 segment_id) const;
+
+    bool loadIndex(std::map<U32, U64>& scanned_sizes);
+    void scanSegment(Segment& segment, U64 offset);
+    Segment* openSegment(U32 segment_id);
+
+    /**
+     * Find the removals and renames in the victim segment that still matter
+     * once it is gone. Reads the sealed segments through handles of its own
+     * and must be called without mMutex held.
+     */
+    bool findTombstones(U32 victim, std::vector<Key>& removed, std::vector<Key>& renamed);
+
+    /**
+     * Helpers below must be called with mMutex held
+     */
+    bool appendRecord(U32 op, const Key& key, const U8* data, U32 size, Extent& extent);
+    bool readEntry(const Entry& entry, U8* data);
+    void setEntry(const Key& key, Entry&& entry);
+    void eraseEntry(const Key& key);
+    void releaseExtents(const Entry& entry);
+    bool carryTombstones(U32 victim, const std::vector<Key>& removed, const std::vector<Key>& renamed);
+
+    const std::string mPackDir;
+    const bool mReadOnly;
+
+    LLMutex mMutex;
+    index_map_t mIndex;
+    segment_map_t mSegments;
+    U32 mActiveSegment = 0;
+};
+
+#endif // LL_LLDISKCACHEPACK_H
@@ -33,6 +33,16 @@
 #include "llfilesystem.h"
 #include "llfasttimer.h"
 #include "lldiskcache.h"
+#include "lldiskcachepack.h"
+
+#if LL_WINDOWS
+#include "llwin32headerslean.h"
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 const S32 LLFileSystem::READ        = 0x00000001;
 const S32 LLFileSystem::WRITE       = 0x00000002;
@@ -48,32 +58,38 @@ LLFileSystem::LLFileSystem(const LLUUID& file_id, const LLAssetType::EType file_
     mPosition = 0;
     mBytesRead = 0;
     mMode = mode;
+    mMappedData = nullptr;
+    mMappedSize = 0;
+    mMapAttempted = false;
+    mPackCache = LLDiskCache::getInstance()->getPackCache();
 
     // This block of code was originally called in the read() method but after comments here:
     // https://bitbucket.org/lindenlab/viewer/commits/e28c1b46e9944f0215a13cab8ee7dded88d7fc90#comment-10537114
     // we decided to follow Henri's suggestion and move the code to update the last access time here.
     if (mode == LLFileSystem::READ)
     {
-        // update the last access time for the file if it exists - this is required
+        // update the last access time for the file if it is cached - this is required
         // even though we are reading and not writing because this is the
         // way the cache works - it relies on a valid "last accessed time" for
-        // each file so it knows how to remove the oldest, unused files
-        boost::system::error_code ec;
-        bool exists = boost::filesystem::exists(mFilePath, ec);
-        if (exists && !ec.failed())
-        {
-            LLDiskCache::updateFileAccessTime(mFilePath);
-        }
+        // each file so it knows how to remove the oldest, unused files.
+        // This only touches the in-memory index, the file itself is left alone.
+        LLDiskCache::getInstance()->notifyRead(file_id);
     }
 }
 
 LLFileSystem::~LLFileSystem()
 {
+    unmapFile();
 }
 
 // static
 bool LLFileSystem::getExists(const LLUUID& file_id, const LLAssetType::EType file_type)
 {
+    if (LLDiskCachePack* pack_cache = LLDiskCache::getInstance()->getPackCache())
+    {
+        return pack_cache->exists(file_id, file_type);
+    }
+
     const boost::filesystem::path filename = LLDiskCache::getInstance()->metaDataToFilepath(file_id, file_type);
     boost::system::error_code ec;
     return boost::filesystem::exists(filename, ec) && !ec.failed();
@@ -84,7 +100,13 @@ bool LLFileSystem::removeFile(const LLUUID& file_id, const LLAssetType::EType fi
 {
     const boost::filesystem::path filename = LLDiskCache::getInstance()->metaDataToFilepath(file_id, file_type);
 
+    if (LLDiskCachePack* pack_cache = LLDiskCache::getInstance()->getPackCache())
+    {
+        pack_cache->remove(file_id, file_type);
+        suppress_error = ENOENT;
+    }
     LLFile::remove(filename, suppress_error);
+    LLDiskCache::getInstance()->notifyRemove(file_id);
 
     return true;
 }
@@ -100,6 +122,11 @@ bool LLFileSystem::renameFile(const LLUUID& old_file_id, const LLAssetType::ETyp
 // static
 S32 LLFileSystem::getFileSize(const LLUUID& file_id, const LLAssetType::EType file_type)
 {
+    if (LLDiskCachePack* pack_cache = LLDiskCache::getInstance()->getPackCache())
+    {
+        return pack_cache->getSize(file_id, file_type);
+    }
+
     const boost::filesystem::path filename = LLDiskCache::getInstance()->metaDataToFilepath(file_id, file_type);
     boost::system::error_code ec;
     S32 file_size = boost::filesystem::file_size(filename, ec);
@@ -114,6 +141,27 @@ BOOL LLFileSystem::read(U8* buffer, S32 bytes)
 {
     BOOL success = FALSE;
 
+    if (mPackCache && !mMappedData)
+    {
+        loadPackData();
+        if (!mMappedData)
+        {
+            return FALSE;
+        }
+    }
+
+    if (mMappedData)
+    {
+        mBytesRead = llclamp(mMappedSize - mPosition, 0, bytes);
+        if (mBytesRead)
+        {
+            memcpy(buffer, mMappedData + mPosition, mBytesRead);
+            mPosition += mBytesRead;
+            success = TRUE;
+        }
+        return success;
+    }
+
     LLFILE* file = LLFile::fopen(mFilePath, TEXT("rb"));
     if (file)
     {
@@ -150,7 +198,32 @@ BOOL LLFileSystem::write(const U8* buffer, S32 bytes)
 {
     BOOL success = FALSE;
 
-    if (mMode == APPEND)
+    LLDiskCache::getInstance()->beginWrite(mFileID);
+
+    if (mPackCache)
+    {
+        if (mMode == APPEND)
+        {
+            success = mPackCache->append(mFileID, mFileType, buffer, bytes);
+            mPosition = mPackCache->getSize(mFileID, mFileType);
+        }
+        else if (mMode == READ_WRITE)
+        {
+            // Only the new bytes are stored, the rest of the asset stays put
+            success = mPackCache->patch(mFileID, mFileType, mPosition, buffer, bytes);
+            mPosition += bytes;
+        }
+        else
+        {
+            success = mPackCache->write(mFileID, mFileType, buffer, bytes);
+            mPosition = bytes;
+        }
+
+        // Whatever was loaded for reading is stale now
+        unmapFile();
+        mMapAttempted = false;
+    }
+    else if (mMode == APPEND)
     {
         LLFILE* ofs = LLFile::fopen(mFilePath, TEXT("a+b"));
         if (ofs)
@@ -188,6 +261,9 @@ BOOL LLFileSystem::write(const U8* buffer, S32 bytes)
     }
     else
     {
+#if LL_WINDOWS
+        // Windows refuses to truncate a file that is mapped elsewhere, in
+        // which case this write fails and the cached copy is left alone.
         LLFILE* ofs = LLFile::fopen(mFilePath, TEXT("wb"));
         if (ofs)
         {
@@ -196,8 +272,41 @@ BOOL LLFileSystem::write(const U8* buffer, S32 bytes)
             fclose(ofs);
             success = (bytes_written == bytes);
         }
+#else
+        // Write a new file and move it over the old one rather than
+        // truncating in place: another LLFileSystem may have the old
+        // contents mapped and would fault reading past the new end.
+        boost::system::error_code ec;
+        boost::filesystem::path temp_path = mFilePath;
+        temp_path += boost::filesystem::unique_path(".%%%%-%%%%-%%%%.tmp", ec);
+        LLFILE* ofs = ec.failed() ? nullptr : LLFile::fopen(temp_path, TEXT("wb"));
+        if (ofs)
+        {
+            S32 bytes_written = fwrite(buffer, 1, bytes, ofs);
+            mPosition = ftell(ofs);
+            fclose(ofs);
+            success = (bytes_written == bytes);
+
+            if (success)
+            {
+                boost::filesystem::rename(temp_path, mFilePath, ec);
+                success = !ec.failed();
+            }
+            if (!success)
+            {
+                boost::filesystem::remove(temp_path, ec);
+            }
+        }
+#endif
     }
 
+    if (success)
+    {
+        // "wb" and "a+b" leave mPosition at the end of the file, an in-place
+        // update may have stopped short of it.
+        const S32 file_size = (mMode == READ_WRITE) ? getSize() : mPosition;
+        LLDiskCache::getInstance()->notifyWrite(mFileID, (uintmax_t)file_size);
+    }
 
     return success;
 }
@@ -239,6 +348,16 @@ S32 LLFileSystem::tell() const
 
 S32 LLFileSystem::getSize()
 {
+    if (mMappedData)
+    {
+        return mMappedSize;
+    }
+
+    if (mPackCache)
+    {
+        return mPackCache->getSize(mFileID, mFileType);
+    }
+
     boost::system::error_code ec;
     S32 file_size = boost::filesystem::file_size(mFilePath, ec);
     if(ec.failed())
@@ -254,10 +373,136 @@ S32 LLFileSystem::getMaxSize()
     return INT_MAX;
 }
 
+std::span<const U8> LLFileSystem::getMappedData()
+{
+    if (mMapAttempted || mMode != READ)
+    {
+        return std::span<const U8>(mMappedData, mMappedSize);
+    }
+    mMapAttempted = true;
+
+    if (mPackCache)
+    {
+        loadPackData();
+        return std::span<const U8>(mMappedData, mMappedSize);
+    }
+
+#if LL_WINDOWS
+    HANDLE file = CreateFileW(mFilePath.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                              nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        return {};
+    }
+
+    LARGE_INTEGER file_size;
+    if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart <= 0 || file_size.QuadPart > S32_MAX)
+    {
+        CloseHandle(file);
+        return {};
+    }
+
+    HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    CloseHandle(file);
+    if (!mapping)
+    {
+        return {};
+    }
+
+    // The view keeps the mapping object alive
+    void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(mapping);
+    if (!view)
+    {
+        return {};
+    }
+
+    mMappedData = (const U8*)view;
+    mMappedSize = (S32)file_size.QuadPart;
+#else
+    int fd = ::open(mFilePath.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        return {};
+    }
+
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) != 0 || file_stat.st_size <= 0 || file_stat.st_size > S32_MAX)
+    {
+        ::close(fd);
+        return {};
+    }
+
+    // The mapping keeps the file alive even if the cache purges it
+    void* view = mmap(nullptr, (size_t)file_stat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (view == MAP_FAILED)
+    {
+        return {};
+    }
+
+    // Assets are parsed front to back in one go, start paging it in now
+    madvise(view, (size_t)file_stat.st_size, MADV_WILLNEED);
+
+    mMappedData = (const U8*)view;
+    mMappedSize = (S32)file_stat.st_size;
+#endif
+
+    return std::span<const U8>(mMappedData, mMappedSize);
+}
+
+void LLFileSystem::loadPackData()
+{
+    if (mPackCache->read(mFileID, mFileType, mPackData) && !mPackData.empty())
+    {
+        mMappedData = mPackData.data();
+        mMappedSize = (S32)mPackData.size();
+    }
+}
+
+void LLFileSystem::unmapFile()
+{
+    if (mPackCache)
+    {
+        mMappedData = nullptr;
+        mMappedSize = 0;
+        mPackData.clear();
+    }
+    else if (mMappedData)
+    {
+#if LL_WINDOWS
+        UnmapViewOfFile(mMappedData);
+#else
+        munmap((void*)mMappedData, (size_t)mMappedSize);
+#endif
+        mMappedData = nullptr;
+        mMappedSize = 0;
+    }
+}
+
 BOOL LLFileSystem::rename(const LLUUID& new_id, const LLAssetType::EType new_type)
 {
     const boost::filesystem::path new_filename = LLDiskCache::getInstance()->metaDataToFilepath(new_id, new_type);
 
+    LLDiskCache::getInstance()->beginWrite(new_id);
+
+    if (mPackCache)
+    {
+        if (mPackCache->rename(mFileID, mFileType, new_id, new_type))
+        {
+            LLDiskCache::getInstance()->notifyRename(mFileID, new_id);
+        }
+        else
+        {
+            LL_WARNS() << "Failed to rename " << mFileID << " to " << new_id << " in the pack cache" << LL_ENDL;
+        }
+
+        mFileID = new_id;
+        mFileType = new_type;
+        mFilePath = new_filename;
+        return TRUE;
+    }
+
     // Rename needs the new file to not exist.
     boost::system::error_code ec;
     boost::filesystem::remove(new_filename, ec);
@@ -276,6 +521,10 @@ BOOL LLFileSystem::rename(const LLUUID& new_id, const LLAssetType::EType new_typ
         //return FALSE;
         LL_WARNS() << "Failed to rename " << mFileID << " to " << new_id << " reason: "  << ec.what() << LL_ENDL;
     }
+    else
+    {
+        LLDiskCache::getInstance()->notifyRename(mFileID, new_id);
+    }
 
     mFileID = new_id;
     mFileType = new_type;
@@ -286,7 +535,13 @@ BOOL LLFileSystem::rename(const LLUUID& new_id, const LLAssetType::EType new_typ
 
 BOOL LLFileSystem::remove()
 {
+    if (mPackCache)
+    {
+        mPackCache->remove(mFileID, mFileType);
+    }
+
     boost::system::error_code ec;
     boost::filesystem::remove(mFilePath, ec);
+    LLDiskCache::getInstance()->notifyRemove(mFileID);
     return TRUE;
 }
@@ -34,6 +34,8 @@
 #include "llassettype.h"
 #include "lldiskcache.h"
 
+#include <span>
+
 class LLFileSystem
 {
     public:
@@ -50,6 +52,18 @@ class LLFileSystem
 
         S32 getSize();
         S32 getMaxSize();
+
+        /**
+         * Map the whole file read-only and return a view of its contents,
+         * so parsers can work on the cached bytes without copying them.
+         * The mapping is created on the first call and stays valid for the
+         * lifetime of this object; read() and getSize() are served from it
+         * from then on. Only available in READ mode. Returns an empty span
+         * if the file is missing, empty or cannot be mapped, in which case
+         * callers should fall back to read().
+         * With the pack backend the asset is read into memory instead.
+         */
+        std::span<const U8> getMappedData();
         BOOL rename(const LLUUID& new_id, const LLAssetType::EType new_type);
         BOOL remove();
 
@@ -72,6 +86,15 @@ class LLFileSystem
         S32     mPosition;
         S32     mMode;
         S32     mBytesRead;
+        const U8* mMappedData;
+        S32     mMappedSize;
+        bool    mMapAttempted;
+        LLDiskCachePack* mPackCache;
+        std::vector<U8> mPackData;
+
+    private:
+        void unmapFile();
+        void loadPackData();
 //private:
 //    static const std::string idToFilepath(const std::string id, LLAssetType::EType at);
 };
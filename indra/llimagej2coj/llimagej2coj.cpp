@@ -32,6 +32,8 @@
 
 #include "lltimer.h"
 
+#include <immintrin.h>
+
 struct LLJp2StreamReader 
 {
 	LLJp2StreamReader(LLImageJ2C* pImage) : m_pImage(pImage), m_Position(0) { }
@@ -215,15 +217,128 @@ int ceildivpow2(int a, int b)
 	return (a + (1 << b) - 1) >> b;
 }
 
+// Load 16 samples of a component, rescale them to 8 bits and clamp them
+// to [0, 255]. The result holds one sample per byte.
+static inline __m128i pack_samples(const OPJ_INT32* in, const __m128i& bias, const __m128i& shift)
+{
+	__m128i a = _mm_loadu_si128((const __m128i*)in);
+	__m128i b = _mm_loadu_si128((const __m128i*)(in + 4));
+	__m128i c = _mm_loadu_si128((const __m128i*)(in + 8));
+	__m128i d = _mm_loadu_si128((const __m128i*)(in + 12));
+	a = _mm_sra_epi32(_mm_add_epi32(a, bias), shift);
+	b = _mm_sra_epi32(_mm_add_epi32(b, bias), shift);
+	c = _mm_sra_epi32(_mm_add_epi32(c, bias), shift);
+	d = _mm_sra_epi32(_mm_add_epi32(d, bias), shift);
+	// Signed saturation to 16 bits, then unsigned saturation to 8 bits
+	return _mm_packus_epi16(_mm_packs_epi32(a, b), _mm_packs_epi32(c, d));
+}
+
+// Convert the planar components OpenJPEG decodes into to the interleaved,
+// 8 bits per channel layout of LLImageRaw. Rows are flipped on the way
+// since LLImageRaw stores the bottom row first. Handles 1 to 4 channels.
+static void copy_planar_to_interleaved(U8* dst, const OPJ_INT32* const* planes, const S32* bias, const S32* shift,
+									   S32 channels, S32 width, S32 height, S32 src_stride)
+{
+	// Byte shuffles spreading 16 samples of each of 3 channels over 48 bytes
+	const __m128i rgb_mask[3][3] = {
+		{ _mm_setr_epi8(0, -1, -1, 1, -1, -1, 2, -1, -1, 3, -1, -1, 4, -1, -1, 5),
+		  _mm_setr_epi8(-1, 0, -1, -1, 1, -1, -1, 2, -1, -1, 3, -1, -1, 4, -1, -1),
+		  _mm_setr_epi8(-1, -1, 0, -1, -1, 1, -1, -1, 2, -1, -1, 3, -1, -1, 4, -1) },
+		{ _mm_setr_epi8(-1, -1, 6, -1, -1, 7, -1, -1, 8, -1, -1, 9, -1, -1, 10, -1),
+		  _mm_setr_epi8(5, -1, -1, 6, -1, -1, 7, -1, -1, 8, -1, -1, 9, -1, -1, 10),
+		  _mm_setr_epi8(-1, 5, -1, -1, 6, -1, -1, 7, -1, -1, 8, -1, -1, 9, -1, -1) },
+		{ _mm_setr_epi8(-1, 11, -1, -1, 12, -1, -1, 13, -1, -1, 14, -1, -1, 15, -1, -1),
+		  _mm_setr_epi8(-1, -1, 11, -1, -1, 12, -1, -1, 13, -1, -1, 14, -1, -1, 15, -1),
+		  _mm_setr_epi8(10, -1, -1, 11, -1, -1, 12, -1, -1, 13, -1, -1, 14, -1, -1, 15) } };
+
+	__m128i bias_v[4];
+	__m128i shift_v[4];
+	for (S32 c = 0; c < channels; ++c)
+	{
+		bias_v[c] = _mm_set1_epi32(bias[c]);
+		shift_v[c] = _mm_cvtsi32_si128(shift[c]);
+	}
+
+	for (S32 y = 0; y < height; ++y)
+	{
+		const size_t src_offset = (size_t)y * src_stride;
+		U8* out = dst + (size_t)(height - 1 - y) * width * channels;
+
+		S32 x = 0;
+		for (; x + 16 <= width; x += 16)
+		{
+			__m128i p[4];
+			for (S32 c = 0; c < channels; ++c)
+			{
+				p[c] = pack_samples(planes[c] + src_offset + x, bias_v[c], shift_v[c]);
+			}
+
+			switch (channels)
+			{
+			case 1:
+				_mm_storeu_si128((__m128i*)out, p[0]);
+				break;
+			case 2:
+				_mm_storeu_si128((__m128i*)out, _mm_unpacklo_epi8(p[0], p[1]));
+				_mm_storeu_si128((__m128i*)(out + 16), _mm_unpackhi_epi8(p[0], p[1]));
+				break;
+			case 3:
+				for (S32 i = 0; i < 3; ++i)
+				{
+					__m128i v = _mm_or_si128(_mm_shuffle_epi8(p[0], rgb_mask[i][0]),
+											 _mm_or_si128(_mm_shuffle_epi8(p[1], rgb_mask[i][1]),
+														  _mm_shuffle_epi8(p[2], rgb_mask[i][2])));
+					_mm_storeu_si128((__m128i*)(out + i * 16), v);
+				}
+				break;
+			default:
+			{
+				__m128i rg_lo = _mm_unpacklo_epi8(p[0], p[1]);
+				__m128i rg_hi = _mm_unpackhi_epi8(p[0], p[1]);
+				__m128i ba_lo = _mm_unpacklo_epi8(p[2], p[3]);
+				__m128i ba_hi = _mm_unpackhi_epi8(p[2], p[3]);
+				_mm_storeu_si128((__m128i*)out, _mm_unpacklo_epi16(rg_lo, ba_lo));
+				_mm_storeu_si128((__m128i*)(out + 16), _mm_unpackhi_epi16(rg_lo, ba_lo));
+				_mm_storeu_si128((__m128i*)(out + 32), _mm_unpacklo_epi16(rg_hi, ba_hi));
+				_mm_storeu_si128((__m128i*)(out + 48), _mm_unpackhi_epi16(rg_hi, ba_hi));
+				break;
+			}
+			}
+			out += 16 * channels;
+		}
+
+		for (; x < width; ++x)
+		{
+			for (S32 c = 0; c < channels; ++c)
+			{
+				S32 v = (planes[c][src_offset + x] + bias[c]) >> shift[c];
+				*out++ = (U8)llclamp(v, 0, 255);
+			}
+		}
+	}
+}
+
 LLImageJ2COJ::LLImageJ2COJ()
-	: LLImageJ2CImpl()
+	: LLImageJ2CImpl(),
+	mHasRegion(false)
 {
+	mRegion[0] = mRegion[1] = mRegion[2] = mRegion[3] = 0;
 }
 
 bool LLImageJ2COJ::initDecode(LLImageJ2C &base, LLImageRaw &raw_image, int discard_level, int* region)
 {
-	// No specific implementation for this method in the OpenJpeg case
-	return false;
+	// LLImageJ2C::initDecode() already set the discard level that drives
+	// the reduce factor, only the region {x0, y0, x1, y1} is kept for
+	// decodeImpl().
+	mHasRegion = (region != NULL);
+	if (mHasRegion)
+	{
+		for (S32 i = 0; i < 4; ++i)
+		{
+			mRegion[i] = region[i];
+		}
+	}
+	return true;
 }
 
 bool LLImageJ2COJ::initEncode(LLImageJ2C &base, LLImageRaw &raw_image, int blocks_size, int precincts_size, int levels)
@@ -283,7 +398,8 @@ bool LLImageJ2COJ::decodeImpl(LLImageJ2C &base, LLImageRaw &raw_image, F32 decod
 	/* set decoding parameters to default values */
 	opj_set_default_decoder_parameters(&parameters);
 
-	parameters.cp_reduce = base.getRawDiscardLevel();
+	// The reduce factor is applied once the header is read, see below
+	parameters.cp_reduce = 0;
 
 	/* decode the code-stream */
 	/* ---------------------- */
@@ -331,9 +447,47 @@ bool LLImageJ2COJ::decodeImpl(LLImageJ2C &base, LLImageRaw &raw_image, F32 decod
 	opj_stream_set_user_data_length(opj_stream_p, base.getDataSize());
 
 	/* decode the stream and fill the image structure */
-	bool success = opj_read_header(opj_stream_p, opj_decoder_p, &image) &&
-	                opj_decode(opj_decoder_p, opj_stream_p, image) &&
-					opj_end_decompress(opj_decoder_p, opj_stream_p);
+	bool success = opj_read_header(opj_stream_p, opj_decoder_p, &image);
+
+	if (success)
+	{
+		// Skip the resolution levels the requested discard level does not
+		// need. Asking for more levels than the codestream has fails the
+		// whole decode, so clamp to what the header advertises.
+		S32 reduce = llmax((S32)base.getRawDiscardLevel(), 0);
+		opj_codestream_info_v2_t* info = opj_get_cstr_info(opj_decoder_p);
+		if (info)
+		{
+			if (info->m_default_tile_info.tccp_info)
+			{
+				S32 levels = (S32)info->m_default_tile_info.tccp_info[0].numresolutions;
+				reduce = llmin(reduce, llmax(levels - 1, 0));
+			}
+			opj_destroy_cstr_info(&info);
+		}
+		if (reduce > 0)
+		{
+			success = opj_set_decoded_resolution_factor(opj_decoder_p, reduce);
+		}
+	}
+
+	if (success && mHasRegion)
+	{
+		// Only decode the code blocks covering the requested area. The
+		// region is given on the full resolution grid.
+		S32 x0 = llclamp(mRegion[0], (S32)image->x0, (S32)image->x1);
+		S32 y0 = llclamp(mRegion[1], (S32)image->y0, (S32)image->y1);
+		S32 x1 = llclamp(mRegion[2], x0, (S32)image->x1);
+		S32 y1 = llclamp(mRegion[3], y0, (S32)image->y1);
+		if (x1 > x0 && y1 > y0)
+		{
+			success = opj_set_decode_area(opj_decoder_p, image, x0, y0, x1, y1);
+		}
+	}
+
+	success = success &&
+	          opj_decode(opj_decoder_p, opj_stream_p, image) &&
+	          opj_end_decompress(opj_decoder_p, opj_stream_p);
 
 	/* close the byte stream */
 	opj_stream_destroy(opj_stream_p);
@@ -376,6 +530,8 @@ bool LLImageJ2COJ::decodeImpl(LLImageJ2C &base, LLImageRaw &raw_image, F32 decod
 	S32 channels = img_components - first_channel;
 	if( channels > max_channel_count )
 		channels = max_channel_count;
+	if( channels > 4 ) // LLImageRaw holds at most 4 channels
+		channels = 4;
 
 	// Component buffers are allocated in an image width by height buffer.
 	// The image placed in that buffer is ceil(width/2^factor) by
@@ -383,11 +539,12 @@ bool LLImageJ2COJ::decodeImpl(LLImageJ2C &base, LLImageRaw &raw_image, F32 decod
 	// top left of the buffer with black filled in the rest of the pixels.
 	// It is integer math so the formula is written in ceildivpo2.
 	// (Assuming all the components have the same width, height and
-	// factor.)
+	// factor.) When a decode area is set the image bounds are those of
+	// the area.
 	S32 comp_width = image->comps[0].w;
 	S32 f=image->comps[0].factor;
-	S32 width = ceildivpow2(image->x1 - image->x0, f);
-	S32 height = ceildivpow2(image->y1 - image->y0, f);
+	S32 width = llmin(ceildivpow2(image->x1 - image->x0, f), comp_width);
+	S32 height = llmin(ceildivpow2(image->y1 - image->y0, f), (S32)image->comps[0].h);
 	raw_image.resize(width, height, channels);
 	U8 *rawp = raw_image.getData();
 	if (!rawp)
@@ -401,22 +558,14 @@ bool LLImageJ2COJ::decodeImpl(LLImageJ2C &base, LLImageRaw &raw_image, F32 decod
 	// first_channel is what channel to start copying from
 	// dest is what channel to copy to.  first_channel comes from the
 	// argument, dest always starts writing at channel zero.
+	const OPJ_INT32* planes[4];
+	S32 bias[4];
+	S32 shift[4];
 	for (S32 comp = first_channel, dest=0; comp < first_channel + channels;
 		comp++, dest++)
 	{
-		if (image->comps[comp].data)
-		{
-			S32 offset = dest;
-			for (S32 y = (height - 1); y >= 0; y--)
-			{
-				for (S32 x = 0; x < width; x++)
-				{
-					rawp[offset] = image->comps[comp].data[y*comp_width + x];
-					offset += channels;
-				}
-			}
-		}
-		else // Some rare OpenJPEG versions have this bug.
+		const opj_image_comp_t& image_comp = image->comps[comp];
+		if (!image_comp.data) // Some rare OpenJPEG versions have this bug.
 		{
 #ifdef SHOW_DEBUG
 			LL_DEBUGS("Texture") << "ERROR -> decodeImpl: failed to decode image! (NULL comp data - OpenJPEG bug)" << LL_ENDL;
@@ -425,8 +574,16 @@ bool LLImageJ2COJ::decodeImpl(LLImageJ2C &base, LLImageRaw &raw_image, F32 decod
 			base.decodeFailed();
 			return true; // done
 		}
+		// Signed components are centered on zero and deeper ones are
+		// scaled down so that every channel ends up in [0, 255].
+		S32 prec = llclamp((S32)image_comp.prec, 1, 31);
+		planes[dest] = image_comp.data;
+		bias[dest] = image_comp.sgnd ? (1 << (prec - 1)) : 0;
+		shift[dest] = llmax(prec - 8, 0);
 	}
 
+	copy_planar_to_interleaved(rawp, planes, bias, shift, channels, width, height, comp_width);
+
 	/* free image data structure */
 	opj_image_destroy(image);
 
@@ -291,6 +291,84 @@ S32 LLCamera::AABBInRegionFrustumNoFarClip(const LLVector4a& center, const LLVec
 	return AABBInFrustumNoFarClip(center, radius, mRegionPlanes);
 }
 
+void LLCamera::AABBInPlanes4(const LLVector4a* centers, const LLVector4a* radii, S32* results, const LLPlane* planes, U32 skip_plane)
+{
+	if(!planes)
+	{
+		//use agent space
+		planes = mAgentPlanes;
+	}
+
+	// Same arithmetic as AABBInFrustum, in the same order, for four boxes
+	// per plane so the results match it exactly
+	U32 outside = 0;
+	U32 intersects = 0;
+	LLVector4a rscale, minp[3], maxp[3], dmin, dmax, tmp, d;
+	U32 max_planes = llmin(mPlaneCount, (U32) AGENT_PLANE_USER_CLIP_NUM);
+	for (U32 i = 0; i < max_planes && outside != 0xf; i++)
+	{
+		U8 mask = mPlaneMask[i];
+		if ((i != skip_plane) && (mask < PLANE_MASK_NUM))
+		{
+			const LLPlane& p(planes[i]);
+			const LLVector4a& scaler = sFrustumScaler[mask];
+			for (U32 j = 0; j < 3; j++)
+			{
+				tmp.splat(scaler[j]);
+				rscale.setMul(radii[j], tmp);
+				minp[j].setSub(centers[j], rscale);
+				maxp[j].setAdd(centers[j], rscale);
+			}
+
+			LLVector4a px, py, pz;
+			px.splat(p[0]);
+			py.splat(p[1]);
+			pz.splat(p[2]);
+			d.splat(-p[3]);
+
+			dmin.setMul(minp[0], px);
+			tmp.setMul(minp[1], py);
+			dmin.add(tmp);
+			tmp.setMul(minp[2], pz);
+			dmin.add(tmp);
+			outside |= dmin.greaterThan(d).getGatheredBits();
+
+			dmax.setMul(maxp[0], px);
+			tmp.setMul(maxp[1], py);
+			dmax.add(tmp);
+			tmp.setMul(maxp[2], pz);
+			dmax.add(tmp);
+			intersects |= dmax.greaterThan(d).getGatheredBits();
+		}
+	}
+
+	for (U32 i = 0; i < 4; i++)
+	{
+		U32 bit = 1 << i;
+		results[i] = (outside & bit) ? 0 : ((intersects & bit) ? 1 : 2);
+	}
+}
+
+void LLCamera::AABBInFrustum4(const LLVector4a* centers, const LLVector4a* radii, S32* results, const LLPlane* planes)
+{
+	AABBInPlanes4(centers, radii, results, planes, AGENT_PLANE_USER_CLIP_NUM);
+}
+
+void LLCamera::AABBInRegionFrustum4(const LLVector4a* centers, const LLVector4a* radii, S32* results)
+{
+	AABBInPlanes4(centers, radii, results, mRegionPlanes, AGENT_PLANE_USER_CLIP_NUM);
+}
+
+void LLCamera::AABBInFrustumNoFarClip4(const LLVector4a* centers, const LLVector4a* radii, S32* results, const LLPlane* planes)
+{
+	AABBInPlanes4(centers, radii, results, planes, AGENT_PLANE_FAR);
+}
+
+void LLCamera::AABBInRegionFrustumNoFarClip4(const LLVector4a* centers, const LLVector4a* radii, S32* results)
+{
+	AABBInPlanes4(centers, radii, results, mRegionPlanes, AGENT_PLANE_FAR);
+}
+
 int LLCamera::sphereInFrustumQuick(const LLVector3 &sphere_center, const F32 radius) 
 {
 	LLVector3 dist = sphere_center-mFrustCenter;
@@ -202,6 +202,15 @@ class LLCamera
 	S32 AABBInFrustumNoFarClip(const LLVector4a& center, const LLVector4a& radius, const LLPlane* planes = NULL);
 	S32 AABBInRegionFrustumNoFarClip(const LLVector4a& center, const LLVector4a& radius);
 
+	// Batched versions of the AABB tests above for four boxes at once, given
+	// component by component: centers[0] holds the x of all four centers,
+	// centers[1] the y and centers[2] the z, and likewise for radii. Each
+	// box gets the same result in results[] as the single box test returns.
+	void AABBInFrustum4(const LLVector4a* centers, const LLVector4a* radii, S32* results, const LLPlane* planes = NULL);
+	void AABBInRegionFrustum4(const LLVector4a* centers, const LLVector4a* radii, S32* results);
+	void AABBInFrustumNoFarClip4(const LLVector4a* centers, const LLVector4a* radii, S32* results, const LLPlane* planes = NULL);
+	void AABBInRegionFrustumNoFarClip4(const LLVector4a* centers, const LLVector4a* radii, S32* results);
+
 	//does a quick 'n dirty sphere-sphere check
 	S32 sphereInFrustumQuick(const LLVector3 &sphere_center, const F32 radius); 
 
@@ -218,6 +227,7 @@ class LLCamera
 	void calculateFrustumPlanes();
 	void calculateFrustumPlanes(F32 left, F32 right, F32 top, F32 bottom);
 	void calculateFrustumPlanesFromWindow(F32 x1, F32 y1, F32 x2, F32 y2);
+	void AABBInPlanes4(const LLVector4a* centers, const LLVector4a* radii, S32* results, const LLPlane* planes, U32 skip_plane);
 } LL_ALIGN_POSTFIX(16);
 
 
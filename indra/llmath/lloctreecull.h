@@ -0,0 +1,169 @@
+/**
+ * @file lloctreecull.h
+ * @brief Frustum culling traversal of an octree.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLOCTREECULL_H
+#define LL_LLOCTREECULL_H
+
+#include "lloctree.h"
+#include "llvector4a.h"
+
+#include <algorithm>
+
+// Run a four box test such as LLCamera::AABBInFrustum4 over count <= 8
+// boxes, bounds[i] pointing to the center and radius of box i
+template <typename TEST>
+void ll_aabb_test_batch(const LLVector4a* const* bounds, U32 count, S32* results, TEST test)
+{
+	LLVector4a centers[3];
+	LLVector4a radii[3];
+	S32 res[4];
+	for (U32 i = 0; i < count; i += 4)
+	{
+		U32 batch = llmin(count - i, (U32) 4);
+
+		// Transpose into one register per component, repeating the last
+		// box to fill all four
+		LLQuad c[4];
+		LLQuad r[4];
+		for (U32 j = 0; j < 4; j++)
+		{
+			const LLVector4a* box = bounds[i + llmin(j, batch - 1)];
+			c[j] = box[0];
+			r[j] = box[1];
+		}
+
+		_MM_TRANSPOSE4_PS(c[0], c[1], c[2], c[3]);
+		_MM_TRANSPOSE4_PS(r[0], r[1], r[2], r[3]);
+
+		for (U32 j = 0; j < 3; j++)
+		{
+			centers[j] = c[j];
+			radii[j] = r[j];
+		}
+
+		test(centers, radii, res);
+		std::copy(res, res + batch, results + i);
+	}
+}
+
+// Depth first traversal that skips nodes outside the frustum. Once a node is
+// fully inside, its subtree is traversed without further checks. When a node
+// is partially inside, all of its children are checked together with
+// frustumCheckNodes() before the first of them is traversed, which gives the
+// same results as checking each one as it is reached since the checks have
+// no side effects.
+template <class T, typename T_PTR>
+class LLOctreeCullTraveler : public LLOctreeTraveler<T, T_PTR>
+{
+public:
+	typedef LLOctreeTraveler<T, T_PTR> BaseType;
+	typedef LLOctreeNode<T, T_PTR> oct_node;
+
+	LLOctreeCullTraveler()
+		: mRes(0), mBatchedRes(-1), mBatchFrustumCheck(true) { }
+
+	virtual void traverse(const oct_node* n) override
+	{
+		// only valid for this node, not its children
+		S32 batched_res = mBatchedRes;
+		mBatchedRes = -1;
+
+		if (earlyFailNode(n))
+		{
+			return;
+		}
+
+		if (mRes == 2 || (mRes && skipFrustumCheckNode(n)))
+		{	//fully in, just add everything
+			BaseType::traverse(n);
+		}
+		else
+		{
+			mRes = batched_res >= 0 ? batched_res : frustumCheckNode(n);
+
+			if (mRes)
+			{ //at least partially in, run on down
+				traversePartial(n);
+			}
+
+			mRes = 0;
+		}
+	}
+
+protected:
+	virtual bool earlyFailNode(const oct_node* n) { return false; }
+
+	// True if n is inside whenever its parent is
+	virtual bool skipFrustumCheckNode(const oct_node* n) { return false; }
+
+	// 0 if n is outside, 1 if partially and 2 if fully inside
+	virtual S32 frustumCheckNode(const oct_node* n) = 0;
+
+	// Result of frustumCheckNode for each of count <= 8 nodes. Calls
+	// frustumCheckNode for each unless overridden.
+	virtual void frustumCheckNodes(const oct_node* const* nodes, U32 count, S32* results)
+	{
+		for (U32 i = 0; i < count; i++)
+		{
+			results[i] = frustumCheckNode(nodes[i]);
+		}
+	}
+
+	// Visit a partially visible node and traverse its children
+	void traversePartial(const oct_node* n)
+	{
+		U32 count = n->getChildCount();
+		if (!mBatchFrustumCheck || mRes == 2 || count < 2)
+		{ //children are either fully in or too few to batch
+			BaseType::traverse(n);
+			return;
+		}
+
+		n->accept(this);
+
+		const oct_node* children[8];
+		S32 results[8];
+		llassert(count <= 8);
+		for (U32 i = 0; i < count; i++)
+		{
+			children[i] = n->getChild(i);
+		}
+		frustumCheckNodes(children, count, results);
+
+		for (U32 i = 0; i < count; i++)
+		{
+			mBatchedRes = results[i];
+			traverse(children[i]);
+		}
+		mBatchedRes = -1;
+	}
+
+	S32 mRes;
+	S32 mBatchedRes; // frustumCheckNode result for the next node traversed, -1 if not computed
+	bool mBatchFrustumCheck; // false to check the children of partially visible nodes one at a time
+};
+
+#endif
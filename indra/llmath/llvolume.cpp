@@ -48,6 +48,7 @@
 #include "lloctree.h"
 #include "llvolume.h"
 #include "llvolumeoctree.h"
+#include "llvolumebvh.h"
 #include "llstl.h"
 #include "llsdserialize.h"
 #include "llvector4a.h"
@@ -2374,28 +2375,494 @@ bool LLVolumeFace::VertexData::compareNormal(const LLVolumeFace::VertexData& rhs
 	return retval;
 }
 
+// Everything unpackVolumeFaces needs from one face of a mesh LOD block. The
+// blobs point either into a parsed LLSD tree or straight into the inflated
+// binary LLSD, which must outlive the block.
+struct LLMeshFaceBlock
+{
+	struct Blob
+	{
+		const U8* mData = nullptr;
+		size_t mSize = 0;
+	};
+
+	Blob mPosition;
+	Blob mNormal;
+	Blob mTexCoord0;
+	Blob mTriangleList;
+	Blob mWeights;
+	LLVector3 mPositionMin;
+	LLVector3 mPositionMax;
+	LLVector2 mTexCoordMin;
+	LLVector2 mTexCoordMax;
+	LLVector3 mNormalizedScale = LLVector3(1.f, 1.f, 1.f);
+	bool mNoGeometry = false;
+	bool mHasWeights = false;
+};
+
+namespace
+{
+	// same limit LLUZipHelper::unzip_llsd parses with
+	constexpr S32 MESH_LOD_MAX_DEPTH = 96;
+
+	LLMeshFaceBlock::Blob blob_from_llsd(const LLSD& sd)
+	{
+		const LLSD::Binary& bin = sd.asBinary();
+		LLMeshFaceBlock::Blob blob;
+		blob.mData = bin.data();
+		blob.mSize = bin.size();
+		return blob;
+	}
+
+	// Walks the binary LLSD of an inflated mesh LOD block and records where
+	// each face's data lives without building an LLSD tree. Anything a mesh
+	// asset does not normally contain (notation style strings, non binary
+	// geometry, ...) makes read() fail so the caller can fall back to the
+	// regular LLSD parser.
+	class LLMeshLODReader
+	{
+	public:
+		LLMeshLODReader(const U8* data, size_t size)
+		:	mCur(data),
+			mEnd(data + size)
+		{
+		}
+
+		bool read(std::vector<LLMeshFaceBlock>& faces)
+		{
+			static const char deprecated_header[] = "<? LLSD/Binary ?>";
+			constexpr size_t deprecated_header_size = sizeof(deprecated_header) - 1;
+
+			skipSpace();
+			if (remaining() > deprecated_header_size
+				&& memcmp(mCur, deprecated_header, deprecated_header_size) == 0)
+			{
+				mCur += deprecated_header_size;
+				skipSpace();
+			}
+
+			U32 count = 0;
+			if (!readToken('[') || !readU32(count))
+			{
+				return false;
+			}
+
+			// every face takes at least 6 bytes: '{', its size and '}'
+			faces.reserve(llmin((size_t)count, remaining() / 6));
+			for (U32 i = 0; i < count && peek() != ']'; ++i)
+			{
+				faces.emplace_back();
+				if (!readFace(faces.back()))
+				{
+					return false;
+				}
+			}
+			return readToken(']');
+		}
+
+	private:
+		size_t remaining() const { return mEnd - mCur; }
+		char peek() const { return mCur < mEnd ? (char)*mCur : 0; }
+
+		void skipSpace()
+		{
+			while (mCur < mEnd && isspace(*mCur))
+			{
+				++mCur;
+			}
+		}
+
+		bool skip(size_t bytes)
+		{
+			if (remaining() < bytes)
+			{
+				return false;
+			}
+			mCur += bytes;
+			return true;
+		}
+
+		bool readToken(char token)
+		{
+			if (peek() != token)
+			{
+				return false;
+			}
+			++mCur;
+			return true;
+		}
+
+		bool readU32(U32& value)
+		{
+			if (remaining() < 4)
+			{
+				return false;
+			}
+			value = ((U32)mCur[0] << 24) | ((U32)mCur[1] << 16) | ((U32)mCur[2] << 8) | (U32)mCur[3];
+			mCur += 4;
+			return true;
+		}
+
+		// strings, uris, binaries and map keys are all a 4 byte size followed
+		// by the bytes
+		bool readSized(const U8*& data, size_t& size)
+		{
+			U32 len = 0;
+			if (!readU32(len) || len > remaining())
+			{
+				return false;
+			}
+			data = mCur;
+			size = len;
+			mCur += len;
+			return true;
+		}
+
+		bool readKey(std::string_view& key)
+		{
+			const U8* data = nullptr;
+			size_t size = 0;
+			if (!readToken('k') || !readSized(data, size))
+			{
+				return false;
+			}
+			key = std::string_view((const char*)data, size);
+			return true;
+		}
+
+		bool readBlob(LLMeshFaceBlock::Blob& blob)
+		{
+			return readToken('b') && readSized(blob.mData, blob.mSize);
+		}
+
+		// Any scalar LLSD::asReal() would turn into a number
+		bool readReal(F32& value)
+		{
+			if (mCur >= mEnd)
+			{
+				return false;
+			}
+			switch (*mCur++)
+			{
+			case '!':
+			case '0':
+				value = 0.f;
+				return true;
+			case '1':
+				value = 1.f;
+				return true;
+			case 'i':
+			{
+				U32 bits = 0;
+				if (!readU32(bits))
+				{
+					return false;
+				}
+				value = (F32)(S32)bits;
+				return true;
+			}
+			case 'r':
+			{
+				U32 high = 0;
+				U32 low = 0;
+				if (!readU32(high) || !readU32(low))
+				{
+					return false;
+				}
+				U64 bits = ((U64)high << 32) | low;
+				F64 real;
+				memcpy(&real, &bits, sizeof(real));
+				value = (F32)real;
+				return true;
+			}
+			default:
+				return false;
+			}
+		}
+
+		// An array of up to count numbers, missing ones are zero like
+		// LLVector3::setValue() leaves them
+		bool readVector(F32* out, U32 count)
+		{
+			std::fill_n(out, count, 0.f);
+			if (readToken('!'))
+			{
+				return true;
+			}
+
+			U32 size = 0;
+			if (!readToken('[') || !readU32(size))
+			{
+				return false;
+			}
+			for (U32 i = 0; i < size && peek() != ']'; ++i)
+			{
+				F32 value = 0.f;
+				if (!readReal(value))
+				{
+					return false;
+				}
+				if (i < count)
+				{
+					out[i] = value;
+				}
+			}
+			return readToken(']');
+		}
+
+		bool readDomain(F32* min, F32* max, U32 count)
+		{
+			std::fill_n(min, count, 0.f);
+			std::fill_n(max, count, 0.f);
+			if (readToken('!'))
+			{
+				return true;
+			}
+
+			U32 size = 0;
+			if (!readToken('{') || !readU32(size))
+			{
+				return false;
+			}
+			for (U32 i = 0; i < size && peek() != '}'; ++i)
+			{
+				std::string_view key;
+				if (!readKey(key))
+				{
+					return false;
+				}
+				bool ok = key == "Min" ? readVector(min, count)
+						: key == "Max" ? readVector(max, count)
+						: skipValue(MESH_LOD_MAX_DEPTH);
+				if (!ok)
+				{
+					return false;
+				}
+			}
+			return readToken('}');
+		}
+
+		bool readFace(LLMeshFaceBlock& face)
+		{
+			U32 size = 0;
+			if (!readToken('{') || !readU32(size))
+			{
+				return false;
+			}
+			for (U32 i = 0; i < size && peek() != '}'; ++i)
+			{
+				std::string_view key;
+				if (!readKey(key))
+				{
+					return false;
+				}
+
+				bool ok;
+				if (key == "Position")
+				{
+					ok = readBlob(face.mPosition);
+				}
+				else if (key == "Normal")
+				{
+					ok = readBlob(face.mNormal);
+				}
+				else if (key == "TexCoord0")
+				{
+					ok = readBlob(face.mTexCoord0);
+				}
+				else if (key == "TriangleList")
+				{
+					ok = readBlob(face.mTriangleList);
+				}
+				else if (key == "Weights")
+				{
+					face.mHasWeights = true;
+					ok = readBlob(face.mWeights);
+				}
+				else if (key == "PositionDomain")
+				{
+					ok = readDomain(face.mPositionMin.mV, face.mPositionMax.mV, 3);
+				}
+				else if (key == "TexCoord0Domain")
+				{
+					ok = readDomain(face.mTexCoordMin.mV, face.mTexCoordMax.mV, 2);
+				}
+				else if (key == "NormalizedScale")
+				{
+					ok = readVector(face.mNormalizedScale.mV, 3);
+				}
+				else
+				{
+					face.mNoGeometry |= key == "NoGeometry";
+					ok = skipValue(MESH_LOD_MAX_DEPTH);
+				}
+
+				if (!ok)
+				{
+					return false;
+				}
+			}
+			return readToken('}');
+		}
+
+		bool skipValue(S32 depth)
+		{
+			if (depth <= 0 || mCur >= mEnd)
+			{
+				return false;
+			}
+
+			const U8* data = nullptr;
+			size_t size = 0;
+			U32 count = 0;
+			switch (*mCur++)
+			{
+			case '!':
+			case '0':
+			case '1':
+				return true;
+			case 'i':
+				return skip(4);
+			case 'r':
+			case 'd':
+				return skip(8);
+			case 'u':
+				return skip(UUID_BYTES);
+			case 's':
+			case 'l':
+			case 'b':
+				return readSized(data, size);
+			case '[':
+				if (!readU32(count))
+				{
+					return false;
+				}
+				for (U32 i = 0; i < count && peek() != ']'; ++i)
+				{
+					if (!skipValue(depth - 1))
+					{
+						return false;
+					}
+				}
+				return readToken(']');
+			case '{':
+				if (!readU32(count))
+				{
+					return false;
+				}
+				for (U32 i = 0; i < count && peek() != '}'; ++i)
+				{
+					std::string_view key;
+					if (!readKey(key) || !skipValue(depth - 1))
+					{
+						return false;
+					}
+				}
+				return readToken('}');
+			default:
+				return false;
+			}
+		}
+
+		const U8* mCur;
+		const U8* mEnd;
+	};
+
+	// Expand 16 bit quantized vectors as (v / 65535) * scale + offset, the
+	// same operations in the same order as the scalar LLVector4a code did.
+	inline LLQuad dequantize_u16(__m128i quantized, const LLVector4a& scale, const LLVector4a& offset)
+	{
+		LLQuad v = _mm_cvtepi32_ps(_mm_unpacklo_epi16(quantized, _mm_setzero_si128()));
+		v = _mm_div_ps(v, _mm_set1_ps(65535.f));
+		v = _mm_mul_ps(v, scale);
+		return _mm_add_ps(v, offset);
+	}
+
+	// count xyz triplets; w is computed from a zero like LLVector4a::set(x, y, z)
+	void dequantize_xyz(LLVector4a* out, const U8* in, U32 count, const LLVector4a& scale, const LLVector4a& offset)
+	{
+		// each vertex is 6 bytes but loads 8, so the last one goes through a copy
+		const __m128i xyz_mask = _mm_set_epi32(0, 0, 0x0000FFFF, -1);
+		U32 i = 0;
+		for (; i + 1 < count; ++i)
+		{
+			__m128i q = _mm_and_si128(_mm_loadl_epi64((const __m128i*)(in + i * 6)), xyz_mask);
+			out[i] = dequantize_u16(q, scale, offset);
+		}
+		if (i < count)
+		{
+			U8 last[8] = { 0 };
+			memcpy(last, in + i * 6, 6);
+			out[i] = dequantize_u16(_mm_loadl_epi64((const __m128i*)last), scale, offset);
+		}
+	}
+
+	// count uv pairs, two to an LLVector4a; an odd last one gets zeros in z and w
+	void dequantize_uv(LLVector4a* out, const U8* in, U32 count, const LLVector4a& scale, const LLVector4a& offset)
+	{
+		U32 i = 0;
+		for (; i + 1 < count; i += 2)
+		{
+			out[i / 2] = dequantize_u16(_mm_loadl_epi64((const __m128i*)(in + i * 4)), scale, offset);
+		}
+		if (i < count)
+		{
+			U8 last[8] = { 0 };
+			memcpy(last, in + i * 4, 4);
+			out[i / 2] = dequantize_u16(_mm_loadl_epi64((const __m128i*)last), scale, offset);
+		}
+	}
+}
+
 bool LLVolume::unpackVolumeFaces(std::istream& is, S32 size)
 {
 	LL_PROFILE_ZONE_SCOPED_CATEGORY_VOLUME
 
 	//input stream is now pointing at a zlib compressed block of LLSD
-	//decompress block
-	LLSD mdl;
-	U32 uzip_result = LLUZipHelper::unzip_llsd(mdl, is, size);
-	if (uzip_result != LLUZipHelper::ZR_OK)
+	std::unique_ptr<U8[]> in;
+	try
 	{
-		LL_DEBUGS("MeshStreaming") << "Failed to unzip LLSD blob for LoD with code " << uzip_result << " , will probably fetch from sim again." << LL_ENDL;
+		in = std::make_unique<U8[]>(size);
+	}
+	catch (const std::bad_alloc&)
+	{
+		LL_DEBUGS("MeshStreaming") << "Failed to allocate " << size << " bytes for LoD, will probably fetch from sim again." << LL_ENDL;
 		return false;
 	}
-	return unpackVolumeFacesInternal(mdl);
+	is.read((char*) in.get(), size);
+
+	return unpackVolumeFaces(in.get(), size);
 }
 
-bool LLVolume::unpackVolumeFaces(U8* in_data, S32 size)
+bool LLVolume::unpackVolumeFaces(const U8* in_data, S32 size)
 {
+	LL_PROFILE_ZONE_SCOPED_CATEGORY_VOLUME
+
 	//input data is now pointing at a zlib compressed block of LLSD
-	//decompress block
+	//decompress block into a buffer the decoding thread keeps reusing
+	static thread_local std::vector<U8> inflated;
+	U32 uzip_result = LLUZipHelper::unzip(inflated, in_data, size);
+	if (uzip_result != LLUZipHelper::ZR_OK)
+	{
+		LL_DEBUGS("MeshStreaming") << "Failed to unzip LLSD blob for LoD with code " << uzip_result << " , will probably fetch from sim again." << LL_ENDL;
+		LLUZipHelper::releaseOversized(inflated);
+		return false;
+	}
+
+	//read the faces straight out of the binary LLSD
+	std::vector<LLMeshFaceBlock> faces;
+	LLMeshLODReader reader(inflated.data(), inflated.size());
+	if (reader.read(faces))
+	{
+		bool success = unpackVolumeFacesInternal(faces);
+		LLUZipHelper::releaseOversized(inflated);
+		return success;
+	}
+	LLUZipHelper::releaseOversized(inflated);
+
+	//not something the reader handles, take the long way through LLSD
 	LLSD mdl;
-	U32 uzip_result = LLUZipHelper::unzip_llsd(mdl, in_data, size);
+	uzip_result = LLUZipHelper::unzip_llsd(mdl, in_data, size);
 	if (uzip_result != LLUZipHelper::ZR_OK)
 	{
 		LL_DEBUGS("MeshStreaming") << "Failed to unzip LLSD blob for LoD with code " << uzip_result << " , will probably fetch from sim again." << LL_ENDL;
@@ -2405,9 +2872,39 @@ bool LLVolume::unpackVolumeFaces(U8* in_data, S32 size)
 }
 
 bool LLVolume::unpackVolumeFacesInternal(const LLSD& mdl)
+{
+	std::vector<LLMeshFaceBlock> faces(mdl.size());
+
+	for (size_t i = 0; i < faces.size(); ++i)
+	{
+		LLMeshFaceBlock& face = faces[i];
+		const LLSD& mdl_face = mdl[i];
+
+		face.mNoGeometry = mdl_face.has("NoGeometry");
+		face.mPosition = blob_from_llsd(mdl_face["Position"]);
+		face.mNormal = blob_from_llsd(mdl_face["Normal"]);
+		face.mTexCoord0 = blob_from_llsd(mdl_face["TexCoord0"]);
+		face.mTriangleList = blob_from_llsd(mdl_face["TriangleList"]);
+		face.mHasWeights = mdl_face.has("Weights");
+		face.mWeights = blob_from_llsd(mdl_face["Weights"]);
+
+		face.mPositionMin.setValue(mdl_face["PositionDomain"]["Min"]);
+		face.mPositionMax.setValue(mdl_face["PositionDomain"]["Max"]);
+		face.mTexCoordMin.setValue(mdl_face["TexCoord0Domain"]["Min"]);
+		face.mTexCoordMax.setValue(mdl_face["TexCoord0Domain"]["Max"]);
+		if (mdl_face.has("NormalizedScale"))
+		{
+			face.mNormalizedScale.setValue(mdl_face["NormalizedScale"]);
+		}
+	}
+
+	return unpackVolumeFacesInternal(faces);
+}
+
+bool LLVolume::unpackVolumeFacesInternal(const std::vector<LLMeshFaceBlock>& faces)
 {
 	{
-		U32 face_count = mdl.size();
+		U32 face_count = faces.size();
 
 		if (face_count == 0)
 		{ //no faces unpacked, treat as failed decode
@@ -2421,9 +2918,9 @@ bool LLVolume::unpackVolumeFacesInternal(const LLSD& mdl)
 		{
 			LLVolumeFace& face = mVolumeFaces[i];
 
-			const auto& mdl_face = mdl[i];
+			const LLMeshFaceBlock& block = faces[i];
 
-			if (mdl_face.has("NoGeometry"))
+			if (block.mNoGeometry)
 			{ //face has no geometry, continue
 				face.resizeIndices(3);
 				face.resizeVertices(1);
@@ -2434,16 +2931,8 @@ bool LLVolume::unpackVolumeFacesInternal(const LLSD& mdl)
 				continue;
 			}
 
-			const LLSD::Binary& pos = mdl_face["Position"].asBinary();
-			const LLSD::Binary& norm = mdl_face["Normal"].asBinary();
-#if 0 // keep this code for now in case we decide to add support for on-the-wire tangents
-			const LLSD::Binary& tangent = mdl_face["Tangent"].asBinary();
-#endif
-			const LLSD::Binary& tc = mdl_face["TexCoord0"].asBinary();
-			const LLSD::Binary& idx = mdl_face["TriangleList"].asBinary();
-
 			//copy out indices
-            S32 num_indices = idx.size() / 2;
+            S32 num_indices = block.mTriangleList.mSize / 2;
             const S32 indices_to_discard = num_indices % 3;
             if (indices_to_discard > 0)
             {
@@ -2459,20 +2948,16 @@ bool LLVolume::unpackVolumeFacesInternal(const LLSD& mdl)
                 continue;
             }
 			
-			if (idx.empty() || face.mNumIndices < 3)
+			if (block.mTriangleList.mSize == 0 || face.mNumIndices < 3)
 			{ //why is there an empty index list?
 				LL_WARNS() << "Empty face present! Face index: " << i << " Total: " << face_count << LL_ENDL;
 				continue;
 			}
 
-			U16* indices = (U16*) &(idx[0]);
-            for (U32 j = 0; j < num_indices; ++j)
-			{
-				face.mIndices[j] = indices[j];
-			}
+			memcpy(face.mIndices, block.mTriangleList.mData, num_indices * sizeof(U16));
 
 			//copy out vertices
-			U32 num_verts = pos.size()/(3*2);
+			U32 num_verts = block.mPosition.mSize/(3*2);
 			face.resizeVertices(num_verts);
 
             if (num_verts > 0 && !face.mPositions)
@@ -2482,29 +2967,15 @@ bool LLVolume::unpackVolumeFacesInternal(const LLSD& mdl)
                 continue;
             }
 
-			LLVector3 minp;
-			LLVector3 maxp;
-			LLVector2 min_tc; 
-			LLVector2 max_tc; 
-		
-			minp.setValue(mdl_face["PositionDomain"]["Min"]);
-			maxp.setValue(mdl_face["PositionDomain"]["Max"]);
 			LLVector4a min_pos, max_pos;
-			min_pos.load3(minp.mV);
-			max_pos.load3(maxp.mV);
+			min_pos.load3(block.mPositionMin.mV);
+			max_pos.load3(block.mPositionMax.mV);
 
-			min_tc.setValue(mdl_face["TexCoord0Domain"]["Min"]);
-			max_tc.setValue(mdl_face["TexCoord0Domain"]["Max"]);
+			const LLVector2& min_tc = block.mTexCoordMin;
+			const LLVector2& max_tc = block.mTexCoordMax;
 
             //unpack normalized scale/translation
-            if (mdl_face.has("NormalizedScale"))
-            {
-                face.mNormalizedScale.setValue(mdl_face["NormalizedScale"]);
-            }
-            else
-            {
-                face.mNormalizedScale.set(1, 1, 1);
-            }
+            face.mNormalizedScale = block.mNormalizedScale;
             
 			LLVector4a pos_range;
 			pos_range.setSub(max_pos, min_pos);
@@ -2514,111 +2985,39 @@ bool LLVolume::unpackVolumeFacesInternal(const LLSD& mdl)
 			tc_range.set(tc_range2[0], tc_range2[1], tc_range2[0], tc_range2[1]);
 			LLVector4a min_tc4(min_tc[0], min_tc[1], min_tc[0], min_tc[1]);
 
-			LLVector4a* pos_out = face.mPositions;
-			LLVector4a* norm_out = face.mNormals;
-			LLVector4a* tc_out = (LLVector4a*) face.mTexCoords;
+			dequantize_xyz(face.mPositions, block.mPosition.mData, num_verts, pos_range, min_pos);
 
+			// a short normal or texture coordinate array is treated as missing
+			if (block.mNormal.mSize >= num_verts * 3 * 2)
+			{
+				LLVector4a norm_scale, norm_offset;
+				norm_scale.splat(2.f);
+				norm_offset.splat(-1.f);
+				dequantize_xyz(face.mNormals, block.mNormal.mData, num_verts, norm_scale, norm_offset);
+			}
+			else
 			{
-				U16* v = (U16*) &(pos[0]);
 				for (U32 j = 0; j < num_verts; ++j)
 				{
-					pos_out->set((F32) v[0], (F32) v[1], (F32) v[2]);
-					pos_out->div(65535.f);
-					pos_out->mul(pos_range);
-					pos_out->add(min_pos);
-					pos_out++;
-					v += 3;
+					face.mNormals[j].clear();
 				}
-
 			}
 
+			if (block.mTexCoord0.mSize >= num_verts * 2 * 2)
 			{
-				if (!norm.empty())
-				{
-					U16* n = (U16*) &(norm[0]);
-					for (U32 j = 0; j < num_verts; ++j)
-					{
-						norm_out->set((F32) n[0], (F32) n[1], (F32) n[2]);
-						norm_out->div(65535.f);
-						norm_out->mul(2.f);
-						norm_out->sub(1.f);
-						norm_out++;
-						n += 3;
-					}
-				}
-				else
-				{
-					for (U32 j = 0; j < num_verts; ++j)
-					{
-						norm_out->clear();
-						norm_out++; // or just norm_out[j].clear();
-					}
-				}
+				dequantize_uv((LLVector4a*) face.mTexCoords, block.mTexCoord0.mData, num_verts, tc_range, min_tc4);
 			}
-
-#if 0 // keep this code for now in case we decide to add support for on-the-wire tangents
-            {
-                if (!tangent.empty())
-                {
-                    face.allocateTangents(face.mNumVertices);
-                    U16* t = (U16*)&(tangent[0]);
-
-                    // NOTE: tangents coming from the asset may not be mikkt space, but they should always be used by the GLTF shaders to 
-                    // maintain compliance with the GLTF spec
-                    LLVector4a* t_out = face.mTangents; 
-
-                    for (U32 j = 0; j < num_verts; ++j)
-                    {
-                        t_out->set((F32)t[0], (F32)t[1], (F32)t[2], (F32) t[3]);
-                        t_out->div(65535.f);
-                        t_out->mul(2.f);
-                        t_out->sub(1.f);
-
-                        F32* tp = t_out->getF32ptr();
-                        tp[3] = tp[3] < 0.f ? -1.f : 1.f;
-
-                        t_out++;
-                        t += 4;
-                    }
-                }
-            }
-#endif
-
+			else
 			{
-				if (!tc.empty())
+				LLVector4a* tc_out = (LLVector4a*) face.mTexCoords;
+				for (U32 j = 0; j < num_verts; j += 2)
 				{
-					U16* t = (U16*) &(tc[0]);
-					for (U32 j = 0; j < num_verts; j+=2)
-					{
-						if (j < num_verts-1)
-						{
-							tc_out->set((F32) t[0], (F32) t[1], (F32) t[2], (F32) t[3]);
-						}
-						else
-						{
-							tc_out->set((F32) t[0], (F32) t[1], 0.f, 0.f);
-						}
-
-						t += 4;
-
-						tc_out->div(65535.f);
-						tc_out->mul(tc_range);
-						tc_out->add(min_tc4);
-
-						tc_out++;
-					}
-				}
-				else
-				{
-					for (U32 j = 0; j < num_verts; j += 2)
-					{
-						tc_out->clear();
-						tc_out++;
-					}
+					tc_out->clear();
+					tc_out++;
 				}
 			}
 
-			if (mdl_face.has("Weights"))
+			if (block.mHasWeights)
 			{
 				face.allocateWeights(num_verts);
                 if (!face.mWeights && num_verts)
@@ -2629,12 +3028,12 @@ bool LLVolume::unpackVolumeFacesInternal(const LLSD& mdl)
                     continue;
                 }
 
-				const LLSD::Binary& weights = mdl_face["Weights"].asBinary();
+				const U8* weights = block.mWeights.mData;
 
 				U32 idx = 0;
 
 				U32 cur_vertex = 0;
-				size_t weight_size = weights.size();
+				size_t weight_size = block.mWeights.mSize;
 				while (idx < weight_size && cur_vertex < num_verts)
 				{
 					const U8 END_INFLUENCES = 0xFF;
@@ -2682,7 +3081,7 @@ bool LLVolume::unpackVolumeFacesInternal(const LLSD& mdl)
 					cur_vertex++;
 				}
 
-				if (cur_vertex != num_verts || idx != weights.size())
+				if (cur_vertex != num_verts || idx != weight_size)
 				{
 					LL_WARNS() << "Vertex weight count does not match vertex count!" << LL_ENDL;
 				}
@@ -4242,16 +4641,76 @@ S32 LLVolume::lineSegmentIntersect(const LLVector4a& start, const LLVector4a& en
 			}
 			else
 			{
-                if (!face.getOctree())
+				if (!face.getBVH())
 				{
-					face.createOctree();
+					face.createBVH();
 				}
-			
-				LLOctreeTriangleRayIntersect intersect(start, dir, &face, &closest_t, intersection, tex_coord, normal, tangent_out);
-                intersect.traverse(face.getOctree());
-				if (intersect.mHitFace)
+
+				F32 a, b;
+				S32 tri = face.getBVH()->intersect(face.mPositions, face.mIndices, start, dir, closest_t, a, b);
+				if (tri >= 0)
 				{
 					hit_face = i;
+
+					if (intersection != NULL)
+					{
+						LLVector4a intersect = dir;
+						intersect.mul(closest_t);
+						intersect.add(start);
+						*intersection = intersect;
+					}
+
+					U16 idx0 = face.mIndices[tri*3+0];
+					U16 idx1 = face.mIndices[tri*3+1];
+					U16 idx2 = face.mIndices[tri*3+2];
+
+					if (tex_coord != NULL)
+					{
+						LLVector2* tc = (LLVector2*) face.mTexCoords;
+						*tex_coord = ((1.f - a - b)  * tc[idx0] +
+							a              * tc[idx1] +
+							b              * tc[idx2]);
+					}
+
+					if (normal != NULL)
+					{
+						LLVector4a* norm = face.mNormals;
+
+						LLVector4a n1,n2,n3;
+						n1 = norm[idx0];
+						n1.mul(1.f-a-b);
+
+						n2 = norm[idx1];
+						n2.mul(a);
+
+						n3 = norm[idx2];
+						n3.mul(b);
+
+						n1.add(n2);
+						n1.add(n3);
+
+						*normal = n1;
+					}
+
+					if (tangent_out != NULL)
+					{
+						LLVector4a* tangents = face.mTangents;
+
+						LLVector4a t1,t2,t3;
+						t1 = tangents[idx0];
+						t1.mul(1.f-a-b);
+
+						t2 = tangents[idx1];
+						t2.mul(a);
+
+						t3 = tangents[idx2];
+						t3.mul(b);
+
+						t1.add(t2);
+						t1.add(t3);
+
+						*tangent_out = t1;
+					}
 				}
 			}
 		}		
@@ -4798,6 +5257,7 @@ LLVolumeFace::LLVolumeFace() :
     mWeightsScrubbed(FALSE),
 	mOctree(NULL),
     mOctreeTriangles(NULL),
+    mBVH(NULL),
 	mOptimized(FALSE)
 {
 	mExtents = (LLVector4a*) ll_aligned_malloc_16(sizeof(LLVector4a)*3);
@@ -4825,6 +5285,7 @@ LLVolumeFace::LLVolumeFace(const LLVolumeFace& src)
     mWeightsScrubbed(FALSE),
     mOctree(NULL),
     mOctreeTriangles(NULL),
+    mBVH(NULL),
 	mOptimized(FALSE)
 {
 	mExtents = (LLVector4a*) ll_aligned_malloc_16(sizeof(LLVector4a)*3);
@@ -4968,14 +5429,16 @@ void LLVolumeFace::freeData()
 #endif
 
     destroyOctree();
+    destroyBVH();
 }
 
 BOOL LLVolumeFace::create(LLVolume* volume, BOOL partial_build)
 {
 	LL_PROFILE_ZONE_SCOPED_CATEGORY_VOLUME
 
-	//tree for this face is no longer valid
+	//trees for this face are no longer valid
     destroyOctree();
+    destroyBVH();
 
 	LL_CHECK_MEMORY
 	BOOL ret = FALSE ;
@@ -5735,6 +6198,23 @@ const LLOctreeNode<LLVolumeTriangle, LLVolumeTriangle*>* LLVolumeFace::getOctree
     return mOctree;
 }
 
+void LLVolumeFace::createBVH()
+{
+	LL_PROFILE_ZONE_SCOPED_CATEGORY_VOLUME;
+
+	if (!mBVH)
+	{
+		mBVH = new LLVolumeBVH();
+	}
+	mBVH->build(mPositions, mIndices, mNumIndices);
+}
+
+void LLVolumeFace::destroyBVH()
+{
+	delete mBVH;
+	mBVH = NULL;
+}
+
 
 void LLVolumeFace::swapData(LLVolumeFace& rhs)
 {
@@ -5745,6 +6225,7 @@ void LLVolumeFace::swapData(LLVolumeFace& rhs)
 	llswap(rhs.mIndices,mIndices);
 	llswap(rhs.mNumVertices, mNumVertices);
 	llswap(rhs.mNumIndices, mNumIndices);
+	llswap(rhs.mBVH, mBVH);
 }
 
 void	LerpPlanarVertex(LLVolumeFace::VertexData& v0,
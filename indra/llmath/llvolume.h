@@ -41,6 +41,8 @@ template <class T, typename T_PTR> class LLOctreeNode;
 class LLVolumeFace;
 class LLVolume;
 class LLVolumeTriangle;
+class LLVolumeBVH;
+struct LLMeshFaceBlock;
 
 #include "lluuid.h"
 #include "v4color.h"
@@ -918,6 +920,13 @@ class LLVolumeFace
     // Get a reference to the octree, which may be null
     const LLOctreeNode<LLVolumeTriangle, LLVolumeTriangle*>* getOctree() const;
 
+	// Hierarchy used by LLVolume::lineSegmentIntersect, the octree is only
+	// kept around for debug display
+	void createBVH();
+	void destroyBVH();
+	// May be null
+	const LLVolumeBVH* getBVH() const { return mBVH; }
+
 	enum
 	{
 		SINGLE_MASK =	0x0001,
@@ -987,6 +996,7 @@ class LLVolumeFace
 private:
     LLOctreeNode<LLVolumeTriangle, LLVolumeTriangle*>* mOctree;
     LLVolumeTriangle* mOctreeTriangles;
+    LLVolumeBVH* mBVH;
 
 	BOOL createUnCutCubeCap(LLVolume* volume, BOOL partial_build = FALSE);
 	BOOL createCap(LLVolume* volume, BOOL partial_build = FALSE);
@@ -1104,9 +1114,10 @@ class LLVolume : public LLRefCount
 	void createVolumeFaces();
 public:
 	bool unpackVolumeFaces(std::istream& is, S32 size);
-	bool unpackVolumeFaces(U8* in_data, S32 size);
+	bool unpackVolumeFaces(const U8* in_data, S32 size);
 private:
 	bool unpackVolumeFacesInternal(const LLSD& mdl);
+	bool unpackVolumeFacesInternal(const std::vector<LLMeshFaceBlock>& faces);
 
 public:
 	virtual void setMeshAssetLoaded(bool loaded);
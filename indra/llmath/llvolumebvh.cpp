@@ -0,0 +1,596 @@
+/** 
+ * @file llvolumebvh.cpp
+ * @brief Bounding volume hierarchy over the triangles of a volume face.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ * 
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ * 
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ * 
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "llvolumebvh.h"
+
+#include <algorithm>
+#include <cfloat>
+
+namespace
+{
+	const U32 SAH_BINS = 8;
+	// Past this depth nodes are split at the median, which bounds the
+	// traversal stack however skewed the geometry is
+	const U32 MAX_SAH_DEPTH = 48;
+	const S32 MAX_STACK = 256;
+
+	F32 half_area(const LLVector4a& min, const LLVector4a& max)
+	{
+		LLVector4a size;
+		size.setSub(max, min);
+		return size[0] * size[1] + size[1] * size[2] + size[2] * size[0];
+	}
+
+	// a * b - c * d, lane by lane
+	inline void set_mul_sub(LLVector4a& out, const LLVector4a& a, const LLVector4a& b, const LLVector4a& c, const LLVector4a& d)
+	{
+		LLVector4a cd;
+		cd.setMul(c, d);
+		out.setMul(a, b);
+		out.sub(cd);
+	}
+}
+
+class LLVolumeBVHBuilder
+{
+public:
+	LLVolumeBVHBuilder(LLVolumeBVH& bvh, const LLVector4a* positions, const U16* indices, U32 num_triangles);
+
+	void build();
+
+private:
+	// Intermediate two-wide tree, collapsed into the four-wide one
+	struct BinaryNode
+	{
+		LLVector4a mMin;
+		LLVector4a mMax;
+		S32 mLeft = -1;		// -1 for leaves
+		S32 mRight = -1;
+		U32 mFirst = 0;		// leaves only, range of mBVH.mTriangles
+		U32 mCount = 0;
+	};
+
+	S32 buildBinary(U32 first, U32 count, U32 depth);
+	U32 collapse(S32 binary_index);
+
+	LLVolumeBVH& mBVH;
+	std::vector<LLVector4a> mTriangleMin;
+	std::vector<LLVector4a> mTriangleMax;
+	std::vector<LLVector4a> mCentroid;
+	std::vector<BinaryNode> mBinary;
+};
+
+LLVolumeBVHBuilder::LLVolumeBVHBuilder(LLVolumeBVH& bvh, const LLVector4a* positions, const U16* indices, U32 num_triangles)
+:	mBVH(bvh)
+{
+	mTriangleMin.resize(num_triangles);
+	mTriangleMax.resize(num_triangles);
+	mCentroid.resize(num_triangles);
+	mBVH.mTriangles.resize(num_triangles);
+
+	for (U32 i = 0; i < num_triangles; ++i)
+	{
+		const LLVector4a& v0 = positions[indices[i * 3]];
+		const LLVector4a& v1 = positions[indices[i * 3 + 1]];
+		const LLVector4a& v2 = positions[indices[i * 3 + 2]];
+
+		LLVector4a& min = mTriangleMin[i];
+		LLVector4a& max = mTriangleMax[i];
+		min.setMin(v0, v1);
+		min.setMin(min, v2);
+		max.setMax(v0, v1);
+		max.setMax(max, v2);
+
+		mCentroid[i].setAdd(min, max);
+		mCentroid[i].mul(0.5f);
+
+		mBVH.mTriangles[i] = i;
+	}
+
+	// A binary tree has 2n - 1 nodes at most
+	mBinary.reserve(num_triangles * 2);
+}
+
+void LLVolumeBVHBuilder::build()
+{
+	U32 count = (U32)mBVH.mTriangles.size();
+	if (!count)
+	{
+		return;
+	}
+
+	buildBinary(0, count, 0);
+
+	// Collapse the binary tree into nodes of four. The root always gets a
+	// node of its own so traversal can start at node 0.
+	mBVH.mNodes.reserve(mBinary.size() / 3 + 1);
+	const BinaryNode& root = mBinary[0];
+	if (root.mLeft >= 0)
+	{
+		collapse(0);
+	}
+	else
+	{
+		LLVolumeBVH::Node node;
+		for (U32 axis = 0; axis < 3; ++axis)
+		{
+			node.mMin[axis].splat(FLT_MAX);
+			node.mMax[axis].splat(-FLT_MAX);
+			node.mMin[axis].getF32ptr()[0] = root.mMin[axis];
+			node.mMax[axis].getF32ptr()[0] = root.mMax[axis];
+		}
+		node.mChild[0] = LLVolumeBVH::makeLeaf(root.mFirst, root.mCount);
+		node.mChild[1] = node.mChild[2] = node.mChild[3] = LLVolumeBVH::EMPTY;
+		mBVH.mNodes.push_back(node);
+	}
+}
+
+S32 LLVolumeBVHBuilder::buildBinary(U32 first, U32 count, U32 depth)
+{
+	U32* triangles = mBVH.mTriangles.data();
+
+	LLVector4a min = mTriangleMin[triangles[first]];
+	LLVector4a max = mTriangleMax[triangles[first]];
+	LLVector4a centroid_min = mCentroid[triangles[first]];
+	LLVector4a centroid_max = centroid_min;
+	for (U32 i = first + 1; i < first + count; ++i)
+	{
+		U32 tri = triangles[i];
+		min.setMin(min, mTriangleMin[tri]);
+		max.setMax(max, mTriangleMax[tri]);
+		centroid_min.setMin(centroid_min, mCentroid[tri]);
+		centroid_max.setMax(centroid_max, mCentroid[tri]);
+	}
+
+	S32 index = (S32)mBinary.size();
+	mBinary.emplace_back();
+	mBinary[index].mMin = min;
+	mBinary[index].mMax = max;
+
+	if (count <= LLVolumeBVH::MAX_LEAF_TRIANGLES)
+	{
+		mBinary[index].mFirst = first;
+		mBinary[index].mCount = count;
+		return index;
+	}
+
+	// Split along the axis the centroids spread the most on
+	LLVector4a extent;
+	extent.setSub(centroid_max, centroid_min);
+	U32 axis = 0;
+	if (extent[1] > extent[axis])
+	{
+		axis = 1;
+	}
+	if (extent[2] > extent[axis])
+	{
+		axis = 2;
+	}
+
+	U32 mid = first + count / 2;
+	if (extent[axis] <= 0.f)
+	{
+		// All centroids coincide, any split is as good as another
+	}
+	else if (depth < MAX_SAH_DEPTH)
+	{
+		// Binned surface area heuristic
+		U32 bin_count[SAH_BINS] = { 0 };
+		LLVector4a bin_min[SAH_BINS];
+		LLVector4a bin_max[SAH_BINS];
+		for (U32 b = 0; b < SAH_BINS; ++b)
+		{
+			bin_min[b].splat(FLT_MAX);
+			bin_max[b].splat(-FLT_MAX);
+		}
+
+		const F32 origin = centroid_min[axis];
+		const F32 scale = SAH_BINS * (1.f - 1e-5f) / extent[axis];
+		auto get_bin = [&](U32 tri)
+		{
+			return llmin((U32)((mCentroid[tri][axis] - origin) * scale), SAH_BINS - 1);
+		};
+
+		for (U32 i = first; i < first + count; ++i)
+		{
+			U32 tri = triangles[i];
+			U32 b = get_bin(tri);
+			bin_count[b]++;
+			bin_min[b].setMin(bin_min[b], mTriangleMin[tri]);
+			bin_max[b].setMax(bin_max[b], mTriangleMax[tri]);
+		}
+
+		// Area and count to the right of each split plane
+		F32 right_area[SAH_BINS];
+		U32 right_count[SAH_BINS];
+		LLVector4a accum_min = bin_min[SAH_BINS - 1];
+		LLVector4a accum_max = bin_max[SAH_BINS - 1];
+		U32 accum_count = 0;
+		for (U32 b = SAH_BINS - 1; b > 0; --b)
+		{
+			accum_min.setMin(accum_min, bin_min[b]);
+			accum_max.setMax(accum_max, bin_max[b]);
+			accum_count += bin_count[b];
+			right_area[b] = accum_count ? half_area(accum_min, accum_max) : 0.f;
+			right_count[b] = accum_count;
+		}
+
+		F32 best_cost = FLT_MAX;
+		U32 best_split = 0;
+		accum_min = bin_min[0];
+		accum_max = bin_max[0];
+		accum_count = 0;
+		for (U32 b = 1; b < SAH_BINS; ++b)
+		{
+			accum_min.setMin(accum_min, bin_min[b - 1]);
+			accum_max.setMax(accum_max, bin_max[b - 1]);
+			accum_count += bin_count[b - 1];
+			if (!accum_count || !right_count[b])
+			{
+				continue;
+			}
+
+			F32 cost = half_area(accum_min, accum_max) * accum_count + right_area[b] * right_count[b];
+			if (cost < best_cost)
+			{
+				best_cost = cost;
+				best_split = b;
+			}
+		}
+
+		if (best_split)
+		{
+			U32* split = std::partition(triangles + first, triangles + first + count,
+				[&](U32 tri) { return get_bin(tri) < best_split; });
+			mid = (U32)(split - triangles);
+		}
+		else
+		{
+			std::nth_element(triangles + first, triangles + mid, triangles + first + count,
+				[&](U32 lhs, U32 rhs) { return mCentroid[lhs][axis] < mCentroid[rhs][axis]; });
+		}
+	}
+	else
+	{
+		std::nth_element(triangles + first, triangles + mid, triangles + first + count,
+			[&](U32 lhs, U32 rhs) { return mCentroid[lhs][axis] < mCentroid[rhs][axis]; });
+	}
+
+	S32 left = buildBinary(first, mid - first, depth + 1);
+	S32 right = buildBinary(mid, first + count - mid, depth + 1);
+	mBinary[index].mLeft = left;
+	mBinary[index].mRight = right;
+	return index;
+}
+
+U32 LLVolumeBVHBuilder::collapse(S32 binary_index)
+{
+	// Pull grandchildren up until there are four children, opening the
+	// largest inner child first
+	S32 children[4] = { mBinary[binary_index].mLeft, mBinary[binary_index].mRight, -1, -1 };
+	U32 num_children = 2;
+	while (num_children < 4)
+	{
+		S32 best = -1;
+		F32 best_area = -1.f;
+		for (U32 i = 0; i < num_children; ++i)
+		{
+			const BinaryNode& child = mBinary[children[i]];
+			F32 area = half_area(child.mMin, child.mMax);
+			if (child.mLeft >= 0 && area > best_area)
+			{
+				best = (S32)i;
+				best_area = area;
+			}
+		}
+
+		if (best < 0)
+		{
+			break;
+		}
+
+		const BinaryNode& opened = mBinary[children[best]];
+		children[best] = opened.mLeft;
+		children[num_children++] = opened.mRight;
+	}
+
+	U32 node_index = (U32)mBVH.mNodes.size();
+	mBVH.mNodes.emplace_back();
+
+	LLVolumeBVH::Node node;
+	for (U32 axis = 0; axis < 3; ++axis)
+	{
+		node.mMin[axis].splat(FLT_MAX);
+		node.mMax[axis].splat(-FLT_MAX);
+	}
+
+	for (U32 slot = 0; slot < 4; ++slot)
+	{
+		if (slot >= num_children)
+		{
+			// Inverted box, never hit
+			node.mChild[slot] = LLVolumeBVH::EMPTY;
+			continue;
+		}
+
+		const BinaryNode& child = mBinary[children[slot]];
+		for (U32 axis = 0; axis < 3; ++axis)
+		{
+			node.mMin[axis].getF32ptr()[slot] = child.mMin[axis];
+			node.mMax[axis].getF32ptr()[slot] = child.mMax[axis];
+		}
+		node.mChild[slot] = child.mLeft < 0 ? LLVolumeBVH::makeLeaf(child.mFirst, child.mCount) : collapse(children[slot]);
+	}
+
+	// Children were appended after this node, write it back by index
+	mBVH.mNodes[node_index] = node;
+	return node_index;
+}
+
+void LLVolumeBVH::build(const LLVector4a* positions, const U16* indices, S32 num_indices)
+{
+	LL_PROFILE_ZONE_SCOPED_CATEGORY_VOLUME;
+
+	mNodes.clear();
+	mTriangles.clear();
+
+	LLVolumeBVHBuilder builder(*this, positions, indices, (U32)(num_indices / 3));
+	builder.build();
+}
+
+S32 LLVolumeBVH::intersect(const LLVector4a* positions, const U16* indices,
+						   const LLVector4a& start, const LLVector4a& dir,
+						   F32& closest_t, F32& a, F32& b) const
+{
+	if (mNodes.empty())
+	{
+		return -1;
+	}
+
+	// Ray in one register per component for testing four boxes or four
+	// triangles at once. Axis aligned rays get a tiny direction instead of
+	// zero so the slab test never computes 0 * inf.
+	LLVector4a origin[3];
+	LLVector4a direction[3];
+	LLVector4a inv_direction[3];
+	bool negative[3];
+	for (U32 axis = 0; axis < 3; ++axis)
+	{
+		F32 d = dir[axis];
+		negative[axis] = d < 0.f;
+		F32 safe_d = fabsf(d) < 1e-20f ? (negative[axis] ? -1e-20f : 1e-20f) : d;
+		origin[axis].splat(start[axis]);
+		direction[axis].splat(d);
+		inv_direction[axis].splat(1.f / safe_d);
+	}
+
+	const LLVector4a zero = LLVector4a::getZero();
+	const LLVector4a epsilon = LLVector4a::getEpsilon();
+	LLVector4a one;
+	one.splat(1.f);
+
+	struct Entry
+	{
+		U32 mChild;
+		F32 mNear;
+	};
+	Entry stack[MAX_STACK];
+	S32 stack_size = 0;
+	stack[stack_size++] = { 0, 0.f };
+
+	S32 hit_triangle = -1;
+
+	while (stack_size)
+	{
+		const Entry entry = stack[--stack_size];
+		if (entry.mNear > closest_t)
+		{
+			// a closer hit was found since this was pushed
+			continue;
+		}
+
+		if (entry.mChild & LEAF_FLAG)
+		{
+			U32 first = (entry.mChild & ~LEAF_FLAG) >> 2;
+			U32 count = (entry.mChild & 3) + 1;
+
+			// Gather the leaf into lanes, repeating the last triangle to
+			// fill all four
+			LL_ALIGN_16(F32 soa[9][4]);
+			U32 tri[4];
+			for (U32 lane = 0; lane < 4; ++lane)
+			{
+				tri[lane] = mTriangles[first + llmin(lane, count - 1)];
+				const U16* idx = indices + tri[lane] * 3;
+				const F32* v0 = positions[idx[0]].getF32ptr();
+				const F32* v1 = positions[idx[1]].getF32ptr();
+				const F32* v2 = positions[idx[2]].getF32ptr();
+				for (U32 axis = 0; axis < 3; ++axis)
+				{
+					soa[axis][lane] = v0[axis];
+					soa[3 + axis][lane] = v1[axis] - v0[axis];
+					soa[6 + axis][lane] = v2[axis] - v0[axis];
+				}
+			}
+
+			LLVector4a v0[3], edge1[3], edge2[3];
+			for (U32 axis = 0; axis < 3; ++axis)
+			{
+				v0[axis].load4a(soa[axis]);
+				edge1[axis].load4a(soa[3 + axis]);
+				edge2[axis].load4a(soa[6 + axis]);
+			}
+
+			// Same tests as LLTriangleRayIntersect, four triangles at a time
+			LLVector4a pvec[3];
+			set_mul_sub(pvec[0], direction[1], edge2[2], direction[2], edge2[1]);
+			set_mul_sub(pvec[1], direction[2], edge2[0], direction[0], edge2[2]);
+			set_mul_sub(pvec[2], direction[0], edge2[1], direction[1], edge2[0]);
+
+			LLVector4a det, tmp;
+			det.setMul(edge1[0], pvec[0]);
+			tmp.setMul(edge1[1], pvec[1]);
+			det.add(tmp);
+			tmp.setMul(edge1[2], pvec[2]);
+			det.add(tmp);
+
+			LLVector4a tvec[3];
+			for (U32 axis = 0; axis < 3; ++axis)
+			{
+				tvec[axis].setSub(origin[axis], v0[axis]);
+			}
+
+			LLVector4a u;
+			u.setMul(tvec[0], pvec[0]);
+			tmp.setMul(tvec[1], pvec[1]);
+			u.add(tmp);
+			tmp.setMul(tvec[2], pvec[2]);
+			u.add(tmp);
+
+			LLVector4a qvec[3];
+			set_mul_sub(qvec[0], tvec[1], edge1[2], tvec[2], edge1[1]);
+			set_mul_sub(qvec[1], tvec[2], edge1[0], tvec[0], edge1[2]);
+			set_mul_sub(qvec[2], tvec[0], edge1[1], tvec[1], edge1[0]);
+
+			LLVector4a v;
+			v.setMul(direction[0], qvec[0]);
+			tmp.setMul(direction[1], qvec[1]);
+			v.add(tmp);
+			tmp.setMul(direction[2], qvec[2]);
+			v.add(tmp);
+
+			LLVector4a t;
+			t.setMul(edge2[0], qvec[0]);
+			tmp.setMul(edge2[1], qvec[1]);
+			t.add(tmp);
+			tmp.setMul(edge2[2], qvec[2]);
+			t.add(tmp);
+
+			LLVector4a sum_uv;
+			sum_uv.setAdd(u, v);
+
+			U32 mask = det.greaterEqual(epsilon).getGatheredBits();
+			mask &= u.greaterEqual(zero).getGatheredBits();
+			mask &= u.lessEqual(det).getGatheredBits();
+			mask &= v.greaterEqual(zero).getGatheredBits();
+			mask &= sum_uv.lessEqual(det).getGatheredBits();
+			mask &= (1 << count) - 1;
+			if (!mask)
+			{
+				continue;
+			}
+
+			t.div(det);
+			u.div(det);
+			v.div(det);
+
+			for (U32 lane = 0; lane < count; ++lane)
+			{
+				F32 lane_t = t[lane];
+				if ((mask & (1 << lane)) &&
+					lane_t >= 0.f &&		// if hit is after start
+					lane_t <= 1.f &&		// and before end
+					lane_t < closest_t)		// and this hit is closer
+				{
+					closest_t = lane_t;
+					a = u[lane];
+					b = v[lane];
+					hit_triangle = (S32)tri[lane];
+				}
+			}
+			continue;
+		}
+
+		const Node& node = mNodes[entry.mChild];
+
+		// Slab test against all four child boxes, entering through the
+		// near side of each axis
+		LLVector4a t_near, t_far, t0, t1;
+		for (U32 axis = 0; axis < 3; ++axis)
+		{
+			const LLVector4a& near_plane = negative[axis] ? node.mMax[axis] : node.mMin[axis];
+			const LLVector4a& far_plane = negative[axis] ? node.mMin[axis] : node.mMax[axis];
+			t0.setSub(near_plane, origin[axis]);
+			t0.mul(inv_direction[axis]);
+			t1.setSub(far_plane, origin[axis]);
+			t1.mul(inv_direction[axis]);
+			if (axis == 0)
+			{
+				t_near = t0;
+				t_far = t1;
+			}
+			else
+			{
+				t_near.setMax(t_near, t0);
+				t_far.setMin(t_far, t1);
+			}
+		}
+
+		LLVector4a limit;
+		limit.splat(llmin(closest_t, 1.f));
+		t_near.setMax(t_near, zero);
+		t_far.setMin(t_far, limit);
+
+		U32 hits = t_near.lessEqual(t_far).getGatheredBits() & 0xF;
+		if (!hits)
+		{
+			continue;
+		}
+
+		// Push the farthest child first so the nearest is visited next
+		Entry children[4];
+		U32 num_children = 0;
+		for (U32 slot = 0; slot < 4; ++slot)
+		{
+			if (hits & (1 << slot))
+			{
+				Entry child = { node.mChild[slot], t_near[slot] };
+				U32 i = num_children++;
+				while (i > 0 && children[i - 1].mNear < child.mNear)
+				{
+					children[i] = children[i - 1];
+					--i;
+				}
+				children[i] = child;
+			}
+		}
+
+		llassert(stack_size + num_children <= MAX_STACK);
+		for (U32 i = 0; i < num_children; ++i)
+		{
+			stack[stack_size++] = children[i];
+		}
+	}
+
+	return hit_triangle;
+}
+
+size_t LLVolumeBVH::getMemoryUsage() const
+{
+	return mNodes.capacity() * sizeof(Node) + mTriangles.capacity() * sizeof(U32);
+}
@@ -0,0 +1,81 @@
+/** 
+ * @file llvolumebvh.h
+ * @brief Bounding volume hierarchy over the triangles of a volume face.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ * 
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ * 
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ * 
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLVOLUMEBVH_H
+#define LL_LLVOLUMEBVH_H
+
+#include <vector>
+
+#include "llmath.h"
+#include "llvector4a.h"
+
+// Four-wide bounding volume hierarchy for ray picking against a triangle
+// list. Built with binned SAH, stored as one array of nodes that each hold
+// the boxes of up to four children, and leaves of up to four triangles
+// referenced by their position in the index buffer. The hierarchy doesn't
+// copy any vertex data, so positions and indices must be passed back in
+// unchanged when intersecting.
+class LLVolumeBVH
+{
+public:
+	void build(const LLVector4a* positions, const U16* indices, S32 num_indices);
+
+	// Intersects the segment start + t * dir, 0 <= t <= 1, with the
+	// triangles (one sided, like LLTriangleRayIntersect). If a triangle is
+	// hit closer than closest_t, updates closest_t, sets the barycentric
+	// coordinates a and b and returns the triangle number (its first index
+	// is at indices[3 * triangle]). Returns -1 otherwise.
+	S32 intersect(const LLVector4a* positions, const U16* indices,
+				  const LLVector4a& start, const LLVector4a& dir,
+				  F32& closest_t, F32& a, F32& b) const;
+
+	bool isEmpty() const { return mNodes.empty(); }
+	size_t getMemoryUsage() const;
+
+private:
+	struct Node
+	{
+		// Boxes of the four children, component by component
+		LLVector4a mMin[3];
+		LLVector4a mMax[3];
+		// Node index, a leaf made by makeLeaf(), or EMPTY
+		U32 mChild[4];
+	};
+
+	static const U32 EMPTY = 0xFFFFFFFF;
+	static const U32 LEAF_FLAG = 0x80000000;
+	static const U32 MAX_LEAF_TRIANGLES = 4;
+
+	static U32 makeLeaf(U32 first, U32 count) { return LEAF_FLAG | (first << 2) | (count - 1); }
+
+	std::vector<Node> mNodes;
+	// Triangle numbers, grouped by leaf
+	std::vector<U32> mTriangles;
+
+	friend class LLVolumeBVHBuilder;
+};
+
+#endif
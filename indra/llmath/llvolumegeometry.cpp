@@ -0,0 +1,232 @@
+/**
+ * @file llvolumegeometry.cpp
+ * @brief Vertex and index generation for volume faces.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "llvolumegeometry.h"
+
+#include "llmath.h"
+#include "llvolume.h"
+
+// Transform the texture coordinates for this face.
+static void xform4a(LLVector4a &tex_coord, const LLVector4a& trans, const LLVector4Logical& mask, const LLVector4a& rot0, const LLVector4a& rot1, const LLVector4a& offset, const LLVector4a& scale)
+{
+	//tex coord is two coords, <s0, t0, s1, t1>
+	LLVector4a st;
+
+	// Texture transforms are done about the center of the face.
+	st.setAdd(tex_coord, trans);
+
+	// <s0 * cosAng, s0*-sinAng, s1*cosAng, s1*-sinAng>
+	LLVector4a s0;
+	s0.splat(st, 0);
+	LLVector4a s1;
+	s1.splat(st, 2);
+	LLVector4a ss;
+	ss.setSelectWithMask(mask, s1, s0);
+
+	LLVector4a a;
+	a.setMul(rot0, ss);
+
+	// <t0*sinAng, t0*cosAng, t1*sinAng, t1*cosAng>
+	LLVector4a t0;
+	t0.splat(st, 1);
+	LLVector4a t1;
+	t1.splat(st, 3);
+	LLVector4a tt;
+	tt.setSelectWithMask(mask, t1, t0);
+
+	LLVector4a b;
+	b.setMul(rot1, tt);
+
+	st.setAdd(a,b);
+
+	// Then scale
+	st.mul(scale);
+
+	// Then offset
+	tex_coord.setAdd(st, offset);
+}
+
+void ll_volume_face_indices(U16* dst, const LLVolumeFace& vf, U16 index_offset)
+{
+	S32 num_indices = vf.mNumIndices;
+	volatile __m128i* dst128 = (__m128i*) dst;
+	__m128i* src = (__m128i*) vf.mIndices;
+	__m128i offset = _mm_set1_epi16(index_offset);
+
+	S32 end = num_indices/8;
+
+	for (S32 i = 0; i < end; i++)
+	{
+		__m128i res = _mm_add_epi16(src[i], offset);
+		_mm_storeu_si128((__m128i*) dst128++, res);
+	}
+
+	U16* idx = (U16*) dst128;
+
+	for (S32 i = end*8; i < num_indices; ++i)
+	{
+		*idx++ = vf.mIndices[i]+index_offset;
+	}
+}
+
+void ll_volume_face_tex_coords(F32* dst, const LLVolumeFace& vf)
+{
+	S32 tc_size = (vf.mNumVertices*2*sizeof(F32)+0xF) & ~0xF;
+	LLVector4a::memcpyNonAliased16(dst, (F32*) vf.mTexCoords, tc_size);
+}
+
+void ll_volume_face_tex_coords(F32* dst, const LLVolumeFace& vf,
+                               F32 cos_ang, F32 sin_ang, F32 os, F32 ot, F32 ms, F32 mt)
+{
+	LLVector4a* src = (LLVector4a*) vf.mTexCoords;
+
+	LLVector4a trans;
+	trans.splat(-0.5f);
+
+	LLVector4a rot0;
+	rot0.set(cos_ang, -sin_ang, cos_ang, -sin_ang);
+
+	LLVector4a rot1;
+	rot1.set(sin_ang, cos_ang, sin_ang, cos_ang);
+
+	LLVector4a scale;
+	scale.set(ms, mt, ms, mt);
+
+	LLVector4a offset;
+	offset.set(os+0.5f, ot+0.5f, os+0.5f, ot+0.5f);
+
+	LLVector4Logical mask;
+	mask.clear();
+	mask.setElement<2>();
+	mask.setElement<3>();
+
+	S32 count = vf.mNumVertices/2 + vf.mNumVertices%2;
+
+	for (S32 i = 0; i < count; i++)
+	{
+		LLVector4a res = *src++;
+		xform4a(res, trans, mask, rot0, rot1, offset, scale);
+		res.store4a(dst);
+		dst += 4;
+	}
+}
+
+void ll_volume_face_positions(F32* dst, S32 geom_count, const LLVolumeFace& vf,
+                              const LLMatrix4a& mat_vert, S32 texture_index)
+{
+	LLVector4a* src = vf.mPositions;
+	LLVector4a* end = src+vf.mNumVertices;
+	F32* end_f32 = dst+geom_count*4;
+
+	LLVector4a res0;
+	res0.clear();
+
+	F32 val = 0.f;
+	S32* vp = (S32*) &val;
+	*vp = texture_index;
+
+	LLVector4Logical mask;
+	mask.clear();
+	mask.setElement<3>();
+
+	LLVector4a texIdx;
+	texIdx.set(0,0,0,val);
+
+	LLVector4a tmp;
+
+	while (src < end)
+	{
+		mat_vert.affineTransform(*src++, res0);
+		tmp.setSelectWithMask(mask, texIdx, res0);
+		tmp.store4a(dst);
+		dst += 4;
+	}
+
+	while (dst < end_f32)
+	{
+		res0.store4a(dst);
+		dst += 4;
+	}
+}
+
+void ll_volume_face_normals(F32* dst, const LLVolumeFace& vf, const LLMatrix4a& mat_normal)
+{
+	LLVector4a* src = vf.mNormals;
+	LLVector4a* end = src+vf.mNumVertices;
+
+	while (src < end)
+	{
+		LLVector4a normal;
+		mat_normal.rotate(*src++, normal);
+		normal.store4a(dst);
+		dst += 4;
+	}
+}
+
+void ll_volume_face_tangents(F32* dst, const LLVolumeFace& vf, const LLMatrix4a& mat_normal)
+{
+	LLVector4Logical mask;
+	mask.clear();
+	mask.setElement<3>();
+
+	LLVector4a* src = vf.mTangents;
+	LLVector4a* end = vf.mTangents+vf.mNumVertices;
+
+	while (src < end)
+	{
+		LLVector4a tangent_out;
+		mat_normal.rotate(*src, tangent_out);
+		tangent_out.setSelectWithMask(mask, *src, tangent_out);
+		tangent_out.store4a(dst);
+
+		src++;
+		dst += 4;
+	}
+}
+
+void ll_volume_face_colors(F32* dst, S32 num_vertices, U32 rgba)
+{
+	LLVector4a src;
+
+	U32 vec[4];
+	vec[0] = vec[1] = vec[2] = vec[3] = rgba;
+
+	src.loadua((F32*) vec);
+
+	S32 num_vecs = num_vertices/4;
+	if (num_vertices%4 > 0)
+	{
+		++num_vecs;
+	}
+
+	for (S32 i = 0; i < num_vecs; i++)
+	{
+		src.store4a(dst);
+		dst += 4;
+	}
+}
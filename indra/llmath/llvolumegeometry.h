@@ -0,0 +1,66 @@
+/**
+ * @file llvolumegeometry.h
+ * @brief Vertex and index generation for volume faces.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLVOLUMEGEOMETRY_H
+#define LL_LLVOLUMEGEOMETRY_H
+
+class LLMatrix4a;
+class LLVolumeFace;
+
+// The loops LLFace::getGeometryVolume() fills vertex buffer streams with.
+// Destinations are laid out like LLVertexBuffer streams: 16 byte aligned,
+// four floats per position, normal and tangent, two per texture coordinate
+// and one U32 per color. They depend on nothing but the volume face, so
+// they are safe to run on any thread.
+
+// Indices of vf, offset by index_offset
+void ll_volume_face_indices(U16* dst, const LLVolumeFace& vf, U16 index_offset);
+
+// Texture coordinates of vf as they are. Writes up to the next 16 bytes.
+void ll_volume_face_tex_coords(F32* dst, const LLVolumeFace& vf);
+
+// Texture coordinates of vf rotated, scaled and offset about the center
+// of the texture. Writes up to the next 16 bytes.
+void ll_volume_face_tex_coords(F32* dst, const LLVolumeFace& vf,
+                               F32 cos_ang, F32 sin_ang, F32 os, F32 ot, F32 ms, F32 mt);
+
+// Positions of vf transformed by mat_vert, with texture_index in the bits
+// of w, and the last position repeated up to geom_count
+void ll_volume_face_positions(F32* dst, S32 geom_count, const LLVolumeFace& vf,
+                              const LLMatrix4a& mat_vert, S32 texture_index);
+
+// Normals of vf rotated by mat_normal
+void ll_volume_face_normals(F32* dst, const LLVolumeFace& vf, const LLMatrix4a& mat_normal);
+
+// Tangents of vf rotated by mat_normal, keeping the sign in w. The
+// tangents must have been generated.
+void ll_volume_face_tangents(F32* dst, const LLVolumeFace& vf, const LLMatrix4a& mat_normal);
+
+// rgba for every vertex of a face with num_vertices vertices. Writes up to
+// the next 16 bytes.
+void ll_volume_face_colors(F32* dst, S32 num_vertices, U32 rgba);
+
+#endif // LL_LLVOLUMEGEOMETRY_H
@@ -0,0 +1,164 @@
+/**
+ * @file llvolumebvh_test.cpp
+ * @brief LLVolumeBVH test cases.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ * 
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ * 
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ * 
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+#include "../test/lltut.h"
+
+#include "../llvolumebvh.h"
+#include "../llvolume.h"
+
+namespace
+{
+	// Deterministic so failures can be reproduced
+	struct Random
+	{
+		U32 mState = 12345;
+		F32 next(F32 min, F32 max)
+		{
+			mState = mState * 1664525 + 1013904223;
+			return min + (max - min) * (F32)(mState >> 8) / (F32)(1 << 24);
+		}
+	};
+
+	// Closest hit by testing every triangle
+	S32 brute_force(const std::vector<LLVector4a>& positions, const std::vector<U16>& indices,
+					const LLVector4a& start, const LLVector4a& dir, F32& closest_t)
+	{
+		S32 hit = -1;
+		for (size_t i = 0; i < indices.size(); i += 3)
+		{
+			F32 a, b, t;
+			if (LLTriangleRayIntersect(positions[indices[i]], positions[indices[i + 1]], positions[indices[i + 2]],
+									   start, dir, a, b, t) &&
+				t >= 0.f && t <= 1.f && t < closest_t)
+			{
+				closest_t = t;
+				hit = (S32)(i / 3);
+			}
+		}
+		return hit;
+	}
+}
+
+namespace tut
+{
+	struct llvolumebvh_data
+	{
+	};
+	typedef test_group<llvolumebvh_data> llvolumebvh_test;
+	typedef llvolumebvh_test::object llvolumebvh_object;
+	tut::llvolumebvh_test tut_llvolumebvh("LLVolumeBVH");
+
+	template<> template<>
+	void llvolumebvh_object::test<1>()
+	{
+		LLVolumeBVH bvh;
+		ensure("new hierarchy is empty", bvh.isEmpty());
+
+		LLVector4a positions[3];
+		positions[0].set(-1.f, -1.f, 0.f);
+		positions[1].set(1.f, -1.f, 0.f);
+		positions[2].set(0.f, 1.f, 0.f);
+		U16 indices[3] = { 0, 1, 2 };
+		bvh.build(positions, indices, 3);
+		ensure("hierarchy built", !bvh.isEmpty());
+
+		LLVector4a start, dir;
+		start.set(0.f, 0.f, 1.f);
+		dir.set(0.f, 0.f, -2.f);
+		F32 closest_t = 2.f;
+		F32 a = 0.f, b = 0.f;
+		ensure_equals("front face hit", bvh.intersect(positions, indices, start, dir, closest_t, a, b), 0);
+		ensure_approximately_equals("hit distance", closest_t, 0.5f, 16);
+
+		// Back face
+		start.set(0.f, 0.f, -1.f);
+		dir.set(0.f, 0.f, 2.f);
+		closest_t = 2.f;
+		ensure_equals("back face missed", bvh.intersect(positions, indices, start, dir, closest_t, a, b), -1);
+	}
+
+	template<> template<>
+	void llvolumebvh_object::test<2>()
+	{
+		// Triangle soup, every ray checked against testing all triangles
+		Random random;
+		const U32 num_vertices = 3000;
+		std::vector<LLVector4a> positions(num_vertices);
+		for (LLVector4a& position : positions)
+		{
+			position.set(random.next(-10.f, 10.f), random.next(-10.f, 10.f), random.next(-10.f, 10.f));
+		}
+
+		std::vector<U16> indices;
+		for (U32 i = 0; i < num_vertices; i += 3)
+		{
+			// Keep triangles small so rays hit a few of them
+			for (U32 j = 1; j < 3; ++j)
+			{
+				LLVector4a offset;
+				offset.set(random.next(-1.f, 1.f), random.next(-1.f, 1.f), random.next(-1.f, 1.f));
+				positions[i + j].setAdd(positions[i], offset);
+			}
+			indices.push_back((U16)i);
+			indices.push_back((U16)(i + 1));
+			indices.push_back((U16)(i + 2));
+		}
+
+		LLVolumeBVH bvh;
+		bvh.build(positions.data(), indices.data(), (S32)indices.size());
+
+		U32 hits = 0;
+		for (U32 i = 0; i < 2000; ++i)
+		{
+			LLVector4a start, end, dir;
+			start.set(random.next(-12.f, 12.f), random.next(-12.f, 12.f), random.next(-12.f, 12.f));
+			end.set(random.next(-12.f, 12.f), random.next(-12.f, 12.f), random.next(-12.f, 12.f));
+			if (i % 4 == 0)
+			{
+				// Axis aligned segments
+				end = start;
+				end.getF32ptr()[i % 3] += 24.f;
+			}
+			dir.setSub(end, start);
+
+			F32 expected_t = 2.f;
+			S32 expected = brute_force(positions, indices, start, dir, expected_t);
+
+			F32 closest_t = 2.f;
+			F32 a, b;
+			S32 hit = bvh.intersect(positions.data(), indices.data(), start, dir, closest_t, a, b);
+
+			ensure_equals("same triangle hit", hit, expected);
+			if (hit >= 0)
+			{
+				++hits;
+				ensure_approximately_equals("same hit distance", closest_t, expected_t, 12);
+			}
+		}
+		ensure("rays hit some triangles", hits > 0);
+	}
+}
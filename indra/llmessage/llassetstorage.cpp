@@ -1386,16 +1386,29 @@ void LLAssetStorage::legacyGetDataCallback(const LLUUID &uuid,
         LLFILE* fp = LLFile::fopen(filename, "wb");     /* Flawfinder: ignore */ 
         if (fp)
         {
-            const S32 buf_size = 65536;
-            U8 copy_buf[buf_size];
-            while (file.read(copy_buf, buf_size))   /* Flawfinder: ignore */
+            std::span<const U8> mapped = file.getMappedData();
+            if (!mapped.empty())
             {
-                if (fwrite(copy_buf, file.getLastBytesRead(), 1, fp) < 1)
+                // copy straight out of the mapped cache file
+                if (fwrite(mapped.data(), mapped.size(), 1, fp) < 1)
                 {
                     // return a bad file error if we can't write the whole thing
                     status = LL_ERR_CANNOT_OPEN_FILE;
                 }
             }
+            else
+            {
+                const S32 buf_size = 65536;
+                U8 copy_buf[buf_size];
+                while (file.read(copy_buf, buf_size))   /* Flawfinder: ignore */
+                {
+                    if (fwrite(copy_buf, file.getLastBytesRead(), 1, fp) < 1)
+                    {
+                        // return a bad file error if we can't write the whole thing
+                        status = LL_ERR_CANNOT_OPEN_FILE;
+                    }
+                }
+            }
 
             fclose(fp);
         }
@@ -193,6 +193,7 @@ class LLMessageBlock
 			LL_ERRS() << name << " has already been used as a variable name!" << LL_ENDL;
 		}
 		*varp = new LLMessageVariable(name, type, size);
+		setSlotName(mVariableNames, mMemberVariables.find(name) - mMemberVariables.begin(), (*varp)->getName());
 		if (((*varp)->getType() != MVT_VARIABLE)
 			&&(mTotalSize != -1))
 		{
@@ -220,10 +221,41 @@ class LLMessageBlock
 		return iter != mMemberVariables.end()? *iter : NULL;
 	}
 
+	// Position of the variable in mMemberVariables, or -1 if the block has
+	// no such variable. name must be a canonical string.
+	S32 getVariableIndex(const char* name) const
+	{
+		return findSlot(mVariableNames, name);
+	}
+
+	// Names are canonical string table pointers and blocks hold a handful
+	// of variables, so scanning a contiguous array beats the map lookup.
+	static S32 findSlot(const std::vector<const char*>& names, const char* name)
+	{
+		for (size_t i = 0, count = names.size(); i < count; ++i)
+		{
+			if (names[i] == name)
+			{
+				return (S32)i;
+			}
+		}
+		return -1;
+	}
+
+	static void setSlotName(std::vector<const char*>& names, size_t index, const char* name)
+	{
+		if (names.size() <= index)
+		{
+			names.resize(index + 1, NULL);
+		}
+		names[index] = name;
+	}
+
 	friend std::ostream&	 operator<<(std::ostream& s, LLMessageBlock &msg);
 
 	typedef LLIndexedVector<LLMessageVariable*, const char *, 8> message_variable_map_t;
 	message_variable_map_t 					mMemberVariables;
+	std::vector<const char*>				mVariableNames;	// parallel to mMemberVariables
 	char									*mName;
 	EMsgBlockType							mType;
 	S32										mNumber;
@@ -300,6 +332,7 @@ class LLMessageTemplate
 				<< "has already been used as a block name!" << LL_ENDL;
 		}
 		*member_blockp = blockp;
+		LLMessageBlock::setSlotName(mBlockNames, mMemberBlocks.find(blockp->mName) - mMemberBlocks.begin(), blockp->mName);
 		if ((mTotalSize != -1)
 			&& (blockp->mTotalSize != -1)
 			&& ((blockp->mType == MBT_SINGLE)
@@ -388,9 +421,22 @@ class LLMessageTemplate
 		return iter != mMemberBlocks.end() ? *iter : NULL;
 	}
 
+	// Position of the block in mMemberBlocks, or -1 if the message has no
+	// such block. name must be a canonical string.
+	S32 getBlockIndex(const char* name) const
+	{
+		return LLMessageBlock::findSlot(mBlockNames, name);
+	}
+
+	const LLMessageBlock* getBlockAt(S32 index) const
+	{
+		return *(mMemberBlocks.begin() + index);
+	}
+
 public:
 	typedef LLIndexedVector<LLMessageBlock*, char*, 8> message_block_map_t;
 	message_block_map_t						mMemberBlocks;
+	std::vector<const char*>				mBlockNames;	// parallel to mMemberBlocks
 	char									*mName;
 	EMsgFrequency							mFrequency;
 	EMsgTrust								mTrust;
@@ -34,8 +34,21 @@
 
 ///////////////////////////////////////////////////////////
 
-LLPacketBuffer::LLPacketBuffer(const LLHost &host, const char *datap, const S32 size) : mHost(host)
+LLPacketBuffer::LLPacketBuffer(const LLHost &host, const char *datap, const S32 size)
 {
+	init(host, datap, size);
+}
+
+LLPacketBuffer::LLPacketBuffer (S32 hSocket)
+{
+	init(hSocket);
+}
+
+///////////////////////////////////////////////////////////
+
+void LLPacketBuffer::init(const LLHost &host, const char *datap, const S32 size)
+{
+	mHost = host;
 	mSize = 0;
 	mData[0] = '!';
 
@@ -51,16 +64,8 @@ LLPacketBuffer::LLPacketBuffer(const LLHost &host, const char *datap, const S32
 			mSize = size;
 		}
 	}
-	
-}
-
-LLPacketBuffer::LLPacketBuffer (S32 hSocket)
-{
-	init(hSocket);
 }
 
-///////////////////////////////////////////////////////////
-
 void LLPacketBuffer::init (S32 hSocket)
 {
 	mSize = receive_packet(hSocket, mData);
@@ -68,3 +73,41 @@ void LLPacketBuffer::init (S32 hSocket)
 	mReceivingIF = ::get_receiving_interface();
 }
 
+// static
+S32 LLPacketBuffer::receiveBatch(S32 hSocket, LLPacketBuffer* buffers, S32 count)
+{
+	LLNetDatagram datagrams[NET_MAX_DATAGRAM_BATCH];
+	count = llmin(count, NET_MAX_DATAGRAM_BATCH);
+	for (S32 i = 0; i < count; ++i)
+	{
+		datagrams[i].mData = buffers[i].mData;
+	}
+
+	S32 received = receive_packets(hSocket, datagrams, count);
+	for (S32 i = 0; i < received; ++i)
+	{
+		LLPacketBuffer& buffer = buffers[i];
+		buffer.mSize = datagrams[i].mSize;
+		buffer.mHost.set(datagrams[i].mAddress, datagrams[i].mPort);
+		buffer.mReceivingIF.set(datagrams[i].mReceivingIF, INVALID_PORT);
+	}
+	return received;
+}
+
+// static
+S32 LLPacketBuffer::sendBatch(S32 hSocket, const LLPacketBuffer* buffers, S32 count)
+{
+	LLNetDatagram datagrams[NET_MAX_DATAGRAM_BATCH];
+	count = llmin(count, NET_MAX_DATAGRAM_BATCH);
+	for (S32 i = 0; i < count; ++i)
+	{
+		const LLPacketBuffer& buffer = buffers[i];
+		datagrams[i].mData = const_cast<char*>(buffer.mData);
+		datagrams[i].mSize = buffer.mSize;
+		datagrams[i].mAddress = buffer.mHost.getAddress();
+		datagrams[i].mPort = buffer.mHost.getPort();
+		datagrams[i].mReceivingIF = INVALID_HOST_IP_ADDRESS;
+	}
+	return send_packets(hSocket, datagrams, count);
+}
+
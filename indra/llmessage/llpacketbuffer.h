@@ -34,6 +34,7 @@
 class LLPacketBuffer
 {
 public:
+	LLPacketBuffer() : mSize(0) {}          // for preallocated batches
 	LLPacketBuffer(const LLHost &host, const char *datap, const S32 size);
 	LLPacketBuffer(S32 hSocket);           // receive a packet
 	~LLPacketBuffer() = default;
@@ -42,7 +43,15 @@ class LLPacketBuffer
 	const char	*getData() const				{ return mData; }
 	LLHost		getHost() const					{ return mHost; }
 	LLHost		getReceivingInterface() const	{ return mReceivingIF; }
+	void		setReceivingInterface(const LLHost& host)	{ mReceivingIF = host; }
 	void init(S32 hSocket);
+	void init(const LLHost &host, const char *datap, const S32 size);
+
+	// Receive into or send count buffers with a single system call.
+	// Return the number of buffers received or sent, or -1 if the platform
+	// can't batch and packets have to go one by one.
+	static S32 receiveBatch(S32 hSocket, LLPacketBuffer* buffers, S32 count);
+	static S32 sendBatch(S32 hSocket, const LLPacketBuffer* buffers, S32 count);
 
 protected:
 	char	mData[NET_BUFFER_SIZE];        // packet data		/* Flawfinder : ignore */
@@ -0,0 +1,251 @@
+/** 
+ * @file llpacketreceivethread.cpp
+ * @brief Reads UDP packets off the message socket on a worker thread.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ * 
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ * 
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ * 
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "llpacketreceivethread.h"
+
+#if LL_WINDOWS
+	#include "llwin32headerslean.h"
+#else
+	#include <netinet/in.h>
+#endif
+
+#include "llerror.h"
+#include "lltimer.h"
+#include "message.h"
+#include "net.h"
+
+LLPacketReceiveThread::LLPacketReceiveThread(S32 socket) :
+	LLThread("Packet receive"),
+	mSocket(socket),
+	mUseBatching(true),
+	mWriteBlock(new Block),
+	mReadPos(0),
+	mBlockCount(1),
+	mSpareBlock(nullptr)
+{
+	mReadBlock = mWriteBlock;
+}
+
+LLPacketReceiveThread::~LLPacketReceiveThread()
+{
+	shutdown();
+
+	while (mReadBlock)
+	{
+		Block* next = mReadBlock->mNext.load(std::memory_order_relaxed);
+		delete mReadBlock;
+		mReadBlock = next;
+	}
+	delete mSpareBlock.load(std::memory_order_relaxed);
+}
+
+S32 LLPacketReceiveThread::pop(char* datap, LLHost& sender, LLHost& receiving_if, S32& compressed_size)
+{
+	while (true)
+	{
+		if (mReadPos == BLOCK_SIZE)
+		{
+			Block* next = mReadBlock->mNext.load(std::memory_order_acquire);
+			if (!next)
+			{
+				return 0;
+			}
+			releaseBlock(mReadBlock);
+			mReadBlock = next;
+			mReadPos = 0;
+		}
+
+		if (mReadPos == mReadBlock->mFilled.load(std::memory_order_acquire))
+		{
+			return 0;
+		}
+
+		const LLPacketBuffer& packet = mReadBlock->mPackets[mReadPos];
+		S32 packet_size = packet.getSize();
+		if (packet_size)
+		{
+			memcpy(datap, packet.getData(), packet_size);	/*Flawfinder: ignore*/
+			sender = packet.getHost();
+			receiving_if = packet.getReceivingInterface();
+			compressed_size = mReadBlock->mCompressedSize[mReadPos];
+		}
+		++mReadPos;
+
+		// Slots of packets dropped by the thread are empty, skip them
+		if (packet_size)
+		{
+			return packet_size;
+		}
+	}
+}
+
+// Main thread. The thread is done with a block once it has linked the next.
+void LLPacketReceiveThread::releaseBlock(Block* block)
+{
+	mBlockCount.fetch_sub(1, std::memory_order_release);
+	delete mSpareBlock.exchange(block, std::memory_order_acq_rel);
+}
+
+// Thread. Links a block after the full mWriteBlock, or returns NULL if the
+// queue is as long as it gets.
+LLPacketReceiveThread::Block* LLPacketReceiveThread::nextWriteBlock()
+{
+	if (mBlockCount.load(std::memory_order_acquire) >= MAX_BLOCKS)
+	{
+		return NULL;
+	}
+
+	Block* block = mSpareBlock.exchange(nullptr, std::memory_order_acq_rel);
+	if (block)
+	{
+		block->mFilled.store(0, std::memory_order_relaxed);
+		block->mNext.store(nullptr, std::memory_order_relaxed);
+	}
+	else
+	{
+		block = new Block;
+	}
+
+	mBlockCount.fetch_add(1, std::memory_order_relaxed);
+	mWriteBlock->mNext.store(block, std::memory_order_release);
+	return block;
+}
+
+void LLPacketReceiveThread::run()
+{
+	while (!isQuitting())
+	{
+		U32 filled = mWriteBlock->mFilled.load(std::memory_order_relaxed);
+		if (filled == BLOCK_SIZE)
+		{
+			Block* block = nextWriteBlock();
+			if (!block)
+			{
+				// Main thread is far behind, leave the packets in the socket buffer
+				ms_sleep(1);
+				continue;
+			}
+			mWriteBlock = block;
+			filled = 0;
+		}
+
+		if (!wait_for_packet(mSocket, WAIT_MS))
+		{
+			continue;
+		}
+
+		// Only fill the rest of this block so a batch can be received in one call
+		S32 received = receive(&mWriteBlock->mPackets[filled], (S32)(BLOCK_SIZE - filled));
+		for (S32 i = 0; i < received; ++i)
+		{
+			mWriteBlock->mCompressedSize[filled + i] = expand(mWriteBlock->mPackets[filled + i]);
+		}
+
+		if (received > 0)
+		{
+			mWriteBlock->mFilled.store(filled + received, std::memory_order_release);
+		}
+	}
+}
+
+S32 LLPacketReceiveThread::receive(LLPacketBuffer* buffers, S32 count)
+{
+	if (LLProxy::isSOCKSProxyEnabled())
+	{
+		S32 packet_size = receive_packet(mSocket, reinterpret_cast<char*>(mScratch));
+		if (packet_size <= 0)
+		{
+			return 0;
+		}
+
+		if (packet_size > SOCKS_HEADER_SIZE)
+		{
+			// *FIX We are assuming ATYP is 0x01 (IPv4), not 0x03 (hostname) or 0x04 (IPv6)
+			proxywrap_t* header = reinterpret_cast<proxywrap_t*>(mScratch);
+			LLHost sender(header->addr, ntohs(header->port));
+			buffers[0].init(sender, reinterpret_cast<char*>(mScratch) + SOCKS_HEADER_SIZE, packet_size - SOCKS_HEADER_SIZE);
+		}
+		else
+		{
+			// Keep the slot so the read counts, pop() skips it
+			buffers[0].init(LLHost(), NULL, 0);
+		}
+		buffers[0].setReceivingInterface(::get_receiving_interface());
+		return 1;
+	}
+
+	if (mUseBatching)
+	{
+		S32 received = LLPacketBuffer::receiveBatch(mSocket, buffers, count);
+		if (received >= 0)
+		{
+			return received;
+		}
+		LL_INFOS() << "Batched packet receive not available, receiving one packet at a time" << LL_ENDL;
+		mUseBatching = false;
+	}
+
+	buffers[0].init(mSocket);
+	return buffers[0].getSize() > 0 ? 1 : 0;
+}
+
+// Expands a zero coded packet in place, leaving any appended acks as they
+// are. Returns the zero coded size of the body, or 0 if the packet is
+// left for the main thread to expand or reject.
+S32 LLPacketReceiveThread::expand(LLPacketBuffer& packet)
+{
+	S32 packet_size = packet.getSize();
+	const U8* data = reinterpret_cast<const U8*>(packet.getData());
+	if (packet_size < LL_MINIMUM_VALID_PACKET_SIZE || !(data[0] & LL_ZERO_CODE_FLAG))
+	{
+		return 0;
+	}
+
+	S32 body_size = packet_size;
+	S32 acks_size = 0;
+	if (data[0] & LL_ACK_FLAG)
+	{
+		acks_size = 1 + data[packet_size - 1] * sizeof(TPACKETID);
+		if (packet_size < acks_size + LL_MINIMUM_VALID_PACKET_SIZE)
+		{
+			return 0;
+		}
+		body_size -= acks_size;
+	}
+
+	S32 expanded_size = LLMessageSystem::zeroCodeExpand(data, body_size, mScratch, NET_BUFFER_SIZE - acks_size);
+	if (expanded_size < 0)
+	{
+		return 0;
+	}
+
+	memcpy(mScratch + expanded_size, data + body_size, acks_size);	/*Flawfinder: ignore*/
+	mScratch[0] &= ~LL_ZERO_CODE_FLAG;
+	packet.init(packet.getHost(), reinterpret_cast<char*>(mScratch), expanded_size + acks_size);
+	return body_size;
+}
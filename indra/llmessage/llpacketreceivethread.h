@@ -0,0 +1,92 @@
+/** 
+ * @file llpacketreceivethread.h
+ * @brief Reads UDP packets off the message socket on a worker thread.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ * 
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ * 
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ * 
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLPACKETRECEIVETHREAD_H
+#define LL_LLPACKETRECEIVETHREAD_H
+
+#include <atomic>
+#include <memory>
+
+#include "llhost.h"
+#include "llpacketbuffer.h"
+#include "llproxy.h"
+#include "llthread.h"
+
+// Drains the socket as soon as packets arrive, unwraps SOCKS and expands
+// zero coded packets, and hands them to the main thread through a single
+// producer, single consumer queue. The queue grows a block at a time, so
+// the bursts of a login or teleport are taken off the socket even while
+// the main thread is stuck in a long frame. Circuits, acks and template
+// checks are left to the message system on the main thread.
+class LLPacketReceiveThread : public LLThread
+{
+public:
+	LLPacketReceiveThread(S32 socket);
+	~LLPacketReceiveThread();
+
+	// Main thread only. Copies the oldest received packet to datap and
+	// returns its size, or 0 if none is waiting. compressed_size is the
+	// zero coded size of the packet body if it was expanded here, else 0.
+	S32 pop(char* datap, LLHost& sender, LLHost& receiving_if, S32& compressed_size);
+
+protected:
+	void run() override;
+
+private:
+	S32 receive(LLPacketBuffer* buffers, S32 count);
+	S32 expand(LLPacketBuffer& packet);
+
+	static const U32 BLOCK_SIZE = 128;		// packets per block
+	static const U32 MAX_BLOCKS = 32;		// beyond this packets wait in the socket buffer
+	static const S32 WAIT_MS = 50;			// how often to check for shutdown
+
+	// The thread fills mPackets in order and publishes them through
+	// mFilled. Once a block is full it links a new one through mNext, and
+	// the main thread lets go of a block after it has moved on to the next.
+	struct Block
+	{
+		LLPacketBuffer mPackets[BLOCK_SIZE];
+		S32 mCompressedSize[BLOCK_SIZE];
+		std::atomic<U32> mFilled{ 0 };
+		std::atomic<Block*> mNext{ nullptr };
+	};
+
+	Block* nextWriteBlock();
+	void releaseBlock(Block* block);
+
+	const S32 mSocket;
+	bool mUseBatching;
+
+	Block* mWriteBlock;				// thread only
+	Block* mReadBlock;				// main thread only
+	U32 mReadPos;					// main thread only
+	std::atomic<U32> mBlockCount;	// blocks in the queue
+	std::atomic<Block*> mSpareBlock;	// last released block, kept for reuse
+
+	U8 mScratch[NET_BUFFER_SIZE + SOCKS_HEADER_SIZE];
+};
+
+#endif
@@ -56,13 +56,22 @@ LLPacketRing::LLPacketRing () :
 	mInBufferLength(0),
 	mOutBufferLength(0),
 	mDropPercentage(0.0f),
-	mPacketsToDrop(0x0)
+	mPacketsToDrop(0x0),
+	mUseBatching(true),
+	mReceiveBatchCount(0),
+	mReceiveBatchNext(0),
+	mSendBatchCount(0),
+	mSendBatchSocket(-1),
+	mSendBatching(false),
+	mReceiveThreadSocket(-1),
+	mLastCompressedSize(0)
 {
 }
 
 ///////////////////////////////////////////////////////////
 LLPacketRing::~LLPacketRing ()
 {
+	stopReceiveThread();
 	cleanup();
 }
 	
@@ -84,6 +93,11 @@ void LLPacketRing::cleanup ()
 		delete packetp;
 		mSendQueue.pop();
 	}
+
+	mReceiveBatchCount = 0;
+	mReceiveBatchNext = 0;
+	mSendBatchCount = 0;
+	mSendBatching = false;
 }
 
 ///////////////////////////////////////////////////////////
@@ -101,6 +115,17 @@ void LLPacketRing::setDropPercentage (F32 percent_to_drop)
 void LLPacketRing::setUseInThrottle(const BOOL use_throttle)
 {
 	mUseInThrottle = use_throttle;
+	if (mUseInThrottle && mReceiveThread)
+	{
+		// The throttle reads the socket itself
+		LL_INFOS() << "Incoming throttle enabled, stopping packet receive thread" << LL_ENDL;
+		mReceiveThread.reset();
+	}
+	else if (!mUseInThrottle && !mReceiveThread && mReceiveThreadSocket >= 0)
+	{
+		LL_INFOS() << "Incoming throttle disabled, restarting packet receive thread" << LL_ENDL;
+		startReceiveThread(mReceiveThreadSocket);
+	}
 }
 
 void LLPacketRing::setUseOutThrottle(const BOOL use_throttle)
@@ -154,10 +179,76 @@ S32 LLPacketRing::receiveFromRing (S32 socket, char *datap)
 	return packet_size;
 }
 
+///////////////////////////////////////////////////////////
+// Hands out the next packet of the current batch, reading a new batch
+// with one system call once it is used up. Returns -1 if the platform
+// can't batch receives.
+S32 LLPacketRing::receiveFromBatch(S32 socket, char *datap)
+{
+	if (mReceiveBatchNext >= mReceiveBatchCount)
+	{
+		if (!mUseBatching)
+		{
+			return -1;
+		}
+
+		if (!mReceiveBatch)
+		{
+			mReceiveBatch.reset(new LLPacketBuffer[PACKET_BATCH_SIZE]);
+		}
+
+		mReceiveBatchNext = 0;
+		mReceiveBatchCount = LLPacketBuffer::receiveBatch(socket, mReceiveBatch.get(), PACKET_BATCH_SIZE);
+		if (mReceiveBatchCount < 0)
+		{
+			LL_INFOS() << "Batched packet receive not available, receiving one packet at a time" << LL_ENDL;
+			mUseBatching = false;
+			mReceiveBatchCount = 0;
+			mReceiveBatch.reset();
+			return -1;
+		}
+		if (!mReceiveBatchCount)
+		{
+			return 0;
+		}
+	}
+
+	const LLPacketBuffer& packet = mReceiveBatch[mReceiveBatchNext++];
+	S32 packet_size = packet.getSize();
+	memcpy(datap, packet.getData(), packet_size);	/*Flawfinder: ignore*/
+	mLastSender = packet.getHost();
+	mLastReceivingIF = packet.getReceivingInterface();
+	return packet_size;
+}
+
+///////////////////////////////////////////////////////////
+void LLPacketRing::startReceiveThread(S32 socket)
+{
+	// Remembered so the thread can come back once the throttle is off
+	mReceiveThreadSocket = socket;
+	if (mReceiveThread || mUseInThrottle)
+	{
+		return;
+	}
+
+	LL_INFOS() << "Starting packet receive thread" << LL_ENDL;
+	mReceiveThread.reset(new LLPacketReceiveThread(socket));
+	mReceiveThread->start();
+}
+
+void LLPacketRing::stopReceiveThread()
+{
+	// Packets still queued in the thread are dropped, the sender
+	// resends the reliable ones.
+	mReceiveThreadSocket = -1;
+	mReceiveThread.reset();
+}
+
 ///////////////////////////////////////////////////////////
 S32 LLPacketRing::receivePacket (S32 socket, char *datap)
 {
 	S32 packet_size = 0;
+	mLastCompressedSize = 0;
 
 	// If using the throttle, simulate a limited size input buffer.
 	if (mUseInThrottle)
@@ -225,7 +316,11 @@ S32 LLPacketRing::receivePacket (S32 socket, char *datap)
 	else
 	{
 		// no delay, pull straight from net
-		if (LLProxy::isSOCKSProxyEnabled())
+		if (mReceiveThread)
+		{
+			packet_size = mReceiveThread->pop(datap, mLastSender, mLastReceivingIF, mLastCompressedSize);
+		}
+		else if (LLProxy::isSOCKSProxyEnabled())
 		{
 			U8 buffer[NET_BUFFER_SIZE + SOCKS_HEADER_SIZE];
 			packet_size = receive_packet(socket, static_cast<char*>(static_cast<void*>(buffer)));
@@ -244,15 +339,19 @@ S32 LLPacketRing::receivePacket (S32 socket, char *datap)
 			{
 				packet_size = 0;
 			}
+			mLastReceivingIF = ::get_receiving_interface();
 		}
 		else
 		{
-			packet_size = receive_packet(socket, datap);
-			mLastSender = ::get_sender();
+			packet_size = receiveFromBatch(socket, datap);
+			if (packet_size < 0)
+			{
+				packet_size = receive_packet(socket, datap);
+				mLastSender = ::get_sender();
+				mLastReceivingIF = ::get_receiving_interface();
+			}
 		}
 
-		mLastReceivingIF = ::get_receiving_interface();
-
 		if (packet_size)  // did we actually get a packet?
 		{
 			if (mDropPercentage && (ll_frand(100.f) < mDropPercentage))
@@ -279,6 +378,16 @@ BOOL LLPacketRing::sendPacket(int h_socket, char * send_buffer, S32 buf_size, co
 	BOOL status = TRUE;
 	if (!mUseOutThrottle)
 	{
+		if (mSendBatching && !LLProxy::isSOCKSProxyEnabled())
+		{
+			if (mSendBatchCount == PACKET_BATCH_SIZE || (mSendBatchCount && h_socket != mSendBatchSocket))
+			{
+				flushSendBatch();
+			}
+			mSendBatchSocket = h_socket;
+			mSendBatch[mSendBatchCount++].init(host, send_buffer, buf_size);
+			return TRUE;
+		}
 		return sendPacketImpl(h_socket, send_buffer, buf_size, host );
 	}
 	else
@@ -373,3 +482,43 @@ BOOL LLPacketRing::sendPacketImpl(int h_socket, const char * send_buffer, S32 bu
 						LLProxy::getInstance()->getUDPProxy().getAddress(),
 						LLProxy::getInstance()->getUDPProxy().getPort());
 }
+
+void LLPacketRing::beginSendBatch()
+{
+	if (!mUseBatching)
+	{
+		return;
+	}
+	if (!mSendBatch)
+	{
+		mSendBatch.reset(new LLPacketBuffer[PACKET_BATCH_SIZE]);
+	}
+	mSendBatching = true;
+}
+
+void LLPacketRing::endSendBatch()
+{
+	flushSendBatch();
+	mSendBatching = false;
+}
+
+void LLPacketRing::flushSendBatch()
+{
+	if (!mSendBatchCount)
+	{
+		return;
+	}
+
+	if (LLPacketBuffer::sendBatch(mSendBatchSocket, mSendBatch.get(), mSendBatchCount) < 0)
+	{
+		LL_INFOS() << "Batched packet send not available, sending one packet at a time" << LL_ENDL;
+		mUseBatching = false;
+		mSendBatching = false;
+		for (S32 i = 0; i < mSendBatchCount; ++i)
+		{
+			const LLPacketBuffer& packet = mSendBatch[i];
+			sendPacketImpl(mSendBatchSocket, packet.getData(), packet.getSize(), packet.getHost());
+		}
+	}
+	mSendBatchCount = 0;
+}
@@ -28,10 +28,12 @@
 #ifndef LL_LLPACKETRING_H
 #define LL_LLPACKETRING_H
 
+#include <memory>
 #include <queue>
 
 #include "llhost.h"
 #include "llpacketbuffer.h"
+#include "llpacketreceivethread.h"
 #include "llproxy.h"
 #include "llthrottle.h"
 #include "net.h"
@@ -55,6 +57,21 @@ class LLPacketRing
 
 	BOOL sendPacket(int h_socket, char * send_buffer, S32 buf_size, const LLHost& host);
 
+	// Between these calls unthrottled packets are queued and sent with as
+	// few system calls as possible. Queued packets are reported as sent,
+	// failures are only logged.
+	void beginSendBatch();
+	void endSendBatch();
+
+	// Read packets from socket on a worker thread from now on. Suspended
+	// while the incoming throttle is simulating a slow connection.
+	void startReceiveThread(S32 socket);
+	void stopReceiveThread();
+
+	// Zero coded body size of the last received packet if the receive
+	// thread already expanded it, 0 otherwise
+	S32 getLastCompressedSize() const			{ return mLastCompressedSize; }
+
 	inline LLHost getLastSender();
 	inline LLHost getLastReceivingInterface();
 
@@ -83,8 +100,26 @@ class LLPacketRing
 	LLHost mLastSender;
 	LLHost mLastReceivingIF;
 
+	// Batched transport, allocated on first use. Cleared if the platform
+	// turns out not to support it.
+	static const S32 PACKET_BATCH_SIZE = 32;
+	bool mUseBatching;
+	std::unique_ptr<LLPacketBuffer[]> mReceiveBatch;
+	S32 mReceiveBatchCount;
+	S32 mReceiveBatchNext;
+	std::unique_ptr<LLPacketBuffer[]> mSendBatch;
+	S32 mSendBatchCount;
+	S32 mSendBatchSocket;
+	bool mSendBatching;
+
+	std::unique_ptr<LLPacketReceiveThread> mReceiveThread;
+	S32 mReceiveThreadSocket;		// -1 unless the receive thread was requested
+	S32 mLastCompressedSize;
+
 private:
 	BOOL sendPacketImpl(int h_socket, const char * send_buffer, S32 buf_size, const LLHost& host);
+	S32 receiveFromBatch(S32 socket, char *datap);
+	void flushSendBatch();
 };
 
 
@@ -41,25 +41,45 @@ LLTemplateMessageReader::LLTemplateMessageReader(message_template_number_map_t&
 												 number_template_map) :
 	mReceiveSize(0),
 	mCurrentRMessageTemplate(nullptr),
-	mCurrentRMessageData(nullptr),
+	mMessageDecoded(false),
 	mMessageNumbers(number_template_map)
 {
+	mPacket.reserve(MAX_BUFFER_SIZE);
 }
 
 //virtual 
-LLTemplateMessageReader::~LLTemplateMessageReader()
-{
-	delete mCurrentRMessageData;
-	mCurrentRMessageData = nullptr;
-}
+LLTemplateMessageReader::~LLTemplateMessageReader() = default;
 
 //virtual
 void LLTemplateMessageReader::clearMessage()
 {
 	mReceiveSize = -1;
 	mCurrentRMessageTemplate = nullptr;
-	delete mCurrentRMessageData;
-	mCurrentRMessageData = nullptr;
+	mMessageDecoded = false;
+	mBlockSlots.clear();
+	mVarSlots.clear();
+}
+
+S32 LLTemplateMessageReader::findBlock(const char* blockname, S32 blocknum) const
+{
+	S32 block_index = mCurrentRMessageTemplate->getBlockIndex(blockname);
+	if (block_index < 0 || blocknum < 0 || blocknum >= mBlockSlots[block_index].mCount)
+	{
+		return -1;
+	}
+	return block_index;
+}
+
+const LLTemplateMessageReader::VarSlot* LLTemplateMessageReader::findVar(S32 block_index, S32 blocknum, const char* varname) const
+{
+	const LLMessageBlock* block = mCurrentRMessageTemplate->getBlockAt(block_index);
+	S32 var_index = block->getVariableIndex(varname);
+	if (var_index < 0)
+	{
+		return nullptr;
+	}
+	S32 num_vars = (S32)block->mMemberVariables.size();
+	return &mVarSlots[mBlockSlots[block_index].mFirstVar + blocknum * num_vars + var_index];
 }
 
 void LLTemplateMessageReader::getData(const char *blockname, const char *varname, void *datap, S32 size, S32 blocknum, S32 max_size)
@@ -71,83 +91,94 @@ void LLTemplateMessageReader::getData(const char *blockname, const char *varname
 		return;
 	}
 
-	if (!mCurrentRMessageData)
+	if (!mMessageDecoded)
 	{
-		LL_ERRS() << "Invalid mCurrentMessageData in getData!" << LL_ENDL;
+		LL_ERRS() << "Message not decoded in getData!" << LL_ENDL;
 		return;
 	}
 
-	char *bnamep = (char *)blockname + blocknum; // this works because it's just a hash.  The bnamep is never derefference
-	char *vnamep = (char *)varname; 
-
-	LLMsgData::msg_blk_data_map_t::const_iterator iter = mCurrentRMessageData->mMemberBlocks.find(bnamep);
-
-	if (iter == mCurrentRMessageData->mMemberBlocks.end())
+	S32 block_index = findBlock(blockname, blocknum);
+	if (block_index < 0)
 	{
 		LL_ERRS() << "Block " << blockname << " #" << blocknum
-			<< " not in message " << mCurrentRMessageData->mName << LL_ENDL;
+			<< " not in message " << mCurrentRMessageTemplate->mName << LL_ENDL;
 		return;
 	}
 
-	LLMsgBlkData *msg_block_data = iter->second;
-	LLMsgBlkData::msg_var_data_map_t &var_data_map = msg_block_data->mMemberVarData;
-
-	if (var_data_map.find(vnamep) == var_data_map.end())
+	const VarSlot* vardata = findVar(block_index, blocknum, varname);
+	if (!vardata)
 	{
-		LL_ERRS() << "Variable "<< vnamep << " not in message "
-			<< mCurrentRMessageData->mName<< " block " << bnamep << LL_ENDL;
+		LL_ERRS() << "Variable "<< varname << " not in message "
+			<< mCurrentRMessageTemplate->mName<< " block " << blockname << LL_ENDL;
 		return;
 	}
 
-	LLMsgVarData& vardata = msg_block_data->mMemberVarData[vnamep];
-
-	if (size && size != vardata.getSize())
+	if (size && size != vardata->mSize)
 	{
-		LL_ERRS() << "Msg " << mCurrentRMessageData->mName 
-			<< " variable " << vnamep
-			<< " is size " << vardata.getSize()
+		LL_ERRS() << "Msg " << mCurrentRMessageTemplate->mName 
+			<< " variable " << varname
+			<< " is size " << vardata->mSize
 			<< " but copying into buffer of size " << size
 			<< LL_ENDL;
 		return;
 	}
 
-
-	const S32 vardata_size = vardata.getSize();
-	if( max_size >= vardata_size )
-	{   
-		switch( vardata_size )
-		{ 
-		case 0:
-			// This is here to prevent a memcpy from a null value which is undefined behavior.
-			break;
-		case 1:
-			*((U8*)datap) = *((U8*)vardata.getData());
-			break;
-		case 2:
-			*((U16*)datap) = *((U16*)vardata.getData());
-			break;
-		case 4:
-			*((U32*)datap) = *((U32*)vardata.getData());
-			break;
-		case 8:
-			((U32*)datap)[0] = ((U32*)vardata.getData())[0];
-			((U32*)datap)[1] = ((U32*)vardata.getData())[1];
-			break;
-		default:
-			memcpy(datap, vardata.getData(), vardata_size);
-			break;
-		}
-	}
-	else
+	S32 vardata_size = vardata->mSize;
+	if (max_size < vardata_size)
 	{
-		LL_WARNS() << "Msg " << mCurrentRMessageData->mName 
-			<< " variable " << vnamep
-			<< " is size " << vardata.getSize()
+		LL_WARNS() << "Msg " << mCurrentRMessageTemplate->mName 
+			<< " variable " << varname
+			<< " is size " << vardata_size
 			<< " but truncated to max size of " << max_size
 			<< LL_ENDL;
+		vardata_size = max_size;
+	}
 
-		memcpy(datap, vardata.getData(), max_size);
+	if (vardata_size <= 0)
+	{
+		// This is here to prevent a memcpy from a null value which is undefined behavior.
+		return;
 	}
+
+	if (vardata->mOffset < 0)
+	{
+		// Ran off the end of the packet, default to 0s.
+		memset(datap, 0, vardata_size);
+		return;
+	}
+
+	const U8* src = &mPacket[vardata->mOffset];
+#ifdef LL_BIG_ENDIAN
+	const LLMessageVariable* var = mCurrentRMessageTemplate->getBlockAt(block_index)->getVariable((char*)varname);
+	htolememcpy(datap, src, var->getType(), vardata_size);
+#else
+	// Packet data is unaligned, constant sizes let the compiler inline
+	// the common cases.
+	switch (vardata_size)
+	{
+	case 1:
+		*((U8*)datap) = *src;
+		break;
+	case 2:
+		memcpy(datap, src, 2);
+		break;
+	case 4:
+		memcpy(datap, src, 4);
+		break;
+	case 8:
+		memcpy(datap, src, 8);
+		break;
+	case 12:
+		memcpy(datap, src, 12);
+		break;
+	case 16:
+		memcpy(datap, src, 16);
+		break;
+	default:
+		memcpy(datap, src, vardata_size);
+		break;
+	}
+#endif
 }
 
 S32 LLTemplateMessageReader::getNumberOfBlocks(const char *blockname)
@@ -159,22 +190,19 @@ S32 LLTemplateMessageReader::getNumberOfBlocks(const char *blockname)
 		return -1;
 	}
 
-	if (!mCurrentRMessageData)
+	if (!mMessageDecoded)
 	{
-		LL_ERRS() << "Invalid mCurrentRMessageData in getData!" << LL_ENDL;
+		LL_ERRS() << "Message not decoded in getNumberOfBlocks!" << LL_ENDL;
 		return -1;
 	}
 
-	char *bnamep = (char *)blockname; 
-
-	LLMsgData::msg_blk_data_map_t::const_iterator iter = mCurrentRMessageData->mMemberBlocks.find(bnamep);
-	
-	if (iter == mCurrentRMessageData->mMemberBlocks.end())
+	S32 block_index = mCurrentRMessageTemplate->getBlockIndex(blockname);
+	if (block_index < 0)
 	{
 		return 0;
 	}
 
-	return (iter->second)->mBlockNumber;
+	return mBlockSlots[block_index].mCount;
 }
 
 S32 LLTemplateMessageReader::getSize(const char *blockname, const char *varname)
@@ -186,43 +214,36 @@ S32 LLTemplateMessageReader::getSize(const char *blockname, const char *varname)
 		return LL_MESSAGE_ERROR;
 	}
 
-	if (!mCurrentRMessageData)
+	if (!mMessageDecoded)
 	{	// This is a serious error - crash
-		LL_ERRS() << "Invalid mCurrentRMessageData in getData!" << LL_ENDL;
+		LL_ERRS() << "Message not decoded in getSize!" << LL_ENDL;
 		return LL_MESSAGE_ERROR;
 	}
 
-	char *bnamep = (char *)blockname; 
-
-	LLMsgData::msg_blk_data_map_t::const_iterator iter = mCurrentRMessageData->mMemberBlocks.find(bnamep);
-	
-	if (iter == mCurrentRMessageData->mMemberBlocks.end())
+	S32 block_index = findBlock(blockname, 0);
+	if (block_index < 0)
 	{	// don't crash
-		LL_INFOS() << "Block " << bnamep << " not in message "
-			<< mCurrentRMessageData->mName << LL_ENDL;
+		LL_INFOS() << "Block " << blockname << " not in message "
+			<< mCurrentRMessageTemplate->mName << LL_ENDL;
 		return LL_BLOCK_NOT_IN_MESSAGE;
 	}
 
-	char *vnamep = (char *)varname; 
-
-	LLMsgBlkData* msg_data = iter->second;
-	LLMsgVarData& vardata = msg_data->mMemberVarData[vnamep];
-	
-	if (!vardata.getName())
+	const VarSlot* vardata = findVar(block_index, 0, varname);
+	if (!vardata)
 	{	// don't crash
 		LL_INFOS() << "Variable " << varname << " not in message "
-			<< mCurrentRMessageData->mName << " block " << bnamep << LL_ENDL;
+			<< mCurrentRMessageTemplate->mName << " block " << blockname << LL_ENDL;
 		return LL_VARIABLE_NOT_IN_BLOCK;
 	}
 
-	if (mCurrentRMessageTemplate->mMemberBlocks[bnamep]->mType != MBT_SINGLE)
+	if (mCurrentRMessageTemplate->getBlockAt(block_index)->mType != MBT_SINGLE)
 	{	// This is a serious error - crash
-		LL_ERRS() << "Block " << bnamep << " isn't type MBT_SINGLE,"
+		LL_ERRS() << "Block " << blockname << " isn't type MBT_SINGLE,"
 			" use getSize with blocknum argument!" << LL_ENDL;
 		return LL_MESSAGE_ERROR;
 	}
 
-	return vardata.getSize();
+	return vardata->mSize;
 }
 
 S32 LLTemplateMessageReader::getSize(const char *blockname, S32 blocknum, const char *varname)
@@ -234,35 +255,29 @@ S32 LLTemplateMessageReader::getSize(const char *blockname, S32 blocknum, const
 		return LL_MESSAGE_ERROR;
 	}
 
-	if (!mCurrentRMessageData)
+	if (!mMessageDecoded)
 	{	// This is a serious error - crash
-		LL_ERRS() << "Invalid mCurrentRMessageData in getData!" << LL_ENDL;
+		LL_ERRS() << "Message not decoded in getSize!" << LL_ENDL;
 		return LL_MESSAGE_ERROR;
 	}
 
-	char *bnamep = (char *)blockname + blocknum; 
-	char *vnamep = (char *)varname; 
-
-	LLMsgData::msg_blk_data_map_t::const_iterator iter = mCurrentRMessageData->mMemberBlocks.find(bnamep);
-	
-	if (iter == mCurrentRMessageData->mMemberBlocks.end())
+	S32 block_index = findBlock(blockname, blocknum);
+	if (block_index < 0)
 	{	// don't crash
-		LL_INFOS() << "Block " << bnamep << " not in message " 
-			<< mCurrentRMessageData->mName << LL_ENDL;
+		LL_INFOS() << "Block " << blockname << " #" << blocknum << " not in message " 
+			<< mCurrentRMessageTemplate->mName << LL_ENDL;
 		return LL_BLOCK_NOT_IN_MESSAGE;
 	}
 
-	LLMsgBlkData* msg_data = iter->second;
-	LLMsgVarData& vardata = msg_data->mMemberVarData[vnamep];
-	
-	if (!vardata.getName())
+	const VarSlot* vardata = findVar(block_index, blocknum, varname);
+	if (!vardata)
 	{	// don't crash
-		LL_INFOS() << "Variable " << vnamep << " not in message "
-			<<  mCurrentRMessageData->mName << " block " << bnamep << LL_ENDL;
+		LL_INFOS() << "Variable " << varname << " not in message "
+			<<  mCurrentRMessageTemplate->mName << " block " << blockname << LL_ENDL;
 		return LL_VARIABLE_NOT_IN_BLOCK;
 	}
 
-	return vardata.getSize();
+	return vardata->mSize;
 }
 
 void LLTemplateMessageReader::getBinaryData(const char *blockname, 
@@ -539,24 +554,25 @@ BOOL LLTemplateMessageReader::decodeData(const U8* buffer, const LLHost& sender,
 
 	llassert( mReceiveSize >= 0 );
 	llassert( mCurrentRMessageTemplate);
-	llassert( !mCurrentRMessageData );
-	delete mCurrentRMessageData; // just to make sure
+	llassert( !mMessageDecoded );
 
 	// The offset tells us how may bytes to skip after the end of the
 	// message name.
 	U8 offset = buffer[PHL_OFFSET];
 	S32 decode_pos = LL_PACKET_ID_SIZE + (S32)(mCurrentRMessageTemplate->mFrequency) + offset;
 
-	// create base working data set
-	mCurrentRMessageData = new LLMsgData(mCurrentRMessageTemplate->mName);
-	
-	// loop through the template building the data structure as we go
-	LLMessageTemplate::message_block_map_t::const_iterator iter;
-	for(iter = mCurrentRMessageTemplate->mMemberBlocks.begin();
-		iter != mCurrentRMessageTemplate->mMemberBlocks.end();
-		++iter)
+	// keep our own copy, accessors read straight from it
+	mPacket.assign(buffer, buffer + mReceiveSize);
+
+	const S32 num_blocks = (S32)mCurrentRMessageTemplate->mMemberBlocks.size();
+	mBlockSlots.resize(num_blocks);
+	mVarSlots.clear();
+	S32 total_blocks = 0;
+
+	// loop through the template recording where the data is as we go
+	for (S32 block_index = 0; block_index < num_blocks; ++block_index)
 	{
-		LLMessageBlock* mbci = *iter;
+		const LLMessageBlock* mbci = mCurrentRMessageTemplate->getBlockAt(block_index);
 		U8	repeat_number;
 		S32	i;
 
@@ -598,36 +614,21 @@ BOOL LLTemplateMessageReader::decodeData(const U8* buffer, const LLHost& sender,
 			return FALSE;
 		}
 
-		LLMsgBlkData* cur_data_block = nullptr;
+		BlockSlot& block_slot = mBlockSlots[block_index];
+		block_slot.mCount = repeat_number;
+		block_slot.mFirstVar = (S32)mVarSlots.size();
+		total_blocks += repeat_number;
 
 		// now loop through the block
 		for (i = 0; i < repeat_number; i++)
 		{
-			if (i)
-			{
-				// build new name to prevent collisions
-				// TODO: This should really change to a vector
-				cur_data_block = new LLMsgBlkData(mbci->mName, repeat_number);
-				cur_data_block->mName = mbci->mName + i;
-			}
-			else
-			{
-				cur_data_block = new LLMsgBlkData(mbci->mName, repeat_number);
-			}
-
-			// add the block to the message
-			mCurrentRMessageData->addBlock(cur_data_block);
-
 			// now read the variables
 			for (LLMessageBlock::message_variable_map_t::const_iterator iter = 
 					 mbci->mMemberVariables.begin();
 				 iter != mbci->mMemberVariables.end(); iter++)
 			{
 				const LLMessageVariable& mvci = **iter;
-
-				// ok, build out the variables
-				// add variable block
-				cur_data_block->addVariable(mvci.getName(), mvci.getType());
+				VarSlot var_slot;
 
 				// what type of variable?
 				if (mvci.getType() == MVT_VARIABLE)
@@ -668,38 +669,50 @@ BOOL LLTemplateMessageReader::decodeData(const U8* buffer, const LLHost& sender,
 					}
 					decode_pos += data_size;
 
-					cur_data_block->addData(mvci.getName(), &buffer[decode_pos], tsize, mvci.getType());
+					if (tsize > (U32)llmax(mReceiveSize - decode_pos, 0))
+					{
+						if (!custom)
+						logRanOffEndOfPacket(sender, decode_pos, tsize);
+
+						// the data is not all there, default to 0 length
+						var_slot.mOffset = -1;
+						var_slot.mSize = 0;
+					}
+					else
+					{
+						var_slot.mOffset = decode_pos;
+						var_slot.mSize = (S32)tsize;
+					}
 					decode_pos += tsize;
 				}
 				else
 				{
 					// fixed!
-					// so, copy data pointer and set data size to fixed size
+					// so, record the data position and set data size to fixed size
 					if ((decode_pos + mvci.getSize()) > mReceiveSize)
 					{
 						if (!custom)
 						logRanOffEndOfPacket(sender, decode_pos, mvci.getSize());
 
 						// default to 0s.
-						U32 size = mvci.getSize();
-						std::vector<U8> data(size, 0);
-						cur_data_block->addData(mvci.getName(), &(data[0]), 
-												size, mvci.getType());
+						var_slot.mOffset = -1;
 					}
 					else
 					{
-						cur_data_block->addData(mvci.getName(), 
-												&buffer[decode_pos], 
-												mvci.getSize(), 
-												mvci.getType());
+						var_slot.mOffset = decode_pos;
 					}
+					var_slot.mSize = mvci.getSize();
 					decode_pos += mvci.getSize();
 				}
+
+				mVarSlots.push_back(var_slot);
 			}
 		}
 	}
 
-	if (mCurrentRMessageData->mMemberBlocks.empty()
+	mMessageDecoded = true;
+
+	if (total_blocks == 0
 		&& !mCurrentRMessageTemplate->mMemberBlocks.empty())
 	{
 		LL_DEBUGS() << "Empty message '" << mCurrentRMessageTemplate->mName << "' (no blocks)" << LL_ENDL;
@@ -829,11 +842,44 @@ bool LLTemplateMessageReader::isUdpBanned() const
 //virtual 
 void LLTemplateMessageReader::copyToBuilder(LLMessageBuilder& builder) const
 {
-	if(nullptr == mCurrentRMessageTemplate)
+	if(nullptr == mCurrentRMessageTemplate || !mMessageDecoded)
     {
         return;
     }
-	builder.copyFromMessageData(*mCurrentRMessageData);
+
+	// Only used to forward or wrap a message, so rebuild the data tree the
+	// builders expect from the recorded slots.
+	LLMsgData message_data(mCurrentRMessageTemplate->mName);
+	const S32 num_blocks = (S32)mCurrentRMessageTemplate->mMemberBlocks.size();
+	for (S32 block_index = 0; block_index < num_blocks; ++block_index)
+	{
+		const LLMessageBlock* mbci = mCurrentRMessageTemplate->getBlockAt(block_index);
+		const BlockSlot& block_slot = mBlockSlots[block_index];
+		const VarSlot* var_slot = mVarSlots.data() + block_slot.mFirstVar;
+		for (S32 i = 0; i < block_slot.mCount; i++)
+		{
+			// blocks after the first are named name + i to prevent collisions
+			LLMsgBlkData* cur_data_block = new LLMsgBlkData(mbci->mName, block_slot.mCount);
+			cur_data_block->mName = mbci->mName + i;
+			message_data.addBlock(cur_data_block);
+
+			for (const LLMessageVariable* mvci : mbci->mMemberVariables)
+			{
+				cur_data_block->addVariable(mvci->getName(), mvci->getType());
+				if (var_slot->mOffset < 0)
+				{
+					std::vector<U8> data(var_slot->mSize, 0);
+					cur_data_block->addData(mvci->getName(), data.data(), var_slot->mSize, mvci->getType());
+				}
+				else
+				{
+					cur_data_block->addData(mvci->getName(), &mPacket[var_slot->mOffset], var_slot->mSize, mvci->getType());
+				}
+				++var_slot;
+			}
+		}
+	}
+	builder.copyFromMessageData(message_data);
 }
 
 LLMessageTemplate* LLTemplateMessageReader::getTemplate()
@@ -30,7 +30,6 @@
 #include "llmessagereader.h"
 
 class LLMessageTemplate;
-class LLMsgData;
 
 class LLTemplateMessageReader : public LLMessageReader
 {
@@ -117,9 +116,36 @@ class LLTemplateMessageReader : public LLMessageReader
 
 	void logRanOffEndOfPacket( const LLHost& host, const S32 where, const S32 wanted );
 
+	// Decoding only records where each block and variable lives in
+	// mPacket. Slots are indexed by the position of blocks and variables in
+	// the template, so nothing is allocated per message once the vectors
+	// have grown to fit the largest message seen.
+	struct BlockSlot
+	{
+		S32 mCount;		// number of repeats in this message
+		S32 mFirstVar;	// into mVarSlots, repeats follow each other
+	};
+
+	struct VarSlot
+	{
+		S32 mOffset;	// into mPacket, or -1 if it ran off the end and reads as zeros
+		S32 mSize;
+	};
+
+	// Index of the block in the current template, or -1 if the message does
+	// not hold at least blocknum + 1 of that block
+	S32 findBlock(const char* blockname, S32 blocknum) const;
+	// NULL if the block has no such variable
+	const VarSlot* findVar(S32 block_index, S32 blocknum, const char* varname) const;
+
 	S32	mReceiveSize;
 	LLMessageTemplate* mCurrentRMessageTemplate;
-	LLMsgData* mCurrentRMessageData;
+	bool mMessageDecoded;
+	// Copy of the packet being read. Callers are free to reuse their
+	// buffer once decodeData() returns.
+	std::vector<U8> mPacket;
+	std::vector<BlockSlot> mBlockSlots;
+	std::vector<VarSlot> mVarSlots;
 	message_template_number_map_t& mMessageNumbers;
 };
 
@@ -0,0 +1,285 @@
+/**
+ * @file llviewerpartarrays.cpp
+ * @brief Particle group simulation state and billboard geometry
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "llviewerpartarrays.h"
+
+#include "llmath.h"
+#include "v2math.h"
+#include "v3math.h"
+
+/////////////////////////////
+//
+// LLViewerPartArrays implementation
+//
+//
+
+namespace
+{
+	// lanes whose flags have any of the bits in mask set
+	inline LLQuad flag_mask(const U32* flags, U32 mask)
+	{
+		const __m128i bits = _mm_and_si128(_mm_load_si128((const __m128i*) flags), _mm_set1_epi32(mask));
+		return _mm_castsi128_ps(_mm_xor_si128(_mm_cmpeq_epi32(bits, _mm_setzero_si128()), _mm_set1_epi32(-1)));
+	}
+
+	inline LLQuad select_quad(const LLQuad& mask, const LLQuad& if_true, const LLQuad& if_false)
+	{
+		return _mm_or_ps(_mm_and_ps(mask, if_true), _mm_andnot_ps(mask, if_false));
+	}
+
+	// a * (1 - u) + b * u, how LLColor4 and LLVector2 interpolation works out
+	inline LLQuad interp_quad(const LLQuad& a, const LLQuad& b, const LLQuad& u, const LLQuad& inv_u)
+	{
+		return _mm_add_ps(_mm_mul_ps(a, inv_u), _mm_mul_ps(u, b));
+	}
+}
+
+void LLViewerPartArrays::replaceWithLast(U32 i)
+{
+	llassert(i < mSize);
+	const U32 last = --mSize;
+	if (i != last)
+	{
+		forEachColumn([i, last](auto& column) { column[i] = column[last]; });
+	}
+}
+
+void LLViewerPartArrays::clear()
+{
+	mSize = 0;
+}
+
+void LLViewerPartArrays::shift(const LLVector3& offset)
+{
+	for (U32 c = 0; c < 3; c++)
+	{
+		const F32 delta = offset.mV[c];
+		for (U32 i = 0; i < mSize; i++)
+		{
+			mPos[c][i] += delta;
+		}
+	}
+}
+
+void LLViewerPartArrays::beginUpdate(F32 dt)
+{
+	const LLQuad base_dt = _mm_set1_ps(dt);
+	for (U32 i = 0; i < mSize; i += 4)
+	{
+		_mm_store_ps(&mDt[i], _mm_sub_ps(base_dt, _mm_load_ps(&mSkipOffset[i])));
+		_mm_store_ps(&mSkipOffset[i], _mm_setzero_ps());
+
+		// "Drift" the particle based on the source object
+		const LLQuad follow = flag_mask(&mFlags[i], LLPartData::LL_PART_FOLLOW_SRC_MASK);
+		for (U32 c = 0; c < 3; c++)
+		{
+			const LLQuad pos = _mm_add_ps(_mm_load_ps(&mSourcePos[c][i]), _mm_load_ps(&mPosOffset[c][i]));
+			_mm_store_ps(&mPos[c][i], select_quad(follow, pos, _mm_load_ps(&mPos[c][i])));
+		}
+	}
+}
+
+void LLViewerPartArrays::integrate()
+{
+	const LLQuad zero = _mm_setzero_ps();
+	const LLQuad one = _mm_set1_ps(1.f);
+	const LLQuad half = _mm_set1_ps(0.5f);
+	const LLQuad tenth = _mm_set1_ps(0.1f);
+
+	for (U32 i = 0; i < mSize; i += 4)
+	{
+		const U32* flags = &mFlags[i];
+		const LLQuad dt = _mm_load_ps(&mDt[i]);
+		const LLQuad last_time = _mm_load_ps(&mLastUpdateTime[i]);
+		const LLQuad max_age = _mm_load_ps(&mMaxAge[i]);
+		const LLQuad cur_time = _mm_add_ps(last_time, dt);
+		const LLQuad frac = _mm_div_ps(cur_time, max_age);
+		const LLQuad inv_frac = _mm_sub_ps(one, frac);
+
+		LLQuad pos[3];
+		LLQuad vel[3];
+		LLQuad src[3];
+		for (U32 c = 0; c < 3; c++)
+		{
+			pos[c] = _mm_load_ps(&mPos[c][i]);
+			vel[c] = _mm_load_ps(&mVelocity[c][i]);
+			src[c] = _mm_load_ps(&mSourcePos[c][i]);
+		}
+
+		// Wind drag
+		const LLQuad wind = flag_mask(flags, LLPartData::LL_PART_WIND_MASK);
+		const LLQuad wind_dt = _mm_mul_ps(tenth, dt);
+		const LLQuad wind_keep = _mm_sub_ps(one, wind_dt);
+		for (U32 c = 0; c < 3; c++)
+		{
+			const LLQuad v = _mm_add_ps(_mm_mul_ps(vel[c], wind_keep), _mm_mul_ps(wind_dt, _mm_load_ps(&mWind[c][i])));
+			vel[c] = select_quad(wind, v, vel[c]);
+		}
+
+		// Interpolation towards a target
+		const LLQuad target = flag_mask(flags, LLPartData::LL_PART_TARGET_POS_MASK);
+		const LLQuad remaining = _mm_sub_ps(max_age, last_time);
+		LLQuad step = _mm_min_ps(_mm_max_ps(_mm_div_ps(dt, remaining), zero), tenth);
+		step = _mm_mul_ps(step, _mm_set1_ps(5.f));
+		const LLQuad keep = _mm_sub_ps(one, step);
+		for (U32 c = 0; c < 3; c++)
+		{
+			const LLQuad delta_pos = _mm_div_ps(_mm_sub_ps(_mm_load_ps(&mTargetPos[c][i]), pos[c]), remaining);
+			const LLQuad v = _mm_add_ps(_mm_mul_ps(vel[c], keep), _mm_mul_ps(step, delta_pos));
+			vel[c] = select_quad(target, v, vel[c]);
+		}
+
+		// Linear motion from source to target, or velocity integration
+		const LLQuad linear = flag_mask(flags, LLPartData::LL_PART_TARGET_LINEAR_MASK);
+		const LLQuad half_dt_sq = _mm_mul_ps(_mm_mul_ps(half, dt), dt);
+		for (U32 c = 0; c < 3; c++)
+		{
+			const LLQuad accel = _mm_load_ps(&mAccel[c][i]);
+			const LLQuad delta_pos = _mm_sub_ps(_mm_load_ps(&mTargetPos[c][i]), src[c]);
+			const LLQuad linear_pos = _mm_add_ps(src[c], _mm_mul_ps(frac, delta_pos));
+
+			LLQuad p = _mm_add_ps(pos[c], _mm_mul_ps(dt, vel[c]));
+			p = _mm_add_ps(p, _mm_mul_ps(half_dt_sq, accel));
+			const LLQuad v = _mm_add_ps(vel[c], _mm_mul_ps(accel, dt));
+
+			pos[c] = select_quad(linear, linear_pos, p);
+			vel[c] = select_quad(linear, delta_pos, v);
+		}
+
+		// Bounce off the source object's height
+		const LLQuad dz = _mm_sub_ps(pos[VZ], src[VZ]);
+		const LLQuad bounce = _mm_and_ps(flag_mask(flags, LLPartData::LL_PART_BOUNCE_MASK), _mm_cmplt_ps(dz, zero));
+		pos[VZ] = select_quad(bounce, _mm_sub_ps(pos[VZ], _mm_add_ps(dz, dz)), pos[VZ]);
+		vel[VZ] = select_quad(bounce, _mm_mul_ps(vel[VZ], _mm_set1_ps(-0.75f)), vel[VZ]);
+
+		// Reset the offset from the source position
+		const LLQuad follow = flag_mask(flags, LLPartData::LL_PART_FOLLOW_SRC_MASK);
+		for (U32 c = 0; c < 3; c++)
+		{
+			_mm_store_ps(&mPos[c][i], pos[c]);
+			_mm_store_ps(&mVelocity[c][i], vel[c]);
+			const LLQuad offset = _mm_sub_ps(pos[c], src[c]);
+			_mm_store_ps(&mPosOffset[c][i], select_quad(follow, offset, _mm_load_ps(&mPosOffset[c][i])));
+		}
+
+		// Color and scale interpolation
+		const LLQuad interp_color = flag_mask(flags, LLPartData::LL_PART_INTERP_COLOR_MASK);
+		for (U32 c = 0; c < 4; c++)
+		{
+			const LLQuad color = interp_quad(_mm_load_ps(&mStartColor[c][i]), _mm_load_ps(&mEndColor[c][i]), frac, inv_frac);
+			_mm_store_ps(&mColor[c][i], select_quad(interp_color, color, _mm_load_ps(&mColor[c][i])));
+		}
+
+		const LLQuad interp_scale = flag_mask(flags, LLPartData::LL_PART_INTERP_SCALE_MASK);
+		for (U32 c = 0; c < 2; c++)
+		{
+			const LLQuad scale = interp_quad(_mm_load_ps(&mStartScale[c][i]), _mm_load_ps(&mEndScale[c][i]), frac, inv_frac);
+			_mm_store_ps(&mScale[c][i], select_quad(interp_scale, scale, _mm_load_ps(&mScale[c][i])));
+		}
+
+		_mm_store_ps(&mLastUpdateTime[i], cur_time);
+	}
+}
+
+
+/////////////////////////////
+//
+// Billboards
+//
+//
+
+void ll_part_billboard(LLVector4a* vertices, const LLVector3& pos_agent, const LLVector3& velocity,
+					   const LLVector2& scale, U32 flags, const LLVector4a& camera_agent)
+{
+	LLVector4a part_pos_agent;
+	part_pos_agent.load3(pos_agent.mV);
+	LLVector4a at;
+	at.setSub(part_pos_agent, camera_agent);
+	LLVector4a up(0, 0, 1);
+	LLVector4a right;
+
+	right.setCross3(at, up);
+	right.normalize3fast();
+
+	up.setCross3(right, at);
+	up.normalize3fast();
+
+	if (flags & LLPartData::LL_PART_FOLLOW_VELOCITY_MASK && !velocity.isExactlyZero())
+	{
+		LLVector4a normvel;
+		normvel.load3(velocity.mV);
+		normvel.normalize3fast();
+		LLVector2 up_fracs;
+		up_fracs.mV[0] = normvel.dot3(right).getF32();
+		up_fracs.mV[1] = normvel.dot3(up).getF32();
+		up_fracs.normalize();
+		LLVector4a new_up;
+		LLVector4a new_right;
+
+		//new_up = up_fracs.mV[0] * right + up_fracs.mV[1]*up;
+		LLVector4a t = right;
+		t.mul(up_fracs.mV[0]);
+		new_up = up;
+		new_up.mul(up_fracs.mV[1]);
+		new_up.add(t);
+
+		//new_right = up_fracs.mV[1] * right - up_fracs.mV[0]*up;
+		t = right;
+		t.mul(up_fracs.mV[1]);
+		new_right = up;
+		new_right.mul(up_fracs.mV[0]);
+		t.sub(new_right);
+
+		up = new_up;
+		right = t;
+		up.normalize3fast();
+		right.normalize3fast();
+	}
+
+	right.mul(0.5f*scale.mV[0]);
+	up.mul(0.5f*scale.mV[1]);
+
+
+	//HACK -- the vertices[i].mV[3] = 0.f here are to set the texture index to 0 (particles don't use texture batching, maybe they should)
+	// this works because there is actually a 4th float stored after the vertex position which is used as a texture index
+
+	LLVector4a ppapu;
+	LLVector4a ppamu;
+
+	ppapu.setAdd(part_pos_agent, up);
+	ppamu.setSub(part_pos_agent, up);
+
+	vertices[0].setSub(ppapu, right);
+	vertices[1].setSub(ppamu, right);
+	vertices[2].setAdd(ppapu, right);
+	vertices[3].setAdd(ppamu, right);
+	for (U32 i = 0; i < 4; i++)
+	{
+		vertices[i].getF32ptr()[3] = 0.f;
+	}
+}
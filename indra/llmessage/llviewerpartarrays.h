@@ -0,0 +1,197 @@
+/**
+ * @file llviewerpartarrays.h
+ * @brief Particle group simulation state and billboard geometry
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLVIEWERPARTARRAYS_H
+#define LL_LLVIEWERPARTARRAYS_H
+
+#include "llpartdata.h"
+#include "llvector4a.h"
+
+#include "boost/align/aligned_allocator.hpp"
+
+#define LL_MAX_PARTICLE_COUNT 8192
+
+///////////////////
+//
+// Simulated state of the particles in a group, one array per component so
+// the per-frame integration runs four particles at a time. Slot i belongs to
+// LLViewerPartGroup::mParticles[i]. The slots are the live state during an
+// update, the particles are refreshed from them at the end of it.
+//
+// Particles are anything LLPartData based with LLViewerPart's mPosAgent,
+// mVelocity, mAccel, mColor, mScale, mLastUpdateTime and mSkipOffset.
+//
+
+class LLViewerPartArrays
+{
+public:
+	typedef std::vector<F32, boost::alignment::aligned_allocator<F32, 16> > column_t;
+	typedef std::vector<U32, boost::alignment::aligned_allocator<U32, 16> > flag_column_t;
+
+	U32 size() const							{ return mSize; }
+
+	// Slots are swapped out like vector_replace_with_last() does for the
+	// particle list. Arrays keep their capacity as particles come and go.
+	template<typename PART>
+	void push_back(const PART& part);
+	void replaceWithLast(U32 i);
+	void clear();
+
+	// copy particle state into and out of slot i
+	template<typename PART>
+	void load(U32 i, const PART& part);
+	template<typename PART>
+	void store(U32 i, PART& part) const;
+
+	void shift(const LLVector3& offset);
+
+	// start of the update: per particle dt and follow source positions
+	void beginUpdate(F32 dt);
+	// rest of the update, after callbacks and wind lookups
+	void integrate();
+
+	column_t		mPos[3];
+	column_t		mVelocity[3];
+	column_t		mAccel[3];
+	column_t		mPosOffset[3];
+	column_t		mColor[4];
+	column_t		mStartColor[4];
+	column_t		mEndColor[4];
+	column_t		mScale[2];
+	column_t		mStartScale[2];
+	column_t		mEndScale[2];
+	column_t		mLastUpdateTime;
+	column_t		mMaxAge;
+	column_t		mSkipOffset;
+	flag_column_t	mFlags;
+
+	// gathered every update
+	column_t		mDt;
+	column_t		mSourcePos[3];
+	column_t		mTargetPos[3];
+	column_t		mWind[3];
+
+private:
+	template<typename FUNC>
+	void forEachColumn(FUNC func);
+
+	U32				mSize = 0;
+};
+
+// Camera facing quad of a particle that isn't a ribbon, in the vertex order
+// LLVOPartGroup draws it, with w cleared for the texture index
+void ll_part_billboard(LLVector4a* vertices, const LLVector3& pos_agent, const LLVector3& velocity,
+					   const LLVector2& scale, U32 flags, const LLVector4a& camera_agent);
+
+template<typename FUNC>
+void LLViewerPartArrays::forEachColumn(FUNC func)
+{
+	for (U32 c = 0; c < 3; c++)
+	{
+		func(mPos[c]);
+		func(mVelocity[c]);
+		func(mAccel[c]);
+		func(mPosOffset[c]);
+		func(mSourcePos[c]);
+		func(mTargetPos[c]);
+		func(mWind[c]);
+	}
+	for (U32 c = 0; c < 4; c++)
+	{
+		func(mColor[c]);
+		func(mStartColor[c]);
+		func(mEndColor[c]);
+	}
+	for (U32 c = 0; c < 2; c++)
+	{
+		func(mScale[c]);
+		func(mStartScale[c]);
+		func(mEndScale[c]);
+	}
+	func(mLastUpdateTime);
+	func(mMaxAge);
+	func(mSkipOffset);
+	func(mDt);
+	func(mFlags);
+}
+
+template<typename PART>
+void LLViewerPartArrays::push_back(const PART& part)
+{
+	llassert(mSize < LL_MAX_PARTICLE_COUNT);
+
+	// round up to whole SIMD lanes, padding slots are simulated but never read
+	const U32 padded = (mSize + 4) & ~3;
+	if (mFlags.size() < padded)
+	{
+		forEachColumn([padded](auto& column) { column.resize(padded); });
+	}
+	load(mSize++, part);
+}
+
+template<typename PART>
+void LLViewerPartArrays::load(U32 i, const PART& part)
+{
+	for (U32 c = 0; c < 3; c++)
+	{
+		mPos[c][i] = part.mPosAgent.mV[c];
+		mVelocity[c][i] = part.mVelocity.mV[c];
+		mAccel[c][i] = part.mAccel.mV[c];
+		mPosOffset[c][i] = part.mPosOffset.mV[c];
+	}
+	for (U32 c = 0; c < 4; c++)
+	{
+		mColor[c][i] = part.mColor.mV[c];
+		mStartColor[c][i] = part.mStartColor.mV[c];
+		mEndColor[c][i] = part.mEndColor.mV[c];
+	}
+	for (U32 c = 0; c < 2; c++)
+	{
+		mScale[c][i] = part.mScale.mV[c];
+		mStartScale[c][i] = part.mStartScale.mV[c];
+		mEndScale[c][i] = part.mEndScale.mV[c];
+	}
+	mLastUpdateTime[i] = part.mLastUpdateTime;
+	mMaxAge[i] = part.mMaxAge;
+	mSkipOffset[i] = part.mSkipOffset;
+	mFlags[i] = part.mFlags;
+}
+
+template<typename PART>
+void LLViewerPartArrays::store(U32 i, PART& part) const
+{
+	part.mPosAgent.set(mPos[VX][i], mPos[VY][i], mPos[VZ][i]);
+	part.mVelocity.set(mVelocity[VX][i], mVelocity[VY][i], mVelocity[VZ][i]);
+	part.mAccel.set(mAccel[VX][i], mAccel[VY][i], mAccel[VZ][i]);
+	part.mPosOffset.set(mPosOffset[VX][i], mPosOffset[VY][i], mPosOffset[VZ][i]);
+	part.mColor.set(mColor[0][i], mColor[1][i], mColor[2][i], mColor[3][i]);
+	part.mScale.set(mScale[0][i], mScale[1][i]);
+	part.mLastUpdateTime = mLastUpdateTime[i];
+	part.mSkipOffset = mSkipOffset[i];
+	part.mFlags = mFlags[i];
+}
+
+#endif // LL_LLVIEWERPARTARRAYS_H
@@ -326,6 +326,9 @@ LLMessageSystem::~LLMessageSystem()
 	std::for_each(mMessageNumbers.begin(), mMessageNumbers.end(), DeletePairedPointer());
 	mMessageNumbers.clear();
 	
+	// Before the socket goes away
+	mPacketRing.stopReceiveThread();
+
 	if (!mbError)
 	{
 		end_net(mSocket);
@@ -580,7 +583,20 @@ BOOL LLMessageSystem::checkMessages(LockMessageChecker&, S64 frame_count,
 			}
 
 			// process the message as normal
-			mIncomingCompressedSize = zeroCodeExpand(&buffer, &receive_size);
+			S32 compressed_size = faked_message ? 0 : mPacketRing.getLastCompressedSize();
+			if (compressed_size)
+			{
+				// Already expanded by the receive thread
+				mTotalBytesIn += compressed_size;
+				mCompressedPacketsIn++;
+				mCompressedBytesIn += compressed_size;
+				mUncompressedBytesIn += receive_size;
+				mIncomingCompressedSize = compressed_size;
+			}
+			else
+			{
+				mIncomingCompressedSize = zeroCodeExpand(&buffer, &receive_size);
+			}
 			U32 cur_rec_pkt_id = 0U;
 			memcpy(&cur_rec_pkt_id, buffer + PHL_PACKET_ID, sizeof(cur_rec_pkt_id));
 			mCurrentRecvPacketID = ntohl(cur_rec_pkt_id);
@@ -795,12 +811,17 @@ void LLMessageSystem::processAcks(LockMessageChecker&, F32 collect_time)
 		// Check the status of circuits
 		mCircuitInfo.updateWatchDogTimers(this);
 
+		// resends and acks go out in bursts, batch their system calls
+		mPacketRing.beginSendBatch();
+
 		//resend any necessary packets
 		mCircuitInfo.resendUnackedPackets(mUnackedListDepth, mUnackedListSize);
 
 		//cycle through ack list for each host we need to send acks to
 		mCircuitInfo.sendAcks(collect_time);
 
+		mPacketRing.endSendBatch();
+
 		if (!mDenyTrustedCircuitSet.empty())
 		{
 			LL_INFOS("Messaging") << "Sending queued DenyTrustedCircuit messages." << LL_ENDL;
@@ -2897,10 +2918,33 @@ S32 LLMessageSystem::zeroCodeExpand(U8** data, S32* data_size)
 	
 	*data[0] &= (~LL_ZERO_CODE_FLAG);
 
-	S32 count = (*data_size);  
-	
-	U8 *inptr = (U8 *)*data;
-	U8 *outptr = (U8 *)mEncodedRecvBuffer;
+	S32 out_size = zeroCodeExpand(*data, *data_size, mEncodedRecvBuffer, MAX_BUFFER_SIZE);
+	if (out_size < 0)
+	{
+		LL_WARNS("Messaging") << "attempt to write past reasonable encoded buffer size" << LL_ENDL;
+		callExceptionFunc(MX_WROTE_PAST_BUFFER_SIZE);
+		out_size = 0;
+	}
+
+	*data = mEncodedRecvBuffer;
+	*data_size = out_size;
+	mUncompressedBytesIn += *data_size;
+
+	return(in_size);
+}
+
+
+// static
+S32 LLMessageSystem::zeroCodeExpand(const U8* in, S32 in_size, U8* out, S32 out_capacity)
+{
+	if (in_size < (S32)LL_PACKET_ID_SIZE)
+	{
+		return -1;
+	}
+
+	S32 count = in_size;
+	const U8* inptr = in;
+	U8* outptr = out;
 
 // skip the packet id field
 
@@ -2917,55 +2961,39 @@ S32 LLMessageSystem::zeroCodeExpand(U8** data, S32* data_size)
 
 	while (count--)
 	{
-		if (outptr > (&mEncodedRecvBuffer[MAX_BUFFER_SIZE-1]))
+		if (outptr > out + out_capacity - 1)
 		{
-			LL_WARNS("Messaging") << "attempt to write past reasonable encoded buffer size 1" << LL_ENDL;
-			callExceptionFunc(MX_WROTE_PAST_BUFFER_SIZE);
-			outptr = mEncodedRecvBuffer;					
-			break;
+			return -1;
 		}
 		if (!((*outptr++ = *inptr++)))
 		{
 			while (((count--)) && (!(*inptr)))
 			{
 				*outptr++ = *inptr++;
-  				if (outptr > (&mEncodedRecvBuffer[MAX_BUFFER_SIZE-256]))
-  				{
-  					LL_WARNS("Messaging") << "attempt to write past reasonable encoded buffer size 2" << LL_ENDL;
-					callExceptionFunc(MX_WROTE_PAST_BUFFER_SIZE);
-					outptr = mEncodedRecvBuffer;
-					count = -1;
-					break;
-  				}
+				if (outptr > out + out_capacity - 256)
+				{
+					return -1;
+				}
 				memset(outptr,0,255);
 				outptr += 255;
 			}
-			
+
 			if (count < 0)
 			{
 				break;
 			}
 
-			else
+			if (outptr > out + out_capacity - (*inptr))
 			{
-  				if (outptr > (&mEncodedRecvBuffer[MAX_BUFFER_SIZE-(*inptr)]))
-				{
-  					LL_WARNS("Messaging") << "attempt to write past reasonable encoded buffer size 3" << LL_ENDL;
-					callExceptionFunc(MX_WROTE_PAST_BUFFER_SIZE);
-					outptr = mEncodedRecvBuffer;					
-				}
-				memset(outptr,0,(*inptr) - 1);
-				outptr += ((*inptr) - 1);
-				inptr++;
+				return -1;
 			}
-		}		
+			memset(outptr,0,(*inptr) - 1);
+			outptr += ((*inptr) - 1);
+			inptr++;
+		}
 	}
-	
-	*data = mEncodedRecvBuffer;
-	*data_size = (S32)(outptr - mEncodedRecvBuffer);
-	mUncompressedBytesIn += *data_size;
 
-	return(in_size);
+	return (S32)(outptr - out);
 }
 
 
@@ -375,6 +375,9 @@ class LLMessageSystem : public LLMessageSenderInterface
 	BOOL isOK() const { return !mbError; }
 	S32 getErrorCode() const { return mErrorCode; }
 
+	// Read incoming packets on a worker thread
+	void startReceiveThread() { mPacketRing.startReceiveThread(mSocket); }
+
 	// Read file and build message templates filename must point to a
 	// valid string which specifies the path of a valid linden
 	// template.
@@ -546,6 +549,9 @@ class LLMessageSystem : public LLMessageSenderInterface
 
 	S32     zeroCode(U8 **data, S32 *data_size);
 	S32		zeroCodeExpand(U8 **data, S32 *data_size);
+	// Expands the zero coded packet in into out. Returns the expanded size
+	// or -1 if it would not fit in out_capacity bytes.
+	static S32 zeroCodeExpand(const U8* in, S32 in_size, U8* out, S32 out_capacity);
 	S32		zeroCodeAdjustCurrentSendTotal();
 
 	// Uses ping-based retry
@@ -26,7 +26,7 @@
 
 #include "linden_common.h"
 
-//#include "net.h"
+#include "net.h"
 
 // system library includes
 #include <stdexcept>
@@ -40,6 +40,7 @@
 	#include <arpa/inet.h>
 	#include <fcntl.h>
 	#include <errno.h>
+	#include <poll.h>
 #endif
 
 // linden library includes
@@ -374,6 +375,32 @@ BOOL send_packet(int hSocket, const char *sendBuffer, int size, U32 recipient, i
 	return (nRet != SOCKET_ERROR);
 }
 
+S32 receive_packets(int hSocket, LLNetDatagram* datagrams, S32 count)
+{
+	// No batched receive, use receive_packet()
+	return -1;
+}
+
+S32 send_packets(int hSocket, const LLNetDatagram* datagrams, S32 count)
+{
+	// No batched send, use send_packet()
+	return -1;
+}
+
+BOOL wait_for_packet(int hSocket, S32 timeout_ms)
+{
+	fd_set read_fds;
+	FD_ZERO(&read_fds);
+	FD_SET((SOCKET)hSocket, &read_fds);
+
+	struct timeval timeout;
+	timeout.tv_sec = timeout_ms / 1000;
+	timeout.tv_usec = (timeout_ms % 1000) * 1000;
+
+	// First argument is ignored by winsock
+	return select(0, &read_fds, NULL, NULL, &timeout) > 0;
+}
+
 //////////////////////////////////////////////////////////////////////////////////////////
 // Linux Versions
 //////////////////////////////////////////////////////////////////////////////////////////
@@ -523,12 +550,30 @@ void end_net(S32& socket_out)
 }
 
 #if LL_LINUX
+static void get_pktinfo_destip(struct msghdr& msg, U32 *dstip)
+{
+	struct cmsghdr *cmsgptr;
+	for (cmsgptr = CMSG_FIRSTHDR(&msg); cmsgptr != NULL; cmsgptr = CMSG_NXTHDR( &msg, cmsgptr))
+	{
+		if( cmsgptr->cmsg_level == SOL_IP && cmsgptr->cmsg_type == IP_PKTINFO )
+		{
+			in_pktinfo *pktinfo = (in_pktinfo *)CMSG_DATA(cmsgptr);
+			if( pktinfo )
+			{
+				// Two choices. routed and specified. ipi_addr is routed, ipi_spec_dst is
+				// routed. We should stay with specified until we go to multiple
+				// interfaces
+				*dstip = pktinfo->ipi_spec_dst.s_addr;
+			}
+		}
+	}
+}
+
 static int recvfrom_destip( int socket, void *buf, int len, struct sockaddr *from, socklen_t *fromlen, U32 *dstip )
 {
 	int size;
 	struct iovec iov[1];
 	char cmsg[CMSG_SPACE(sizeof(struct in_pktinfo))];
-	struct cmsghdr *cmsgptr;
 	struct msghdr msg = {};
 
 	iov[0].iov_base = buf;
@@ -549,20 +594,7 @@ static int recvfrom_destip( int socket, void *buf, int len, struct sockaddr *fro
 		return -1;
 	}
 
-	for (cmsgptr = CMSG_FIRSTHDR(&msg); cmsgptr != NULL; cmsgptr = CMSG_NXTHDR( &msg, cmsgptr))
-	{
-		if( cmsgptr->cmsg_level == SOL_IP && cmsgptr->cmsg_type == IP_PKTINFO )
-		{
-			in_pktinfo *pktinfo = (in_pktinfo *)CMSG_DATA(cmsgptr);
-			if( pktinfo )
-			{
-				// Two choices. routed and specified. ipi_addr is routed, ipi_spec_dst is
-				// routed. We should stay with specified until we go to multiple
-				// interfaces
-				*dstip = pktinfo->ipi_spec_dst.s_addr;
-			}
-		}
-	}
+	get_pktinfo_destip(msg, dstip);
 
 	return size;
 }
@@ -658,6 +690,123 @@ BOOL send_packet(int hSocket, const char * sendBuffer, int size, U32 recipient,
 	return success;
 }
 
+#if LL_LINUX
+S32 receive_packets(int hSocket, LLNetDatagram* datagrams, S32 count)
+{
+	struct mmsghdr msgs[NET_MAX_DATAGRAM_BATCH];
+	struct iovec iovs[NET_MAX_DATAGRAM_BATCH];
+	struct sockaddr_in from[NET_MAX_DATAGRAM_BATCH];
+	char cmsgs[NET_MAX_DATAGRAM_BATCH][CMSG_SPACE(sizeof(struct in_pktinfo))];
+
+	count = llmin(count, NET_MAX_DATAGRAM_BATCH);
+	memset(msgs, 0, sizeof(msgs[0]) * count);
+	for (S32 i = 0; i < count; ++i)
+	{
+		iovs[i].iov_base = datagrams[i].mData;
+		iovs[i].iov_len = NET_BUFFER_SIZE;
+
+		struct msghdr& msg = msgs[i].msg_hdr;
+		msg.msg_name = &from[i];
+		msg.msg_namelen = sizeof(from[i]);
+		msg.msg_iov = &iovs[i];
+		msg.msg_iovlen = 1;
+		msg.msg_control = cmsgs[i];
+		msg.msg_controllen = sizeof(cmsgs[i]);
+	}
+
+	int received = recvmmsg(hSocket, msgs, count, MSG_DONTWAIT, NULL);
+	if (received < 0)
+	{
+		// Like receive_packet(), errors just mean no data this time.
+		return (errno == ENOSYS) ? -1 : 0;
+	}
+
+	for (S32 i = 0; i < received; ++i)
+	{
+		LLNetDatagram& datagram = datagrams[i];
+		datagram.mSize = (S32)msgs[i].msg_len;
+		datagram.mAddress = from[i].sin_addr.s_addr;
+		datagram.mPort = ntohs(from[i].sin_port);
+		datagram.mReceivingIF = INVALID_HOST_IP_ADDRESS;
+		get_pktinfo_destip(msgs[i].msg_hdr, &datagram.mReceivingIF);
+	}
+
+	return received;
+}
+
+S32 send_packets(int hSocket, const LLNetDatagram* datagrams, S32 count)
+{
+	struct mmsghdr msgs[NET_MAX_DATAGRAM_BATCH];
+	struct iovec iovs[NET_MAX_DATAGRAM_BATCH];
+	struct sockaddr_in to[NET_MAX_DATAGRAM_BATCH];
+
+	count = llmin(count, NET_MAX_DATAGRAM_BATCH);
+	memset(msgs, 0, sizeof(msgs[0]) * count);
+	memset(to, 0, sizeof(to[0]) * count);
+	for (S32 i = 0; i < count; ++i)
+	{
+		iovs[i].iov_base = datagrams[i].mData;
+		iovs[i].iov_len = datagrams[i].mSize;
+
+		to[i].sin_family = AF_INET;
+		to[i].sin_addr.s_addr = datagrams[i].mAddress;
+		to[i].sin_port = htons(datagrams[i].mPort);
+
+		struct msghdr& msg = msgs[i].msg_hdr;
+		msg.msg_name = &to[i];
+		msg.msg_namelen = sizeof(to[i]);
+		msg.msg_iov = &iovs[i];
+		msg.msg_iovlen = 1;
+	}
+
+	S32 sent = 0;
+	while (sent < count)
+	{
+		int ret = sendmmsg(hSocket, msgs + sent, count - sent, 0);
+		if (ret > 0)
+		{
+			sent += ret;
+		}
+		else if (sent == 0 && errno == ENOSYS)
+		{
+			return -1;
+		}
+		else
+		{
+			// sendmmsg() stops at the first datagram that fails, let
+			// send_packet() retry or report it and carry on with the rest.
+			const LLNetDatagram& datagram = datagrams[sent];
+			send_packet(hSocket, datagram.mData, datagram.mSize, datagram.mAddress, datagram.mPort);
+			++sent;
+		}
+	}
+
+	return sent;
+}
+#else
+S32 receive_packets(int hSocket, LLNetDatagram* datagrams, S32 count)
+{
+	// No batched receive, use receive_packet()
+	return -1;
+}
+
+S32 send_packets(int hSocket, const LLNetDatagram* datagrams, S32 count)
+{
+	// No batched send, use send_packet()
+	return -1;
+}
+#endif
+
+BOOL wait_for_packet(int hSocket, S32 timeout_ms)
+{
+	struct pollfd pfd;
+	pfd.fd = hSocket;
+	pfd.events = POLLIN;
+	pfd.revents = 0;
+
+	return poll(&pfd, 1, timeout_ms) > 0 && (pfd.revents & POLLIN);
+}
+
 #endif
 
 //EOF
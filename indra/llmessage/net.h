@@ -45,6 +45,31 @@ S32		receive_packet(int hSocket, char * receiveBuffer);
 
 BOOL	send_packet(int hSocket, const char *sendBuffer, int size, U32 recipient, int nPort);	// Returns TRUE on success.
 
+// One datagram of a batched receive or send
+struct LLNetDatagram
+{
+	char*	mData;			// NET_BUFFER_SIZE bytes on receive
+	S32		mSize;
+	U32		mAddress;		// sender on receive, recipient on send
+	U32		mPort;
+	U32		mReceivingIF;	// receive only
+};
+
+// Batched versions of the above, one system call for up to
+// NET_MAX_DATAGRAM_BATCH datagrams. Only implemented on Linux, both return
+// -1 where the platform or kernel can't batch and the single packet
+// functions must be used instead.
+const S32 NET_MAX_DATAGRAM_BATCH = 64;
+
+// Returns the number of datagrams received, 0 if none were waiting.
+S32		receive_packets(int hSocket, LLNetDatagram* datagrams, S32 count);
+// Returns the number of datagrams handed to the kernel.
+S32		send_packets(int hSocket, const LLNetDatagram* datagrams, S32 count);
+
+// Blocks until a datagram is waiting or timeout_ms have passed. Returns TRUE
+// if one is waiting.
+BOOL	wait_for_packet(int hSocket, S32 timeout_ms);
+
 //void	get_sender(char * tmp);
 LLHost	get_sender();
 U32		get_sender_port();
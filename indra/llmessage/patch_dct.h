@@ -86,6 +86,11 @@ void get_patch_group_header(LLGroupHeader *gopp);
 void set_group_of_patch_header(LLGroupHeader *gopp);
 void init_patch_decompressor(S32 size);
 void decompress_patch(F32 *patch, S32 *cpatch, LLPatchHeader *ph);
+// cpatches holds count patches of patch_size*patch_size coefficients back to
+// back; the patches are decoded concurrently on the general job pool
+void decompress_patches(F32 **patches, S32 *cpatches, LLPatchHeader *headers, S32 count);
+// reference implementation decompress_patch() is checked against
+void decompress_patch_scalar(F32 *patch, S32 *cpatch, LLPatchHeader *ph);
 void decompress_patchv(LLVector3 *v, S32 *cpatch, LLPatchHeader *ph);
 
 #endif
@@ -27,8 +27,11 @@
 #include "linden_common.h"
 
 #include "llmath.h"
+#include "llmemory.h"
 //#include "vmath.h"
 #include "v3math.h"
+#include "llsimdtypes.h"
+#include "parallelfor.h"
 #include "patch_dct.h"
 
 LLGroupHeader	*gGOPP;
@@ -55,6 +58,10 @@ S32	gCurrentDeSize = 0;
 
 F32	gPatchICosines[LARGE_PATCH_SIZE*LARGE_PATCH_SIZE];
 
+// gPatchICosines with the first row replaced by OO_SQRT2, the weight every
+// idct routine gives the first coefficient
+LL_ALIGN_16(F32 gPatchICosinesW[LARGE_PATCH_SIZE*LARGE_PATCH_SIZE]);
+
 void setup_patch_icosines(S32 size)
 {
 	S32 n, u;
@@ -65,6 +72,7 @@ void setup_patch_icosines(S32 size)
 		for (n = 0; n < size; n++)
 		{
 			gPatchICosines[u*size+n] = cosf((2.f*n+1.f)*u*oosob);
+			gPatchICosinesW[u*size+n] = u ? gPatchICosines[u*size+n] : OO_SQRT2;
 		}
 	}
 }
@@ -588,7 +596,7 @@ inline void idct_patch_large(F32 *block)
 
 S32	gDitherNoise = 128;
 
-void decompress_patch(F32 *patch, S32 *cpatch, LLPatchHeader *ph)
+void decompress_patch_scalar(F32 *patch, S32 *cpatch, LLPatchHeader *ph)
 {
 	S32		i, j;
 
@@ -682,3 +690,99 @@ void decompress_patchv(LLVector3 *v, S32 *cpatch, LLPatchHeader *ph)
 	}
 }
 
+
+// Dequantize, idct and scale one 16x16 or 32x32 patch four values at a
+// time.  Both passes are the products idct_column and idct_line compute,
+// summed in the same order, so the result matches decompress_patch_scalar().
+template <S32 SIZE>
+static void idct_patch_simd(F32 *patch, const S32 *cpatch, const LLPatchHeader *ph, S32 stride)
+{
+	LL_ALIGN_16(F32 block[SIZE*SIZE]);
+	LL_ALIGN_16(F32 temp[SIZE*SIZE]);
+
+	S32		prequant = (ph->quant_wbits >> 4) + 2;
+	S32		quantize = 1<<prequant;
+	F32		ooq = 1.f/(F32)quantize;
+	F32		mult = ooq*ph->range;
+	F32		addval = mult*(F32)(1<<(prequant - 1))+ph->dc_offset;
+
+	// undo the zig zag order and dequantize
+	LL_ALIGN_16(S32 coefs[SIZE*SIZE]);
+	for (S32 i = 0; i < SIZE*SIZE; i++)
+	{
+		coefs[i] = cpatch[gDeCopyMatrix[i]];
+	}
+	for (S32 i = 0; i < SIZE*SIZE; i += 4)
+	{
+		const LLQuad c = _mm_cvtepi32_ps(_mm_load_si128((const __m128i*)(coefs + i)));
+		_mm_store_ps(block + i, _mm_mul_ps(c, _mm_loadu_ps(gPatchDequantizeTable + i)));
+	}
+
+	// columns: temp[n][c] = sum over u of block[u][c]*w[u][n]
+	for (S32 n = 0; n < SIZE; n++)
+	{
+		for (S32 c = 0; c < SIZE; c += 4)
+		{
+			LLQuad total = _mm_mul_ps(_mm_set1_ps(gPatchICosinesW[n]), _mm_load_ps(block + c));
+			for (S32 u = 1; u < SIZE; u++)
+			{
+				total = _mm_add_ps(total, _mm_mul_ps(_mm_load_ps(block + u*SIZE + c), _mm_set1_ps(gPatchICosinesW[u*SIZE + n])));
+			}
+			_mm_store_ps(temp + n*SIZE + c, total);
+		}
+	}
+
+	// lines: patch[l][n] = (sum over u of temp[l][u]*w[u][n])*2/size, then
+	// scaled back to heights
+	const LLQuad oosob = _mm_set1_ps(2.f/SIZE);
+	const LLQuad multq = _mm_set1_ps(mult);
+	const LLQuad addq = _mm_set1_ps(addval);
+	for (S32 l = 0; l < SIZE; l++)
+	{
+		const F32 *line = temp + l*SIZE;
+		F32 *out = patch + l*stride;
+		for (S32 n = 0; n < SIZE; n += 4)
+		{
+			LLQuad total = _mm_mul_ps(_mm_set1_ps(line[0]), _mm_load_ps(gPatchICosinesW + n));
+			for (S32 u = 1; u < SIZE; u++)
+			{
+				total = _mm_add_ps(total, _mm_mul_ps(_mm_set1_ps(line[u]), _mm_load_ps(gPatchICosinesW + u*SIZE + n)));
+			}
+			total = _mm_mul_ps(total, oosob);
+			_mm_storeu_ps(out + n, _mm_add_ps(_mm_mul_ps(total, multq), addq));
+		}
+	}
+}
+
+void decompress_patch(F32 *patch, S32 *cpatch, LLPatchHeader *ph)
+{
+	S32		size = gGOPP->patch_size;
+	S32		stride = gGOPP->stride;
+
+	if (size == NORMAL_PATCH_SIZE)
+	{
+		idct_patch_simd<NORMAL_PATCH_SIZE>(patch, cpatch, ph, stride);
+	}
+	else if (size == LARGE_PATCH_SIZE)
+	{
+		idct_patch_simd<LARGE_PATCH_SIZE>(patch, cpatch, ph, stride);
+	}
+	else
+	{
+		decompress_patch_scalar(patch, cpatch, ph);
+	}
+}
+
+void decompress_patches(F32 **patches, S32 *cpatches, LLPatchHeader *headers, S32 count)
+{
+	const S32 size = gGOPP->patch_size;
+	const size_t grain = size == LARGE_PATCH_SIZE ? 2 : 8;
+
+	LL::parallel_for(count, grain, [patches, cpatches, headers, size](size_t begin, size_t end)
+		{
+			for (size_t i = begin; i < end; ++i)
+			{
+				decompress_patch(patches[i], cpatches + i*size*size, headers + i);
+			}
+		});
+}
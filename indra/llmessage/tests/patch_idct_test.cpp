@@ -0,0 +1,172 @@
+/**
+ * @file patch_idct_test.cpp
+ * @brief Terrain patch decompressor test cases.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ * 
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ * 
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ * 
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include <random>
+#include <vector>
+
+#include "../patch_dct.h"
+
+#include "../test/lltut.h"
+
+namespace tut
+{
+	struct patch_idct_test
+	{
+		LLGroupHeader mGroup;
+		std::mt19937 mRandom;
+
+		patch_idct_test() : mRandom(1234)
+		{
+		}
+
+		// Sets up the decompressor for size x size patches laid out
+		// side by side in a region stride heights wide.
+		void setup(S32 size, S32 stride)
+		{
+			mGroup.stride = stride;
+			mGroup.patch_size = size;
+			mGroup.layer_type = 0;
+			init_patch_decompressor(size);
+			set_group_of_patch_header(&mGroup);
+		}
+
+		void randomPatch(S32 size, S32* coefs, LLPatchHeader& header, U8 quant_wbits)
+		{
+			S32 wbits = (quant_wbits & 0xf) + 2;
+			std::uniform_int_distribution<S32> coef(-(1 << (wbits - 1)), (1 << (wbits - 1)));
+			std::uniform_int_distribution<S32> coef_count(1, size*size);
+			S32 count = coef_count(mRandom);
+			for (S32 i = 0; i < size*size; i++)
+			{
+				// the encoder sends the low frequencies first and ends the
+				// patch early, so trailing coefficients are zero
+				coefs[i] = i < count ? coef(mRandom) : 0;
+			}
+			std::uniform_real_distribution<F32> offset(-50.f, 200.f);
+			header.dc_offset = offset(mRandom);
+			header.range = (U16)std::uniform_int_distribution<S32>(1, 255)(mRandom);
+			header.quant_wbits = quant_wbits;
+			header.patchids = 0;
+		}
+
+		void ensureMatches(const char* msg, const F32* expected, const F32* actual, S32 count)
+		{
+			for (S32 i = 0; i < count; i++)
+			{
+				F32 tolerance = 1.e-4f*llmax(1.f, fabsf(expected[i]));
+				if (fabsf(expected[i] - actual[i]) > tolerance)
+				{
+					ensure_equals(msg, actual[i], expected[i]);
+				}
+			}
+		}
+	};
+
+	typedef test_group<patch_idct_test> patch_idct_test_t;
+	typedef patch_idct_test_t::object patch_idct_test_object_t;
+	tut::patch_idct_test_t tut_patch_idct_test("patch_idct");
+
+	// a patch with only a DC coefficient decodes to a flat patch
+	template<> template<>
+	void patch_idct_test_object_t::test<1>()
+	{
+		const S32 size = NORMAL_PATCH_SIZE;
+		setup(size, size);
+
+		std::vector<S32> coefs(size*size, 0);
+		coefs[0] = 40;
+		LLPatchHeader header;
+		header.dc_offset = 20.f;
+		header.range = 16;
+		header.quant_wbits = 0x88;
+		header.patchids = 0;
+
+		std::vector<F32> heights(size*size);
+		decompress_patch(heights.data(), coefs.data(), &header);
+		for (S32 i = 1; i < size*size; i++)
+		{
+			ensure_approximately_equals("flat patch", heights[i], heights[0], 16);
+		}
+	}
+
+	// the vectorized decoder matches the scalar one for both patch sizes,
+	// writing only the patch inside a wider region
+	template<> template<>
+	void patch_idct_test_object_t::test<2>()
+	{
+		const S32 sizes[] = { NORMAL_PATCH_SIZE, LARGE_PATCH_SIZE };
+		const U8 quant_wbits[] = { 0x00, 0x46, 0x88, 0x8d };
+		for (S32 size : sizes)
+		{
+			const S32 stride = 2*size + 1;
+			setup(size, stride);
+			for (U8 qw : quant_wbits)
+			{
+				std::vector<S32> coefs(size*size);
+				LLPatchHeader header;
+				randomPatch(size, coefs.data(), header, qw);
+
+				std::vector<F32> expected(stride*size, -1.f);
+				std::vector<F32> actual(stride*size, -1.f);
+				decompress_patch_scalar(expected.data() + 1, coefs.data(), &header);
+				decompress_patch(actual.data() + 1, coefs.data(), &header);
+				ensureMatches("decompress_patch", expected.data(), actual.data(), stride*size);
+			}
+		}
+	}
+
+	// a batch decodes each patch the way the scalar decoder does
+	template<> template<>
+	void patch_idct_test_object_t::test<3>()
+	{
+		const S32 sizes[] = { NORMAL_PATCH_SIZE, LARGE_PATCH_SIZE };
+		const S32 patches_per_edge = 4;
+		for (S32 size : sizes)
+		{
+			const S32 stride = patches_per_edge*size + 1;
+			const S32 count = patches_per_edge*patches_per_edge;
+			setup(size, stride);
+
+			std::vector<S32> coefs(count*size*size);
+			std::vector<LLPatchHeader> headers(count);
+			std::vector<F32*> outputs(count);
+			std::vector<F32> expected(stride*stride, 0.f);
+			std::vector<F32> actual(stride*stride, 0.f);
+			for (S32 i = 0; i < count; i++)
+			{
+				randomPatch(size, &coefs[i*size*size], headers[i], (U8)(0x44 + (i & 3)*0x11));
+				S32 origin = (i / patches_per_edge)*size*stride + (i % patches_per_edge)*size;
+				decompress_patch_scalar(expected.data() + origin, &coefs[i*size*size], &headers[i]);
+				outputs[i] = actual.data() + origin;
+			}
+
+			decompress_patches(outputs.data(), coefs.data(), headers.data(), count);
+			ensureMatches("decompress_patches", expected.data(), actual.data(), stride*stride);
+		}
+	}
+}
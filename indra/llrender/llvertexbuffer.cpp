@@ -1119,9 +1119,9 @@ U8* LLVertexBuffer::mapVertexBuffer(LLVertexBuffer::AttributeType type, U32 inde
     U32 start = mOffsets[type] + sTypeSize[type] * index;
     U32 end = start + sTypeSize[type] * count-1;
 
-	bool flagged = false;
+	bool flagged = mMappedAll;
 	// flag region as mapped
-	for (U32 i = 0; i < mMappedVertexRegions.size(); ++i)
+	for (U32 i = 0; !flagged && i < mMappedVertexRegions.size(); ++i)
 	{
 		MappedRegion& region = mMappedVertexRegions[i];
         if (expand_region(region, start, end))
@@ -1153,9 +1153,9 @@ U8* LLVertexBuffer::mapIndexBuffer(U32 index, S32 count)
     U32 start = sizeof(U16) * index;
     U32 end = start + sizeof(U16) * count-1;
 
-    bool flagged = false;
+    bool flagged = mMappedAll;
     // flag region as mapped
-    for (U32 i = 0; i < mMappedIndexRegions.size(); ++i)
+    for (U32 i = 0; !flagged && i < mMappedIndexRegions.size(); ++i)
     {
         MappedRegion& region = mMappedIndexRegions[i];
         if (expand_region(region, start, end))
@@ -1174,6 +1174,23 @@ U8* LLVertexBuffer::mapIndexBuffer(U32 index, S32 count)
     return mMappedIndexData + sizeof(U16)*index;
 }
 
+void LLVertexBuffer::mapAll()
+{
+    mMappedVertexRegions.clear();
+    mMappedIndexRegions.clear();
+
+    if (mSize > 0)
+    {
+        mMappedVertexRegions.push_back({ 0, mSize - 1 });
+    }
+    if (mIndicesSize > 0)
+    {
+        mMappedIndexRegions.push_back({ 0, mIndicesSize - 1 });
+    }
+
+    mMappedAll = true;
+}
+
 // flush the given byte range
 //  target -- "targret" parameter for glBufferSubData
 //  start -- first byte to copy
@@ -1278,6 +1295,8 @@ void LLVertexBuffer::unmapBuffer()
 
 		mMappedIndexRegions.clear();
 	}
+
+    mMappedAll = false;
 }
 
 //----------------------------------------------------------------------------
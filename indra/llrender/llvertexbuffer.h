@@ -159,6 +159,11 @@ class LLVertexBuffer final : public LLRefCount
 	U8*		mapIndexBuffer(U32 index, S32 count = -1);
     void	unmapBuffer();
 
+	// flag the whole buffer as mapped.  Until the next unmapBuffer(), mapping
+	// only computes pointers, so getXXXStrider() may be called from worker
+	// threads as long as each thread writes its own range
+	void	mapAll();
+
 	// set for rendering
     // assumes (and will assert on) the following:
     //      - this buffer has no pending unampBuffer call
@@ -236,6 +241,7 @@ class LLVertexBuffer final : public LLRefCount
 
 	std::vector<MappedRegion> mMappedVertexRegions;  // list of mMappedData byte ranges that must be sent to GL
 	std::vector<MappedRegion> mMappedIndexRegions;   // list of mMappedIndexData byte ranges that must be sent to GL
+	bool	mMappedAll = false; // mapAll() was called, regions above cover the whole buffer
 
 private:
     // DEPRECATED
@@ -2926,6 +2926,12 @@ LLKeyframeMotion* BDFloaterPoseCreator::onReadyTempMotion(std::string filename,
 		LLDataPackerBinaryBuffer dp(anim_data, anim_file_size);
 		success = mTempMotion && mTempMotion->deserialize(dp, mMotionID);
 
+		//BD - We edit the keys of this motion in place, play them straight from the curves.
+		if (success)
+		{
+			mTempMotion->getJointMotionList()->releaseCompiledCurves();
+		}
+
 		if (success && eternal)
 		{
 			mTempMotion->setEternal(true);
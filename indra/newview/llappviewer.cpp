@@ -250,6 +250,7 @@
 #include "llavatariconctrl.h"
 #include "llgroupiconctrl.h"
 #include "llviewerassetstats.h"
+#include "parallelfor.h"
 #include "workqueue.h"
 using namespace LL;
 
@@ -659,6 +660,7 @@ LLAppViewer::LLAppViewer()
 	mReportedCrash(false),
 	mNumSessions(0),
     mGeneralThreadPool(nullptr),
+    mJobThreadPool(nullptr),
 	mPurgeCache(false),
 	mPurgeCacheOnExit(false),
 	mPurgeUserDataOnExit(false),
@@ -2002,6 +2004,10 @@ bool LLAppViewer::cleanup()
 	{
 		mGeneralThreadPool->close();
 	}
+	if (mJobThreadPool)
+	{
+		mJobThreadPool->close();
+	}
 
 	sTextureFetch->shutDownTextureCacheThread() ;
     LLLFSThread::sLocal->shutdown();
@@ -2036,6 +2042,8 @@ bool LLAppViewer::cleanup()
 	sPurgeDiskCacheThread = NULL;
     delete mGeneralThreadPool;
     mGeneralThreadPool = NULL;
+    delete mJobThreadPool;
+    mJobThreadPool = NULL;
 
 	if (LLFastTimerView::sAnalyzePerformance)
 	{
@@ -2157,11 +2165,21 @@ bool LLAppViewer::initThreads()
         cores = llmin(cores, (S32) max_cores);
     }
 
-    // The only configurable thread count right now is ImageDecode
+    // The configurable thread counts right now are ImageDecode and MeshDecode
     // The viewer typically starts around 8 threads not including image decode, 
     // so try to leave at least one core free
     S32 image_decode_count = llclamp(cores - 9, 1, 8);
     threadCounts["ImageDecode"] = image_decode_count;
+
+    // Mesh parsing comes in bursts after login and teleports, a quarter of
+    // the cores keeps up without starving image decode
+    S32 mesh_decode_count = llclamp(cores / 4, 1, 4);
+    threadCounts["MeshDecode"] = mesh_decode_count;
+
+    // The main thread waits for these, so they only need to cover the
+    // cores that would otherwise idle during a frame
+    S32 job_count = llclamp(cores / 2, 1, 6);
+    threadCounts[LL::JOB_POOL_NAME] = job_count;
     gSavedSettings.setLLSD("ThreadPoolSizes", threadCounts);
 
 	// Image decoding
@@ -2174,6 +2192,10 @@ bool LLAppViewer::initThreads()
     // general task background thread (LLPerfStats, etc)
     LLAppViewer::instance()->initGeneralThread();
 
+    // short parallel bursts of frame work, see LL::parallel_for()
+    mJobThreadPool = new LL::ThreadPool(LL::JOB_POOL_NAME, job_count);
+    mJobThreadPool->start();
+
 	LLAppViewer::sPurgeDiskCacheThread = new LLPurgeDiskCacheThread();
 
 	if (LLTrace::BlockTimer::sLog || LLTrace::BlockTimer::sMetricLog)
@@ -4056,7 +4078,7 @@ U32 LLAppViewer::getObjectCacheVersion()
 {
 	// Viewer object cache version, change if object update
 	// format changes. JC
-	const U32 INDRA_OBJECT_CACHE_VERSION = 17;
+	const U32 INDRA_OBJECT_CACHE_VERSION = 18;
 
 	return INDRA_OBJECT_CACHE_VERSION;
 }
@@ -4149,7 +4171,8 @@ bool LLAppViewer::initCache()
 		const uintmax_t disk_cache_bytes = disk_cache_mb * 1024ull * 1024ull;
 
 		const bool enable_cache_debug_info = gSavedSettings.getBOOL("EnableDiskCacheDebugInfo");
-		LLDiskCache::getInstance()->init(LL_PATH_CACHE, disk_cache_bytes, enable_cache_debug_info, disk_cache_mismatch);
+		const bool use_pack_cache = gSavedSettings.getBOOL("DiskCachePackBackend");
+		LLDiskCache::getInstance()->init(LL_PATH_CACHE, disk_cache_bytes, enable_cache_debug_info, disk_cache_mismatch, use_pack_cache);
 
 		if (!read_only)
 		{
@@ -289,6 +289,7 @@ class LLAppViewer : public LLApp
 	static LLTextureFetch* sTextureFetch;
 	static LLPurgeDiskCacheThread* sPurgeDiskCacheThread;
     LL::ThreadPool* mGeneralThreadPool;
+    LL::ThreadPool* mJobThreadPool;
 
 	S32 mNumSessions;
 
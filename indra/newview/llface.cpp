@@ -32,6 +32,7 @@
 
 #include "llviewercontrol.h"
 #include "llvolume.h"
+#include "llvolumegeometry.h"
 #include "m3math.h"
 #include "llmatrix4a.h"
 #include "v3color.h"
@@ -771,47 +772,6 @@ static void xform(LLVector2 &tex_coord, F32 cosAng, F32 sinAng, F32 offS, F32 of
 	tex_coord.mV[1] = t;
 }
 
-// Transform the texture coordinates for this face.
-static void xform4a(LLVector4a &tex_coord, const LLVector4a& trans, const LLVector4Logical& mask, const LLVector4a& rot0, const LLVector4a& rot1, const LLVector4a& offset, const LLVector4a& scale) 
-{
-	//tex coord is two coords, <s0, t0, s1, t1>
-	LLVector4a st;
-
-	// Texture transforms are done about the center of the face.
-	st.setAdd(tex_coord, trans);
-	
-	// <s0 * cosAng, s0*-sinAng, s1*cosAng, s1*-sinAng>
-	LLVector4a s0;
-	s0.splat(st, 0);
-	LLVector4a s1;
-	s1.splat(st, 2);
-	LLVector4a ss;
-	ss.setSelectWithMask(mask, s1, s0);
-
-	LLVector4a a; 
-	a.setMul(rot0, ss);
-	
-	// <t0*sinAng, t0*cosAng, t1*sinAng, t1*cosAng>
-	LLVector4a t0;
-	t0.splat(st, 1);
-	LLVector4a t1;
-	t1.splat(st, 3);
-	LLVector4a tt;
-	tt.setSelectWithMask(mask, t1, t0);
-
-	LLVector4a b;
-	b.setMul(rot1, tt);
-		
-	st.setAdd(a,b);
-
-	// Then scale
-	st.mul(scale);
-
-	// Then offset
-	tex_coord.setAdd(st, offset);
-}
-
-
 bool less_than_max_mag(const LLVector4a& vec)
 {
 	LLVector4a MAX_MAG;
@@ -1161,6 +1121,32 @@ bool LLFace::canRenderAsMask()
 	return false;
 }
 
+void LLFace::prepareGeometryVolume(S32 face_index)
+{
+	LLVOVolume* vobj = mDrawablep->getVOVolume();
+	LLVolume* volume = vobj ? vobj->getVolume() : NULL;
+	if (!volume || face_index < 0 || face_index >= volume->getNumVolumeFaces() || mVertexBuffer.isNull())
+	{
+		return;
+	}
+
+	const LLTextureEntry* tep = mVObjp->getTE(face_index);
+	const LLTextureEntry* face_te = getTextureEntry();
+	U8 texgen = face_te ? face_te->getTexGen() : LLTextureEntry::TEX_GEN_DEFAULT;
+
+	if ((tep && tep->getBumpmap()) ||
+		texgen != LLTextureEntry::TEX_GEN_DEFAULT ||
+		mVertexBuffer->hasDataType(LLVertexBuffer::TYPE_TANGENT))
+	{
+		volume->genTangents(face_index);
+	}
+
+	if (isState(TEXTURE_ANIM) && !vobj->mTexAnimMode)
+	{
+		clearState(TEXTURE_ANIM);
+	}
+}
+
 BOOL LLFace::getGeometryVolume(const LLVolume& volume,
                                 S32 face_index,
                                 const LLMatrix4a& mat_vert_in,
@@ -1316,28 +1302,7 @@ BOOL LLFace::getGeometryVolume(const LLVolume& volume,
 	{
         LL_PROFILE_ZONE_NAMED_CATEGORY_FACE("getGeometryVolume - indices");
 		mVertexBuffer->getIndexStrider(indicesp, mIndicesIndex, mIndicesCount);
-
-		volatile __m128i* dst = (__m128i*) indicesp.get();
-		__m128i* src = (__m128i*) vf.mIndices;
-		__m128i offset = _mm_set1_epi16(index_offset);
-
-		S32 end = num_indices/8;
-		
-		for (S32 i = 0; i < end; i++)
-		{
-			__m128i res = _mm_add_epi16(src[i], offset);
-			_mm_storeu_si128((__m128i*) dst++, res);
-		}
-
-		{
-            LL_PROFILE_ZONE_NAMED_CATEGORY_FACE("getGeometryVolume - indices tail");
-			U16* idx = (U16*) dst;
-
-			for (S32 i = end*8; i < num_indices; ++i)
-			{
-				*idx++ = vf.mIndices[i]+index_offset;
-			}
-		}
+		ll_volume_face_indices(indicesp.get(), vf, index_offset);
 	}
 	
 
@@ -1586,44 +1551,12 @@ BOOL LLFace::getGeometryVolume(const LLVolume& volume,
 						if (xforms == XFORM_NONE)
 						{
                             LL_PROFILE_ZONE_NAMED_CATEGORY_FACE("ggv - texgen 1");
-							S32 tc_size = (num_vertices*2*sizeof(F32)+0xF) & ~0xF;
-							LLVector4a::memcpyNonAliased16((F32*) tex_coords0.get(), (F32*) vf.mTexCoords, tc_size);
+							ll_volume_face_tex_coords((F32*) tex_coords0.get(), vf);
 						}
 						else
 						{
                             LL_PROFILE_ZONE_NAMED_CATEGORY_FACE("ggv - texgen 2");
-							F32* dst = (F32*) tex_coords0.get();
-							LLVector4a* src = (LLVector4a*) vf.mTexCoords;
-
-							LLVector4a trans;
-							trans.splat(-0.5f);
-
-							LLVector4a rot0;
-							rot0.set(cos_ang, -sin_ang, cos_ang, -sin_ang);
-
-							LLVector4a rot1;
-							rot1.set(sin_ang, cos_ang, sin_ang, cos_ang);
-
-							LLVector4a scale;
-							scale.set(ms, mt, ms, mt);
-
-							LLVector4a offset;
-							offset.set(os+0.5f, ot+0.5f, os+0.5f, ot+0.5f);
-
-							LLVector4Logical mask;
-							mask.clear();
-							mask.setElement<2>();
-							mask.setElement<3>();
-
-							U32 count = num_vertices/2 + num_vertices%2;
-
-							for (S32 i = 0; i < count; i++)
-							{	
-								LLVector4a res = *src++;
-								xform4a(res, trans, mask, rot0, rot1, offset, scale);
-								res.store4a(dst);
-								dst += 4;
-							}
+							ll_volume_face_tex_coords((F32*) tex_coords0.get(), vf, cos_ang, sin_ang, os, ot, ms, mt);
 						}
 					}
 					else
@@ -1836,62 +1769,14 @@ BOOL LLFace::getGeometryVolume(const LLVolume& volume,
 
 		if (rebuild_pos)
 		{
-			LLVector4a* src = vf.mPositions;
-			
-			//_mm_prefetch((char*)src, _MM_HINT_T0);
-
-			LLVector4a* end = src+num_vertices;
-			//LLVector4a* end_64 = end-4;
-
 			llassert(num_vertices > 0);
 		
 			mVertexBuffer->getVertexStrider(vert, mGeomIndex, mGeomCount);
-			
-			
-			F32* dst = (F32*) vert.get();
-			F32* end_f32 = dst+mGeomCount*4;
-
-			//_mm_prefetch((char*)dst, _MM_HINT_NTA);
-			//_mm_prefetch((char*)src, _MM_HINT_NTA);
-				
-			//_mm_prefetch((char*)dst, _MM_HINT_NTA);
-
-
-			LLVector4a res0; //,res1,res2,res3;
-			res0.clear();
-
-			LLVector4a texIdx;
 
 			S32 index = mTextureIndex < FACE_DO_NOT_BATCH_TEXTURES ? mTextureIndex : 0;
-
-			F32 val = 0.f;
-			S32* vp = (S32*) &val;
-			*vp = index;
-			
 			llassert(index <= LLGLSLShader::sIndexedTextureChannels-1);
 
-			LLVector4Logical mask;
-			mask.clear();
-			mask.setElement<3>();
-		
-			texIdx.set(0,0,0,val);
-
-			LLVector4a tmp;
-
-			
-			while (src < end)
-			{	
-				mat_vert.affineTransform(*src++, res0);
-				tmp.setSelectWithMask(mask, texIdx, res0);
-				tmp.store4a((F32*) dst);
-				dst += 4;
-			}
-			
-			while (dst < end_f32)
-			{
-				res0.store4a((F32*) dst);
-				dst += 4;
-			}
+			ll_volume_face_positions((F32*) vert.get(), mGeomCount, vf, mat_vert, index);
 		}
 
 		if (rebuild_normal)
@@ -1899,44 +1784,17 @@ BOOL LLFace::getGeometryVolume(const LLVolume& volume,
             LL_PROFILE_ZONE_NAMED_CATEGORY_FACE("getGeometryVolume - normal");
 
 			mVertexBuffer->getNormalStrider(norm, mGeomIndex, mGeomCount);
-			F32* normals = (F32*) norm.get();
-			LLVector4a* src = vf.mNormals;
-			LLVector4a* end = src+num_vertices;
-			
-			while (src < end)
-			{	
-				LLVector4a normal;
-				mat_normal.rotate(*src++, normal);
-				normal.store4a(normals);
-				normals += 4;
-			}
+			ll_volume_face_normals((F32*) norm.get(), vf, mat_normal);
 		}
 		
 		if (rebuild_tangent)
 		{
             LL_PROFILE_ZONE_NAMED_CATEGORY_FACE("getGeometryVolume - tangent");
 			mVertexBuffer->getTangentStrider(tangent, mGeomIndex, mGeomCount);
-			F32* tangents = (F32*) tangent.get();
 			
             mVObjp->getVolume()->genTangents(face_index);
-			
-			LLVector4Logical mask;
-			mask.clear();
-			mask.setElement<3>();
-
-			LLVector4a* src = vf.mTangents;
-			LLVector4a* end = vf.mTangents +num_vertices;
 
-			while (src < end)
-			{
-				LLVector4a tangent_out;
-				mat_normal.rotate(*src, tangent_out);
-				tangent_out.setSelectWithMask(mask, *src, tangent_out);
-				tangent_out.store4a(tangents);
-				
-				src++;
-				tangents += 4;
-			}
+			ll_volume_face_tangents((F32*) tangent.get(), vf, mat_normal);
 		}
 	
 		if (rebuild_weights && vf.mWeights)
@@ -1950,26 +1808,7 @@ BOOL LLFace::getGeometryVolume(const LLVolume& volume,
 		{
             LL_PROFILE_ZONE_NAMED_CATEGORY_FACE("getGeometryVolume - color");
 			mVertexBuffer->getColorStrider(colors, mGeomIndex, mGeomCount);
-
-			LLVector4a src;
-
-			U32 vec[4];
-			vec[0] = vec[1] = vec[2] = vec[3] = color.asRGBA();
-		
-			src.loadua((F32*) vec);
-
-			F32* dst = (F32*) colors.get();
-			S32 num_vecs = num_vertices/4;
-			if (num_vertices%4 > 0)
-			{
-				++num_vecs;
-			}
-
-			for (S32 i = 0; i < num_vecs; i++)
-			{	
-				src.store4a(dst);
-				dst += 4;
-			}
+			ll_volume_face_colors((F32*) colors.get(), num_vertices, color.asRGBA());
 		}
 
 		if (rebuild_emissive)
@@ -1979,31 +1818,9 @@ BOOL LLFace::getGeometryVolume(const LLVolume& volume,
 			mVertexBuffer->getEmissiveStrider(emissive, mGeomIndex, mGeomCount);
 
 			U8 glow = (U8) llclamp((S32) (getTextureEntry()->getGlow()*255), 0, 255);
-
-			LLVector4a src;
-
-		
 			LLColor4U glow4u = LLColor4U(0,0,0,glow);
 
-			U32 glow32 = glow4u.asRGBA();
-
-			U32 vec[4];
-			vec[0] = vec[1] = vec[2] = vec[3] = glow32;
-		
-			src.loadua((F32*) vec);
-
-			F32* dst = (F32*) emissive.get();
-			S32 num_vecs = num_vertices/4;
-			if (num_vertices%4 > 0)
-			{
-				++num_vecs;
-			}
-
-			for (S32 i = 0; i < num_vecs; i++)
-			{	
-				src.store4a(dst);
-				dst += 4;
-			}
+			ll_volume_face_colors((F32*) emissive.get(), num_vertices, glow4u.asRGBA());
 		}
 	}
 
@@ -154,6 +154,10 @@ class alignas(16) LLFace
                             U16 index_offset,
                             bool force_rebuild = false,
                             bool no_debug_assert = false);
+	// Do the parts of a forced getGeometryVolume() that touch state shared
+	// with other faces (tangents of a possibly shared LLVolume) or read
+	// after it by the caller, so the call itself can run on a worker thread
+	void prepareGeometryVolume(S32 face_index);
 
 	// For avatar
 	U16			 getGeometryAvatar(
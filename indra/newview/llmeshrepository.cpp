@@ -45,7 +45,9 @@
 #include "llsdutil_math.h"
 #include "llsdserialize.h"
 #include "llthread.h"
+#include "lldiskcache.h"
 #include "llfilesystem.h"
+#include "threadpool.h"
 #include "llviewercontrol.h"
 #include "llviewerinventory.h"
 #include "llviewermenufile.h"
@@ -109,6 +111,7 @@
 //
 //   main     Main rendering thread, very sensitive to locking and other stalls
 //   repo     Overseeing worker thread associated with the LLMeshRepoThread class
+//   decodeN  "MeshDecode" pool parsing and unpacking fetched or cached mesh data
 //   decom    Worker thread for mesh decomposition requests
 //   core     HTTP worker thread:  does the work but doesn't intrude here
 //   uploadN  0-N temporary mesh upload threads (0-1 in practice)
@@ -137,11 +140,15 @@
 //                             ...
 //                             onCompleted() invoked for GET
 //                               data copied
-//                               headerReceived() invoked
-//                                 LLSD parsed
-//                                 mMeshHeader updated
-//                                 scan mPendingLOD for LOD request
-//                                 push LODRequest to mLODReqQ
+//                               postDecode() for mesh ID
+//                             ...
+//                                                 decode thread
+//                                                 headerReceived() invoked
+//                                                   LLSD parsed
+//                                                   mMeshHeader updated
+//                                                   scan mPendingLOD for LOD request
+//                                                   push LODRequest to mLODReqQ
+//                                                 postToRepoThread() cache write
 //                             ...
 //                             scan mLODReqQ
 //                             fetchMeshLOD() invoked
@@ -149,9 +156,13 @@
 //                             ...
 //                             onCompleted() invoked for GET
 //                               data copied
-//                               lodReceived() invoked
-//                                 unpack data into LLVolume
-//                                 append LoadedMesh to mLoadedQ
+//                               postDecode() for mesh ID
+//                             ...
+//                                                 decode thread
+//                                                 lodReceived() invoked
+//                                                   unpack data into LLVolume
+//                                                   append LoadedMesh to mLoadedQ
+//                                                 postToRepoThread() cache write
 //                             ...
 //         notifyLoadedMeshes() invoked again
 //           scan mLoadedQ
@@ -165,6 +176,7 @@
 //   LLMeshRepository::mMeshMutex
 //   LLMeshRepoThread::mMutex
 //   LLMeshRepoThread::mHeaderMutex
+//   LLMeshRepoThread::mDecodeMutex
 //   LLMeshRepoThread::mSignal (LLCondition)
 //   LLPhysicsDecomp::mSignal (LLCondition)
 //   LLPhysicsDecomp::mMutex
@@ -174,6 +186,7 @@
 //
 //   1.  LLMeshRepoThread::mMutex before LLMeshRepoThread::mHeaderMutex
 //   2.  LLMeshRepository::mMeshMutex before LLMeshRepoThread::mMutex
+//   3.  LLMeshRepoThread::mDecodeMutex is never held while taking another
 //   (There are more rules, haven't been extracted.)
 //
 // Data Member Access/Locking
@@ -246,7 +259,7 @@
 //     sActiveHeaderRequests    mMutex        rw.any.mMutex, ro.repo.none [1]
 //     sActiveLODRequests       mMutex        rw.any.mMutex, ro.repo.none [1]
 //     sMaxConcurrentRequests   mMutex        wo.main.none, ro.repo.none, ro.main.mMutex
-//     mMeshHeader              mHeaderMutex  rw.repo.mHeaderMutex, ro.main.mHeaderMutex, ro.main.none [0]
+//     mMeshHeader              mHeaderMutex  rw.decode.mHeaderMutex, ro.repo.mHeaderMutex, ro.main.mHeaderMutex, ro.main.none [0]
 //     mSkinReqQ			    mMutex        rw.repo.mMutex, ro.repo.none [5]
 //     mSkinUnavailableQ        mMutex        rw.repo.mMutex, ro.repo.none [5]
 //     mSkinInfoQ               mMutex        rw.repo.mMutex, rw.main.mMutex [5] (was:  [0])
@@ -262,6 +275,8 @@
 //     mGetMesh2Capability      mMutex        rw.main.mMutex, ro.repo.mMutex (was:  [0])
 //     mGetMeshVersion          mMutex        rw.main.mMutex, ro.repo.mMutex
 //     mHttp*                   none          rw.repo.none
+//     mDecodeQueues            mDecodeMutex  rw.any.mDecodeMutex
+//     mRepoWorkQ               mMutex        rw.any.mMutex
 //
 //   LLMeshUploadThread:
 //
@@ -429,6 +444,57 @@ const std::array<std::string, 4> header_lod =
 
 const char * const LOG_MESH = "Mesh";
 
+// Mesh data kept for the decode pool after the HTTP response it came from
+// is gone
+typedef std::shared_ptr<std::vector<U8>> mesh_data_ptr_t;
+
+static mesh_data_ptr_t copy_mesh_data(const U8* data, S32 data_size)
+{
+	try
+	{
+		return std::make_shared<std::vector<U8>>(data, data + llmax(data_size, 0));
+	}
+	catch (const std::bad_alloc&)
+	{
+		LL_WARNS(LOG_MESH) << "Failed to allocate " << data_size << " bytes for mesh data" << LL_ENDL;
+		return nullptr;
+	}
+}
+
+// Cached mesh data for the decode pool, read straight out of the cache
+// file's mapping. The pointer keeps the file, and with it the mapping,
+// alive until the job lets go of it. On Windows a mapped file can't be
+// rewritten, so unless the pack backend holds the asset in memory anyway
+// the bytes are copied there instead of blocking cache writes meanwhile.
+static std::shared_ptr<const U8> hold_cached_mesh_data(std::shared_ptr<LLFileSystem> file, const U8* data, S32 data_size)
+{
+#if LL_WINDOWS
+	if (!LLDiskCache::getInstance()->getPackCache())
+	{
+		mesh_data_ptr_t buffer = copy_mesh_data(data, data_size);
+		return buffer ? std::shared_ptr<const U8>(buffer, buffer->data()) : nullptr;
+	}
+#endif
+	return std::shared_ptr<const U8>(std::move(file), data);
+}
+
+// Store a fetched byte range of a mesh asset in the cache file
+// LLMeshHeaderHandler reserved for it.  Repo thread only.
+static void write_mesh_range_to_cache(const LLUUID& mesh_id, S32 offset, S32 size, const std::vector<U8>& data)
+{
+	// <FS:Ansariel> Fix asset caching
+	LLFileSystem file(mesh_id, LLAssetType::AT_MESH, LLFileSystem::READ_WRITE);
+
+	if (file.getSize() >= offset+size)
+	{
+		size = llmin(size, (S32)data.size());
+		LLMeshRepository::sCacheBytesWritten += size;
+		++LLMeshRepository::sCacheWrites;
+		file.seek(offset);
+		file.write(data.data(), size);
+	}
+}
+
 // Static data and functions to measure mesh load
 // time metrics for a new region scene.
 static unsigned int metrics_teleport_start_count = 0;
@@ -841,6 +907,10 @@ LLMeshRepoThread::LLMeshRepoThread()
 	mHttpPolicyClass = app_core_http.getPolicy(LLAppCoreHttp::AP_MESH2);
 	mHttpLegacyPolicyClass = app_core_http.getPolicy(LLAppCoreHttp::AP_MESH1);
 	mHttpLargePolicyClass = app_core_http.getPolicy(LLAppCoreHttp::AP_LARGE_MESH);
+
+	// width comes from ThreadPoolSizes, see LLAppViewer::initThreads()
+	mDecodePool.reset(new LL::ThreadPool("MeshDecode", 2));
+	mDecodePool->start();
 }
 
 
@@ -851,6 +921,14 @@ LLMeshRepoThread::~LLMeshRepoThread()
 					   << ", Max Lock Holdoffs:  " << LLMeshRepository::sMaxLockHoldoffs
 					   << LL_ENDL;
 
+	if (mDecodePool)
+	{
+		// Finishes the decodes still queued, they need the mutexes below
+		mDecodePool->close();
+		mDecodePool.reset();
+	}
+	mRepoWorkQ.clear();
+
 	mHttpRequestSet.clear();
     mHttpHeaders.reset();
 
@@ -905,6 +983,17 @@ void LLMeshRepoThread::run()
 			mHttpRequest->update(0L);
 		}
 		sRequestWaterLevel = mHttpRequestSet.size();			// Stats data update
+
+		// Cache writes and fetches handed back by the decode pool
+		std::deque<work_t> repo_work;
+		{
+			LLMutexLock lock(mMutex);
+			repo_work.swap(mRepoWorkQ);
+		}
+		for (work_t& work : repo_work)
+		{
+			work();
+		}
 			
 		// NOTE: order of queue processing intentionally favors LOD requests over header requests
 		// Todo: we are processing mLODReqQ, mHeaderReqQ, mSkinRequests, mDecompositionRequests and mPhysicsShapeRequests
@@ -1317,34 +1406,95 @@ LLCore::HttpHandle LLMeshRepoThread::getByteRange(const std::string & url, int l
 	return handle;
 }
 
-bool LLMeshRepoThread::loadInfoFromFilesystem(const LLUUID& mesh_id, MeshHeaderInfo& info, boost::function<bool(const LLUUID&, U8*, S32)> fn)
+void LLMeshRepoThread::postDecode(const LLUUID& mesh_id, work_t&& work)
 {
-	//check cache for mesh skin info
-	LLFileSystem file(mesh_id, LLAssetType::AT_MESH);
-	if (file.getSize() >= info.mOffset + info.mSize)
 	{
-		auto buffer = std::make_unique<U8[]>(info.mSize);
-		if (!buffer)
+		LLMutexLock lock(&mDecodeMutex);
+		std::deque<work_t>& queue = mDecodeQueues[mesh_id];
+		queue.emplace_back(std::move(work));
+		if (queue.size() > 1)
+		{ // a decode thread is already working through this mesh's queue
+			return;
+		}
+	}
+
+	if (!mDecodePool || !mDecodePool->getQueue().post([this, mesh_id]() { runDecodeQueue(mesh_id); }))
+	{
+		// Shutting down, the pool has stopped taking work
+		runDecodeQueue(mesh_id);
+	}
+}
+
+void LLMeshRepoThread::runDecodeQueue(const LLUUID& mesh_id)
+{
+	LL_PROFILE_ZONE_SCOPED;
+
+	while (true)
+	{
+		work_t work;
 		{
-			LL_WARNS_ONCE(LOG_MESH) << "Failed to allocate memory for mesh data load, size: " << info.mSize << LL_ENDL;
-			return false;
+			// the running item stays at the front so postDecode() knows
+			// this mesh is taken
+			LLMutexLock lock(&mDecodeMutex);
+			work = mDecodeQueues[mesh_id].front();
+		}
+
+		if (!LLApp::isExiting())
+		{
+			work();
+		}
+
+		LLMutexLock lock(&mDecodeMutex);
+		auto iter = mDecodeQueues.find(mesh_id);
+		iter->second.pop_front();
+		if (iter->second.empty())
+		{
+			mDecodeQueues.erase(iter);
+			return;
 		}
-		LLMeshRepository::sCacheBytesRead += info.mSize;
-		++LLMeshRepository::sCacheReads;
-		file.seek(info.mOffset);
-		file.read(buffer.get(), info.mSize);
+	}
+}
+
+void LLMeshRepoThread::postToRepoThread(work_t&& work)
+{
+	{
+		LLMutexLock lock(mMutex);
+		mRepoWorkQ.emplace_back(std::move(work));
+	}
+	mSignal->signal();
+}
+
+bool LLMeshRepoThread::loadInfoFromFilesystem(const LLUUID& mesh_id, MeshHeaderInfo& info, decode_fn_t decode, work_t on_failure)
+{
+	//check cache for mesh skin info
+	auto file = std::make_shared<LLFileSystem>(mesh_id, LLAssetType::AT_MESH);
+	std::span<const U8> mapped = file->getMappedData();
+	if (mapped.size() >= (size_t)info.mOffset + info.mSize)
+	{
+		const U8* data = mapped.data() + info.mOffset;
 
 		//make sure buffer isn't all 0's by checking the first 1KB (reserved block but not written)
 		bool zero = true;
 		for (S32 i = 0; i < llmin(info.mSize, S32(1024)) && zero; ++i)
 		{
-			zero = buffer[i] > 0 ? false : true;
+			zero = data[i] > 0 ? false : true;
 		}
 
 		if (!zero)
-		{ //attempt to parse
-			if (fn(mesh_id, buffer.get(), info.mSize) == MESH_OK)
+		{ //decode on the pool straight from the mapped cache file
+			std::shared_ptr<const U8> buffer = hold_cached_mesh_data(std::move(file), data, info.mSize);
+			if (buffer)
 			{
+				LLMeshRepository::sCacheBytesRead += info.mSize;
+				++LLMeshRepository::sCacheReads;
+
+				postDecode(mesh_id, [this, buffer, size = info.mSize, decode = std::move(decode), on_failure = std::move(on_failure)]()
+				{
+					if (decode(buffer.get(), size) != MESH_OK)
+					{
+						postToRepoThread(work_t(on_failure));
+					}
+				});
 				return true;
 			}
 		}
@@ -1352,7 +1502,7 @@ bool LLMeshRepoThread::loadInfoFromFilesystem(const LLUUID& mesh_id, MeshHeaderI
 	return false;
 }
 
-bool LLMeshRepoThread::fetchMeshSkinInfo(const LLUUID& mesh_id, bool can_retry)
+bool LLMeshRepoThread::fetchMeshSkinInfo(const LLUUID& mesh_id, bool can_retry, bool check_cache)
 {
 	MeshHeaderInfo info;
 	{
@@ -1383,7 +1533,17 @@ bool LLMeshRepoThread::fetchMeshSkinInfo(const LLUUID& mesh_id, bool can_retry)
 	if (info.mVersion <= MAX_MESH_VERSION && info.mOffset >= 0 && info.mSize > 0)
 	{
 		//check cache for mesh skin info
-		if (loadInfoFromFilesystem(mesh_id, info, boost::bind(&LLMeshRepoThread::skinInfoReceived, this, _1, _2, _3)))
+		if (check_cache
+			&& loadInfoFromFilesystem(mesh_id, info,
+				[this, mesh_id](const U8* data, S32 data_size) { return skinInfoReceived(mesh_id, data, data_size); },
+				[this, mesh_id, can_retry]()
+				{ // cached copy did not decode, fetch from sim
+					if (!fetchMeshSkinInfo(mesh_id, can_retry, false))
+					{
+						LLMutexLock locker(mMutex);
+						mSkinUnavailableQ.emplace_back(mesh_id);
+					}
+				}))
 			return true;
 
 		//reading from cache failed for whatever reason, fetch from sim
@@ -1430,7 +1590,7 @@ bool LLMeshRepoThread::fetchMeshSkinInfo(const LLUUID& mesh_id, bool can_retry)
 	return true;
 }
 
-bool LLMeshRepoThread::fetchMeshDecomposition(const LLUUID& mesh_id)
+bool LLMeshRepoThread::fetchMeshDecomposition(const LLUUID& mesh_id, bool check_cache)
 {
 	MeshHeaderInfo info;
 	{
@@ -1461,7 +1621,10 @@ bool LLMeshRepoThread::fetchMeshDecomposition(const LLUUID& mesh_id)
 	if (info.mVersion <= MAX_MESH_VERSION && info.mOffset >= 0 && info.mSize > 0)
 	{
 		//check cache for mesh physics info
-		if (loadInfoFromFilesystem(mesh_id, info, boost::bind(&LLMeshRepoThread::decompositionReceived, this, _1, _2, _3)))
+		if (check_cache
+			&& loadInfoFromFilesystem(mesh_id, info,
+				[this, mesh_id](const U8* data, S32 data_size) { return decompositionReceived(mesh_id, data, data_size); },
+				[this, mesh_id]() { fetchMeshDecomposition(mesh_id, false); }))
 			return true;
 
 		//reading from cache failed for whatever reason, fetch from sim
@@ -1493,7 +1656,7 @@ bool LLMeshRepoThread::fetchMeshDecomposition(const LLUUID& mesh_id)
 	return true;
 }
 
-bool LLMeshRepoThread::fetchMeshPhysicsShape(const LLUUID& mesh_id)
+bool LLMeshRepoThread::fetchMeshPhysicsShape(const LLUUID& mesh_id, bool check_cache)
 {
 	MeshHeaderInfo info;
 	{
@@ -1523,7 +1686,10 @@ bool LLMeshRepoThread::fetchMeshPhysicsShape(const LLUUID& mesh_id)
 
 	if (info.mVersion <= MAX_MESH_VERSION && info.mOffset >= 0 && info.mSize > 0)
 	{
-		if (loadInfoFromFilesystem(mesh_id, info, boost::bind(&LLMeshRepoThread::physicsShapeReceived, this, _1, _2, _3)))
+		if (check_cache
+			&& loadInfoFromFilesystem(mesh_id, info,
+				[this, mesh_id](const U8* data, S32 data_size) { return physicsShapeReceived(mesh_id, data, data_size); },
+				[this, mesh_id]() { fetchMeshPhysicsShape(mesh_id, false); }))
 			return true;
 
 		//reading from cache failed for whatever reason, fetch from sim
@@ -1588,32 +1754,51 @@ void LLMeshRepoThread::decActiveHeaderRequests()
 }
 
 //return false if failed to get header
-bool LLMeshRepoThread::fetchMeshHeader(const LLVolumeParams& mesh_params, bool can_retry)
+bool LLMeshRepoThread::fetchMeshHeader(const LLVolumeParams& mesh_params, bool can_retry, bool check_cache)
 {
+	if (check_cache)
 	{
 		//look for mesh in asset in cache
-		LLFileSystem file(mesh_params.getSculptID(), LLAssetType::AT_MESH);
+		auto file = std::make_shared<LLFileSystem>(mesh_params.getSculptID(), LLAssetType::AT_MESH);
 			
-		S32 size = file.getSize();
+		std::span<const U8> mapped = file->getMappedData();
 
-		if (size > 0)
+		// *NOTE:  if the header size is ever more than 4KB, this will break
+		S32 size = llmin((S32)mapped.size(), MESH_HEADER_SIZE);
+		std::shared_ptr<const U8> buffer = size > 0 ? hold_cached_mesh_data(std::move(file), mapped.data(), size) : nullptr;
+		if (buffer)
 		{
-			// *NOTE:  if the header size is ever more than 4KB, this will break
-			U8 buffer[MESH_HEADER_SIZE];
-			S32 bytes = llmin(size, MESH_HEADER_SIZE);
-			LLMeshRepository::sCacheBytesRead += bytes;	
+			LLMeshRepository::sCacheBytesRead += size;
 			++LLMeshRepository::sCacheReads;
-			file.read(buffer, bytes);
-			if (headerReceived(mesh_params, buffer, bytes) == MESH_OK)
+
+			// Found mesh in cache, parse the header on the decode pool
+			postDecode(mesh_params.getSculptID(), [this, mesh_params, can_retry, buffer, size]()
 			{
+				if (headerReceived(mesh_params, buffer.get(), size) == MESH_OK)
+				{
 #ifdef SHOW_DEBUG
-				std::string mid;
-				mesh_params.getSculptID().toString(mid);
-				LL_DEBUGS(LOG_MESH) << "Mesh/Cache: Mesh header for ID " << mid << " - was retrieved from the cache." << LL_ENDL;
+					std::string mid;
+					mesh_params.getSculptID().toString(mid);
+					LL_DEBUGS(LOG_MESH) << "Mesh/Cache: Mesh header for ID " << mid << " - was retrieved from the cache." << LL_ENDL;
 #endif
-				// Found mesh in cache
-				return true;
-			}
+					return;
+				}
+
+				// cached header is corrupt, request it from the simulator
+				postToRepoThread([this, mesh_params, can_retry]()
+				{
+					if (!fetchMeshHeader(mesh_params, can_retry, false))
+					{
+						// Can't get the header so none of the LODs will be available
+						LLMutexLock lock(mMutex);
+						for (int i(0); i < LLVolumeLODGroup::NUM_LODS; ++i)
+						{
+							mUnavailableQ.emplace_back(mesh_params, i);
+						}
+					}
+				});
+			});
+			return true;
 		}
 	}
 
@@ -1656,7 +1841,7 @@ bool LLMeshRepoThread::fetchMeshHeader(const LLVolumeParams& mesh_params, bool c
 }
 
 //return false if failed to get mesh lod.
-bool LLMeshRepoThread::fetchMeshLOD(const LLVolumeParams& mesh_params, S32 lod, bool can_retry)
+bool LLMeshRepoThread::fetchMeshLOD(const LLVolumeParams& mesh_params, S32 lod, bool can_retry, bool check_cache)
 {
 	const LLUUID& mesh_id = mesh_params.getSculptID();
 	MeshHeaderInfo info;
@@ -1687,7 +1872,17 @@ bool LLMeshRepoThread::fetchMeshLOD(const LLVolumeParams& mesh_params, S32 lod,
 			
 	if(info.mVersion <= MAX_MESH_VERSION && info.mOffset >= 0 && info.mSize > 0)
 	{
-		if (loadInfoFromFilesystem(mesh_id, info, boost::bind(&LLMeshRepoThread::lodReceived, this, mesh_params, lod, _2, _3 )))
+		if (check_cache
+			&& loadInfoFromFilesystem(mesh_id, info,
+				[this, mesh_params, lod](const U8* data, S32 data_size) { return lodReceived(mesh_params, lod, data, data_size); },
+				[this, mesh_params, lod, can_retry]()
+				{ // cached copy did not decode, fetch from sim
+					if (!fetchMeshLOD(mesh_params, lod, can_retry, false))
+					{
+						LLMutexLock lock(mMutex);
+						mUnavailableQ.emplace_back(mesh_params, lod);
+					}
+				}))
 			return true;
 
 		//reading from cache failed for whatever reason, fetch from sim
@@ -1736,7 +1931,7 @@ bool LLMeshRepoThread::fetchMeshLOD(const LLVolumeParams& mesh_params, S32 lod,
 	return true;
 }
 
-EMeshProcessingResult LLMeshRepoThread::headerReceived(const LLVolumeParams& mesh_params, U8* data, S32 data_size)
+EMeshProcessingResult LLMeshRepoThread::headerReceived(const LLVolumeParams& mesh_params, const U8* data, S32 data_size)
 {
 	const LLUUID& mesh_id = mesh_params.getSculptID();
 	LLSD header_data;
@@ -1747,7 +1942,7 @@ EMeshProcessingResult LLMeshRepoThread::headerReceived(const LLVolumeParams& mes
 	if (data_size > 0)
 	{
 		llssize dsize = data_size;
-		char* result_ptr = strip_deprecated_header((char*)data, dsize, &header_size);
+		char* result_ptr = strip_deprecated_header(const_cast<char*>(reinterpret_cast<const char*>(data)), dsize, &header_size);
 
 		data_size = dsize;
 
@@ -1813,7 +2008,7 @@ EMeshProcessingResult LLMeshRepoThread::headerReceived(const LLVolumeParams& mes
 	return MESH_OK;
 }
 
-EMeshProcessingResult LLMeshRepoThread::lodReceived(const LLVolumeParams& mesh_params, S32 lod, U8* data, S32 data_size)
+EMeshProcessingResult LLMeshRepoThread::lodReceived(const LLVolumeParams& mesh_params, S32 lod, const U8* data, S32 data_size)
 {
 	if (data == NULL || data_size == 0)
 	{
@@ -1843,7 +2038,7 @@ EMeshProcessingResult LLMeshRepoThread::lodReceived(const LLVolumeParams& mesh_p
 	return MESH_UNKNOWN;
 }
 
-EMeshProcessingResult LLMeshRepoThread::skinInfoReceived(const LLUUID& mesh_id, U8* data, S32 data_size)
+EMeshProcessingResult LLMeshRepoThread::skinInfoReceived(const LLUUID& mesh_id, const U8* data, S32 data_size)
 {
 	if (data == NULL || data_size == 0)
 	{
@@ -1890,7 +2085,7 @@ EMeshProcessingResult LLMeshRepoThread::skinInfoReceived(const LLUUID& mesh_id,
 	return MESH_OK;
 }
 
-EMeshProcessingResult LLMeshRepoThread::decompositionReceived(const LLUUID& mesh_id, U8* data, S32 data_size)
+EMeshProcessingResult LLMeshRepoThread::decompositionReceived(const LLUUID& mesh_id, const U8* data, S32 data_size)
 {
 	if (data == NULL || data_size == 0)
 	{
@@ -1927,7 +2122,7 @@ EMeshProcessingResult LLMeshRepoThread::decompositionReceived(const LLUUID& mesh
 	return MESH_OK;
 }
 
-EMeshProcessingResult LLMeshRepoThread::physicsShapeReceived(const LLUUID& mesh_id, U8* data, S32 data_size)
+EMeshProcessingResult LLMeshRepoThread::physicsShapeReceived(const LLUUID& mesh_id, const U8* data, S32 data_size)
 {
 	if (data == NULL || data_size == 0)
 	{
@@ -3093,114 +3288,145 @@ void LLMeshHeaderHandler::processFailure(LLCore::HttpStatus status)
 	}
 }
 
-void LLMeshHeaderHandler::processData(LLCore::BufferArray * /* body */, S32 /* body_offset */,
-									  U8 * data, S32 data_size)
+// Reserve the cache file for a mesh whose header was fetched from the sim
+// and parsed, and store what was received.  Repo thread only.
+static void cache_mesh_header(const LLVolumeParams& mesh_params, const U8* data, S32 data_size)
 {
-	const LLUUID& mesh_id = mMeshParams.getSculptID();
-    bool success = (!MESH_HEADER_PROCESS_FAILED)
-        && ((data != NULL) == (data_size > 0)); // if we have data but no size or have size but no data, something is wrong;
-	llassert(success);
-    EMeshProcessingResult res = MESH_UNKNOWN;
-    if (success)
-    {
-        res = gMeshRepo.mThread->headerReceived(mMeshParams, data, data_size);
-        success = (res == MESH_OK);
-    }
-	if (! success)
-	{
-		// *TODO:  Get real reason for parse failure here.  Might we want to retry?
-		LL_WARNS(LOG_MESH) << "Unable to parse mesh header.  ID:  " << mesh_id
-						   << ", Size: " << data_size
-						   << ", Reason: " << res << " Not retrying."
-						   << LL_ENDL;
+	const LLUUID& mesh_id = mesh_params.getSculptID();
 
-		// Can't get the header so none of the LODs will be available
-		LLMutexLock lock(gMeshRepo.mThread->mMutex);
-		for (int i(0); i < LLVolumeLODGroup::NUM_LODS; ++i)
-		{
-			gMeshRepo.mThread->mUnavailableQ.emplace_back(mMeshParams, i);
-		}
+	// header was successfully retrieved from sim and parsed and is in cache
+	S32 header_bytes = 0;
+	LLMeshHeader header;
+
+	gMeshRepo.mThread->mHeaderMutex->lock();
+	LLMeshRepoThread::mesh_header_map::iterator iter = gMeshRepo.mThread->mMeshHeader.find(mesh_id);
+	if (iter != gMeshRepo.mThread->mMeshHeader.end())
+	{
+		header_bytes = (S32)iter->second.first;
+		header = iter->second.second;
 	}
-	else if (data && data_size > 0)
+
+	if (header_bytes > 0
+		&& !header.m404
+		&& (header.mVersion <= MAX_MESH_VERSION))
 	{
-		// header was successfully retrieved from sim and parsed and is in cache
-		S32 header_bytes = 0;
-		LLMeshHeader header;
+		std::stringstream str;
 
-		gMeshRepo.mThread->mHeaderMutex->lock();
-		LLMeshRepoThread::mesh_header_map::iterator iter = gMeshRepo.mThread->mMeshHeader.find(mesh_id);
-		if (iter != gMeshRepo.mThread->mMeshHeader.end())
-		{
-			header_bytes = (S32)iter->second.first;
-			header = iter->second.second;
-		}
+		S32 lod_bytes = 0;
 
-		if (header_bytes > 0
-			&& !header.m404
-			&& (header.mVersion <= MAX_MESH_VERSION))
+		for (U32 i = 0; i < LLModel::LOD_PHYSICS; ++i)
 		{
-			std::stringstream str;
+			// figure out how many bytes we'll need to reserve in the file
+			lod_bytes = llmax(lod_bytes, header.mLodOffset[i]+header.mLodSize[i]);
+		}
+	
+		// just in case skin info or decomposition is at the end of the file (which it shouldn't be)
+		lod_bytes = llmax(lod_bytes, header.mSkinOffset+header.mSkinSize);
+        lod_bytes = llmax(lod_bytes, header.mPhysicsConvexOffset + header.mPhysicsConvexSize);
 
-			S32 lod_bytes = 0;
+        // Do not unlock mutex untill we are done with LLSD.
+        // LLSD is smart and can work like smart pointer, is not thread safe.
+        gMeshRepo.mThread->mHeaderMutex->unlock();
 
-			for (U32 i = 0; i < LLModel::LOD_PHYSICS; ++i)
-			{
-				// figure out how many bytes we'll need to reserve in the file
-				lod_bytes = llmax(lod_bytes, header.mLodOffset[i]+header.mLodSize[i]);
-			}
-		
-			// just in case skin info or decomposition is at the end of the file (which it shouldn't be)
-			lod_bytes = llmax(lod_bytes, header.mSkinOffset+header.mSkinSize);
-            lod_bytes = llmax(lod_bytes, header.mPhysicsConvexOffset + header.mPhysicsConvexSize);
+		S32 bytes = lod_bytes + header_bytes; 
 
-            // Do not unlock mutex untill we are done with LLSD.
-            // LLSD is smart and can work like smart pointer, is not thread safe.
-            gMeshRepo.mThread->mHeaderMutex->unlock();
+	
+		// It's possible for the remote asset to have more data than is needed for the local cache
+		// only allocate as much space in the cache as is needed for the local cache
+		data_size = llmin(data_size, bytes);
 
-			S32 bytes = lod_bytes + header_bytes; 
+		// <FS:Ansariel> Fix asset caching
+		//LLFileSystem file(mesh_id, LLAssetType::AT_MESH, LLFileSystem::WRITE);
+		LLFileSystem file(mesh_id, LLAssetType::AT_MESH, LLFileSystem::READ_WRITE);
+		if (file.getMaxSize() >= bytes)
+		{
+			LLMeshRepository::sCacheBytesWritten += data_size;
+			++LLMeshRepository::sCacheWrites;
 
-		
-			// It's possible for the remote asset to have more data than is needed for the local cache
-			// only allocate as much space in the cache as is needed for the local cache
-			data_size = llmin(data_size, bytes);
+			file.write(data, data_size);
 
 			// <FS:Ansariel> Fix asset caching
-			//LLFileSystem file(mesh_id, LLAssetType::AT_MESH, LLFileSystem::WRITE);
-			LLFileSystem file(mesh_id, LLAssetType::AT_MESH, LLFileSystem::READ_WRITE);
-			if (file.getMaxSize() >= bytes)
+			S32 remaining = bytes - file.tell();
+			if (remaining > 0)
 			{
-				LLMeshRepository::sCacheBytesWritten += data_size;
-				++LLMeshRepository::sCacheWrites;
-
-				file.write(data, data_size);
-
-				// <FS:Ansariel> Fix asset caching
-				S32 remaining = bytes - file.tell();
-				if (remaining > 0)
+				U8* block = new(std::nothrow) U8[remaining];
+				if (block)
 				{
-					U8* block = new(std::nothrow) U8[remaining];
-					if (block)
-					{
-						memset(block, 0, remaining);
-						file.write(block, remaining);
-						delete[] block;
-					}
+					memset(block, 0, remaining);
+					file.write(block, remaining);
+					delete[] block;
 				}
-				// </FS:Ansariel>
 			}
+			// </FS:Ansariel>
 		}
-		else
+	}
+	else
+	{
+		LL_WARNS(LOG_MESH) << "Trying to cache nonexistent mesh, mesh id: " << mesh_id << LL_ENDL;
+
+		gMeshRepo.mThread->mHeaderMutex->unlock();
+
+		// headerReceived() parsed header, but header's data is invalid so none of the LODs will be available
+		LLMutexLock lock(gMeshRepo.mThread->mMutex);
+		for (int i(0); i < LLVolumeLODGroup::NUM_LODS; ++i)
 		{
-			LL_WARNS(LOG_MESH) << "Trying to cache nonexistent mesh, mesh id: " << mesh_id << LL_ENDL;
+			gMeshRepo.mThread->mUnavailableQ.emplace_back(mesh_params, i);
+		}
+	}
+}
 
-			gMeshRepo.mThread->mHeaderMutex->unlock();
+void LLMeshHeaderHandler::processData(LLCore::BufferArray * /* body */, S32 /* body_offset */,
+									  U8 * data, S32 data_size)
+{
+	const LLUUID& mesh_id = mMeshParams.getSculptID();
+    bool success = (!MESH_HEADER_PROCESS_FAILED)
+        && ((data != NULL) == (data_size > 0)); // if we have data but no size or have size but no data, something is wrong;
+	llassert(success);
+	mesh_data_ptr_t buffer = success ? copy_mesh_data(data, data_size) : nullptr;
+	if (buffer)
+	{
+		const LLVolumeParams mesh_params = mMeshParams;
+		gMeshRepo.mThread->postDecode(mesh_id, [mesh_params, buffer]()
+		{
+			LLMeshRepoThread* thread = gMeshRepo.mThread;
+			EMeshProcessingResult res = thread->headerReceived(mesh_params, buffer->data(), (S32)buffer->size());
+			if (res != MESH_OK)
+			{
+				// *TODO:  Get real reason for parse failure here.  Might we want to retry?
+				LL_WARNS(LOG_MESH) << "Unable to parse mesh header.  ID:  " << mesh_params.getSculptID()
+								   << ", Size: " << buffer->size()
+								   << ", Reason: " << res << " Not retrying."
+								   << LL_ENDL;
 
-			// headerReceived() parsed header, but header's data is invalid so none of the LODs will be available
-			LLMutexLock lock(gMeshRepo.mThread->mMutex);
-			for (int i(0); i < LLVolumeLODGroup::NUM_LODS; ++i)
+				// Can't get the header so none of the LODs will be available
+				LLMutexLock lock(thread->mMutex);
+				for (int i(0); i < LLVolumeLODGroup::NUM_LODS; ++i)
+				{
+					thread->mUnavailableQ.emplace_back(mesh_params, i);
+				}
+			}
+			else if (!buffer->empty())
 			{
-				gMeshRepo.mThread->mUnavailableQ.emplace_back(mMeshParams, i);
+				// header was successfully retrieved from sim and parsed, put it in cache
+				thread->postToRepoThread([mesh_params, buffer]()
+				{
+					cache_mesh_header(mesh_params, buffer->data(), (S32)buffer->size());
+				});
 			}
+		});
+	}
+	else
+	{
+		LL_WARNS(LOG_MESH) << "Unable to parse mesh header.  ID:  " << mesh_id
+						   << ", Size: " << data_size
+						   << ", Reason: " << MESH_UNKNOWN << " Not retrying."
+						   << LL_ENDL;
+
+		// Can't get the header so none of the LODs will be available
+		LLMutexLock lock(gMeshRepo.mThread->mMutex);
+		for (int i(0); i < LLVolumeLODGroup::NUM_LODS; ++i)
+		{
+			gMeshRepo.mThread->mUnavailableQ.emplace_back(mMeshParams, i);
 		}
 	}
 }
@@ -3232,39 +3458,43 @@ void LLMeshLODHandler::processFailure(LLCore::HttpStatus status)
 void LLMeshLODHandler::processData(LLCore::BufferArray * /* body */, S32 /* body_offset */,
 								   U8 * data, S32 data_size)
 {
+	mesh_data_ptr_t buffer;
 	if ((!MESH_LOD_PROCESS_FAILED)
 		&& ((data != NULL) == (data_size > 0))) // if we have data but no size or have size but no data, something is wrong
 	{
-		EMeshProcessingResult result = gMeshRepo.mThread->lodReceived(mMeshParams, mLOD, data, data_size);
-		if (result == MESH_OK)
-		{
-			// good fetch from sim, write to cache
-			// <FS:Ansariel> Fix asset caching
-			//LLFileSystem file(mMeshParams.getSculptID(), LLAssetType::AT_MESH, LLFileSystem::WRITE);
-			LLFileSystem file(mMeshParams.getSculptID(), LLAssetType::AT_MESH, LLFileSystem::READ_WRITE);
-
-			S32 offset = mOffset;
-			S32 size = mRequestedBytes;
+		buffer = copy_mesh_data(data, data_size);
+	}
 
-			if (file.getSize() >= offset+size)
+	if (buffer)
+	{
+		const LLVolumeParams mesh_params = mMeshParams;
+		const S32 lod = mLOD;
+		const S32 offset = mOffset;
+		const S32 size = mRequestedBytes;
+		gMeshRepo.mThread->postDecode(mesh_params.getSculptID(), [mesh_params, lod, offset, size, buffer]()
+		{
+			LLMeshRepoThread* thread = gMeshRepo.mThread;
+			EMeshProcessingResult result = thread->lodReceived(mesh_params, lod, buffer->data(), (S32)buffer->size());
+			if (result == MESH_OK)
 			{
-				file.seek(offset);
-				file.write(data, size);
-				LLMeshRepository::sCacheBytesWritten += size;
-				++LLMeshRepository::sCacheWrites;
+				// good fetch from sim, write to cache
+				thread->postToRepoThread([mesh_params, offset, size, buffer]()
+				{
+					write_mesh_range_to_cache(mesh_params.getSculptID(), offset, size, *buffer);
+				});
 			}
-		}
-		else
-		{
-			LL_WARNS(LOG_MESH) << "Error during mesh LOD processing.  ID:  " << mMeshParams.getSculptID()
-							   << ", Reason: " << result
-							   << " LOD: " << mLOD
-							   << " Data size: " << data_size
-							   << " Not retrying."
-							   << LL_ENDL;
-			LLMutexLock lock(gMeshRepo.mThread->mMutex);
-			gMeshRepo.mThread->mUnavailableQ.emplace_back(mMeshParams, mLOD);
-		}
+			else
+			{
+				LL_WARNS(LOG_MESH) << "Error during mesh LOD processing.  ID:  " << mesh_params.getSculptID()
+								   << ", Reason: " << result
+								   << " LOD: " << lod
+								   << " Data size: " << buffer->size()
+								   << " Not retrying."
+								   << LL_ENDL;
+				LLMutexLock lock(thread->mMutex);
+				thread->mUnavailableQ.emplace_back(mesh_params, lod);
+			}
+		});
 	}
 	else
 	{
@@ -3299,33 +3529,46 @@ void LLMeshSkinInfoHandler::processFailure(LLCore::HttpStatus status)
 void LLMeshSkinInfoHandler::processData(LLCore::BufferArray * /* body */, S32 /* body_offset */,
 										U8 * data, S32 data_size)
 {
+	mesh_data_ptr_t buffer;
 	if ((!MESH_SKIN_INFO_PROCESS_FAILED)
-		&& ((data != NULL) == (data_size > 0)) // if we have data but no size or have size but no data, something is wrong
-		&& gMeshRepo.mThread->skinInfoReceived(mMeshID, data, data_size) == MESH_OK)
+		&& ((data != NULL) == (data_size > 0))) // if we have data but no size or have size but no data, something is wrong
 	{
-		// good fetch from sim, write to cache
-		// <FS:Ansariel> Fix asset caching
-		//LLFileSystem file(mMeshID, LLAssetType::AT_MESH, LLFileSystem::WRITE);
-		LLFileSystem file(mMeshID, LLAssetType::AT_MESH, LLFileSystem::READ_WRITE);
-
-		S32 offset = mOffset;
-		S32 size = mRequestedBytes;
+		buffer = copy_mesh_data(data, data_size);
+	}
 
-		if (file.getSize() >= offset+size)
+	const LLUUID mesh_id = mMeshID;
+	if (buffer)
+	{
+		const S32 offset = mOffset;
+		const S32 size = mRequestedBytes;
+		gMeshRepo.mThread->postDecode(mesh_id, [mesh_id, offset, size, buffer]()
 		{
-			LLMeshRepository::sCacheBytesWritten += size;
-			++LLMeshRepository::sCacheWrites;
-			file.seek(offset);
-			file.write(data, size);
-		}
+			LLMeshRepoThread* thread = gMeshRepo.mThread;
+			if (thread->skinInfoReceived(mesh_id, buffer->data(), (S32)buffer->size()) == MESH_OK)
+			{
+				// good fetch from sim, write to cache
+				thread->postToRepoThread([mesh_id, offset, size, buffer]()
+				{
+					write_mesh_range_to_cache(mesh_id, offset, size, *buffer);
+				});
+			}
+			else
+			{
+				LL_WARNS(LOG_MESH) << "Error during mesh skin info processing.  ID:  " << mesh_id
+								   << ", Unknown reason.  Not retrying."
+								   << LL_ENDL;
+				LLMutexLock lock(thread->mMutex);
+				thread->mSkinUnavailableQ.emplace_back(mesh_id);
+			}
+		});
 	}
 	else
 	{
-		LL_WARNS(LOG_MESH) << "Error during mesh skin info processing.  ID:  " << mMeshID
+		LL_WARNS(LOG_MESH) << "Error during mesh skin info processing.  ID:  " << mesh_id
 						   << ", Unknown reason.  Not retrying."
 						   << LL_ENDL;
 		LLMutexLock lock(gMeshRepo.mThread->mMutex);
-		gMeshRepo.mThread->mSkinUnavailableQ.emplace_back(mMeshID);
+		gMeshRepo.mThread->mSkinUnavailableQ.emplace_back(mesh_id);
 	}
 }
 
@@ -3350,29 +3593,41 @@ void LLMeshDecompositionHandler::processFailure(LLCore::HttpStatus status)
 void LLMeshDecompositionHandler::processData(LLCore::BufferArray * /* body */, S32 /* body_offset */,
 											 U8 * data, S32 data_size)
 {
+	mesh_data_ptr_t buffer;
 	if ((!MESH_DECOMP_PROCESS_FAILED)
-		&& ((data != NULL) == (data_size > 0)) // if we have data but no size or have size but no data, something is wrong
-		&& gMeshRepo.mThread->decompositionReceived(mMeshID, data, data_size) == MESH_OK)
+		&& ((data != NULL) == (data_size > 0))) // if we have data but no size or have size but no data, something is wrong
 	{
-		// good fetch from sim, write to cache
-		// <FS:Ansariel> Fix asset caching
-		//LLFileSystem file(mMeshID, LLAssetType::AT_MESH, LLFileSystem::WRITE);
-		LLFileSystem file(mMeshID, LLAssetType::AT_MESH, LLFileSystem::READ_WRITE);
-
-		S32 offset = mOffset;
-		S32 size = mRequestedBytes;
+		buffer = copy_mesh_data(data, data_size);
+	}
 
-		if (file.getSize() >= offset+size)
+	const LLUUID mesh_id = mMeshID;
+	if (buffer)
+	{
+		const S32 offset = mOffset;
+		const S32 size = mRequestedBytes;
+		gMeshRepo.mThread->postDecode(mesh_id, [mesh_id, offset, size, buffer]()
 		{
-			LLMeshRepository::sCacheBytesWritten += size;
-			++LLMeshRepository::sCacheWrites;
-			file.seek(offset);
-			file.write(data, size);
-		}
+			LLMeshRepoThread* thread = gMeshRepo.mThread;
+			if (thread->decompositionReceived(mesh_id, buffer->data(), (S32)buffer->size()) == MESH_OK)
+			{
+				// good fetch from sim, write to cache
+				thread->postToRepoThread([mesh_id, offset, size, buffer]()
+				{
+					write_mesh_range_to_cache(mesh_id, offset, size, *buffer);
+				});
+			}
+			else
+			{
+				LL_WARNS(LOG_MESH) << "Error during mesh decomposition processing.  ID:  " << mesh_id
+								   << ", Unknown reason.  Not retrying."
+								   << LL_ENDL;
+				// *TODO:  Mark mesh unavailable on error
+			}
+		});
 	}
 	else
 	{
-		LL_WARNS(LOG_MESH) << "Error during mesh decomposition processing.  ID:  " << mMeshID
+		LL_WARNS(LOG_MESH) << "Error during mesh decomposition processing.  ID:  " << mesh_id
 						   << ", Unknown reason.  Not retrying."
 						   << LL_ENDL;
 		// *TODO:  Mark mesh unavailable on error
@@ -3399,29 +3654,41 @@ void LLMeshPhysicsShapeHandler::processFailure(LLCore::HttpStatus status)
 void LLMeshPhysicsShapeHandler::processData(LLCore::BufferArray * /* body */, S32 /* body_offset */,
 											U8 * data, S32 data_size)
 {
+	mesh_data_ptr_t buffer;
 	if ((!MESH_PHYS_SHAPE_PROCESS_FAILED)
-		&& ((data != NULL) == (data_size > 0)) // if we have data but no size or have size but no data, something is wrong
-		&& gMeshRepo.mThread->physicsShapeReceived(mMeshID, data, data_size) == MESH_OK)
+		&& ((data != NULL) == (data_size > 0))) // if we have data but no size or have size but no data, something is wrong
 	{
-		// good fetch from sim, write to cache for caching
-		// <FS:Ansariel> Fix asset caching
-		//LLFileSystem file(mMeshID, LLAssetType::AT_MESH, LLFileSystem::WRITE);
-		LLFileSystem file(mMeshID, LLAssetType::AT_MESH, LLFileSystem::READ_WRITE);
-
-		S32 offset = mOffset;
-		S32 size = mRequestedBytes;
+		buffer = copy_mesh_data(data, data_size);
+	}
 
-		if (file.getSize() >= offset+size)
+	const LLUUID mesh_id = mMeshID;
+	if (buffer)
+	{
+		const S32 offset = mOffset;
+		const S32 size = mRequestedBytes;
+		gMeshRepo.mThread->postDecode(mesh_id, [mesh_id, offset, size, buffer]()
 		{
-			LLMeshRepository::sCacheBytesWritten += size;
-			++LLMeshRepository::sCacheWrites;
-			file.seek(offset);
-			file.write(data, size);
-		}
+			LLMeshRepoThread* thread = gMeshRepo.mThread;
+			if (thread->physicsShapeReceived(mesh_id, buffer->data(), (S32)buffer->size()) == MESH_OK)
+			{
+				// good fetch from sim, write to cache for caching
+				thread->postToRepoThread([mesh_id, offset, size, buffer]()
+				{
+					write_mesh_range_to_cache(mesh_id, offset, size, *buffer);
+				});
+			}
+			else
+			{
+				LL_WARNS(LOG_MESH) << "Error during mesh physics shape processing.  ID:  " << mesh_id
+								   << ", Unknown reason.  Not retrying."
+								   << LL_ENDL;
+				// *TODO:  Mark mesh unavailable on error
+			}
+		});
 	}
 	else
 	{
-		LL_WARNS(LOG_MESH) << "Error during mesh physics shape processing.  ID:  " << mMeshID
+		LL_WARNS(LOG_MESH) << "Error during mesh physics shape processing.  ID:  " << mesh_id
 						   << ", Unknown reason.  Not retrying."
 						   << LL_ENDL;
 		// *TODO:  Mark mesh unavailable on error
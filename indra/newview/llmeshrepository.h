@@ -40,6 +40,7 @@
 #include "httpheaders.h"
 #include "httphandler.h"
 #include "llthread.h"
+#include "threadpool_fwd.h"
 
 #include "boost/unordered/unordered_map.hpp"
 #include "boost/unordered/unordered_flat_map.hpp"
@@ -270,6 +271,21 @@ class LLMeshRepoThread final : public LLThread
 	LLMutex*	mHeaderMutex;
 	LLCondition* mSignal;
 
+	typedef std::function<void()> work_t;
+	typedef std::function<EMeshProcessingResult(const U8* data, S32 data_size)> decode_fn_t;
+
+	// Decoding of fetched and cached mesh data (inflate, LLSD parse, volume
+	// unpacking) runs on this pool so it scales with cores while HTTP stays
+	// on this thread. Work for one mesh ID runs one item at a time, in the
+	// order it was posted.
+	std::unique_ptr<LL::ThreadPool> mDecodePool;
+	LLMutex mDecodeMutex;
+	boost::unordered_flat_map<LLUUID, std::deque<work_t>> mDecodeQueues;
+
+	// Follow-up work the decode pool hands back to this thread (cache
+	// writes, HTTP requests). Guarded by mMutex.
+	std::deque<work_t> mRepoWorkQ;
+
 	//map of known mesh headers
 	typedef boost::unordered_flat_map<LLUUID, std::pair<U32, LLMeshHeader>> mesh_header_map;
 	mesh_header_map mMeshHeader;
@@ -424,18 +440,24 @@ class LLMeshRepoThread final : public LLThread
 	void lockAndLoadMeshLOD(const LLVolumeParams& mesh_params, S32 lod);
 	void loadMeshLOD(const LLVolumeParams& mesh_params, S32 lod);
 
-	bool fetchMeshHeader(const LLVolumeParams& mesh_params, bool can_retry = true);
-	bool fetchMeshLOD(const LLVolumeParams& mesh_params, S32 lod, bool can_retry = true);
-	EMeshProcessingResult headerReceived(const LLVolumeParams& mesh_params, U8* data, S32 data_size);
-	EMeshProcessingResult lodReceived(const LLVolumeParams& mesh_params, S32 lod, U8* data, S32 data_size);
-	EMeshProcessingResult skinInfoReceived(const LLUUID& mesh_id, U8* data, S32 data_size);
-	EMeshProcessingResult decompositionReceived(const LLUUID& mesh_id, U8* data, S32 data_size);
-	EMeshProcessingResult physicsShapeReceived(const LLUUID& mesh_id, U8* data, S32 data_size);
+	bool fetchMeshHeader(const LLVolumeParams& mesh_params, bool can_retry = true, bool check_cache = true);
+	bool fetchMeshLOD(const LLVolumeParams& mesh_params, S32 lod, bool can_retry = true, bool check_cache = true);
+	EMeshProcessingResult headerReceived(const LLVolumeParams& mesh_params, const U8* data, S32 data_size);
+	EMeshProcessingResult lodReceived(const LLVolumeParams& mesh_params, S32 lod, const U8* data, S32 data_size);
+	EMeshProcessingResult skinInfoReceived(const LLUUID& mesh_id, const U8* data, S32 data_size);
+	EMeshProcessingResult decompositionReceived(const LLUUID& mesh_id, const U8* data, S32 data_size);
+	EMeshProcessingResult physicsShapeReceived(const LLUUID& mesh_id, const U8* data, S32 data_size);
 	bool hasPhysicsShapeInHeader(const LLUUID& mesh_id);
     bool hasSkinInfoInHeader(const LLUUID& mesh_id);
     bool hasHeader(const LLUUID& mesh_id);
 
-	bool loadInfoFromFilesystem(const LLUUID& mesh_id, MeshHeaderInfo& info, boost::function<bool(const LLUUID&, U8*, S32)> fn);
+	// Returns true if the data is in the cache and was queued for decoding
+	// with decode. on_failure runs on this thread if decoding fails.
+	bool loadInfoFromFilesystem(const LLUUID& mesh_id, MeshHeaderInfo& info, decode_fn_t decode, work_t on_failure);
+
+	// Threads:  any
+	void postDecode(const LLUUID& mesh_id, work_t&& work);
+	void postToRepoThread(work_t&& work);
 
 	void notifyLoadedMeshes(); // Only call from main thread.
 	S32 getActualMeshLOD(const LLVolumeParams& mesh_params, S32 lod);
@@ -446,15 +468,15 @@ class LLMeshRepoThread final : public LLThread
 
 	//send request for skin info, returns true if header info exists 
 	//  (should hold onto mesh_id and try again later if header info does not exist)
-	bool fetchMeshSkinInfo(const LLUUID& mesh_id, bool can_retry = true);
+	bool fetchMeshSkinInfo(const LLUUID& mesh_id, bool can_retry = true, bool check_cache = true);
 
 	//send request for decomposition, returns true if header info exists 
 	//  (should hold onto mesh_id and try again later if header info does not exist)
-	bool fetchMeshDecomposition(const LLUUID& mesh_id);
+	bool fetchMeshDecomposition(const LLUUID& mesh_id, bool check_cache = true);
 
 	//send request for PhysicsShape, returns true if header info exists 
 	//  (should hold onto mesh_id and try again later if header info does not exist)
-	bool fetchMeshPhysicsShape(const LLUUID& mesh_id);
+	bool fetchMeshPhysicsShape(const LLUUID& mesh_id, bool check_cache = true);
 
 	static void incActiveLODRequests();
 	static void decActiveLODRequests();
@@ -471,6 +493,9 @@ class LLMeshRepoThread final : public LLThread
 	void constructUrl(LLUUID mesh_id, std::string * url, int * legacy_version);
 
 private:
+	// Runs the decode work queued for mesh_id until there is none left
+	void runDecodeQueue(const LLUUID& mesh_id);
+
 	// Issue a GET request to a URL with 'Range' header using
 	// the correct policy class and other attributes.  If an invalid
 	// handle is returned, the request failed and caller must retry
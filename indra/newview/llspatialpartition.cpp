@@ -1074,6 +1074,18 @@ class LLOctreeCull : public LLViewerOctreeCull
 		return res;
 	}
 
+	virtual void frustumCheckBatch(const LLViewerOctreeGroup* const* groups, U32 count, S32* results)
+	{
+		AABBInFrustumNoFarClipGroupBounds(groups, count, results);
+		for (U32 i = 0; i < count; i++)
+		{
+			if (results[i] != 0)
+			{
+				results[i] = llmin(results[i], AABBSphereIntersectGroupExtents(groups[i]));
+			}
+		}
+	}
+
 	virtual S32 frustumCheckObjects(const LLViewerOctreeGroup* group)
 	{
 		S32 res = AABBInFrustumNoFarClipObjectBounds(group);
@@ -1107,6 +1119,11 @@ class LLOctreeCullNoFarClip : public LLOctreeCull
 		return AABBInFrustumNoFarClipGroupBounds(group);
 	}
 
+	virtual void frustumCheckBatch(const LLViewerOctreeGroup* const* groups, U32 count, S32* results)
+	{
+		AABBInFrustumNoFarClipGroupBounds(groups, count, results);
+	}
+
 	virtual S32 frustumCheckObjects(const LLViewerOctreeGroup* group)
 	{
 		S32 res = AABBInFrustumNoFarClipObjectBounds(group);
@@ -1125,12 +1142,40 @@ class LLOctreeCullShadow : public LLOctreeCull
 		return AABBInFrustumGroupBounds(group);
 	}
 
+	virtual void frustumCheckBatch(const LLViewerOctreeGroup* const* groups, U32 count, S32* results)
+	{
+		AABBInFrustumGroupBounds(groups, count, results);
+	}
+
 	virtual S32 frustumCheckObjects(const LLViewerOctreeGroup* group)
 	{
 		return AABBInFrustumObjectBounds(group);
 	}
 };
 
+// Gathers the groups a culler would mark instead of marking them, so the
+// traversal can run off the main thread.  Only valid when occlusion culling is
+// off, in which case earlyFail() never fails and has no side effects.
+template <class CULL>
+class LLOctreeCullCollect : public CULL
+{
+public:
+	LLOctreeCullCollect(LLCamera* camera, std::vector<LLSpatialGroup*>& groups)
+		: CULL(camera), mGroups(groups) { }
+
+	virtual bool earlyFail(LLViewerOctreeGroup* group)
+	{
+		return false;
+	}
+
+	virtual void processGroup(LLViewerOctreeGroup* group)
+	{
+		mGroups.push_back((LLSpatialGroup*)group);
+	}
+
+	std::vector<LLSpatialGroup*>& mGroups;
+};
+
 class LLOctreeCullVisExtents: public LLOctreeCullShadow
 {
 public:
@@ -1472,6 +1517,34 @@ S32 LLSpatialPartition::cull(LLCamera &camera, bool do_occlusion)
 	return 0;
 }
 
+void LLSpatialPartition::prepareCull()
+{
+	LLSpatialGroup* group = (LLSpatialGroup*) mOctree->getListener(0);
+	group->rebound();
+}
+
+void LLSpatialPartition::collectCull(LLCamera &camera, std::vector<LLSpatialGroup*>& groups)
+{
+	LL_PROFILE_ZONE_SCOPED_CATEGORY_SPATIAL;
+	llassert(LLPipeline::sUseOcclusion == 0);
+
+	if (LLPipeline::sShadowRender)
+	{
+		LLOctreeCullCollect<LLOctreeCullShadow> culler(&camera, groups);
+		culler.traverse(mOctree);
+	}
+	else if (mInfiniteFarClip || (!LLPipeline::sUseFarClip && !gCubeSnapshot))
+	{
+		LLOctreeCullCollect<LLOctreeCullNoFarClip> culler(&camera, groups);
+		culler.traverse(mOctree);
+	}
+	else
+	{
+		LLOctreeCullCollect<LLOctreeCull> culler(&camera, groups);
+		culler.traverse(mOctree);
+	}
+}
+
 void pushVerts(LLDrawInfo* params)
 {
 	LLRenderPass::applyModelMatrix(*params);
@@ -400,6 +400,10 @@ class LLSpatialPartition: public LLViewerOctreePartition, public LLGeometryManag
 
 	BOOL visibleObjectsInFrustum(LLCamera& camera);
 	/*virtual*/ S32 cull(LLCamera &camera, bool do_occlusion=false); // Cull on arbitrary frustum
+	// Split cull for passes without occlusion culling: prepareCull() must run on the main
+	// thread, after which collectCull() only reads the octree and may run on any thread
+	void prepareCull();
+	void collectCull(LLCamera &camera, std::vector<LLSpatialGroup*>& groups);
 	S32 cull(LLCamera &camera, std::vector<LLDrawable *>* results, BOOL for_select); // Cull on arbitrary frustum
 	
 	BOOL isVisible(const LLVector3& v);
@@ -669,6 +673,20 @@ class LLVolumeGeometryManager: public LLGeometryManager
 	void allocateFaces(U32 pMaxFaceCount);
 	void freeFaces();
 
+	// fill the vertex buffers of faces deferred by genDrawInfo as parallel
+	// jobs, then send the buffers to GL
+	void generatePendingGeometry();
+
+	struct PendingGeometry
+	{
+		LLFace* mFace;
+		U16 mIndexOffset;
+	};
+
+	static bool sDeferGeometry;
+	static std::vector<PendingGeometry> sPendingGeometry;
+	static std::vector<LLPointer<LLVertexBuffer> > sPendingBuffers;
+
 	static int32_t sInstanceCount;
 	static LLFace** sFullbrightFaces[2];
 	static LLFace** sBumpFaces[2];
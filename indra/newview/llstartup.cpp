@@ -659,6 +659,11 @@ bool idle_startup()
 				msg->mPacketRing.setUseOutThrottle(TRUE);
 				msg->mPacketRing.setOutBandwidth(outBandwidth);
 			}
+
+			if (gSavedSettings.getBOOL("NetworkReceiveThread"))
+			{
+				msg->startReceiveThread();
+			}
 		}
 
 		LL_INFOS("AppInit") << "Message System Initialized." << LL_ENDL;
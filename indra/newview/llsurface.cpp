@@ -751,13 +751,20 @@ void LLSurface::decompressDCTPatch(LLBitPack &bitpack, LLGroupHeader *gopp, BOOL
 
 	LLPatchHeader  ph;
 	S32 j, i;
-	S32 patch[LARGE_PATCH_SIZE*LARGE_PATCH_SIZE];
 	LLSurfacePatch *patchp;
 
 	init_patch_decompressor(gopp->patch_size);
 	gopp->stride = mGridsPerEdge;
 	set_group_of_patch_header(gopp);
 
+	// Pull every patch of the message off the bit stream first, then run the
+	// inverse transforms together and apply the heights in message order.
+	const S32 coefs_per_patch = gopp->patch_size*gopp->patch_size;
+	std::vector<S32> coefs;
+	std::vector<LLPatchHeader> headers;
+	std::vector<LLSurfacePatch*> patches;
+	std::vector<S32> slots(mNumberOfPatches, -1);
+
 	while (1)
 	{
 		decode_patch_header(bitpack, &ph, b_large_patch);
@@ -788,15 +795,43 @@ void LLSurface::decompressDCTPatch(LLBitPack &bitpack, LLGroupHeader *gopp, BOOL
 				<< " quant_wbits " << (S32)ph.quant_wbits
 				<< " patchids " << (S32)ph.patchids
 				<< LL_ENDL;
-			return;
+			break;
+		}
+
+		// A patch sent twice in one message keeps its last data, as it
+		// would have when each patch was applied as soon as it was read.
+		S32 patch_index = j*mPatchesPerEdge + i;
+		S32 slot = slots[patch_index];
+		if (slot < 0)
+		{
+			slot = (S32)patches.size();
+			slots[patch_index] = slot;
+			patches.push_back(&mPatchList[patch_index]);
+			headers.push_back(ph);
+			coefs.resize(coefs.size() + coefs_per_patch);
+		}
+		else
+		{
+			headers[slot] = ph;
 		}
 
-		patchp = &mPatchList[j*mPatchesPerEdge + i];
+		decode_patch(bitpack, &coefs[slot*coefs_per_patch]);
+	}
 
+	if (patches.empty())
+	{
+		return;
+	}
 
-		decode_patch(bitpack, patch);
-		decompress_patch(patchp->getDataZ(), patch, &ph);
+	std::vector<F32*> outputs(patches.size());
+	for (size_t k = 0; k < patches.size(); ++k)
+	{
+		outputs[k] = patches[k]->getDataZ();
+	}
+	decompress_patches(outputs.data(), coefs.data(), headers.data(), (S32)patches.size());
 
+	for (LLSurfacePatch* patchp : patches)
+	{
 		// Update edges for neighbors.  Need to guarantee that this gets done before we generate vertical stats.
 		patchp->updateNorthEdge();
 		patchp->updateEastEdge();
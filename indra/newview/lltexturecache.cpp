@@ -38,14 +38,33 @@
 // Included to allow LLTextureCache::purgeTextures() to pause watchdog timeout
 #include "llappviewer.h" 
 #include "llmemory.h"
+#include "workqueue.h"
+
+#ifdef LL_USESYSTEMLIBS
+#include <zlib.h>
+#else
+#include "zlib/zlib.h"
+#endif
+
+#include "boost/unordered/unordered_flat_set.hpp"
+
+#if LL_WINDOWS
+#include "llwin32headerslean.h"
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
 
 // Cache organization:
 // cache/texture.entries
-//  Unordered array of Entry structs
+//  Memory mapped open addressing hash table of Entry structs keyed by UUID
 // cache/texture.cache
-//  First TEXTURE_CACHE_ENTRY_SIZE bytes of each texture in texture.entries in same order
+//  First TEXTURE_CACHE_ENTRY_SIZE bytes of each texture, at the record index stored with its entry
 // cache/textures/[0-F]/UUID.texture
 //  Actual texture body files
+// cache/textures/[0-F]/UUID.mip
+//  Optional deflated raw mip of the texture, see writeToMipCache()
 
 //note: there is no good to define 1024 for TEXTURE_CACHE_ENTRY_SIZE while FIRST_PACKET_SIZE is 600 on sim side.
 const S32 TEXTURE_CACHE_ENTRY_SIZE = FIRST_PACKET_SIZE;//1024;
@@ -56,6 +75,20 @@ const S32 TEXTURE_FAST_CACHE_DATA_SIZE = 16 * 16 * 4;
 const S32 TEXTURE_FAST_CACHE_ENTRY_SIZE = TEXTURE_FAST_CACHE_DATA_SIZE + TEXTURE_FAST_CACHE_ENTRY_OVERHEAD;
 const F32 TEXTURE_LAZY_PURGE_TIME_LIMIT = .004f; // 4ms. Would be better to autoadjust, but there is a major cache rework in progress.
 const F32 TEXTURE_PRUNING_MAX_TIME = 15.f;
+const U32 TEXTURE_CACHE_MIN_BUCKETS = 1024;
+const U32 TEXTURE_MIP_CACHE_MAGIC = 0x3150494d; // 'MIP1'
+const S32 TEXTURE_MIP_CACHE_MAX_DATA_SIZE = 2048 * 2048 * 4;
+
+// Header of a cache/textures/[0-F]/UUID.mip file, followed by the deflated pixels
+struct MipCacheHeader
+{
+	U32 mMagic;
+	S32 mWidth;
+	S32 mHeight;
+	S32 mComponents;
+	S32 mDiscardLevel;
+	S32 mCompressedSize;
+};
 
 class LLTextureCacheWorker : public LLWorkerClass
 {
@@ -798,10 +831,17 @@ LLTextureCache::LLTextureCache(bool threaded)
 	  mHeaderMutex(),
 	  mListMutex(),
 	  mFastCacheMutex(),
-	  mHeaderAPRFile(NULL),
 	  mPrioritizeWriteListEmpty(true),
 	  mCompletedListEmpty(true),
 	  mReadOnly(TRUE), //do not allow to change the texture cache until setReadOnly() is called.
+	  mHeaderTablep(NULL),
+	  mHeaderTableSize(0),
+	  mHeaderTableMapped(false),
+	  mHeaderEntriesInfop(NULL),
+	  mHeaderTableInfop(NULL),
+	  mBuckets(NULL),
+	  mBucketMask(0),
+	  mUsedBuckets(0),
 	  mTexturesSizeTotal(0),
 	  mDoPurge(FALSE),
 	  mFastCachep(NULL),
@@ -814,7 +854,9 @@ LLTextureCache::LLTextureCache(bool threaded)
 LLTextureCache::~LLTextureCache()
 {
 	clearDeleteList() ;
-	writeUpdatedEntries() ;
+	lockHeaders() ;
+	closeHeaderTable(true) ;
+	unlockHeaders() ;
 	delete mFastCachep;
 	delete mFastCachePoolp;
 	delete mHeaderAPRFilePoolp;
@@ -857,7 +899,9 @@ size_t LLTextureCache::update(F32 max_time_ms)
 	if(!res && timer.getElapsedTimeF32() > MAX_TIME_INTERVAL)
 	{
 		timer.reset() ;
-		writeUpdatedEntries() ;
+		lockHeaders() ;
+		flushHeaderTable(false) ;
+		unlockHeaders() ;
 	}
 
 	return res;
@@ -881,13 +925,18 @@ std::string LLTextureCache::getTextureFileName(const LLUUID& id)
 	return fmt::format(FMT_COMPILE("{}{}{}{}{}.texture"), mTexturesDirName, delem, std::string_view(&idstr[0], 1), delem, idstr);
 }
 
+std::string LLTextureCache::getMipFileName(const LLUUID& id)
+{
+	std::string idstr = id.asString();
+	const std::string& delem = gDirUtilp->getDirDelimiter();
+	return fmt::format(FMT_COMPILE("{}{}{}{}{}.mip"), mTexturesDirName, delem, std::string_view(&idstr[0], 1), delem, idstr);
+}
+
 //debug
 BOOL LLTextureCache::isInCache(const LLUUID& id) 
 {
 	LLMutexLock lock(&mHeaderMutex);
-	id_map_t::const_iterator iter = mHeaderIDMap.find(id);
-	
-	return (iter != mHeaderIDMap.end()) ;
+	return findBucket(id) != NULL;
 }
 
 //debug
@@ -932,7 +981,7 @@ BOOL LLTextureCache::isInLocal(const LLUUID& id)
 //////////////////////////////////////////////////////////////////////////////
 
 //static
-F32 LLTextureCache::sHeaderCacheVersion = 1.71f;
+F32 LLTextureCache::sHeaderCacheVersion = 1.72f;
 U32 LLTextureCache::sCacheMaxEntries = 1024 * 1024; //~1 million textures.
 S64 LLTextureCache::sCacheMaxTexturesSize = 0; // no limit
 std::string LLTextureCache::sHeaderCacheEncoderVersion = LLImageJ2C::getEngineInfo();
@@ -965,7 +1014,6 @@ void LLTextureCache::purgeCache(ELLPath location, bool remove_dir)
 	if (!mReadOnly)
 	{
 		setDirNames(location);
-		llassert_always(mHeaderAPRFile == NULL);
 
 		//remove the legacy cache if exists
 		std::string texture_dir = mTexturesDirName ;
@@ -1000,10 +1048,12 @@ S64 LLTextureCache::initCache(ELLPath location, S64 max_size, BOOL texture_cache
 {
 	llassert_always(getPending() == 0) ; //should not start accessing the texture cache before initialized.
 
+	// texture.entries keeps between 4/3 and 8/3 buckets per entry
+	const S64 entry_size = (S64)(TEXTURE_CACHE_ENTRY_SIZE + TEXTURE_FAST_CACHE_ENTRY_SIZE + 3 * sizeof(Bucket));
 	S64 entries_size = (max_size * 36) / 100; //0.36 * max_size
-	S64 max_entries = entries_size / (S64)(TEXTURE_CACHE_ENTRY_SIZE + TEXTURE_FAST_CACHE_ENTRY_SIZE);
+	S64 max_entries = entries_size / entry_size;
 	sCacheMaxEntries = (U32)(llmin((S64)sCacheMaxEntries, max_entries));
-	entries_size = (S64)sCacheMaxEntries * (S64)(TEXTURE_CACHE_ENTRY_SIZE + TEXTURE_FAST_CACHE_ENTRY_SIZE);
+	entries_size = (S64)sCacheMaxEntries * entry_size;
 	max_size -= entries_size;
 	if (sCacheMaxTexturesSize > 0)
 		sCacheMaxTexturesSize = llmin(sCacheMaxTexturesSize, max_size);
@@ -1051,69 +1101,427 @@ S64 LLTextureCache::initCache(ELLPath location, S64 max_size, BOOL texture_cache
 //----------------------------------------------------------------------------
 // mHeaderMutex must be locked for the following functions!
 
-LLAPRFile* LLTextureCache::openHeaderEntriesFile(bool readonly, S32 offset)
+// The bucket a UUID starts probing from. The table is persistent, so this
+// must never change without bumping sHeaderCacheVersion.
+static U32 bucket_hash(const LLUUID& id)
+{
+	U64 lo, hi;
+	memcpy(&lo, id.mData, sizeof(U64));
+	memcpy(&hi, id.mData + sizeof(U64), sizeof(U64));
+	return (U32)(((lo ^ hi) * 0x9E3779B97F4A7C15ull) >> 32);
+}
+
+void LLTextureCache::setEntriesHeader(EntriesInfo& info)
+{
+	if (sHeaderEncoderStringSize < sHeaderCacheEncoderVersion.size() + 1)
+	{
+		// For simplicity we use predefined size of header, so if version string
+		// doesn't fit, either getEngineInfo() returned malformed string or 
+		// sHeaderEncoderStringSize need to be increased.
+		// Also take into accout that c_str() returns additional null character
+		LL_ERRS() << "Version string doesn't fit in header" << LL_ENDL;
+	}
+
+	info.mVersion = sHeaderCacheVersion;
+	info.mAdressSize = sHeaderCacheAddressSize;
+	strcpy(info.mEncoderVersion, sHeaderCacheEncoderVersion.c_str());
+	info.mEntries = 0;
+}
+
+U32 LLTextureCache::getDesiredBucketCount() const
 {
-	llassert_always(mHeaderAPRFile == NULL);
-	apr_int32_t flags = readonly ? APR_READ|APR_BINARY : APR_READ|APR_WRITE|APR_BINARY;
-	mHeaderAPRFile = new LLAPRFile(mHeaderEntriesFileName, flags, mHeaderAPRFilePoolp);
-	if(offset > 0)
+	// Keep the load factor at 3/4 or less so that probe sequences stay short
+	const U64 wanted = ((U64)sCacheMaxEntries * 4) / 3;
+	U32 bucket_count = TEXTURE_CACHE_MIN_BUCKETS;
+	while (bucket_count < wanted)
 	{
-		mHeaderAPRFile->seek(APR_SET, offset);
+		bucket_count <<= 1;
 	}
-	return mHeaderAPRFile;
+	return bucket_count;
 }
 
-void LLTextureCache::closeHeaderEntriesFile()
+bool LLTextureCache::mapHeaderTable(size_t size)
 {
-	if(!mHeaderAPRFile)
+	llassert_always(mHeaderTablep == NULL);
+
+	// In read only mode the mapping is copy on write so the table can still
+	// be updated in memory.
+#if LL_WINDOWS
+	HANDLE file = CreateFileW(ll_convert_string_to_wide(mHeaderEntriesFileName).c_str(),
+							  mReadOnly ? GENERIC_READ : GENERIC_READ | GENERIC_WRITE,
+							  FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+							  nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
 	{
-		return ;
+		return false;
+	}
+
+	HANDLE mapping = CreateFileMappingW(file, nullptr, mReadOnly ? PAGE_WRITECOPY : PAGE_READWRITE, 0, 0, nullptr);
+	CloseHandle(file);
+	if (!mapping)
+	{
+		return false;
+	}
+
+	// The view keeps the mapping object alive
+	void* view = MapViewOfFile(mapping, mReadOnly ? FILE_MAP_COPY : FILE_MAP_WRITE, 0, 0, size);
+	CloseHandle(mapping);
+	if (!view)
+	{
+		return false;
+	}
+#else
+	int fd = ::open(mHeaderEntriesFileName.c_str(), (mReadOnly ? O_RDONLY : O_RDWR) | O_CLOEXEC);
+	if (fd < 0)
+	{
+		return false;
 	}
 
-	delete mHeaderAPRFile;
-	mHeaderAPRFile = NULL;
+	void* view = mmap(nullptr, size, PROT_READ | PROT_WRITE, mReadOnly ? MAP_PRIVATE : MAP_SHARED, fd, 0);
+	::close(fd);
+	if (view == MAP_FAILED)
+	{
+		return false;
+	}
+#endif
+
+	mHeaderTablep = (U8*)view;
+	mHeaderTableSize = size;
+	mHeaderTableMapped = true;
+	mHeaderEntriesInfop = (EntriesInfo*)mHeaderTablep;
+	mHeaderTableInfop = (TableInfo*)(mHeaderTablep + sizeof(EntriesInfo));
+	mBuckets = (Bucket*)(mHeaderTablep + sizeof(EntriesInfo) + sizeof(TableInfo));
+	mBucketMask = mHeaderTableInfop->mBucketCount - 1;
+	return true;
 }
 
-void LLTextureCache::readEntriesHeader()
+// Maps an existing texture.entries. Returns false if there is none or it
+// does not match this viewer, in which case the cache has to be purged.
+bool LLTextureCache::openHeaderTable()
 {
-	// mHeaderEntriesInfo initializes to default values so safe not to read it
-	llassert_always(mHeaderAPRFile == NULL);
-	if (LLAPRFile::isExist(mHeaderEntriesFileName, mHeaderAPRFilePoolp))
+	llassert_always(mHeaderTablep == NULL);
+
+	// Check what is on disk before mapping it, touching a mapped page past
+	// the end of a truncated file would crash.
+	EntriesInfo info;
+	TableInfo table_info;
+	LLFILE* file = LLFile::fopen(mHeaderEntriesFileName, "rb");
+	if (!file)
+	{
+		return false;
+	}
+	bool valid = fread(&info, sizeof(EntriesInfo), 1, file) == 1 &&
+				 fread(&table_info, sizeof(TableInfo), 1, file) == 1;
+	fseek(file, 0, SEEK_END);
+	const size_t file_size = (size_t)ftell(file);
+	LLFile::close(file);
+
+	valid = valid
+		&& info.mVersion == sHeaderCacheVersion
+		&& info.mAdressSize == sHeaderCacheAddressSize
+		&& strncmp(info.mEncoderVersion, sHeaderCacheEncoderVersion.c_str(), sHeaderEncoderStringSize) == 0
+		&& table_info.mBucketCount >= TEXTURE_CACHE_MIN_BUCKETS
+		&& (table_info.mBucketCount & (table_info.mBucketCount - 1)) == 0;
+	const size_t size = sizeof(EntriesInfo) + sizeof(TableInfo) + (size_t)table_info.mBucketCount * sizeof(Bucket);
+	if (!valid || file_size < size)
+	{
+		return false;
+	}
+
+	if (!mapHeaderTable(size))
+	{
+		LL_WARNS("TextureCache") << "Unable to map " << mHeaderEntriesFileName << LL_ENDL;
+		return false;
+	}
+
+	mUsedBuckets = 0;
+	for (U32 i = 0; i <= mBucketMask; ++i)
+	{
+		if (mBuckets[i].mRecord != 0)
+		{
+			++mUsedBuckets;
+		}
+	}
+
+	if (mHeaderTableInfop->mGeneration != mHeaderTableInfop->mCleanGeneration)
+	{
+		// The viewer went down with the table open, updates to it may have
+		// been cut short. Drop whatever does not add up and rehash the rest.
+		LL_WARNS("TextureCache") << "Texture cache index was not closed cleanly, validating it" << LL_ENDL;
+		rebuildHeaderTable(true);
+	}
+
+	if (!mReadOnly && mHeaderTableInfop->mBucketCount != getDesiredBucketCount())
 	{
-		LLAPRFile::readEx(mHeaderEntriesFileName, (U8*)&mHeaderEntriesInfo, 0, sizeof(EntriesInfo),
-						  mHeaderAPRFilePoolp);
+		// The cache size changed, move the entries over to a new table
+		LL_INFOS("TextureCache") << "Resizing texture cache index from " << mHeaderTableInfop->mBucketCount
+								 << " to " << getDesiredBucketCount() << " buckets" << LL_ENDL;
+		std::vector<Bucket> live;
+		for (U32 i = 0; i <= mBucketMask; ++i)
+		{
+			if (mBuckets[i].isLive())
+			{
+				live.push_back(mBuckets[i]);
+			}
+		}
+		const U32 num_entries = mHeaderEntriesInfop->mEntries;
+
+		closeHeaderTable(false);
+		if (!createHeaderTable())
+		{
+			return false;
+		}
+
+		mHeaderEntriesInfop->mEntries = num_entries;
+		for (const Bucket& old_bucket : live)
+		{
+			Bucket* bucket = insertBucket(old_bucket.mEntry.mID);
+			if (!bucket)
+			{
+				// Too many for the smaller table, readHeaderCache() will
+				// purge down to sCacheMaxEntries anyway
+				break;
+			}
+			*bucket = old_bucket;
+		}
 	}
-	else //create an empty entries header.
+	else if (!mReadOnly)
 	{
-		setEntriesHeader();
-		writeEntriesHeader() ;
+		++mHeaderTableInfop->mGeneration;
+		flushHeaderTable(true);
 	}
+
+	return true;
 }
 
-void LLTextureCache::setEntriesHeader()
+// Creates an empty texture.entries and maps it
+bool LLTextureCache::createHeaderTable()
 {
-	if (sHeaderEncoderStringSize < sHeaderCacheEncoderVersion.size() + 1)
+	llassert_always(mHeaderTablep == NULL);
+
+	const U32 bucket_count = getDesiredBucketCount();
+	const size_t size = sizeof(EntriesInfo) + sizeof(TableInfo) + (size_t)bucket_count * sizeof(Bucket);
+
+	if (mReadOnly)
 	{
-		// For simplicity we use predefined size of header, so if version string
-		// doesn't fit, either getEngineInfo() returned malformed string or 
-		// sHeaderEncoderStringSize need to be increased.
-		// Also take into accout that c_str() returns additional null character
-		LL_ERRS() << "Version string doesn't fit in header" << LL_ENDL;
+		// Nothing can be written, so keep an empty table in memory
+		mHeaderTablep = (U8*)calloc(1, size);
+		if (!mHeaderTablep)
+		{
+			return false;
+		}
+		mHeaderTableSize = size;
+		mHeaderTableMapped = false;
+		mHeaderEntriesInfop = (EntriesInfo*)mHeaderTablep;
+		mHeaderTableInfop = (TableInfo*)(mHeaderTablep + sizeof(EntriesInfo));
+		mBuckets = (Bucket*)(mHeaderTablep + sizeof(EntriesInfo) + sizeof(TableInfo));
 	}
+	else
+	{
+		// Zeroed buckets read as empty. Writing only the last byte leaves
+		// the file sparse on filesystems that support it.
+		LLFILE* file = LLFile::fopen(mHeaderEntriesFileName, "wb");
+		if (!file)
+		{
+			LL_WARNS("TextureCache") << "Unable to create " << mHeaderEntriesFileName << LL_ENDL;
+			return false;
+		}
+		const bool success = fseek(file, (long)(size - 1), SEEK_SET) == 0 && fputc(0, file) != EOF;
+		LLFile::close(file);
 
-	mHeaderEntriesInfo.mVersion = sHeaderCacheVersion;
-	mHeaderEntriesInfo.mAdressSize = sHeaderCacheAddressSize;
-	strcpy(mHeaderEntriesInfo.mEncoderVersion, sHeaderCacheEncoderVersion.c_str());
-	mHeaderEntriesInfo.mEntries = 0;
+		if (!success || !mapHeaderTable(size))
+		{
+			LL_WARNS("TextureCache") << "Unable to map " << mHeaderEntriesFileName << LL_ENDL;
+			LLFile::remove(mHeaderEntriesFileName);
+			return false;
+		}
+	}
+
+	setEntriesHeader(*mHeaderEntriesInfop);
+	mHeaderTableInfop->mBucketCount = bucket_count;
+	// Open until closeHeaderTable() says otherwise
+	mHeaderTableInfop->mGeneration = 1;
+	mHeaderTableInfop->mCleanGeneration = 0;
+	mBucketMask = bucket_count - 1;
+	mUsedBuckets = 0;
+	return true;
 }
 
-void LLTextureCache::writeEntriesHeader()
+void LLTextureCache::closeHeaderTable(bool clean)
 {
-	llassert_always(mHeaderAPRFile == NULL);
-	if (!mReadOnly)
+	if (!mHeaderTablep)
+	{
+		return;
+	}
+
+	if (mHeaderTableMapped)
+	{
+		if (clean && !mReadOnly)
+		{
+			// Only mark the table clean once everything else is on disk
+			flushHeaderTable(true);
+			mHeaderTableInfop->mCleanGeneration = mHeaderTableInfop->mGeneration;
+			flushHeaderTable(true);
+		}
+#if LL_WINDOWS
+		UnmapViewOfFile(mHeaderTablep);
+#else
+		munmap(mHeaderTablep, mHeaderTableSize);
+#endif
+	}
+	else
+	{
+		free(mHeaderTablep);
+	}
+
+	mHeaderTablep = NULL;
+	mHeaderTableSize = 0;
+	mHeaderTableMapped = false;
+	mHeaderEntriesInfop = NULL;
+	mHeaderTableInfop = NULL;
+	mBuckets = NULL;
+	mBucketMask = 0;
+	mUsedBuckets = 0;
+}
+
+void LLTextureCache::flushHeaderTable(bool wait)
+{
+	if (!mHeaderTablep || !mHeaderTableMapped || mReadOnly)
+	{
+		return;
+	}
+#if LL_WINDOWS
+	FlushViewOfFile(mHeaderTablep, 0);
+#else
+	msync(mHeaderTablep, mHeaderTableSize, wait ? MS_SYNC : MS_ASYNC);
+#endif
+}
+
+// Reinserts all live entries, which clears out deleted buckets. With
+// validate set, entries that do not make sense are dropped first.
+void LLTextureCache::rebuildHeaderTable(bool validate)
+{
+	if (!mBuckets)
+	{
+		return;
+	}
+
+	std::vector<Bucket> live;
+	std::vector<bool> used_records(validate ? mHeaderEntriesInfop->mEntries : 0, false);
+	boost::unordered_flat_set<LLUUID> used_ids;
+	for (U32 i = 0; i <= mBucketMask; ++i)
+	{
+		const Bucket& bucket = mBuckets[i];
+		if (!bucket.isLive())
+		{
+			continue;
+		}
+		if (validate)
+		{
+			const U32 record = bucket.mRecord - 1;
+			if (record >= used_records.size()
+				|| used_records[record]
+				|| bucket.mEntry.mImageSize <= bucket.mEntry.mBodySize
+				|| bucket.mEntry.mBodySize < 0
+				|| !used_ids.insert(bucket.mEntry.mID).second)
+			{
+				LL_WARNS("TextureCache") << "Dropping bad entry " << bucket.mEntry.mID << " record: " << record << LL_ENDL;
+				continue;
+			}
+			used_records[record] = true;
+		}
+		live.push_back(bucket);
+	}
+
+	memset((void*)mBuckets, 0, (size_t)(mBucketMask + 1) * sizeof(Bucket));
+	mUsedBuckets = 0;
+	for (const Bucket& old_bucket : live)
+	{
+		Bucket* bucket = insertBucket(old_bucket.mEntry.mID);
+		if (bucket)
+		{
+			*bucket = old_bucket;
+		}
+	}
+}
+
+LLTextureCache::Bucket* LLTextureCache::findBucket(const LLUUID& id)
+{
+	if (!mBuckets)
+	{
+		return NULL;
+	}
+
+	U32 idx = bucket_hash(id) & mBucketMask;
+	for (U32 probes = 0; probes <= mBucketMask; ++probes)
+	{
+		Bucket& bucket = mBuckets[idx];
+		if (bucket.mRecord == 0)
+		{
+			break;
+		}
+		if (bucket.mRecord != Bucket::DELETED_RECORD && bucket.mEntry.mID == id)
+		{
+			return &bucket;
+		}
+		idx = (idx + 1) & mBucketMask;
+	}
+	return NULL;
+}
+
+// Returns the bucket holding id, or a free one with mEntry.mID set to id
+// for the caller to fill in (including mRecord). NULL if the table is full.
+LLTextureCache::Bucket* LLTextureCache::insertBucket(const LLUUID& id)
+{
+	if (!mBuckets)
+	{
+		return NULL;
+	}
+
+	Bucket* bucket = findBucket(id);
+	if (bucket)
+	{
+		return bucket;
+	}
+
+	const U32 bucket_count = mBucketMask + 1;
+	if ((U64)(mUsedBuckets + 1) * 8 > (U64)bucket_count * 7)
+	{
+		// Mostly deleted buckets, which only get reclaimed by a rehash
+		rebuildHeaderTable(false);
+		if ((U64)(mUsedBuckets + 1) * 8 > (U64)bucket_count * 7)
+		{
+			return NULL;
+		}
+	}
+
+	U32 idx = bucket_hash(id) & mBucketMask;
+	while (mBuckets[idx].isLive())
+	{
+		idx = (idx + 1) & mBucketMask;
+	}
+	bucket = &mBuckets[idx];
+	if (bucket->mRecord == 0)
+	{
+		++mUsedBuckets;
+	}
+	bucket->mEntry.mID = id;
+	return bucket;
+}
+
+void LLTextureCache::eraseBucket(Bucket* bucket)
+{
+	// A bucket followed by an empty one ends no other probe sequence and
+	// can be emptied outright
+	const U32 next = ((U32)(bucket - mBuckets) + 1) & mBucketMask;
+	if (mBuckets[next].mRecord == 0)
+	{
+		bucket->mRecord = 0;
+		--mUsedBuckets;
+	}
+	else
 	{
-		LLAPRFile::writeEx(mHeaderEntriesFileName, (U8*)&mHeaderEntriesInfo, 0, sizeof(EntriesInfo),
-						   mHeaderAPRFilePoolp);
+		bucket->mRecord = Bucket::DELETED_RECORD;
 	}
 }
 
@@ -1122,20 +1530,15 @@ S32 LLTextureCache::openAndReadEntry(const LLUUID& id, Entry& entry, bool create
 {
 	S32 idx = -1;
 	
-	id_map_t::iterator iter1 = mHeaderIDMap.find(id);
-	if (iter1 != mHeaderIDMap.end())
-	{
-		idx = iter1->second;
-	}
-
-	if (idx < 0)
+	Bucket* bucket = findBucket(id);
+	if (!bucket)
 	{
-		if (create && !mReadOnly)
+		if (create && !mReadOnly && mHeaderEntriesInfop)
 		{
-			if (mHeaderEntriesInfo.mEntries < sCacheMaxEntries)
+			if (mHeaderEntriesInfop->mEntries < sCacheMaxEntries)
 			{
 				// Add an entry to the end of the list
-				idx = mHeaderEntriesInfo.mEntries++;
+				idx = mHeaderEntriesInfop->mEntries++;
 
 			}
 			else if (!mFreeList.empty())
@@ -1153,10 +1556,10 @@ S32 LLTextureCache::openAndReadEntry(const LLUUID& id, Entry& entry, bool create
 					// Erase entry from LRU regardless
 					mLRU.erase(curiter2);
 					// Look up entry and use it if it is valid
-					id_map_t::iterator iter3 = mHeaderIDMap.find(oldid);
-					if (iter3 != mHeaderIDMap.end() && iter3->second >= 0)
+					Bucket* old_bucket = findBucket(oldid);
+					if (old_bucket)
 					{
-						idx = iter3->second;
+						idx = old_bucket->getRecord();
 						removeCachedTexture(oldid) ;//remove the existing cached texture to release the entry index.
 						break;
 					}
@@ -1178,15 +1581,8 @@ S32 LLTextureCache::openAndReadEntry(const LLUUID& id, Entry& entry, bool create
 		// Remove this entry from the LRU if it exists
 		mLRU.erase(id);
 		// Read the entry
-		idx_entry_map_t::iterator iter = mUpdatedEntryMap.find(idx) ;
-		if(iter != mUpdatedEntryMap.end())
-		{
-			entry = iter->second ;
-		}
-		else
-		{
-			readEntryFromHeaderImmediately(idx, entry) ;
-		}
+		idx = bucket->getRecord();
+		entry = bucket->mEntry;
 		if(entry.mImageSize <= entry.mBodySize)//it happens on 64-bit systems, do not know why
 		{
 			LL_WARNS() << "corrupted entry: " << id << " entry image size: " << entry.mImageSize << " entry body size: " << entry.mBodySize << LL_ENDL ;
@@ -1194,7 +1590,6 @@ S32 LLTextureCache::openAndReadEntry(const LLUUID& id, Entry& entry, bool create
 			//erase this entry and the cached texture from the cache.
 			std::string tex_filename = getTextureFileName(id);
 			removeEntry(idx, entry, tex_filename) ;
-			mUpdatedEntryMap.erase(idx) ;
 			idx = -1 ;
 		}
 	}
@@ -1202,63 +1597,12 @@ S32 LLTextureCache::openAndReadEntry(const LLUUID& id, Entry& entry, bool create
 }
 
 //mHeaderMutex is locked before calling this.
-void LLTextureCache::writeEntryToHeaderImmediately(S32& idx, Entry& entry, bool write_header)
-{	
-	LLAPRFile* aprfile ;
-	S32 bytes_written ;
-	S32 offset = sizeof(EntriesInfo) + idx * sizeof(Entry);
-	if(write_header)
-	{
-		aprfile = openHeaderEntriesFile(false, 0);		
-		bytes_written = aprfile->write((U8*)&mHeaderEntriesInfo, sizeof(EntriesInfo)) ;
-		if(bytes_written != sizeof(EntriesInfo))
-		{
-			clearCorruptedCache() ; //clear the cache.
-			idx = -1 ;//mark the idx invalid.
-			return ;
-		}
-
-		mHeaderAPRFile->seek(APR_SET, offset);
-	}
-	else
-	{
-		aprfile = openHeaderEntriesFile(false, offset);
-	}
-	bytes_written = aprfile->write((void*)&entry, (S32)sizeof(Entry));
-	if(bytes_written != sizeof(Entry))
-	{
-		clearCorruptedCache() ; //clear the cache.
-		idx = -1 ;//mark the idx invalid.
-
-		return ;
-	}
-
-	closeHeaderEntriesFile();
-	mUpdatedEntryMap.erase(idx) ;
-}
-
-//mHeaderMutex is locked before calling this.
-void LLTextureCache::readEntryFromHeaderImmediately(S32& idx, Entry& entry)
-{
-	S32 offset = sizeof(EntriesInfo) + idx * sizeof(Entry);
-	LLAPRFile* aprfile = openHeaderEntriesFile(true, offset);
-	S32 bytes_read = aprfile->read((void*)&entry, (S32)sizeof(Entry));
-	closeHeaderEntriesFile();
-
-	if(bytes_read != sizeof(Entry))
-	{
-		clearCorruptedCache() ; //clear the cache.
-		idx = -1 ;//mark the idx invalid.
-	}
-}
-
-//mHeaderMutex is locked before calling this.
-//update an existing entry time stamp, delay writing.
+//update an existing entry time stamp in place.
 void LLTextureCache::updateEntryTimeStamp(S32 idx, Entry& entry)
 {
 	static const U32 MAX_ENTRIES_WITHOUT_TIME_STAMP = (U32)(LLTextureCache::sCacheMaxEntries * 0.75f) ;
 
-	if(mHeaderEntriesInfo.mEntries < MAX_ENTRIES_WITHOUT_TIME_STAMP)
+	if(getEntries() < MAX_ENTRIES_WITHOUT_TIME_STAMP)
 	{
 		return ; //there are enough empty entry index space, no need to stamp time.
 	}
@@ -1268,12 +1612,16 @@ void LLTextureCache::updateEntryTimeStamp(S32 idx, Entry& entry)
 		if (!mReadOnly)
 		{
 			entry.mTime = time(NULL);			
-			mUpdatedEntryMap[idx] = entry ;
+			Bucket* bucket = findBucket(entry.mID);
+			if (bucket)
+			{
+				bucket->mEntry.mTime = entry.mTime;
+			}
 		}
 	}
 }
 
-//update an existing entry, write to header file immediately.
+//update an existing entry, or add a brand-new one to the table.
 bool LLTextureCache::updateEntry(S32& idx, Entry& entry, S32 new_image_size, S32 new_data_size)
 {
     LL_PROFILE_ZONE_SCOPED_CATEGORY_TEXTURE;
@@ -1289,20 +1637,12 @@ bool LLTextureCache::updateEntry(S32& idx, Entry& entry, S32 new_image_size, S32
 
 		lockHeaders() ;
 
-		bool update_header = false ;
 		if(entry.mImageSize < 0) //is a brand-new entry
 		{
-			mHeaderIDMap[entry.mID] = idx;
-			mTexturesSizeMap[entry.mID] = new_body_size ;
 			mTexturesSizeTotal += new_body_size ;
-			
-			// Update Header
-			update_header = true ;
 		}				
 		else if (entry.mBodySize != new_body_size)
 		{
-			//already in mHeaderIDMap.
-			mTexturesSizeMap[entry.mID] = new_body_size ;
 			mTexturesSizeTotal -= entry.mBodySize ;
 			mTexturesSizeTotal += new_body_size ;
 		}
@@ -1310,7 +1650,18 @@ bool LLTextureCache::updateEntry(S32& idx, Entry& entry, S32 new_image_size, S32
 		entry.mImageSize = new_image_size ; 
 		entry.mBodySize = new_body_size ;
 		
-		writeEntryToHeaderImmediately(idx, entry, update_header) ;
+		Bucket* bucket = insertBucket(entry.mID);
+		if (bucket)
+		{
+			bucket->mEntry = entry;
+			bucket->mRecord = (U32)idx + 1;
+		}
+		else
+		{
+			LL_WARNS("TextureCache") << "Texture cache index is full" << LL_ENDL;
+			clearCorruptedCache() ; //clear the cache.
+			idx = -1 ;//mark the idx invalid.
+		}
 	
 		if (mTexturesSizeTotal > sCacheMaxTexturesSize)
 		{
@@ -1328,230 +1679,104 @@ bool LLTextureCache::updateEntry(S32& idx, Entry& entry, S32 new_image_size, S32
 	return false ;
 }
 
-U32 LLTextureCache::openAndReadEntries(std::vector<Entry>& entries)
+//----------------------------------------------------------------------------
+
+// Called from either the main thread or the worker thread
+void LLTextureCache::readHeaderCache()
 {
-	U32 num_entries = mHeaderEntriesInfo.mEntries;
+	mHeaderMutex.lock();
 
-	mHeaderIDMap.clear();
-	mTexturesSizeMap.clear();
-	mFreeList.clear();
-	mTexturesSizeTotal = 0;
+	mLRU.clear(); // always clear the LRU
 
-	LLAPRFile* aprfile = NULL; 
-	if(mUpdatedEntryMap.empty())
-	{
-		aprfile = openHeaderEntriesFile(true, (S32)sizeof(EntriesInfo));
-	}
-	else //update the header file first.
+	if (!mHeaderTablep && !openHeaderTable())
 	{
-		aprfile = openHeaderEntriesFile(false, 0);
-		updatedHeaderEntriesFile() ;
-		if(!aprfile)
+		if (LLFile::isfile(mHeaderEntriesFileName))
 		{
-			return 0;
+			LL_INFOS() << "Texture Cache version mismatch, Purging." << LL_ENDL;
 		}
-		aprfile->seek(APR_SET, (S32)sizeof(EntriesInfo));
+		purgeAllTextures(false); // leaves an empty table behind
 	}
 
-    entries.resize(num_entries);
-    S32 total_entries_size = sizeof(Entry) * num_entries;
-    S32 bytes_read = aprfile->read((void*)entries.data(), total_entries_size);
-    if (bytes_read != total_entries_size)
-    {
-        LL_WARNS() << "Corrupted header entries, expected " << total_entries_size << " bytes but got " << bytes_read << " bytes" << LL_ENDL;
-        closeHeaderEntriesFile();
-        purgeAllTextures(false);
-        return 0;
-    }
-
-	for (U32 idx=0; idx<num_entries; idx++)
+	if (mBuckets)
 	{
-		const Entry& entry = entries[idx];
-// 		LL_INFOS() << "ENTRY: " << entry.mTime << " TEX: " << entry.mID << " IDX: " << idx << " Size: " << entry.mImageSize << LL_ENDL;
-		if(entry.mImageSize > entry.mBodySize)
+		// The free list and the total size are derived from the table
+		const U32 num_entries = mHeaderEntriesInfop->mEntries;
+		std::vector<bool> used_records(num_entries, false);
+		U32 live_entries = 0;
+		mFreeList.clear();
+		mTexturesSizeTotal = 0;
+
+		typedef std::pair<U32, U32> lru_data_t; // time, bucket
+		std::set<lru_data_t> lru;
+		std::set<U32> purge_list;
+		for (U32 i = 0; i <= mBucketMask; i++)
 		{
-			mHeaderIDMap[entry.mID] = idx;
-			mTexturesSizeMap[entry.mID] = entry.mBodySize;
+			const Bucket& bucket = mBuckets[i];
+			if (!bucket.isLive())
+			{
+				continue;
+			}
+			++live_entries;
+			const Entry& entry = bucket.mEntry;
+			if ((U32)bucket.getRecord() < num_entries)
+			{
+				used_records[bucket.getRecord()] = true;
+			}
 			mTexturesSizeTotal += entry.mBodySize;
+			lru.insert(std::make_pair(entry.mTime, i));
+			if (entry.mBodySize > entry.mImageSize)
+			{
+				// Shouldn't happen, failsafe only
+				LL_WARNS() << "Bad entry: " << bucket.getRecord() << ": " << entry.mID << ": BodySize: " << entry.mBodySize << LL_ENDL;
+				purge_list.insert(i);
+			}
 		}
-		else
+		for (U32 idx = 0; idx < num_entries; idx++)
 		{
-			mFreeList.insert(idx);
+			if (!used_records[idx])
+			{
+				mFreeList.insert(idx);
+			}
 		}
-	}
-	closeHeaderEntriesFile();
-	return num_entries;
-}
 
-void LLTextureCache::writeEntriesAndClose(const std::vector<Entry>& entries)
-{
-	S32 num_entries = entries.size();
-	llassert_always(num_entries == mHeaderEntriesInfo.mEntries);
-	
-	if (!mReadOnly)
-	{
-		LLAPRFile* aprfile = openHeaderEntriesFile(false, (S32)sizeof(EntriesInfo));
-		for (S32 idx=0; idx<num_entries; idx++)
+		if (live_entries > sCacheMaxEntries)
 		{
-			S32 bytes_written = aprfile->write((void*)(&entries[idx]), (S32)sizeof(Entry));
-			if(bytes_written != sizeof(Entry))
+			// Special case: cache size was reduced, need to remove entries
+			U32 entries_to_purge = live_entries - sCacheMaxEntries;
+			LL_INFOS() << "Texture Cache Entries: " << live_entries << " Max: " << sCacheMaxEntries << " Purging: " << entries_to_purge << LL_ENDL;
+			// lru holds every live entry, so it cannot run out before the purge list is full
+			std::set<lru_data_t>::iterator iter = lru.begin();
+			while (purge_list.size() < entries_to_purge)
 			{
-				clearCorruptedCache() ; //clear the cache.
-				return ;
+				purge_list.insert(iter->second);
+				++iter;
 			}
 		}
-		closeHeaderEntriesFile();
-	}
-}
-
-void LLTextureCache::writeUpdatedEntries()
-{
-	lockHeaders() ;
-	if (!mReadOnly && !mUpdatedEntryMap.empty())
-	{
-		openHeaderEntriesFile(false, 0);
-		updatedHeaderEntriesFile() ;
-		closeHeaderEntriesFile();
-	}
-	unlockHeaders() ;
-}
 
-//mHeaderMutex is locked and mHeaderAPRFile is created before calling this.
-void LLTextureCache::updatedHeaderEntriesFile()
-{
-	if (!mReadOnly && !mUpdatedEntryMap.empty() && mHeaderAPRFile)
-	{
-		//entriesInfo
-		mHeaderAPRFile->seek(APR_SET, 0);
-		S32 bytes_written = mHeaderAPRFile->write((U8*)&mHeaderEntriesInfo, sizeof(EntriesInfo)) ;
-		if(bytes_written != sizeof(EntriesInfo))
 		{
-			clearCorruptedCache() ; //clear the cache.
-			return ;
-		}
-		
-		//write each updated entry
-		S32 entry_size = (S32)sizeof(Entry) ;
-		S32 prev_idx = -1 ;
-		S32 delta_idx ;
-		for (idx_entry_map_t::iterator iter = mUpdatedEntryMap.begin(); iter != mUpdatedEntryMap.end(); ++iter)
-		{
-			delta_idx = iter->first - prev_idx - 1;
-			prev_idx = iter->first ;
-			if(delta_idx)
-			{
-				mHeaderAPRFile->seek(APR_CUR, delta_idx * entry_size);
-			}
-			
-			bytes_written = mHeaderAPRFile->write((void*)(&iter->second), entry_size);
-			if(bytes_written != entry_size)
+			S32 lru_entries = (S32)((F32)sCacheMaxEntries * TEXTURE_CACHE_LRU_SIZE);
+			for (const auto& lru_pair : lru)
 			{
-				clearCorruptedCache() ; //clear the cache.
-				return ;
+				mLRU.insert(mBuckets[lru_pair.second].mEntry.mID);
+				if (--lru_entries <= 0)
+					break;
 			}
 		}
-		mUpdatedEntryMap.clear() ;
-	}
-}
-//----------------------------------------------------------------------------
 
-// Called from either the main thread or the worker thread
-void LLTextureCache::readHeaderCache()
-{
-	mHeaderMutex.lock();
-
-	mLRU.clear(); // always clear the LRU
-
-	readEntriesHeader();
-	
-	if (mHeaderEntriesInfo.mVersion != sHeaderCacheVersion
-		|| mHeaderEntriesInfo.mAdressSize != sHeaderCacheAddressSize
-		|| strcmp(mHeaderEntriesInfo.mEncoderVersion, sHeaderCacheEncoderVersion.c_str()) != 0)
-	{
-		if (!mReadOnly)
+		if (purge_list.size() > 0)
 		{
-			LL_INFOS() << "Texture Cache version mismatch, Purging." << LL_ENDL;
-			purgeAllTextures(false);
-		}
-	}
-	else
-	{
-		std::vector<Entry> entries;
-		U32 num_entries = openAndReadEntries(entries);
-		if (num_entries)
-		{
-			U32 empty_entries = 0;
-			typedef std::pair<U32, S32> lru_data_t;
-			std::set<lru_data_t> lru;
-			std::set<U32> purge_list;
-			for (U32 i=0; i<num_entries; i++)
-			{
-				Entry& entry = entries[i];
-				if (entry.mImageSize <= 0)
-				{
-					// This will be in the Free List, don't put it in the LRU
-					++empty_entries;
-				}
-				else
-				{
-					lru.insert(std::make_pair(entry.mTime, i));
-					if (entry.mBodySize > 0)
-					{
-						if (entry.mBodySize > entry.mImageSize)
-						{
-							// Shouldn't happen, failsafe only
-							LL_WARNS() << "Bad entry: " << i << ": " << entry.mID << ": BodySize: " << entry.mBodySize << LL_ENDL;
-							purge_list.insert(i);
-						}
-					}
-				}
-			}
-			if (num_entries - empty_entries > sCacheMaxEntries)
+			LLTimer timer;
+			for (U32 bucket_idx : purge_list)
 			{
-				// Special case: cache size was reduced, need to remove entries
-				U32 entries_to_purge = (num_entries - empty_entries) - sCacheMaxEntries;
-				LL_INFOS() << "Texture Cache Entries: " << num_entries << " Max: " << sCacheMaxEntries << " Empty: " << empty_entries << " Purging: " << entries_to_purge << LL_ENDL;
-				// We can exit the following loop with the given condition, since if we'd reach the end of the lru set we'd have:
-				// purge_list.size() = lru.size() = num_entries - empty_entries = entries_to_purge + sCacheMaxEntries >= entries_to_purge
-				// So, it's certain that iter will never reach lru.end() first.
-				std::set<lru_data_t>::iterator iter = lru.begin();
-				while (purge_list.size() < entries_to_purge)
-				{
-					purge_list.insert(iter->second);
-					++iter;
-				}
-			}
+				Entry entry = mBuckets[bucket_idx].mEntry;
+				std::string tex_filename = getTextureFileName(entry.mID);
+				removeEntry(mBuckets[bucket_idx].getRecord(), entry, tex_filename);
 
-			{
-				S32 lru_entries = (S32)((F32)sCacheMaxEntries * TEXTURE_CACHE_LRU_SIZE);
-				for (const auto& lru_pair : lru)
-				{
-					mLRU.insert(entries[lru_pair.second].mID);
-// 					LL_INFOS() << "LRU: " << iter->first << " : " << iter->second << LL_ENDL;
-					if (--lru_entries <= 0)
-						break;
-				}
-			}
-			
-			if (purge_list.size() > 0)
-			{
-				LLTimer timer;
-				for (U32 idx : purge_list)
+				//make sure that pruning entries doesn't take too much time
+				if (timer.getElapsedTimeF32() > TEXTURE_PRUNING_MAX_TIME)
 				{
-					std::string tex_filename = getTextureFileName(entries[idx].mID);
-					removeEntry((S32)idx, entries[idx], tex_filename);
-
-					//make sure that pruning entries doesn't take too much time
-					if (timer.getElapsedTimeF32() > TEXTURE_PRUNING_MAX_TIME)
-					{
-						break;
-					}
+					break;
 				}
-				writeEntriesAndClose(entries);
-			}
-			else
-			{
-				//entries are not changed, nothing here.
 			}
 		}
 	}
@@ -1565,7 +1790,6 @@ void LLTextureCache::clearCorruptedCache()
 {
 	LL_WARNS() << "the texture cache is corrupted, need to be cleared." << LL_ENDL ;
 
-	closeHeaderEntriesFile();//close possible file handler
 	purgeAllTextures(false) ; //clear the cache.
 
 	if (!mReadOnly) //regenerate the directory tree if not exists.
@@ -1585,6 +1809,9 @@ void LLTextureCache::clearCorruptedCache()
 
 void LLTextureCache::purgeAllTextures(bool purge_directories)
 {
+	// The table is about to be deleted along with everything else
+	closeHeaderTable(false);
+
 	if (!mReadOnly)
 	{
 		const char* subdirs = "0123456789abcdef";
@@ -1615,15 +1842,14 @@ void LLTextureCache::purgeAllTextures(bool purge_directories)
 			LLFile::rmdir(mTexturesDirName);
 		}
 	}
-	mHeaderIDMap.clear();
-	mTexturesSizeMap.clear();
 	mTexturesSizeTotal = 0;
 	mFreeList.clear();
-	mUpdatedEntryMap.clear();
 
-	// Info with 0 entries
-	setEntriesHeader();
-	writeEntriesHeader();
+	// Table with 0 entries
+	if (!purge_directories)
+	{
+		createHeaderTable();
+	}
 
 	LL_INFOS() << "The entire texture cache is cleared." << LL_ENDL ;
 }
@@ -1645,32 +1871,19 @@ void LLTextureCache::purgeTexturesLazy(F32 time_limit_sec)
 
 	if (mPurgeEntryList.empty())
 	{
-		// Read the entries list and form list of textures to purge
-		std::vector<Entry> entries;
-		U32 num_entries = openAndReadEntries(entries);
-		if (!num_entries)
+		if (!mBuckets)
 		{
 			return; // nothing to purge
 		}
 
-		// Use mTexturesSizeMap to collect UUIDs of textures with bodies
-		typedef std::set<std::pair<U32, S32> > time_idx_set_t;
-		std::set<std::pair<U32, S32> > time_idx_set;
-		for (size_map_t::iterator iter1 = mTexturesSizeMap.begin();
-			iter1 != mTexturesSizeMap.end(); ++iter1)
+		// Collect the textures with bodies
+		typedef std::set<std::pair<U32, U32> > time_idx_set_t; // time, bucket
+		time_idx_set_t time_idx_set;
+		for (U32 i = 0; i <= mBucketMask; ++i)
 		{
-			if (iter1->second > 0)
+			if (mBuckets[i].isLive() && mBuckets[i].mEntry.mBodySize > 0)
 			{
-				id_map_t::iterator iter2 = mHeaderIDMap.find(iter1->first);
-				if (iter2 != mHeaderIDMap.end())
-				{
-					S32 idx = iter2->second;
-					time_idx_set.insert(std::make_pair(entries[idx].mTime, idx));
-				}
-				else
-				{
-					LL_ERRS("TextureCache") << "mTexturesSizeMap / mHeaderIDMap corrupted." << LL_ENDL;
-				}
+				time_idx_set.insert(std::make_pair(mBuckets[i].mEntry.mTime, i));
 			}
 		}
 
@@ -1679,11 +1892,11 @@ void LLTextureCache::purgeTexturesLazy(F32 time_limit_sec)
 		for (time_idx_set_t::iterator iter = time_idx_set.begin();
 			iter != time_idx_set.end(); ++iter)
 		{
-			S32 idx = iter->second;
+			const Bucket& bucket = mBuckets[iter->second];
 			if (cache_size >= purged_cache_size)
 			{
-				cache_size -= entries[idx].mBodySize;
-				mPurgeEntryList.push_back(std::pair<S32, Entry>(idx, entries[idx]));
+				cache_size -= bucket.mEntry.mBodySize;
+				mPurgeEntryList.push_back(std::pair<S32, Entry>(bucket.getRecord(), bucket.mEntry));
 			}
 			else
 			{
@@ -1702,12 +1915,11 @@ void LLTextureCache::purgeTexturesLazy(F32 time_limit_sec)
 			Entry entry = mPurgeEntryList.back().second;
 			mPurgeEntryList.pop_back();
 			// make sure record is still valid
-			id_map_t::iterator iter_header = mHeaderIDMap.find(entry.mID);
-			if (iter_header != mHeaderIDMap.end() && iter_header->second == idx)
+			Bucket* bucket = findBucket(entry.mID);
+			if (bucket && bucket->getRecord() == idx)
 			{
 				std::string tex_filename = getTextureFileName(entry.mID);
 				removeEntry(idx, entry, tex_filename);
-				writeEntryToHeaderImmediately(idx, entry);
 			}
 		}
 	}
@@ -1730,32 +1942,23 @@ void LLTextureCache::purgeTextures(bool validate)
 
 	LL_INFOS() << "TEXTURE CACHE: Purging." << LL_ENDL;
 
-	// Read the entries list
-	std::vector<Entry> entries;
-	U32 num_entries = openAndReadEntries(entries);
-	if (!num_entries)
+	if (!mBuckets)
 	{
 		return; // nothing to purge
 	}
 	
-	// Use mTexturesSizeMap to collect UUIDs of textures with bodies
-	typedef std::set<std::pair<U32,S32> > time_idx_set_t;
-	std::set<std::pair<U32,S32> > time_idx_set;
-	for (size_map_t::iterator iter1 = mTexturesSizeMap.begin();
-		 iter1 != mTexturesSizeMap.end(); ++iter1)
+	// Collect the textures with bodies
+	typedef std::set<std::pair<U32,U32> > time_idx_set_t; // time, bucket
+	time_idx_set_t time_idx_set;
+	U32 num_entries = 0;
+	for (U32 i = 0; i <= mBucketMask; ++i)
 	{
-		if (iter1->second > 0)
+		if (mBuckets[i].isLive())
 		{
-			id_map_t::iterator iter2 = mHeaderIDMap.find(iter1->first);
-			if (iter2 != mHeaderIDMap.end())
+			++num_entries;
+			if (mBuckets[i].mEntry.mBodySize > 0)
 			{
-				S32 idx = iter2->second;
-				time_idx_set.insert(std::make_pair(entries[idx].mTime, idx));
-// 				LL_INFOS() << "TIME: " << entries[idx].mTime << " TEX: " << entries[idx].mID << " IDX: " << idx << " Size: " << entries[idx].mImageSize << LL_ENDL;
-			}
-			else
-			{
-				LL_ERRS() << "mTexturesSizeMap / mHeaderIDMap corrupted." << LL_ENDL ;
+				time_idx_set.insert(std::make_pair(mBuckets[i].mEntry.mTime, i));
 			}
 		}
 	}
@@ -1776,7 +1979,8 @@ void LLTextureCache::purgeTextures(bool validate)
 	for (time_idx_set_t::iterator iter = time_idx_set.begin();
 		 iter != time_idx_set.end(); ++iter)
 	{
-		S32 idx = iter->second;
+		Entry entry = mBuckets[iter->second].mEntry;
+		S32 idx = mBuckets[iter->second].getRecord();
 		bool purge_entry = false;		
 
 		if (cache_size >= purged_cache_size)
@@ -1786,16 +1990,16 @@ void LLTextureCache::purgeTextures(bool validate)
 		else if (validate)
 		{
 			// make sure file exists and is the correct size
-			U32 uuididx = entries[idx].mID.mData[0];
+			U32 uuididx = entry.mID.mData[0];
 			if (uuididx == validate_idx)
 			{
-				std::string filename = getTextureFileName(entries[idx].mID);
-				LL_DEBUGS("TextureCache") << "Validating: " << filename << "Size: " << entries[idx].mBodySize << LL_ENDL;
+				std::string filename = getTextureFileName(entry.mID);
+				LL_DEBUGS("TextureCache") << "Validating: " << filename << "Size: " << entry.mBodySize << LL_ENDL;
 				// mHeaderAPRFilePoolp because this is under header mutex in main thread
 				S32 bodysize = LLAPRFile::size(filename, mHeaderAPRFilePoolp);
-				if (bodysize != entries[idx].mBodySize)
+				if (bodysize != entry.mBodySize)
 				{
-					LL_WARNS("TextureCache") << "TEXTURE CACHE BODY HAS BAD SIZE: " << bodysize << " != " << entries[idx].mBodySize << filename << LL_ENDL;
+					LL_WARNS("TextureCache") << "TEXTURE CACHE BODY HAS BAD SIZE: " << bodysize << " != " << entry.mBodySize << filename << LL_ENDL;
 					purge_entry = true;
 				}
 			}
@@ -1808,16 +2012,16 @@ void LLTextureCache::purgeTextures(bool validate)
 		if (purge_entry)
 		{
 			purge_count++;
-            std::string filename = getTextureFileName(entries[idx].mID);
+            std::string filename = getTextureFileName(entry.mID);
 	 		LL_DEBUGS("TextureCache") << "PURGING: " << filename << LL_ENDL;
-			cache_size -= entries[idx].mBodySize;
-			removeEntry(idx, entries[idx], filename) ;			
+			cache_size -= entry.mBodySize;
+			removeEntry(idx, entry, filename) ;			
 		}
 	}
 
-	LL_DEBUGS("TextureCache") << "TEXTURE CACHE: Writing Entries: " << num_entries << LL_ENDL;
+	LL_DEBUGS("TextureCache") << "TEXTURE CACHE: Flushing Entries: " << num_entries << LL_ENDL;
 
-	writeEntriesAndClose(entries);
+	flushHeaderTable(false);
 	
 	// *FIX:Mani - watchdog back on.
 	LLAppViewer::instance()->resumeMainloopTimeout();
@@ -1828,7 +2032,6 @@ void LLTextureCache::purgeTextures(bool validate)
 			<< " CACHE SIZE: " << mTexturesSizeTotal / (1024 * 1024) << " MB"
 			<< LL_ENDL;
 }
-
 //////////////////////////////////////////////////////////////////////////////
 
 // call lockWorkers() first!
@@ -2008,13 +2211,13 @@ LLPointer<LLImageRaw> LLTextureCache::readFromFastCache(const LLUUID& id, S32& d
 	U32 offset;
 	{
 		LLMutexLock lock(&mHeaderMutex);
-		id_map_t::const_iterator iter = mHeaderIDMap.find(id);
-		if(iter == mHeaderIDMap.end())
+		const Bucket* bucket = findBucket(id);
+		if (!bucket)
 		{
 			return NULL; //not in the cache
 		}
 
-		offset = iter->second;
+		offset = bucket->getRecord();
 	}
 	offset *= TEXTURE_FAST_CACHE_ENTRY_SIZE;
 
@@ -2136,6 +2339,161 @@ bool LLTextureCache::writeToFastCache(LLUUID image_id, S32 id, LLPointer<LLImage
 	return true;
 }
 
+//called from the texture fetch thread
+LLPointer<LLImageRaw> LLTextureCache::readFromMipCache(const LLUUID& id, S32 max_discard, S32& discardlevel)
+{
+	LL_PROFILE_ZONE_SCOPED_CATEGORY_TEXTURE;
+	{
+		// Mips of evicted textures are ignored until they get overwritten
+		LLMutexLock lock(&mHeaderMutex);
+		if (!findBucket(id))
+		{
+			return NULL;
+		}
+	}
+
+	LLFILE* fp = LLFile::fopen(getMipFileName(id), "rb");
+	if (!fp)
+	{
+		return NULL;
+	}
+
+	MipCacheHeader head;
+	if (fread(&head, sizeof(head), 1, fp) != 1
+		|| head.mMagic != TEXTURE_MIP_CACHE_MAGIC
+		|| head.mDiscardLevel < 0 || head.mDiscardLevel > max_discard
+		|| head.mWidth <= 0 || head.mHeight <= 0
+		|| head.mComponents <= 0 || head.mComponents > 4
+		|| head.mWidth * head.mHeight * head.mComponents > TEXTURE_MIP_CACHE_MAX_DATA_SIZE
+		|| head.mCompressedSize <= 0 || head.mCompressedSize > TEXTURE_MIP_CACHE_MAX_DATA_SIZE)
+	{
+		LLFile::close(fp);
+		return NULL;
+	}
+
+	std::vector<U8> compressed(head.mCompressedSize);
+	bool success = fread(compressed.data(), 1, compressed.size(), fp) == compressed.size();
+	LLFile::close(fp);
+	if (!success)
+	{
+		return NULL;
+	}
+
+	uLongf raw_size = head.mWidth * head.mHeight * head.mComponents;
+	U8* data = (U8*)ll_aligned_malloc_16(raw_size);
+	if (!data)
+	{
+		return NULL;
+	}
+	uLongf data_size = raw_size;
+	if (uncompress(data, &data_size, compressed.data(), compressed.size()) != Z_OK || data_size != raw_size)
+	{
+		LL_WARNS("TextureCache") << "Corrupted mip cache file for " << id << LL_ENDL;
+		ll_aligned_free_16(data);
+		return NULL;
+	}
+
+	// A hit is a use of the texture like any other read, or textures only
+	// ever served from here would be the first to get evicted
+	Entry entry;
+	getHeaderCacheEntry(id, entry);
+
+	discardlevel = head.mDiscardLevel;
+	return new LLImageRaw(data, head.mWidth, head.mHeight, head.mComponents, true);
+}
+
+// Stores the mip whose largest side is max_resolution or less, if raw is
+// detailed enough to produce it. Compression and I/O are done on the
+// general work queue.
+void LLTextureCache::writeToMipCache(const LLUUID& id, LLPointer<LLImageRaw> raw, S32 discardlevel, S32 max_resolution)
+{
+	LL_PROFILE_ZONE_SCOPED_CATEGORY_TEXTURE;
+	if (mReadOnly || max_resolution <= 0 || raw.isNull() || raw->isBufferInvalid() || !raw->getData())
+	{
+		return;
+	}
+
+	S32 w = raw->getWidth();
+	S32 h = raw->getHeight();
+	S32 c = raw->getComponents();
+	if (w <= 0 || h <= 0 || c <= 0 || c > 4)
+	{
+		return;
+	}
+
+	S32 i = 0;
+	while ((llmax(w, h) >> i) > max_resolution)
+	{
+		++i;
+	}
+	if (i == 0 && discardlevel > 0 && llmax(w, h) * 2 <= max_resolution)
+	{
+		// A lower resolution than the level we keep
+		return;
+	}
+
+	std::string filename = getMipFileName(id);
+	if (LLFile::isfile(filename))
+	{
+		// The stored level only depends on the full size of the texture
+		return;
+	}
+
+	LL::WorkQueue::ptr_t general_queue = LL::WorkQueue::getInstance("General");
+	if (!general_queue)
+	{
+		return;
+	}
+
+	// The caller hands raw over to the main thread, which may scale it in
+	// place, so the queue only ever sees a private copy.
+	LLPointer<LLImageRaw> mip = new LLImageRaw(raw->getData(), w, h, c);
+	if (mip->isBufferInvalid())
+	{
+		return;
+	}
+
+	general_queue->post([filename, mip, w, h, c, discardlevel, i]() mutable
+	{
+		LL_PROFILE_ZONE_NAMED_CATEGORY_TEXTURE("tc - write mip");
+		if (i)
+		{
+			mip->scale(llmax(w >> i, 1), llmax(h >> i, 1));
+		}
+
+		MipCacheHeader head;
+		head.mMagic = TEXTURE_MIP_CACHE_MAGIC;
+		head.mWidth = mip->getWidth();
+		head.mHeight = mip->getHeight();
+		head.mComponents = c;
+		head.mDiscardLevel = discardlevel + i;
+
+		uLong raw_size = head.mWidth * head.mHeight * c;
+		uLongf compressed_size = compressBound(raw_size);
+		std::vector<U8> compressed(compressed_size);
+		if (compress2(compressed.data(), &compressed_size, mip->getData(), raw_size, Z_BEST_SPEED) != Z_OK)
+		{
+			return;
+		}
+		head.mCompressedSize = compressed_size;
+
+		// Readers can run at any time, never let them see a partial file
+		std::string temp_filename = filename + ".tmp";
+		LLFILE* fp = LLFile::fopen(temp_filename, "wb");
+		if (!fp)
+		{
+			return;
+		}
+		bool success = fwrite(&head, sizeof(head), 1, fp) == 1
+			&& fwrite(compressed.data(), 1, compressed_size, fp) == compressed_size;
+		LLFile::close(fp);
+		if (!success || LLFile::rename(temp_filename, filename) != 0)
+		{
+			LLFile::remove(temp_filename, ENOENT);
+		}
+	});
+}
+
 void LLTextureCache::openFastCache(bool first_time)
 {
 	if(!mFastCachep)
@@ -2226,12 +2584,12 @@ void LLTextureCache::addCompleted(Responder* responder, bool success)
 //called after mHeaderMutex is locked.
 void LLTextureCache::removeCachedTexture(const LLUUID& id)
 {
-	if(mTexturesSizeMap.find(id) != mTexturesSizeMap.end())
+	Bucket* bucket = findBucket(id);
+	if (bucket)
 	{
-		mTexturesSizeTotal -= mTexturesSizeMap[id] ;
-		mTexturesSizeMap.erase(id);
+		mTexturesSizeTotal -= bucket->mEntry.mBodySize ;
+		eraseBucket(bucket);
 	}
-	mHeaderIDMap.erase(id);
 	// We are inside header's mutex so mHeaderAPRFilePoolp is safe to use,
 	// but getLocalAPRFilePool() is not safe, it might be in use by worker
 	LLAPRFile::remove(getTextureFileName(id), mHeaderAPRFilePoolp);
@@ -2262,8 +2620,11 @@ void LLTextureCache::removeEntry(S32 idx, Entry& entry, std::string& filename)
 
 		entry.mImageSize = -1;
 		entry.mBodySize = 0;
-		mHeaderIDMap.erase(entry.mID);
-		mTexturesSizeMap.erase(entry.mID);		
+		Bucket* bucket = findBucket(entry.mID);
+		if (bucket)
+		{
+			eraseBucket(bucket);
+		}
 		mFreeList.insert(idx);	
 	}
 
@@ -2271,6 +2632,11 @@ void LLTextureCache::removeEntry(S32 idx, Entry& entry, std::string& filename)
 	{
 		LLAPRFile::remove(filename, mHeaderAPRFilePoolp);		
 	}
+
+	if (idx >= 0)
+	{
+		LLFile::remove(getMipFileName(entry.mID), ENOENT);
+	}
 }
 
 bool LLTextureCache::removeFromCache(const LLUUID& id)
@@ -2287,7 +2653,6 @@ bool LLTextureCache::removeFromCache(const LLUUID& id)
 		removeEntry(idx, entry, tex_filename) ;
 		if (idx >= 0)
 		{			
-			writeEntryToHeaderImmediately(idx, entry);					
 			ret = true;
 		}
 
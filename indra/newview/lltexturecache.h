@@ -80,6 +80,26 @@ class LLTextureCache final : public LLWorkerThread
 		U32 mTime; // seconds since 1/1/1970
 	};
 
+	// texture.entries is an open addressing hash table of Buckets keyed by
+	// texture UUID, mapped into memory and updated in place.
+	struct TableInfo
+	{
+		U32 mBucketCount; // power of two
+		U32 mGeneration; // bumped every time the table is opened for writing
+		U32 mCleanGeneration; // equals mGeneration once the table was closed cleanly
+		U32 mPad;
+	};
+	struct Bucket
+	{
+		static constexpr U32 DELETED_RECORD = 0xffffffff;
+
+		bool isLive() const { return mRecord != 0 && mRecord != DELETED_RECORD; }
+		S32 getRecord() const { return (S32)mRecord - 1; }
+
+		Entry mEntry;
+		U32 mRecord; // 0 if empty, DELETED_RECORD if deleted, otherwise the index in texture.cache + 1
+	};
+
 #if LL_WINDOWS
 #pragma pack(pop)
 #endif
@@ -130,6 +150,12 @@ class LLTextureCache final : public LLWorkerThread
 	handle_t writeToCache(const LLUUID& id, U8* data, S32 datasize, S32 imagesize, LLPointer<LLImageRaw> rawimage, S32 discardlevel,
 						  WriteResponder* responder);
 	LLPointer<LLImageRaw> readFromFastCache(const LLUUID& id, S32& discardlevel);
+
+	// Decoded mips of textures seen more than once, stored so that revisits
+	// can skip the J2C decode. Reads return NULL unless the stored mip is at
+	// discard level max_discard or better.
+	LLPointer<LLImageRaw> readFromMipCache(const LLUUID& id, S32 max_discard, S32& discardlevel);
+	void writeToMipCache(const LLUUID& id, LLPointer<LLImageRaw> raw, S32 discardlevel, S32 max_resolution);
 	bool writeComplete(handle_t handle, bool abort = false);
 	void prioritizeWrite(handle_t handle);
 
@@ -146,7 +172,7 @@ class LLTextureCache final : public LLWorkerThread
 	S32 getNumWrites() { return mWriters.size(); }
 	S64Bytes getUsage() { return S64Bytes(mTexturesSizeTotal); }
 	S64Bytes getMaxUsage() { return S64Bytes(sCacheMaxTexturesSize); }
-	U32 getEntries() { return mHeaderEntriesInfo.mEntries; }
+	U32 getEntries() { return mHeaderEntriesInfop ? mHeaderEntriesInfop->mEntries : 0; }
 	U32 getMaxEntries() { return sCacheMaxEntries; };
 	BOOL isInCache(const LLUUID& id) ;
 	BOOL isInLocal(const LLUUID& id) ; //not thread safe at the moment
@@ -155,6 +181,7 @@ class LLTextureCache final : public LLWorkerThread
 	// Accessed by LLTextureCacheWorker
 	std::string getLocalFileName(const LLUUID& id);
 	std::string getTextureFileName(const LLUUID& id);
+	std::string getMipFileName(const LLUUID& id);
 	void addCompleted(Responder* responder, bool success);
 	
 protected:
@@ -167,24 +194,24 @@ class LLTextureCache final : public LLWorkerThread
 	void purgeAllTextures(bool purge_directories);
 	void purgeTexturesLazy(F32 time_limit_sec);
 	void purgeTextures(bool validate);
-	LLAPRFile* openHeaderEntriesFile(bool readonly, S32 offset);
-	void closeHeaderEntriesFile();
-	void readEntriesHeader();
-	void setEntriesHeader();
-	void writeEntriesHeader();
+	void setEntriesHeader(EntriesInfo& info);
+	U32 getDesiredBucketCount() const;
+	bool openHeaderTable();
+	bool createHeaderTable();
+	bool mapHeaderTable(size_t size);
+	void closeHeaderTable(bool clean);
+	void flushHeaderTable(bool wait);
+	void rebuildHeaderTable(bool validate);
+	Bucket* findBucket(const LLUUID& id);
+	Bucket* insertBucket(const LLUUID& id);
+	void eraseBucket(Bucket* bucket);
 	S32 openAndReadEntry(const LLUUID& id, Entry& entry, bool create);
 	bool updateEntry(S32& idx, Entry& entry, S32 new_image_size, S32 new_body_size);
 	void updateEntryTimeStamp(S32 idx, Entry& entry) ;
-	U32 openAndReadEntries(std::vector<Entry>& entries);
-	void writeEntriesAndClose(const std::vector<Entry>& entries);
-	void readEntryFromHeaderImmediately(S32& idx, Entry& entry) ;
-	void writeEntryToHeaderImmediately(S32& idx, Entry& entry, bool write_header = false) ;
 	void removeEntry(S32 idx, Entry& entry, std::string& filename);
 	void removeCachedTexture(const LLUUID& id) ;
 	S32 getHeaderCacheEntry(const LLUUID& id, Entry& entry);
 	S32 setHeaderCacheEntry(const LLUUID& id, Entry& entry, S32 imagesize, S32 datasize);
-	void writeUpdatedEntries() ;
-	void updatedHeaderEntriesFile() ;
 	void lockHeaders() { mHeaderMutex.lock(); }
 	void unlockHeaders() { mHeaderMutex.unlock(); }
 	
@@ -198,7 +225,6 @@ class LLTextureCache final : public LLWorkerThread
 	LLMutex mHeaderMutex;
 	LLMutex mListMutex;
 	LLMutex mFastCacheMutex;
-	LLAPRFile* mHeaderAPRFile;
 	LLVolatileAPRPool* mFastCachePoolp;
 
 	// mLocalAPRFilePoolp is not thread safe and is meant only for workers
@@ -224,11 +250,19 @@ class LLTextureCache final : public LLWorkerThread
 	std::string mHeaderEntriesFileName;
 	std::string mHeaderDataFileName;
 	std::string mFastCacheFileName;
-	EntriesInfo mHeaderEntriesInfo;
 	std::set<S32> mFreeList; // deleted entries
 	std::set<LLUUID> mLRU;
-	typedef boost::unordered_flat_map<LLUUID, S32> id_map_t;
-	id_map_t mHeaderIDMap;
+
+	// The mapped texture.entries: EntriesInfo, TableInfo, then the buckets.
+	// In read only mode changes go to a private copy and never reach disk.
+	U8* mHeaderTablep;
+	size_t mHeaderTableSize;
+	bool mHeaderTableMapped; // false if mHeaderTablep is plain memory
+	EntriesInfo* mHeaderEntriesInfop;
+	TableInfo* mHeaderTableInfop;
+	Bucket* mBuckets;
+	U32 mBucketMask;
+	U32 mUsedBuckets; // live and deleted
 
 	LLAPRFile*   mFastCachep;
 	LLFrameTimer mFastCacheTimer;
@@ -236,13 +270,9 @@ class LLTextureCache final : public LLWorkerThread
 
 	// BODIES (TEXTURES minus headers)
 	std::string mTexturesDirName;
-	typedef boost::unordered_map<LLUUID,S32> size_map_t;
-	size_map_t mTexturesSizeMap;
 	S64 mTexturesSizeTotal;
 	LLAtomicBool mDoPurge;
 
-	typedef std::map<S32, Entry> idx_entry_map_t;
-	idx_entry_map_t mUpdatedEntryMap;
 	typedef std::vector<std::pair<S32, Entry> > idx_entry_vector_t;
 	idx_entry_vector_t mPurgeEntryList;
 
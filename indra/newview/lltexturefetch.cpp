@@ -1209,6 +1209,25 @@ bool LLTextureFetchWorker::doWork(S32 param)
 			}
 			else if ((mUrl.empty() || mFTType==FTT_SERVER_BAKE) && mFetcher->canLoadFromCache())
 			{
+				static LLCachedControl<U32> mip_cache_resolution(gSavedSettings, "TextureCacheMipResolution", 256);
+				if (mip_cache_resolution > 0 && offset == 0 && !mNeedsAux && mRetryAttempt == 0)
+				{
+					// A stored decoded mip that is good enough skips both the read and the decode
+					S32 discard = -1;
+					LLPointer<LLImageRaw> raw = mFetcher->mTextureCache->readFromMipCache(mID, mDesiredDiscard, discard);
+					if (raw.notNull())
+					{
+						add(LLTextureFetch::sCacheHit, 1.0);
+						mInCache = TRUE;
+						mRawImage = raw;
+						mLoadedDiscard = discard;
+						mDecodedDiscard = discard;
+						mDecoded = TRUE;
+						setState(DONE);
+						return doWork(param);
+					}
+				}
+
 				++mCacheReadCount;
 				CacheReadResponder* responder = new CacheReadResponder(mFetcher, mID, mFormattedImage);
 				mCacheReadTimer.reset();
@@ -1867,6 +1886,12 @@ bool LLTextureFetchWorker::doWork(S32 param)
 				LL_DEBUGS(LOG_TXT) << mID << ": Decoded. Discard: " << mDecodedDiscard
 								   << " Raw Image: " << llformat("%dx%d",mRawImage->getWidth(),mRawImage->getHeight()) << LL_ENDL;
 #endif
+				static LLCachedControl<U32> mip_cache_resolution(gSavedSettings, "TextureCacheMipResolution", 256);
+				if (mip_cache_resolution > 0 && mCachedSize > 0 && !mInLocalCache && !mNeedsAux)
+				{
+					// Came from the disk cache, so this is at least the second time it is seen
+					mFetcher->mTextureCache->writeToMipCache(mID, mRawImage, mDecodedDiscard, mip_cache_resolution);
+				}
 				setState(WRITE_TO_CACHE);
 			}
 			// fall through
@@ -84,6 +84,7 @@
 #include "llvocache.h"
 #include "llcorehttputil.h"
 #include "llstartup.h"
+#include "parallelfor.h"
 
 #include <algorithm>
 #include <iterator>
@@ -410,6 +411,97 @@ LLViewerObject* LLViewerObjectList::processObjectUpdateFromCache(LLVOCacheEntry*
 	return objectp;
 }
 
+// An ObjectData block of a compressed object update, copied out of the
+// message and unpacked as far as possible without touching viewer state
+struct LLCompressedObjectUpdate
+{
+	U8 mData[2048];
+	S32 mDataSize;
+	S32 mHeaderSize;	// bytes of mData unpacked into the fields below
+	U32 mFlags;
+	U32 mLocalID;
+	LLUUID mFullID;
+	LLPCode mPCode;
+	LLViewerRegion::CacheUpdateInfo mCacheInfo;
+};
+
+// Reused from message to message, main thread only
+static std::vector<LLCompressedObjectUpdate> sCompressedObjectUpdates;
+
+// Number of blocks per job. Unpacking a block only takes its header and
+// cache bounds, so a message needs more than this for the hand-off to pay
+// and anything smaller is unpacked inline.
+static const size_t COMPRESSED_UPDATE_GRAIN = 16;
+
+static void unpack_compressed_update(LLCompressedObjectUpdate& update, bool terse)
+{
+	LLDataPackerBinaryBuffer dp(update.mData, update.mDataSize);
+	if (terse)
+	{
+		dp.unpackU32(update.mLocalID, "LocalID");
+		update.mHeaderSize = dp.getCurrentSize();
+		return;
+	}
+
+	dp.unpackUUID(update.mFullID, "ID");
+	dp.unpackU32(update.mLocalID, "LocalID");
+	dp.unpackU8(update.mPCode, "PCode");
+	update.mHeaderSize = dp.getCurrentSize();
+
+	if (update.mPCode && !(update.mFlags & FLAGS_TEMPORARY_ON_REZ))
+	{
+		// Headed for the object cache
+		LLViewerRegion::CacheUpdateInfo& info = update.mCacheInfo;
+		LLViewerObject::unpackU32(&dp, info.mLocalID, "LocalID");
+		LLViewerObject::unpackU32(&dp, info.mCRC, "CRC");
+		info.mParentID = LLViewerObject::extractSpatialExtents(&dp, info.mPos, info.mScale, info.mRot);
+	}
+}
+
+// Copies every block out of the message, which has to happen on the main
+// thread, then unpacks them, on the job pool for large full updates. Terse
+// blocks only start with a local ID and are never worth a job.
+static void unpack_compressed_updates(LLMessageSystem* mesgsys, S32 num_objects, bool terse)
+{
+	LL_PROFILE_ZONE_SCOPED;
+
+	if (sCompressedObjectUpdates.size() < (size_t)num_objects)
+	{
+		sCompressedObjectUpdates.resize(num_objects);
+	}
+
+	for (S32 i = 0; i < num_objects; i++)
+	{
+		LLCompressedObjectUpdate& update = sCompressedObjectUpdates[i];
+		S32 size = mesgsys->getSizeFast(_PREHASH_ObjectData, i, _PREHASH_Data);
+		update.mDataSize = llclamp(size, 0, (S32)sizeof(update.mData));
+		mesgsys->getBinaryDataFast(_PREHASH_ObjectData, _PREHASH_Data, update.mData, 0, i, sizeof(update.mData));
+		update.mFlags = 0;
+		if (!terse)
+		{
+			mesgsys->getU32Fast(_PREHASH_ObjectData, _PREHASH_UpdateFlags, update.mFlags, i);
+		}
+	}
+
+	if (terse)
+	{
+		for (S32 i = 0; i < num_objects; i++)
+		{
+			unpack_compressed_update(sCompressedObjectUpdates[i], terse);
+		}
+		return;
+	}
+
+	LL::parallel_for(num_objects, COMPRESSED_UPDATE_GRAIN,
+		[terse](size_t begin, size_t end)
+		{
+			for (size_t i = begin; i < end; ++i)
+			{
+				unpack_compressed_update(sCompressedObjectUpdates[i], terse);
+			}
+		});
+}
+
 void LLViewerObjectList::processObjectUpdate(LLMessageSystem *mesgsys,
 											 void **user_data,
 											 const EObjectUpdateType update_type,
@@ -477,34 +569,34 @@ void LLViewerObjectList::processObjectUpdate(LLMessageSystem *mesgsys,
 		return;
 	}
 
-	U8 compressed_dpbuffer[2048];
-	LLDataPackerBinaryBuffer compressed_dp(compressed_dpbuffer, 2048);
 	LLViewerStatsRecorder& recorder = LLViewerStatsRecorder::instance();
 
+	if (compressed)
+	{
+		// Unpack every block first, potentially in parallel, then apply
+		// them in order below
+		unpack_compressed_updates(mesgsys, num_objects, update_type == OUT_TERSE_IMPROVED);
+	}
+
 	for (i = 0; i < num_objects; i++)
 	{
 		BOOL justCreated = FALSE;
 		bool update_cache = false; //update object cache if it is a full-update or terse update
+		LLDataPackerBinaryBuffer compressed_dp;
 
 		if (compressed)
 		{
-			compressed_dp.reset();
-
-			S32 uncompressed_length = mesgsys->getSizeFast(_PREHASH_ObjectData, i, _PREHASH_Data);
-#ifdef SHOW_DEBUG
-			LL_DEBUGS("ObjectUpdate") << "got binary data from message to compressed_dpbuffer" << LL_ENDL;
-#endif
-			mesgsys->getBinaryDataFast(_PREHASH_ObjectData, _PREHASH_Data, compressed_dpbuffer, 0, i, 2048);
-			compressed_dp.assignBuffer(compressed_dpbuffer, uncompressed_length);
+			LLCompressedObjectUpdate& update = sCompressedObjectUpdates[i];
+			compressed_dp.assignBuffer(update.mData, update.mDataSize);
+			// continue where unpacking stopped
+			compressed_dp.shift(update.mHeaderSize);
+			local_id = update.mLocalID;
 
 			if (update_type != OUT_TERSE_IMPROVED) // OUT_FULL_COMPRESSED only?
 			{
-				U32 flags = 0;
-				mesgsys->getU32Fast(_PREHASH_ObjectData, _PREHASH_UpdateFlags, flags, i);
-
-				compressed_dp.unpackUUID(fullid, "ID");
-				compressed_dp.unpackU32(local_id, "LocalID");
-				compressed_dp.unpackU8(pcode, "PCode");
+				U32 flags = update.mFlags;
+				fullid = update.mFullID;
+				pcode = update.mPCode;
 				
 				if (pcode == 0)
 				{
@@ -520,14 +612,13 @@ void LLViewerObjectList::processObjectUpdate(LLMessageSystem *mesgsys,
 				else if ((flags & FLAGS_TEMPORARY_ON_REZ) == 0)
 				{
 					//send to object cache
-					regionp->cacheFullUpdate(compressed_dp, flags);
+					regionp->cacheFullUpdate(compressed_dp, flags, &update.mCacheInfo);
 					continue;
 				}
 			}
 			else //OUT_TERSE_IMPROVED
 			{
 				update_cache = true;
-				compressed_dp.unpackU32(local_id, "LocalID");
 				getUUIDFromLocal(fullid,
 								 local_id,
 								 gMessageSystem->getSenderIP(),
@@ -1013,6 +1104,8 @@ void LLViewerObjectList::update(LLAgent &agent)
 				objectp->idleUpdate(agent, frame_time);
 			}
 		}
+
+		LLVOAvatar::updatePendingPoses();
 	}
 	else
 	{
@@ -1024,6 +1117,9 @@ void LLViewerObjectList::update(LLAgent &agent)
                 objectp->idleUpdate(agent, frame_time);
 		}
 
+		// finish avatars that left their animation to the job pool
+		LLVOAvatar::updatePendingPoses();
+
 		//update flexible objects
 		LLVolumeImplFlexible::updateClass();
 
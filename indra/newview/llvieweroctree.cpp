@@ -1334,39 +1334,93 @@ BOOL LLViewerOctreePartition::isOcclusionEnabled()
 //class LLViewerOctreeCull definitions
 //-----------------------------------------------------------------------------------
 
+bool LLViewerOctreeCull::sBatchFrustumCheck = true;
+
+namespace
+{
+	// Run a four box LLCamera test over the group bounds of count <= 8 groups
+	template <typename TEST>
+	void batch_group_bounds(const LLViewerOctreeGroup* const* groups, U32 count, S32* results, TEST test)
+	{
+		const LLVector4a* bounds[8];
+		for (U32 i = 0; i < count; i++)
+		{
+			bounds[i] = groups[i]->getBounds();
+		}
+		ll_aabb_test_batch(bounds, count, results, test);
+	}
+}
+
 //virtual 
 bool LLViewerOctreeCull::earlyFail(LLViewerOctreeGroup* group)
 {	
 	return false;
 }
-	
+
 //virtual 
-void LLViewerOctreeCull::traverse(const OctreeNode* n)
+bool LLViewerOctreeCull::earlyFailNode(const OctreeNode* n)
 {
-	LLViewerOctreeGroup* group = (LLViewerOctreeGroup*) n->getListener(0);
+	return earlyFail((LLViewerOctreeGroup*) n->getListener(0));
+}
 
-	if (earlyFail(group))
+//virtual 
+bool LLViewerOctreeCull::skipFrustumCheckNode(const OctreeNode* n)
+{
+	return ((LLViewerOctreeGroup*) n->getListener(0))->hasState(LLViewerOctreeGroup::SKIP_FRUSTUM_CHECK);
+}
+
+//virtual 
+S32 LLViewerOctreeCull::frustumCheckNode(const OctreeNode* n)
+{
+	return frustumCheck((LLViewerOctreeGroup*) n->getListener(0));
+}
+
+//virtual 
+void LLViewerOctreeCull::frustumCheckNodes(const OctreeNode* const* nodes, U32 count, S32* results)
+{
+	const LLViewerOctreeGroup* groups[8];
+	for (U32 i = 0; i < count; i++)
 	{
-		return;
-	}
-		
-	if (mRes == 2 || 
-		(mRes && group->hasState(LLViewerOctreeGroup::SKIP_FRUSTUM_CHECK)))
-	{	//fully in, just add everything
-		OctreeTraveler::traverse(n);
+		groups[i] = (LLViewerOctreeGroup*) nodes[i]->getListener(0);
 	}
-	else
-	{
-		mRes = frustumCheck(group);
-				
-		if (mRes)
-		{ //at least partially in, run on down
-			OctreeTraveler::traverse(n);
-		}
+	frustumCheckBatch(groups, count, results);
+}
 
-		mRes = 0;
+//virtual 
+void LLViewerOctreeCull::frustumCheckBatch(const LLViewerOctreeGroup* const* groups, U32 count, S32* results)
+{
+	for (U32 i = 0; i < count; i++)
+	{
+		results[i] = frustumCheck(groups[i]);
 	}
 }
+
+//------------------------------------------
+//batched agent and region space group culling
+void LLViewerOctreeCull::AABBInFrustumNoFarClipGroupBounds(const LLViewerOctreeGroup* const* groups, U32 count, S32* results)
+{
+	batch_group_bounds(groups, count, results, [this](const LLVector4a* centers, const LLVector4a* radii, S32* res)
+		{
+			mCamera->AABBInFrustumNoFarClip4(centers, radii, res);
+		});
+}
+
+void LLViewerOctreeCull::AABBInFrustumGroupBounds(const LLViewerOctreeGroup* const* groups, U32 count, S32* results)
+{
+	batch_group_bounds(groups, count, results, [this](const LLVector4a* centers, const LLVector4a* radii, S32* res)
+		{
+			mCamera->AABBInFrustum4(centers, radii, res);
+		});
+}
+
+void LLViewerOctreeCull::AABBInRegionFrustumNoFarClipGroupBounds(const LLViewerOctreeGroup* const* groups, U32 count, S32* results)
+{
+	batch_group_bounds(groups, count, results, [this](const LLVector4a* centers, const LLVector4a* radii, S32* res)
+		{
+			mCamera->AABBInRegionFrustumNoFarClip4(centers, radii, res);
+		});
+}
+//------------------------------------------
 	
 //------------------------------------------
 //agent space group culling
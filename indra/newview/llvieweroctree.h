@@ -37,6 +37,7 @@
 #include "llvector4a.h"
 #include "llquaternion.h"
 #include "lloctree.h"
+#include "lloctreecull.h"
 #include "llviewercamera.h"
 
 class LLViewerRegion;
@@ -366,16 +367,24 @@ class LLViewerOctreePartition
 	U32              mLODPeriod;	//number of frames between LOD updates for a given spatial group (staggered by mLODSeed)
 };
 
-class LLViewerOctreeCull : public OctreeTraveler
+class LLViewerOctreeCull : public LLOctreeCullTraveler<LLViewerOctreeEntry, LLPointer<LLViewerOctreeEntry>>
 {
 public:
 	LLViewerOctreeCull(LLCamera* camera)
-		: mCamera(camera), mRes(0) { }
-	
-	virtual void traverse(const OctreeNode* n);
+		: mCamera(camera) { mBatchFrustumCheck = sBatchFrustumCheck; }
+
+	// If true, the children of partially visible nodes are frustum checked
+	// together with frustumCheckBatch instead of one at a time
+	static bool sBatchFrustumCheck;
 
 protected:
 	virtual bool earlyFail(LLViewerOctreeGroup* group);	
+
+	//traversal hooks, forwarded to the group versions below
+	virtual bool earlyFailNode(const OctreeNode* n);
+	virtual bool skipFrustumCheckNode(const OctreeNode* n);
+	virtual S32 frustumCheckNode(const OctreeNode* n);
+	virtual void frustumCheckNodes(const OctreeNode* const* nodes, U32 count, S32* results);
 	
 	//agent space group cull
 	S32 AABBInFrustumNoFarClipGroupBounds(const LLViewerOctreeGroup* group);	
@@ -396,8 +405,16 @@ class LLViewerOctreeCull : public OctreeTraveler
 	S32 AABBInRegionFrustumNoFarClipObjectBounds(const LLViewerOctreeGroup* group);
 	S32 AABBInRegionFrustumObjectBounds(const LLViewerOctreeGroup* group);
 	S32 AABBRegionSphereIntersectObjectExtents(const LLViewerOctreeGroup* group, const LLVector3& shift);	
+
+	//batched group cull, count <= 8, group bounds tested four at a time
+	void AABBInFrustumNoFarClipGroupBounds(const LLViewerOctreeGroup* const* groups, U32 count, S32* results);
+	void AABBInFrustumGroupBounds(const LLViewerOctreeGroup* const* groups, U32 count, S32* results);
+	void AABBInRegionFrustumNoFarClipGroupBounds(const LLViewerOctreeGroup* const* groups, U32 count, S32* results);
 	
 	virtual S32 frustumCheck(const LLViewerOctreeGroup* group) = 0;
+	// Result of frustumCheck for each of count <= 8 groups. Calls
+	// frustumCheck for each unless overridden.
+	virtual void frustumCheckBatch(const LLViewerOctreeGroup* const* groups, U32 count, S32* results);
 	virtual S32 frustumCheckObjects(const LLViewerOctreeGroup* group) = 0;
 
 	bool checkProjectionArea(const LLVector4a& center, const LLVector4a& size, const LLVector3& shift, F32 pixel_threshold, F32 near_radius);
@@ -408,7 +425,6 @@ class LLViewerOctreeCull : public OctreeTraveler
 	
 protected:
 	LLCamera *mCamera;
-	S32 mRes;
 };
 
 //scan the octree, output the info of each node for debug use.
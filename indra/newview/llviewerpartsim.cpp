@@ -42,6 +42,8 @@
 #include "llspatialpartition.h"
 #include "llvoavatarself.h"
 #include "llvovolume.h"
+#include "llvector4a.h"
+#include "parallelfor.h"
 
 const F32 PART_SIM_BOX_SIDE = 16.f;
 
@@ -189,6 +191,9 @@ LLViewerPartGroup::LLViewerPartGroup(const LLVector3 &center_agent, const F32 bo
 	}
 
 	mSkippedTime = 0.f;
+	mPendingUpdate = false;
+	mCallbackCount = 0;
+	mGeometrySerial = 0;
 
 	static U32 id_seed = 0;
 	mID = ++id_seed;
@@ -204,6 +209,7 @@ LLViewerPartGroup::~LLViewerPartGroup()
 		delete mParticles[i] ;
 	}
 	mParticles.clear();
+	mArrays.clear();
 	
 	LLViewerPartSim::decPartCount(count);
 }
@@ -267,7 +273,15 @@ BOOL LLViewerPartGroup::addPart(LLViewerPart* part, F32 desired_size)
 	gPipeline.markRebuild(mVOPartGroupp->mDrawable, LLDrawable::REBUILD_ALL);
 	
 	mParticles.push_back(part);
-	part->mSkipOffset=mSkippedTime;
+	// a group still finishing this frame's update is about to clear its
+	// skipped time, so nothing is owed against it
+	part->mSkipOffset = mPendingUpdate ? 0.f : mSkippedTime;
+	mArrays.push_back(*part);
+	if (part->mVPCallback)
+	{
+		mCallbackCount++;
+	}
+	mGeometrySerial++;
 	LLViewerPartSim::incPartCount(1);
 	return TRUE;
 }
@@ -275,131 +289,92 @@ BOOL LLViewerPartGroup::addPart(LLViewerPart* part, F32 desired_size)
 
 void LLViewerPartGroup::updateParticles(const F32 lastdt)
 {
-	F32 dt;
-	
-	LLVector3 gravity(0.f, 0.f, GRAVITY);
-
-	LLViewerPartSim::checkParticleCount(mParticles.size());
+	simulate(lastdt);
+	finishUpdate();
+}
 
-	LLViewerCamera* camera = LLViewerCamera::getInstance();
+void LLViewerPartGroup::simulate(const F32 lastdt)
+{
 	LLViewerRegion *regionp = getRegion();
-	S32 end = (S32) mParticles.size();
-	for (S32 i = 0 ; i < (S32)mParticles.size();)
-	{
-		LLVector3 a(0.f, 0.f, 0.f);
-		LLViewerPart* part = mParticles[i] ;
+	LLViewerPartArrays& arrays = mArrays;
+	llassert(arrays.size() == mParticles.size());
 
-		dt = lastdt + mSkippedTime - part->mSkipOffset;
-		part->mSkipOffset = 0.f;
-
-		// Update current time
-		const F32 cur_time = part->mLastUpdateTime + dt;
-		const F32 frac = cur_time / part->mMaxAge;
-
-		// "Drift" the object based on the source object
-		if (part->mFlags & LLPartData::LL_PART_FOLLOW_SRC_MASK)
-		{
-			part->mPosAgent = part->mPartSourcep->mPosAgent;
-			part->mPosAgent += part->mPosOffset;
-		}
-
-		// Do a custom callback if we have one...
-		if (part->mVPCallback)
-		{
-			(*part->mVPCallback)(*part, dt);
-		}
-
-		if (part->mFlags & LLPartData::LL_PART_WIND_MASK)
+	const U32 source_mask = LLPartData::LL_PART_FOLLOW_SRC_MASK | LLPartData::LL_PART_TARGET_POS_MASK |
+							LLPartData::LL_PART_TARGET_LINEAR_MASK | LLPartData::LL_PART_BOUNCE_MASK;
+	for (U32 i = 0; i < arrays.size(); i++)
+	{
+		if (arrays.mFlags[i] & source_mask)
 		{
-			part->mVelocity *= 1.f - 0.1f*dt;
-			part->mVelocity += 0.1f*dt*regionp->mWind.getVelocity(regionp->getPosRegionFromAgent(part->mPosAgent));
+			const LLViewerPartSource* sourcep = mParticles[i]->mPartSourcep;
+			for (U32 c = 0; c < 3; c++)
+			{
+				arrays.mSourcePos[c][i] = sourcep->mPosAgent.mV[c];
+				arrays.mTargetPos[c][i] = sourcep->mTargetPosAgent.mV[c];
+			}
 		}
+	}
 
-		// Now do interpolation towards a target
-		if (part->mFlags & LLPartData::LL_PART_TARGET_POS_MASK)
-		{
-			F32 remaining = part->mMaxAge - part->mLastUpdateTime;
-			F32 step = dt / remaining;
-
-			step = llclamp(step, 0.f, 0.1f);
-			step *= 5.f;
-			// we want a velocity that will result in reaching the target in the 
-			// Interpolate towards the target.
-			LLVector3 delta_pos = part->mPartSourcep->mTargetPosAgent - part->mPosAgent;
-
-			delta_pos /= remaining;
-
-			part->mVelocity *= (1.f - step);
-			part->mVelocity += step*delta_pos;
-		}
+	arrays.beginUpdate(lastdt + mSkippedTime);
 
+	for (U32 i = 0; i < arrays.size(); i++)
+	{
+		LLViewerPart* part = mParticles[i];
 
-		if (part->mFlags & LLPartData::LL_PART_TARGET_LINEAR_MASK)
-		{
-			LLVector3 delta_pos = part->mPartSourcep->mTargetPosAgent - part->mPartSourcep->mPosAgent;			
-			part->mPosAgent = part->mPartSourcep->mPosAgent;
-			part->mPosAgent += frac*delta_pos;
-			part->mVelocity = delta_pos;
-		}
-		else
+		// Do a custom callback if we have one...
+		if (part->mVPCallback)
 		{
-			// Do velocity interpolation
-			part->mPosAgent += dt*part->mVelocity;
-			part->mPosAgent += 0.5f*dt*dt*part->mAccel;
-			part->mVelocity += part->mAccel*dt;
+			arrays.store(i, *part);
+			(*part->mVPCallback)(*part, arrays.mDt[i]);
+			arrays.load(i, *part);
 		}
 
-		// Do a bounce test
-		if (part->mFlags & LLPartData::LL_PART_BOUNCE_MASK)
+		if (arrays.mFlags[i] & LLPartData::LL_PART_WIND_MASK)
 		{
-			// Need to do point vs. plane check...
-			// For now, just check relative to object height...
-			F32 dz = part->mPosAgent.mV[VZ] - part->mPartSourcep->mPosAgent.mV[VZ];
-			if (dz < 0)
+			LLVector3 pos_agent(arrays.mPos[VX][i], arrays.mPos[VY][i], arrays.mPos[VZ][i]);
+			LLVector3 wind = regionp->mWind.getVelocity(regionp->getPosRegionFromAgent(pos_agent));
+			for (U32 c = 0; c < 3; c++)
 			{
-				part->mPosAgent.mV[VZ] += -2.f*dz;
-				part->mVelocity.mV[VZ] *= -0.75f;
+				arrays.mWind[c][i] = wind.mV[c];
 			}
 		}
+	}
 
+	arrays.integrate();
 
-		// Reset the offset from the source position
-		if (part->mFlags & LLPartData::LL_PART_FOLLOW_SRC_MASK)
-		{
-			part->mPosOffset = part->mPosAgent;
-			part->mPosOffset -= part->mPartSourcep->mPosAgent;
-		}
-
-		// Do color interpolation
-		if (part->mFlags & LLPartData::LL_PART_INTERP_COLOR_MASK)
-		{
-			part->mColor.setVec(part->mStartColor);
-			// note: LLColor4's v%k means multiply-alpha-only,
-			//       LLColor4's v*k means multiply-rgb-only
-			part->mColor *= 1.f - frac; // rgb*k
-			part->mColor %= 1.f - frac; // alpha*k
-			part->mColor += frac%(frac*part->mEndColor); // rgb,alpha
-		}
-
-		// Do scale interpolation
-		if (part->mFlags & LLPartData::LL_PART_INTERP_SCALE_MASK)
-		{
-			part->mScale.setVec(part->mStartScale);
-			part->mScale *= 1.f - frac;
-			part->mScale += frac*part->mEndScale;
-		}
+	for (U32 i = 0; i < arrays.size(); i++)
+	{
+		LLViewerPart* part = mParticles[i];
+		arrays.store(i, *part);
 
 		// Do glow interpolation
+		const F32 frac = part->mLastUpdateTime / part->mMaxAge;
 		part->mGlow.mV[3] = (U8) ll_round(ll_lerp(part->mStartGlow, part->mEndGlow, frac)*255.f);
+	}
+
+	mGeometrySerial++;
+}
 
-		// Set the last update time to now.
-		part->mLastUpdateTime = cur_time;
+void LLViewerPartGroup::finishUpdate()
+{
+	LLViewerPartSim::checkParticleCount(mParticles.size());
+
+	LLViewerCamera* camera = LLViewerCamera::getInstance();
+	LLViewerPartArrays& arrays = mArrays;
 
+	S32 end = (S32) mParticles.size();
+	for (S32 i = 0 ; i < (S32)mParticles.size();)
+	{
+		LLViewerPart* part = mParticles[i] ;
 
 		// Kill dead particles (either flagged dead, or too old)
 		if ((part->mLastUpdateTime > part->mMaxAge) || (LLViewerPart::LL_PART_DEAD_MASK == part->mFlags))
 		{
+			if (part->mVPCallback)
+			{
+				mCallbackCount--;
+			}
 			vector_replace_with_last(mParticles, mParticles.begin() + i);
+			arrays.replaceWithLast(i);
 			delete part ;
 		}
 		else 
@@ -408,8 +383,13 @@ void LLViewerPartGroup::updateParticles(const F32 lastdt)
 			if (!posInGroup(part->mPosAgent, desired_size))
 			{
 				// Transfer particles between groups
+				if (part->mVPCallback)
+				{
+					mCallbackCount--;
+				}
 				LLViewerPartSim::getInstance()->put(part) ;
 				vector_replace_with_last(mParticles, mParticles.begin() + i);
+				arrays.replaceWithLast(i);
 			}
 			else
 			{
@@ -421,6 +401,8 @@ void LLViewerPartGroup::updateParticles(const F32 lastdt)
 	S32 removed = end - (S32)mParticles.size();
 	if (removed > 0)
 	{
+		mGeometrySerial++;
+
 		// we removed one or more particles, so flag this group for update
 		if (mVOPartGroupp.notNull())
 		{
@@ -450,6 +432,8 @@ void LLViewerPartGroup::shift(const LLVector3 &offset)
 	{
 		mParticles[i]->mPosAgent += offset;
 	}
+	mArrays.shift(offset);
+	mGeometrySerial++;
 }
 
 void LLViewerPartGroup::removeParticlesByID(const U32 source_id)
@@ -459,6 +443,7 @@ void LLViewerPartGroup::removeParticlesByID(const U32 source_id)
 		if(mParticles[i]->mPartSourcep->getID() == source_id)
 		{
 			mParticles[i]->mFlags = LLViewerPart::LL_PART_DEAD_MASK;
+			mArrays.mFlags[i] = LLViewerPart::LL_PART_DEAD_MASK;
 		}		
 	}
 }
@@ -741,10 +726,15 @@ void LLViewerPartSim::updateSimulation()
 		num_updates++;
 	}
 
+	static LLCachedControl<bool> parallel_particles(gSavedSettings, "RenderParallelParticles", true);
+
+	// pick the groups that update this frame
+	mUpdateGroups.clear();
 	count = (S32) mViewerPartGroups.size();
 	for (i = 0; i < count; i++)
 	{
-		LLViewerObject* vobj = mViewerPartGroups[i]->mVOPartGroupp;
+		LLViewerPartGroup* groupp = mViewerPartGroups[i];
+		LLViewerObject* vobj = groupp->mVOPartGroupp;
 
 		S32 visirate = 1;
 		if (vobj && !vobj->isDead() && vobj->mDrawable && !vobj->mDrawable->isDead())
@@ -756,28 +746,76 @@ void LLViewerPartSim::updateSimulation()
 			}
 		}
 
-		if ((LLDrawable::getCurrentFrame()+mViewerPartGroups[i]->mID)%visirate == 0)
+		if ((LLDrawable::getCurrentFrame()+groupp->mID)%visirate == 0)
 		{
 			if (vobj && !vobj->isDead() && vobj->mDrawable)
 			{
 				gPipeline.markRebuild(vobj->mDrawable, LLDrawable::REBUILD_ALL);
 			}
-			mViewerPartGroups[i]->updateParticles(dt * visirate);
-			mViewerPartGroups[i]->mSkippedTime=0.0f;
-			if (!mViewerPartGroups[i]->getCount())
-			{
-				delete mViewerPartGroups[i];
-				vector_replace_with_last(mViewerPartGroups, mViewerPartGroups.begin() + i);
-				i--;
-				count--;
-			}
+			groupp->mPendingUpdate = true;
+			mUpdateGroups.emplace_back(groupp, dt * visirate);
 		}
 		else
 		{	
-			mViewerPartGroups[i]->mSkippedTime+=dt;
+			groupp->mSkippedTime+=dt;
 		}
+	}
 
+	// simulate them, one job per group unless a particle callback needs
+	// the main thread
+	if (parallel_particles && mUpdateGroups.size() > 1)
+	{
+		LL::parallel_for(mUpdateGroups.size(), 1, [this](size_t begin, size_t end)
+			{
+				for (size_t j = begin; j < end; ++j)
+				{
+					if (mUpdateGroups[j].first->canSimulateAsync())
+					{
+						mUpdateGroups[j].first->simulate(mUpdateGroups[j].second);
+					}
+				}
+			});
+
+		for (const auto& update : mUpdateGroups)
+		{
+			if (!update.first->canSimulateAsync())
+			{
+				update.first->simulate(update.second);
+			}
+		}
+	}
+	else
+	{
+		for (const auto& update : mUpdateGroups)
+		{
+			update.first->simulate(update.second);
+		}
 	}
+
+	// then kill and transfer particles in list order, groups created by
+	// transfers wait for the next frame
+	count = (S32) mViewerPartGroups.size();
+	for (i = 0; i < count; i++)
+	{
+		LLViewerPartGroup* groupp = mViewerPartGroups[i];
+		if (!groupp->mPendingUpdate)
+		{
+			continue;
+		}
+
+		groupp->mPendingUpdate = false;
+		groupp->finishUpdate();
+		groupp->mSkippedTime=0.0f;
+		if (!groupp->getCount())
+		{
+			delete groupp;
+			vector_replace_with_last(mViewerPartGroups, mViewerPartGroups.begin() + i);
+			i--;
+			count--;
+		}
+	}
+	mUpdateGroups.clear();
+
 	if (LLDrawable::getCurrentFrame()%16==0)
 	{
 		if (sParticleCount > sMaxParticleCount * 0.875f
@@ -800,6 +838,45 @@ void LLViewerPartSim::updateSimulation()
 	//LL_INFOS() << "Particles: " << sParticleCount << " Adaptive Rate: " << sParticleAdaptiveRate << LL_ENDL;
 }
 
+void LLViewerPartSim::updateBillboards()
+{
+	LL_PROFILE_ZONE_NAMED_CATEGORY_PIPELINE("Particle Billboards");
+	static LLCachedControl<bool> parallel_particles(gSavedSettings, "RenderParallelParticles", true);
+
+	if (!parallel_particles || !(gPipeline.hasRenderType(LLPipeline::RENDER_TYPE_PARTICLES)))
+	{ //particle rebuilds generate billboards themselves
+		return;
+	}
+
+	// groups culled last frame are left to the rebuild, they rarely get one
+	std::vector<std::pair<LLVOPartGroup*, LLVector3> > jobs;
+	for (LLViewerPartGroup* groupp : mViewerPartGroups)
+	{
+		LLVOPartGroup* vobj = groupp->mVOPartGroupp;
+		if (!vobj || vobj->isDead() || !vobj->mDrawable || vobj->mDrawable->isDead() ||
+			vobj->hasCurrentBillboards())
+		{
+			continue;
+		}
+
+		LLSpatialGroup* group = vobj->mDrawable->getSpatialGroup();
+		if (group && !group->isVisible())
+		{
+			continue;
+		}
+
+		jobs.emplace_back(vobj, vobj->getCameraPosition());
+	}
+
+	LL::parallel_for(jobs.size(), 1, [&jobs](size_t begin, size_t end)
+		{
+			for (size_t j = begin; j < end; ++j)
+			{
+				jobs[j].first->generateBillboards(jobs[j].second);
+			}
+		});
+}
+
 void LLViewerPartSim::updatePartBurstRate()
 {
 	if (!(LLDrawable::getCurrentFrame() & 0xf))
@@ -30,6 +30,7 @@
 #include "llframetimer.h"
 #include "llpointer.h"
 #include "llpartdata.h"
+#include "llviewerpartarrays.h"
 #include "llviewerpartsource.h"
 
 class LLViewerTexture;
@@ -37,8 +38,6 @@ class LLViewerPart;
 class LLViewerRegion;
 class LLVOPartGroup;
 
-#define LL_MAX_PARTICLE_COUNT 8192
-
 typedef void (*LLVPCallback)(LLViewerPart &part, const F32 dt);
 
 ///////////////////
@@ -67,7 +66,8 @@ class LLViewerPart final : public LLPartData
 	LLViewerPart*		mParent;					// particle to connect to if this is part of a particle ribbon
 	LLViewerPart*		mChild;						// child particle for clean reference destruction
 
-	// Current particle state (possibly used for rendering)
+	// Current particle state (possibly used for rendering), simulated in the
+	// group's LLViewerPartArrays and copied back after every update
 	LLPointer<LLViewerTexture>	mImagep;
 	LLVector3		mPosAgent;
 	LLVector3		mVelocity;
@@ -84,7 +84,6 @@ class LLViewerPart final : public LLPartData
 };
 
 
-
 class LLViewerPartGroup
 {
 public:
@@ -99,6 +98,18 @@ class LLViewerPartGroup
 	
 	void updateParticles(const F32 lastdt);
 
+	// updateParticles() in two halves.  simulate() only touches this group's
+	// own particles and may run on a worker thread as long as the group has
+	// no particles with callbacks.  finishUpdate() kills and transfers
+	// particles between groups and must run on the main thread.
+	void simulate(const F32 lastdt);
+	void finishUpdate();
+	bool canSimulateAsync() const			{ return mCallbackCount == 0; }
+
+	// bumped whenever particle positions, scales or colors change, so
+	// billboards generated ahead of a rebuild can be checked for staleness
+	U32 getGeometrySerial() const			{ return mGeometrySerial; }
+
 	BOOL posInGroup(const LLVector3 &pos, const F32 desired_size = -1.f);
 
 	void shift(const LLVector3 &offset);
@@ -115,6 +126,8 @@ class LLViewerPartGroup
 
 	void removeParticlesByID(const U32 source_id);
 	
+	LLViewerPartArrays mArrays;
+
 	LLPointer<LLVOPartGroup> mVOPartGroupp;
 
 	BOOL mUniformParticles;
@@ -122,8 +135,12 @@ class LLViewerPartGroup
 
 	F32 mSkippedTime;
 	bool mHud;
+	bool mPendingUpdate;
 
 protected:
+	U32 mCallbackCount;
+	U32 mGeometrySerial;
+
 	LLVector3 mCenterAgent;
 	F32 mBoxRadius;
 	F32 mBoxSide;
@@ -148,6 +165,10 @@ class LLViewerPartSim final : public LLSingleton<LLViewerPartSim>
 
 	void updateSimulation();
 
+	// Generate billboard vertices for groups simulated this frame, one job
+	// per group.  Called after the camera update, before geometry rebuilds.
+	void updateBillboards();
+
 	void addPartSource(LLPointer<LLViewerPartSource> sourcep);
 
 	void cleanupRegion(LLViewerRegion *regionp);
@@ -191,6 +212,7 @@ class LLViewerPartSim final : public LLSingleton<LLViewerPartSim>
 	LLViewerPartGroup *put(LLViewerPart* part);
 
 	group_list_t mViewerPartGroups;
+	std::vector<std::pair<LLViewerPartGroup*, F32> > mUpdateGroups;	// groups updating this frame and their time step
 	source_list_t mViewerPartSources;
 	LLFrameTimer mSimulationTimer;
 
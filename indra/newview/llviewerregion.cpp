@@ -648,7 +648,10 @@ LLViewerRegion::LLViewerRegion(const U64 &handle,
 	mLegacyHttpUrl(""),
 	mViewerAssetUrl(""),
 	mCacheLoaded(FALSE),
+	mCacheLoading(FALSE),
 	mCacheDirty(FALSE),
+	mHandshakeReplyPending(FALSE),
+	mCacheLoadID(0),
 	mReleaseNotesRequested(FALSE),
 	mCapabilitiesState(CAPABILITIES_STATE_INIT),
 	mSimulatorFeaturesReceived(false),
@@ -807,24 +810,57 @@ void LLViewerRegion::setRegionID(const LLUUID& region_id)
 
 void LLViewerRegion::loadObjectCache()
 {
-	if (mCacheLoaded)
+	if (mCacheLoaded || mCacheLoading)
 	{
 		return;
 	}
 
-	// Presume success.  If it fails, we don't want to try again.
-	mCacheLoaded = TRUE;
-
 	if(LLVOCache::instanceExists())
 	{
-        LLVOCache & vocache = LLVOCache::instance();
-		vocache.readFromCache(mHandle, mImpl->mCacheID, mImpl->mCacheMap);
-        vocache.readGenericExtrasFromCache(mHandle, mImpl->mCacheID, mImpl->mGLTFOverridesLLSD);
+		// Regions can be recreated at the same handle before a load
+		// completes, only deliver to the one that asked.
+		static U32 sNextCacheLoadID = 0;
+		mCacheLoadID = ++sNextCacheLoadID;
+		mCacheLoading = TRUE;
 
-		if (mImpl->mCacheMap.empty())
-		{
-			mCacheDirty = TRUE;
-		}
+		U64 handle = mHandle;
+		U32 load_id = mCacheLoadID;
+		LLVOCache::instance().readFromCacheAsync(mHandle, mImpl->mCacheID,
+			[handle, load_id](LLVOCacheEntry::vocache_entry_map_t& entries, LLVOCacheEntry::vocache_gltf_overrides_map_t& extras, bool done)
+			{
+				LLViewerRegion* regionp = LLWorld::instanceExists() ? LLWorld::getInstance()->getRegionFromHandle(handle) : NULL;
+				if (regionp && !regionp->mDead && regionp->mCacheLoading && regionp->mCacheLoadID == load_id)
+				{
+					// Anything the simulator sent meanwhile is newer than the cache
+					regionp->mImpl->mCacheMap.insert(entries.begin(), entries.end());
+					regionp->mImpl->mGLTFOverridesLLSD.insert(extras.begin(), extras.end());
+					if (done)
+					{
+						regionp->objectCacheLoaded();
+					}
+				}
+			});
+	}
+	else
+	{
+		mCacheLoaded = TRUE;
+		mCacheDirty = TRUE;
+	}
+}
+
+void LLViewerRegion::objectCacheLoaded()
+{
+	mCacheLoading = FALSE;
+	mCacheLoaded = TRUE;
+	if (mImpl->mCacheMap.empty())
+	{
+		mCacheDirty = TRUE;
+	}
+
+	if (mHandshakeReplyPending)
+	{
+		mHandshakeReplyPending = FALSE;
+		sendRegionHandshakeReply();
 	}
 }
 
@@ -2618,7 +2654,7 @@ void LLViewerRegion::findOrphans(U32 parent_id)
 	}
 }
 
-void LLViewerRegion::decodeBoundingInfo(LLVOCacheEntry* entry)
+void LLViewerRegion::decodeBoundingInfo(LLVOCacheEntry* entry, const CacheUpdateInfo* info)
 {
 	if(!sVOCacheCullingEnabled)
 	{
@@ -2655,7 +2691,14 @@ void LLViewerRegion::decodeBoundingInfo(LLVOCacheEntry* entry)
 
 		//set parent id
 		U32	parent_id = 0;
-		LLViewerObject::unpackParentID(entry->getDP(), parent_id);
+		if (info)
+		{
+			parent_id = info->mParentID;
+		}
+		else
+		{
+			LLViewerObject::unpackParentID(entry->getDP(), parent_id);
+		}
 		if(parent_id != entry->getParentID())
 		{				
 			entry->setParentID(parent_id);
@@ -2675,7 +2718,18 @@ void LLViewerRegion::decodeBoundingInfo(LLVOCacheEntry* entry)
 	LLQuaternion rot;
 
 	//decode spatial info and parent info
-	U32 parent_id = LLViewerObject::extractSpatialExtents(entry->getDP(), pos, scale, rot);
+	U32 parent_id = 0;
+	if (info)
+	{
+		parent_id = info->mParentID;
+		pos = info->mPos;
+		scale = info->mScale;
+		rot = info->mRot;
+	}
+	else
+	{
+		parent_id = LLViewerObject::extractSpatialExtents(entry->getDP(), pos, scale, rot);
+	}
 	
 	U32 old_parent_id = entry->getParentID();
 	bool same_old_parent = false;
@@ -2784,14 +2838,22 @@ void LLViewerRegion::decodeBoundingInfo(LLVOCacheEntry* entry)
 	return ;
 }
 
-LLViewerRegion::eCacheUpdateResult LLViewerRegion::cacheFullUpdate(LLDataPackerBinaryBuffer &dp, U32 flags)
+LLViewerRegion::eCacheUpdateResult LLViewerRegion::cacheFullUpdate(LLDataPackerBinaryBuffer &dp, U32 flags, const CacheUpdateInfo* info)
 {
 	eCacheUpdateResult result;
 	U32 crc;
 	U32 local_id;
 
-	LLViewerObject::unpackU32(&dp, local_id, "LocalID");
-	LLViewerObject::unpackU32(&dp, crc, "CRC");
+	if (info)
+	{
+		local_id = info->mLocalID;
+		crc = info->mCRC;
+	}
+	else
+	{
+		LLViewerObject::unpackU32(&dp, local_id, "LocalID");
+		LLViewerObject::unpackU32(&dp, crc, "CRC");
+	}
 
 	LLVOCacheEntry* entry = getCacheEntry(local_id, false);
 
@@ -2832,7 +2894,7 @@ LLViewerRegion::eCacheUpdateResult LLViewerRegion::cacheFullUpdate(LLDataPackerB
 
 // [SL:KB] - Patch: World-Derender | Checked: 2014-08-10 (Catznip-3.7)
 		if (fUpdateObj)
-			decodeBoundingInfo(entry);
+			decodeBoundingInfo(entry, info);
 // [/SL:KB]
 	}
 	else
@@ -2850,7 +2912,7 @@ LLViewerRegion::eCacheUpdateResult LLViewerRegion::cacheFullUpdate(LLDataPackerB
 		
 		mImpl->mCacheMap[local_id] = entry;
 		
-		decodeBoundingInfo(entry);
+		decodeBoundingInfo(entry, info);
 	}
 	entry->setUpdateFlags(flags);
 
@@ -3242,9 +3304,22 @@ void LLViewerRegion::unpackRegionHandshake()
 	loadObjectCache();
 
 	// After loading cache, signal that simulator can start
-	// sending data.
+	// sending data, so that its cache probes find the loaded entries.
+	if (mCacheLoaded)
+	{
+		sendRegionHandshakeReply();
+	}
+	else
+	{
+		mHandshakeReplyPending = TRUE;
+	}
+}
+
+void LLViewerRegion::sendRegionHandshakeReply()
+{
 	// TODO: Send all upstream viewer->sim handshake info here.
-	LLHost host = msg->getSender();
+	LLMessageSystem* msg = gMessageSystem;
+	LLHost host = getHost();
 	msg->newMessageFast(_PREHASH_RegionHandshakeReply);
 	msg->nextBlockFast(_PREHASH_AgentData);
 	msg->addUUIDFast(_PREHASH_AgentID, gAgent.getID());
@@ -111,6 +111,7 @@ class LLViewerRegion final : public LLCapabilityProvider // implements this inte
 	~LLViewerRegion();
 
 	// Call this after you have the region name and handle.
+	// Loads in the background, see objectCacheLoaded().
 	void loadObjectCache();
 	void saveObjectCache();
 
@@ -367,8 +368,20 @@ class LLViewerRegion final : public LLCapabilityProvider // implements this inte
 		CACHE_UPDATE_REPLACED
 	} eCacheUpdateResult;
 
+	// Fields of a full update the object cache needs, when they were
+	// already unpacked from the update off the main thread
+	struct CacheUpdateInfo
+	{
+		U32 mLocalID;
+		U32 mCRC;
+		U32 mParentID;
+		LLVector3 mPos;
+		LLVector3 mScale;
+		LLQuaternion mRot;
+	};
+
 	// handle a full update message
-	eCacheUpdateResult cacheFullUpdate(LLDataPackerBinaryBuffer &dp, U32 flags);
+	eCacheUpdateResult cacheFullUpdate(LLDataPackerBinaryBuffer &dp, U32 flags, const CacheUpdateInfo* info = NULL);
 	eCacheUpdateResult cacheFullUpdate(LLViewerObject* objectp, LLDataPackerBinaryBuffer &dp, U32 flags);
 
     void cacheFullUpdateGLTFOverride(const LLGLTFOverrideCacheEntry &override_data);
@@ -485,7 +498,9 @@ class LLViewerRegion final : public LLCapabilityProvider // implements this inte
 	void updateVisibleEntries(F32 max_time); //update visible entries
 
 	void addCacheMiss(U32 id, LLViewerRegion::eCacheMissType miss_type);
-	void decodeBoundingInfo(LLVOCacheEntry* entry);
+	void decodeBoundingInfo(LLVOCacheEntry* entry, const CacheUpdateInfo* info = NULL);
+	void objectCacheLoaded();
+	void sendRegionHandshakeReply();
 	bool isNonCacheableObjectCreated(U32 local_id);	
 	void setGodnames();
 
@@ -619,7 +634,10 @@ class LLViewerRegion final : public LLCapabilityProvider // implements this inte
 	// Regions can have order 10,000 objects, so assume
 	// a structure of size 2^14 = 16,000
 	BOOL									mCacheLoaded;
+	BOOL                                    mCacheLoading;
 	BOOL                                    mCacheDirty;
+	BOOL                                    mHandshakeReplyPending; // waiting for the object cache
+	U32                                     mCacheLoadID;
 	BOOL	mAlive;					// can become false if circuit disconnects
 	BOOL	mSimulatorFeaturesReceived;
 	BOOL    mReleaseNotesRequested;
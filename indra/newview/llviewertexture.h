@@ -199,6 +199,13 @@ class LLViewerTexture : public LLGLTexture
 	mutable S32  mMaxVirtualSizeResetInterval;
 	LLFrameTimer mLastReferencedTimer;	
 
+	// Bookkeeping for LLViewerTextureList's visible texture pass: this
+	// texture's entry in the list being collected, and the last pass that
+	// updated its fetch.
+	S32 mVisibleSlot = -1;
+	U32 mVisiblePass = 0;
+	U32 mVisibleUpdatePass = 0;
+
 	ll_face_list_t    mFaceList[LLRender::NUM_TEXTURE_CHANNELS]; //reverse pointer pointing to the faces using this image as texture
 	U32               mNumFaces[LLRender::NUM_TEXTURE_CHANNELS];
 	LLFrameTimer      mLastFaceListUpdateTimer ;
@@ -91,7 +91,8 @@ LLTextureKey::LLTextureKey(LLUUID id, ETexListType tex_type)
 
 LLViewerTextureList::LLViewerTextureList() 
 	: mForceResetTextureStats(FALSE),
-	mInitialized(FALSE)
+	mInitialized(FALSE),
+	mVisiblePass(1)
 {
 }
 
@@ -898,7 +899,155 @@ static void touch_texture(LLViewerFetchedTexture* tex, F32 vsize)
 
 extern BOOL gCubeSnapshot;
 
-void LLViewerTextureList::updateImageDecodePriority(LLViewerFetchedTexture* imagep)
+// Virtual size a face asks of its textures, scaled by the texture entry's
+// repeats and the discard bias
+static F32 face_virtual_size(LLFace* face, F32 pixel_area, bool in_frustum)
+{
+    static LLCachedControl<F32> bias_distance_scale(gSavedSettings, "TextureBiasDistanceScale", 1.f);
+
+    F32 vsize = pixel_area;
+
+    // scale desired texture resolution higher or lower depending on texture scale
+    const LLTextureEntry* te = face->getTextureEntry();
+    F32 min_scale = te ? llmin(fabsf(te->getScaleS()), fabsf(te->getScaleT())) : 1.f;
+    min_scale = llmax(min_scale*min_scale, 0.1f);
+
+    vsize /= min_scale;
+
+    vsize /= LLViewerTexture::sDesiredDiscardBias;
+    vsize /= llmax(1.f, (LLViewerTexture::sDesiredDiscardBias-1.f) * (1.f + face->getDrawable()->mDistanceWRTCamera * bias_distance_scale));
+
+    if (!in_frustum)
+    { // further reduce by discard bias when off screen or occluded
+        vsize /= LLViewerTexture::sDesiredDiscardBias;
+    }
+
+    return vsize;
+}
+
+void LLViewerTextureList::addVisibleFaces(LLDrawable* drawablep)
+{
+    static LLCachedControl<bool> cull_priorities(gSavedSettings, "TextureCullPriorities", true);
+    if (!cull_priorities)
+    {
+        return;
+    }
+
+    const bool is_volume = drawablep->getVOVolume() != nullptr;
+    for (S32 i = 0; i < drawablep->getNumFaces(); ++i)
+    {
+        LLFace* face = drawablep->getFace(i);
+        if (!face || !face->getViewerObject() || !face->getTextureEntry())
+        {
+            continue;
+        }
+
+        // The drawable was just found visible. For volumes, the face's
+        // virtual size from the last LLVOVolume::updateTextureVirtualSize()
+        // says whether the face itself was in the frustum, without
+        // recomputing its area. Nothing refreshes the area of other faces,
+        // such as particles, so compute it here.
+        bool in_frustum;
+        if (is_volume)
+        {
+            in_frustum = face->getVirtualSize() > 0.f;
+        }
+        else
+        {
+            F32 radius;
+            F32 cos_angle_to_view_dir;
+            in_frustum = face->calcPixelArea(cos_angle_to_view_dir, radius);
+        }
+        F32 vsize = face_virtual_size(face, face->getPixelArea(), in_frustum);
+        if (vsize <= 0.f)
+        {
+            continue;
+        }
+
+        // same as updateImageDecodePriority(): faces with a GLTF material
+        // only count toward the material's textures
+        const LLTextureEntry* te = face->getTextureEntry();
+        LLFetchedGLTFMaterial* mat = (LLFetchedGLTFMaterial*)te->getGLTFRenderMaterial();
+        if (mat)
+        {
+            addVisibleTexture(mat->mBaseColorTexture, vsize);
+            addVisibleTexture(mat->mNormalTexture, vsize);
+            addVisibleTexture(mat->mMetallicRoughnessTexture, vsize);
+            addVisibleTexture(mat->mEmissiveTexture, vsize);
+        }
+        else
+        {
+            for (U32 ch = 0; ch < LLRender::NUM_TEXTURE_CHANNELS; ++ch)
+            {
+                addVisibleTexture(LLViewerTextureManager::staticCastToFetchedTexture(face->getTexture(ch)), vsize);
+            }
+        }
+    }
+}
+
+void LLViewerTextureList::addVisibleTexture(LLViewerFetchedTexture* imagep, F32 vsize)
+{
+    if (!imagep || imagep->isInDebug() || imagep->isUnremovable())
+    {
+        return;
+    }
+
+    if (imagep->mVisiblePass != mVisiblePass)
+    {
+        imagep->mVisiblePass = mVisiblePass;
+        imagep->mVisibleSlot = (S32)mVisibleTextures.size();
+        mVisibleTextures.emplace_back(imagep, vsize);
+    }
+    else
+    {
+        F32& max_vsize = mVisibleTextures[imagep->mVisibleSlot].second;
+        max_vsize = llmax(max_vsize, vsize);
+    }
+}
+
+F32 LLViewerTextureList::updateImagesVisibleTextures(F32 max_time)
+{
+    LL_PROFILE_ZONE_SCOPED_CATEGORY_TEXTURE;
+    LLTimer timer;
+
+    // Start collecting the next pass while this one is consumed
+    visible_texture_list_t visible;
+    visible.swap(mVisibleTextures);
+    const U32 pass = mVisiblePass++;
+
+    // Every visible texture gets this frame's priority, even those whose
+    // fetch isn't reached below
+    for (auto& entry : visible)
+    {
+        entry.first->addTextureStats(entry.second);
+    }
+
+    std::sort(visible.begin(), visible.end(),
+              [](const visible_texture_list_t::value_type& lhs, const visible_texture_list_t::value_type& rhs)
+              {
+                  return lhs.second > rhs.second;
+              });
+
+    for (auto& entry : visible)
+    {
+        LLViewerFetchedTexture* imagep = entry.first;
+        if (imagep->getGLTexture() && imagep->getNumRefs() > 1)
+        {
+            updateImageDecodePriority(imagep, false);
+            imagep->updateFetch();
+            imagep->mVisibleUpdatePass = pass;
+        }
+
+        if (timer.getElapsedTimeF32() > max_time)
+        {
+            break;
+        }
+    }
+
+    return timer.getElapsedTimeF32();
+}
+
+void LLViewerTextureList::updateImageDecodePriority(LLViewerFetchedTexture* imagep, bool add_face_stats)
 {
     if (imagep->isInDebug() || imagep->isUnremovable())
     {
@@ -908,9 +1057,8 @@ void LLViewerTextureList::updateImageDecodePriority(LLViewerFetchedTexture* imag
 
     llassert(!gCubeSnapshot);
 
-    static LLCachedControl<F32> bias_distance_scale(gSavedSettings, "TextureBiasDistanceScale", 1.f);
-
     LL_PROFILE_ZONE_SCOPED_CATEGORY_TEXTURE
+    if (add_face_stats)
     {
         for (U32 i = 0; i < LLRender::NUM_TEXTURE_CHANNELS; ++i)
         {
@@ -920,25 +1068,13 @@ void LLViewerTextureList::updateImageDecodePriority(LLViewerFetchedTexture* imag
 
                 if (face && face->getViewerObject() && face->getTextureEntry())
                 {
-                    F32 vsize = face->getPixelArea();
-
-                    // scale desired texture resolution higher or lower depending on texture scale
-                    const LLTextureEntry* te = face->getTextureEntry();
-                    F32 min_scale = te ? llmin(fabsf(te->getScaleS()), fabsf(te->getScaleT())) : 1.f;
-                    min_scale = llmax(min_scale*min_scale, 0.1f);
-
-                    vsize /= min_scale;
-
-                    vsize /= LLViewerTexture::sDesiredDiscardBias;
-                    vsize /= llmax(1.f, (LLViewerTexture::sDesiredDiscardBias-1.f) * (1.f + face->getDrawable()->mDistanceWRTCamera * bias_distance_scale));
-
+                    F32 pixel_area = face->getPixelArea();
                     F32 radius;
                     F32 cos_angle_to_view_dir;
                     BOOL in_frustum = face->calcPixelArea(cos_angle_to_view_dir, radius);
-                    if (!in_frustum || !face->getDrawable()->isVisible())
-                    { // further reduce by discard bias when off screen or occluded
-                        vsize /= LLViewerTexture::sDesiredDiscardBias;
-                    }
+                    F32 vsize = face_virtual_size(face, pixel_area, in_frustum && face->getDrawable()->isVisible());
+
+                    const LLTextureEntry* te = face->getTextureEntry();
 
                     // if a GLTF material is present, ignore that face
                     // as far as this texture stats go, but update the GLTF material 
@@ -1122,6 +1258,29 @@ void LLViewerTextureList::forceImmediateUpdate(LLViewerFetchedTexture* imagep)
 F32 LLViewerTextureList::updateImagesFetchTextures(F32 max_time)
 {
     LL_PROFILE_ZONE_SCOPED_CATEGORY_TEXTURE;
+    static LLCachedControl<bool> cull_priorities(gSavedSettings, "TextureCullPriorities", true);
+
+    // Visible textures first, in priority order, with up to half the time.
+    // The rest goes to the round robin below, which keeps up the textures
+    // nothing on screen asks for and those the visible pass didn't reach.
+    // Textures no visible face asked for still walk their faces there, so
+    // off screen and occluded faces keep adding their reduced size and the
+    // texture's priority doesn't just decay.
+    F32 visible_time = 0.f;
+    if (cull_priorities)
+    {
+        visible_time = updateImagesVisibleTextures(max_time * 0.5f);
+        max_time = llmax(max_time - visible_time, max_time * 0.5f);
+    }
+    else
+    {
+        // Stale slots of textures collected before the setting was turned
+        // off must not match the pass addVisibleTexture() sees next
+        mVisibleTextures.clear();
+        ++mVisiblePass;
+    }
+    const U32 visible_pass = mVisiblePass - 1;
+
     typedef std::vector<LLPointer<LLViewerFetchedTexture> > entries_list_t;
     entries_list_t entries;
 
@@ -1163,8 +1322,12 @@ F32 LLViewerTextureList::updateImagesFetchTextures(F32 max_time)
         if (imagep && imagep->getNumRefs() > 1) // make sure this image hasn't been deleted before attempting to update (may happen as a side effect of some other image updating)
 
         {
-            updateImageDecodePriority(imagep);
-            imagep->updateFetch();
+            if (!cull_priorities || imagep->mVisibleUpdatePass != visible_pass)
+            {
+                const bool collected = cull_priorities && imagep->mVisiblePass == visible_pass;
+                updateImageDecodePriority(imagep, !collected);
+                imagep->updateFetch();
+            }
         }
 
         last_imagep = imagep;
@@ -1180,7 +1343,7 @@ F32 LLViewerTextureList::updateImagesFetchTextures(F32 max_time)
         mLastUpdateKey = LLTextureKey(last_imagep->getID(), (ETexListType)last_imagep->getTextureListType());
     }
 
-	return timer.getElapsedTimeF32();
+	return visible_time + timer.getElapsedTimeF32();
 }
 
 void LLViewerTextureList::updateImagesUpdateStats()
@@ -50,6 +50,7 @@ const BOOL IMMEDIATE_NO = FALSE;
 class LLImageJ2C;
 class LLMessageSystem;
 class LLTextureView;
+class LLDrawable;
 
 typedef	void (*LLImageCallback)(BOOL success,
 								LLViewerFetchedTexture *src_vi,
@@ -158,12 +159,19 @@ class LLViewerTextureList
 	void clearFetchingRequests();
 	void setDebugFetching(LLViewerFetchedTexture* tex, S32 debug_level);
 
+	// Called for each drawable sorted for the world camera.  Folds the
+	// priority every face asks of its textures into one entry per texture,
+	// used by the next updateImages().
+	void addVisibleFaces(LLDrawable* drawablep);
+
 private:
     // do some book keeping on the specified texture
     // - updates decode priority
     // - updates desired discard level
     // - cleans up textures that haven't been referenced in awhile
-    void updateImageDecodePriority(LLViewerFetchedTexture* imagep);
+    void updateImageDecodePriority(LLViewerFetchedTexture* imagep, bool add_face_stats = true);
+	void addVisibleTexture(LLViewerFetchedTexture* imagep, F32 vsize);
+	F32  updateImagesVisibleTextures(F32 max_time);
 	F32  updateImagesCreateTextures(F32 max_time);
 	F32  updateImagesFetchTextures(F32 max_time);
 	void updateImagesUpdateStats();
@@ -245,6 +253,12 @@ class LLViewerTextureList
 
 	BOOL mInitialized ;
 	LLFrameTimer mForceDecodeTimer;
+
+	// Textures of the faces found visible since the last update, with the
+	// largest virtual size any of them asked for
+	typedef std::vector<std::pair<LLPointer<LLViewerFetchedTexture>, F32> > visible_texture_list_t;
+	visible_texture_list_t mVisibleTextures;
+	U32 mVisiblePass;
 	
 private:
 	static S32 sNumImages;
@@ -38,6 +38,8 @@
 #include "noise.h"
 #include "llregionhandle.h" // for from_region_handle
 #include "llviewercontrol.h"
+#include "llsimdtypes.h"
+#include "parallelfor.h"
 
 
 
@@ -79,6 +81,8 @@ LLVLComposition::LLVLComposition(LLSurface *surfacep, const U32 width, const F32
 	mTexScaleX = 16.f;
 	mTexScaleY = 16.f;
 	mTexturesLoaded = FALSE;
+	mTilesX = 0;
+	mTilesY = 0;
 }
 
 
@@ -104,6 +108,46 @@ void LLVLComposition::setDetailTextureID(S32 corner, const LLUUID& id)
 	mDetailTextures[corner] = LLViewerTextureManager::getFetchedTexture(id);
 	mDetailTextures[corner]->setNoDelete() ;
 	mRawImages[corner] = NULL;
+	dirtyAllTiles();
+}
+
+// Texture tiles are TILE_SIZE texels on a side
+static const S32 TILE_SIZE = 32;
+
+void LLVLComposition::dirtyTiles(S32 x_begin, S32 y_begin, S32 x_end, S32 y_end)
+{
+	if (mCompositeRaw.isNull())
+	{
+		// Everything gets built with the first texture
+		return;
+	}
+
+	// Texel i samples the composition values at floor(i/scale) and the
+	// one after it, so value g is seen by texels [(g-1)*scale, (g+1)*scale).
+	const S32 tex_width = mCompositeRaw->getWidth();
+	const S32 tex_height = mCompositeRaw->getHeight();
+	const F32 x_scale = (F32)tex_width / (F32)mWidth;
+	const F32 y_scale = (F32)tex_height / (F32)mWidth;
+
+	S32 tile_x_begin = llclamp(llfloor((x_begin - 1) * x_scale), 0, tex_width - 1) / TILE_SIZE;
+	S32 tile_y_begin = llclamp(llfloor((y_begin - 1) * y_scale), 0, tex_height - 1) / TILE_SIZE;
+	S32 tile_x_end = x_end >= (S32)mWidth ? tex_width - 1 : llclamp(llceil(x_end * x_scale), 0, tex_width - 1);
+	S32 tile_y_end = y_end >= (S32)mWidth ? tex_height - 1 : llclamp(llceil(y_end * y_scale), 0, tex_height - 1);
+	tile_x_end /= TILE_SIZE;
+	tile_y_end /= TILE_SIZE;
+
+	for (S32 j = tile_y_begin; j <= tile_y_end; j++)
+	{
+		for (S32 i = tile_x_begin; i <= tile_x_end; i++)
+		{
+			mDirtyTiles[j*mTilesX + i] = TRUE;
+		}
+	}
+}
+
+void LLVLComposition::dirtyAllTiles()
+{
+	std::fill(mDirtyTiles.begin(), mDirtyTiles.end(), TRUE);
 }
 
 BOOL LLVLComposition::generateHeights(const F32 x, const F32 y,
@@ -206,6 +250,8 @@ BOOL LLVLComposition::generateHeights(const F32 x, const F32 y,
 			*(mDatap + i + j*mWidth) = scaled_noisy_height;
 		}
 	}
+
+	dirtyTiles(x_begin, y_begin, x_end, y_end);
 	return TRUE;
 }
 
@@ -353,7 +399,6 @@ BOOL LLVLComposition::generateTexture(const F32 x, const F32 y,
 
 	LLViewerTexture *texturep;
 	U32 tex_width, tex_height, tex_comps;
-	U32 tex_stride;
 	F32 tex_x_scalef, tex_y_scalef;
 	S32 tex_x_begin, tex_y_begin, tex_x_end, tex_y_end;
 	F32 tex_x_ratiof, tex_y_ratiof;
@@ -362,7 +407,6 @@ BOOL LLVLComposition::generateTexture(const F32 x, const F32 y,
 	tex_width = texturep->getWidth();
 	tex_height = texturep->getHeight();
 	tex_comps = texturep->getComponents();
-	tex_stride = tex_width * tex_comps;
 
 	U32 st_comps = 3;
 	U32 st_width = BASE_SIZE;
@@ -384,63 +428,77 @@ BOOL LLVLComposition::generateTexture(const F32 x, const F32 y,
 	tex_x_ratiof = (F32)mWidth*mScale / (F32)tex_width;
 	tex_y_ratiof = (F32)mWidth*mScale / (F32)tex_height;
 
-	LLPointer<LLImageRaw> raw = new LLImageRaw(tex_width, tex_height, tex_comps);
-	U8 *rawp = raw->getData();
-
-	F32 st_x_stride, st_y_stride;
-	st_x_stride = ((F32)st_width / (F32)mTexScaleX)*((F32)mWidth / (F32)tex_width);
-	st_y_stride = ((F32)st_height / (F32)mTexScaleY)*((F32)mWidth / (F32)tex_height);
-
-	llassert(st_x_stride > 0.f);
-	llassert(st_y_stride > 0.f);
-	////////////////////////////////
-	//
-	// Iterate through the target texture, striding through the
-	// subtextures and interpolating appropriately.
-	//
-	//
-
-	F32 sti, stj;
-	S32 st_offset;
-	sti = (tex_x_begin * st_x_stride) - st_width*(llfloor((tex_x_begin * st_x_stride)/st_width));
-	stj = (tex_y_begin * st_y_stride) - st_height*(llfloor((tex_y_begin * st_y_stride)/st_height));
+	// A new or resized surface texture gets composited from scratch, and
+	// one that lost its GL texture gets it back from the composited copy.
+	BOOL full_upload = !texturep->hasGLTexture();
+	if (mCompositeRaw.isNull()
+		|| mCompositeRaw->getWidth() != tex_width
+		|| mCompositeRaw->getHeight() != tex_height)
+	{
+		mCompositeRaw = new LLImageRaw(tex_width, tex_height, tex_comps);
+		mTilesX = (tex_width + TILE_SIZE - 1) / TILE_SIZE;
+		mTilesY = (tex_height + TILE_SIZE - 1) / TILE_SIZE;
+		mDirtyTiles.assign(mTilesX*mTilesY, TRUE);
+		full_upload = TRUE;
+	}
 
-	st_offset = (llfloor(stj * st_width) + llfloor(sti)) * st_comps;
-	for (S32 j = tex_y_begin; j < tex_y_end; j++)
+	// Nothing to do if the tiles under this patch are current.  Otherwise
+	// bring every dirty tile up to date, so a burst of changed patches is
+	// composited in one pass.
+	BOOL rect_dirty = FALSE;
+	for (S32 j = tex_y_begin / TILE_SIZE; j <= (tex_y_end - 1) / TILE_SIZE && !rect_dirty; j++)
 	{
-		U32 offset = j * tex_stride + tex_x_begin * tex_comps;
-		sti = (tex_x_begin * st_x_stride) - st_width*((U32)(tex_x_begin * st_x_stride)/st_width);
-		for (S32 i = tex_x_begin; i < tex_x_end; i++)
+		for (S32 i = tex_x_begin / TILE_SIZE; i <= (tex_x_end - 1) / TILE_SIZE; i++)
 		{
-			S32 tex0, tex1;
-			F32 composition = getValueScaled(i*tex_x_ratiof, j*tex_y_ratiof);
-
-			tex0 = llfloor( composition );
-			tex0 = llclamp(tex0, 0, 3);
-			composition -= tex0;
-			tex1 = tex0 + 1;
-			tex1 = llclamp(tex1, 0, 3);
+			if (mDirtyTiles[llclamp(j, 0, mTilesY - 1)*mTilesX + llclamp(i, 0, mTilesX - 1)])
+			{
+				rect_dirty = TRUE;
+				break;
+			}
+		}
+	}
 
-			st_offset = (lltrunc(sti) + lltrunc(stj)*st_width) * st_comps;
-			for (U32 k = 0; k < tex_comps; k++)
+	std::vector<S32> tiles;
+	if (rect_dirty || full_upload)
+	{
+		for (S32 t = 0; t < mTilesX*mTilesY; t++)
+		{
+			if (mDirtyTiles[t])
 			{
-				// Linearly interpolate based on composition.
-				if (st_offset >= st_data_size[tex0] || st_offset >= st_data_size[tex1])
-				{
-					// SJB: This shouldn't be happening, but does... Rounding error?
-					//LL_WARNS() << "offset 0 [" << tex0 << "] =" << st_offset << " >= size=" << st_data_size[tex0] << LL_ENDL;
-					//LL_WARNS() << "offset 1 [" << tex1 << "] =" << st_offset << " >= size=" << st_data_size[tex1] << LL_ENDL;
-				}
-				else
-				{
-					F32 a = *(st_data[tex0] + st_offset);
-					F32 b = *(st_data[tex1] + st_offset);
-					rawp[ offset ] = (U8)lltrunc( a + composition * (b - a) );
-				}
-				offset++;
-				st_offset++;
+				tiles.push_back(t);
+				mDirtyTiles[t] = FALSE;
 			}
+		}
+	}
+
+	if (!tiles.empty())
+	{
+		F32 st_x_stride, st_y_stride;
+		st_x_stride = ((F32)st_width / (F32)mTexScaleX)*((F32)mWidth / (F32)tex_width);
+		st_y_stride = ((F32)st_height / (F32)mTexScaleY)*((F32)mWidth / (F32)tex_height);
+
+		llassert(st_x_stride > 0.f);
+		llassert(st_y_stride > 0.f);
+
+		////////////////////////////////
+		//
+		// Work out once where each texel column and row samples the
+		// composition values and strides through the subtextures.
+		//
+		//
+
+		std::vector<S32> x1(tex_width), x2(tex_width), st_x(tex_width);
+		std::vector<F32> x_frac(tex_width);
+		F32 sti = 0.f;
+		for (U32 i = 0; i < tex_width; i++)
+		{
+			F32 frac = (i*tex_x_ratiof)*mScaleInv;
+			S32 left = llfloor(frac);
+			x_frac[i] = frac - left;
+			x1[i] = llclamp(left, 0, (S32)mWidth - 1);
+			x2[i] = llclamp(left + 1, 0, (S32)mWidth - 1);
 
+			st_x[i] = lltrunc(sti) * st_comps;
 			sti += st_x_stride;
 			if (sti >= st_width)
 			{
@@ -448,18 +506,153 @@ BOOL LLVLComposition::generateTexture(const F32 x, const F32 y,
 			}
 		}
 
-		stj += st_y_stride;
-		if (stj >= st_height)
+		std::vector<S32> row1(tex_height), row2(tex_height), st_y(tex_height);
+		std::vector<F32> y_frac(tex_height);
+		F32 stj = 0.f;
+		for (U32 j = 0; j < tex_height; j++)
 		{
-			stj -= st_height;
+			F32 frac = (j*tex_y_ratiof)*mScaleInv;
+			S32 bottom = llfloor(frac);
+			y_frac[j] = frac - bottom;
+			row1[j] = llclamp(bottom, 0, (S32)mWidth - 1) * mWidth;
+			row2[j] = llclamp(bottom + 1, 0, (S32)mWidth - 1) * mWidth;
+
+			st_y[j] = lltrunc(stj) * st_width * st_comps;
+			stj += st_y_stride;
+			if (stj >= st_height)
+			{
+				stj -= st_height;
+			}
 		}
+
+		////////////////////////////////
+		//
+		// Composite the dirty tiles in parallel, eight texels at a time:
+		// bilinearly sample the composition values, then blend the two
+		// subtextures each texel falls between.
+		//
+		//
+
+		const F32* datap = mDatap;
+		U8* rawp = mCompositeRaw->getData();
+		const U32 tex_stride = tex_width * tex_comps;
+		const S32 tiles_x = mTilesX;
+
+		LL::parallel_for(tiles.size(), 1, [&](size_t begin, size_t end)
+			{
+				LL_ALIGN_16(F32 composition[8]);
+				LL_ALIGN_16(F32 a[24]);
+				LL_ALIGN_16(F32 b[24]);
+				LL_ALIGN_16(F32 f[24]);
+
+				for (size_t t = begin; t < end; ++t)
+				{
+					const S32 i_begin = (tiles[t] % tiles_x) * TILE_SIZE;
+					const S32 j_begin = (tiles[t] / tiles_x) * TILE_SIZE;
+					const S32 i_end = llmin(i_begin + TILE_SIZE, (S32)tex_width);
+					const S32 j_end = llmin(j_begin + TILE_SIZE, (S32)tex_height);
+
+					for (S32 j = j_begin; j < j_end; j++)
+					{
+						const F32* lower = datap + row1[j];
+						const F32* upper = datap + row2[j];
+						const LLQuad yf = _mm_set1_ps(y_frac[j]);
+						U8* out = rawp + j*tex_stride + i_begin*tex_comps;
+
+						for (S32 i = i_begin; i < i_end; i += 8)
+						{
+							const S32 count = llmin(8, i_end - i);
+
+							// Same interpolation as LLViewerLayer::getValueScaled()
+							for (S32 q = 0; count == 8 && q < 8; q += 4)
+							{
+								const S32 k = i + q;
+								const LLQuad xf = _mm_loadu_ps(&x_frac[k]);
+								const LLQuad ll = _mm_setr_ps(lower[x1[k]], lower[x1[k+1]], lower[x1[k+2]], lower[x1[k+3]]);
+								const LLQuad lr = _mm_setr_ps(lower[x2[k]], lower[x2[k+1]], lower[x2[k+2]], lower[x2[k+3]]);
+								const LLQuad ul = _mm_setr_ps(upper[x1[k]], upper[x1[k+1]], upper[x1[k+2]], upper[x1[k+3]]);
+								const LLQuad ur = _mm_setr_ps(upper[x2[k]], upper[x2[k+1]], upper[x2[k+2]], upper[x2[k+3]]);
+								const LLQuad row1_interp = _mm_sub_ps(ll, _mm_mul_ps(xf, _mm_sub_ps(ll, lr)));
+								const LLQuad row2_interp = _mm_sub_ps(ul, _mm_mul_ps(xf, _mm_sub_ps(ul, ur)));
+								_mm_store_ps(composition + q, _mm_sub_ps(row1_interp, _mm_mul_ps(yf, _mm_sub_ps(row1_interp, row2_interp))));
+							}
+							for (S32 p = 0; count < 8 && p < count; p++)
+							{
+								const S32 k = i + p;
+								F32 row1_interp = lower[x1[k]] - x_frac[k] * (lower[x1[k]] - lower[x2[k]]);
+								F32 row2_interp = upper[x1[k]] - x_frac[k] * (upper[x1[k]] - upper[x2[k]]);
+								composition[p] = row1_interp - y_frac[j] * (row1_interp - row2_interp);
+							}
+
+							for (S32 p = 0; p < count; p++)
+							{
+								F32 comp = composition[p];
+								S32 tex0 = llclamp(llfloor(comp), 0, 3);
+								S32 tex1 = llmin(tex0 + 1, 3);
+								comp -= tex0;
+
+								S32 st_offset = st_x[i + p] + st_y[j];
+								BOOL in_range = st_offset + 2 < st_data_size[tex0] && st_offset + 2 < st_data_size[tex1];
+								for (U32 k = 0; k < 3; k++)
+								{
+									a[p*3 + k] = in_range ? *(st_data[tex0] + st_offset + k) : 0.f;
+									b[p*3 + k] = in_range ? *(st_data[tex1] + st_offset + k) : 0.f;
+									f[p*3 + k] = comp;
+								}
+							}
+
+							if (count == 8)
+							{
+								// Linearly interpolate based on composition, 24 channels
+								// at a time, and pack the results down to bytes.
+								__m128i blend[6];
+								for (S32 q = 0; q < 6; q++)
+								{
+									const LLQuad aq = _mm_load_ps(a + q*4);
+									const LLQuad bq = _mm_load_ps(b + q*4);
+									const LLQuad fq = _mm_load_ps(f + q*4);
+									blend[q] = _mm_cvttps_epi32(_mm_add_ps(aq, _mm_mul_ps(fq, _mm_sub_ps(bq, aq))));
+								}
+								const __m128i lo = _mm_packus_epi16(_mm_packs_epi32(blend[0], blend[1]), _mm_packs_epi32(blend[2], blend[3]));
+								const __m128i hi = _mm_packus_epi16(_mm_packs_epi32(blend[4], blend[5]), _mm_setzero_si128());
+								_mm_storeu_si128((__m128i*)out, lo);
+								_mm_storel_epi64((__m128i*)(out + 16), hi);
+							}
+							else
+							{
+								for (S32 k = 0; k < count*3; k++)
+								{
+									out[k] = (U8)lltrunc(a[k] + f[k] * (b[k] - a[k]));
+								}
+							}
+							out += count*3;
+						}
+					}
+				}
+			});
 	}
 
-	if (!texturep->hasGLTexture())
+	if (full_upload)
+	{
+		texturep->createGLTexture(0, mCompositeRaw);
+	}
+	else if (!tiles.empty())
 	{
-		texturep->createGLTexture(0, raw);
+		// Upload the smallest rectangle covering the rebuilt tiles
+		S32 tile_x_begin = mTilesX, tile_y_begin = mTilesY, tile_x_end = 0, tile_y_end = 0;
+		for (S32 t : tiles)
+		{
+			tile_x_begin = llmin(tile_x_begin, t % mTilesX);
+			tile_y_begin = llmin(tile_y_begin, t / mTilesX);
+			tile_x_end = llmax(tile_x_end, t % mTilesX + 1);
+			tile_y_end = llmax(tile_y_end, t / mTilesX + 1);
+		}
+		S32 rect_x = tile_x_begin * TILE_SIZE;
+		S32 rect_y = tile_y_begin * TILE_SIZE;
+		S32 rect_width = llmin(tile_x_end * TILE_SIZE, (S32)tex_width) - rect_x;
+		S32 rect_height = llmin(tile_y_end * TILE_SIZE, (S32)tex_height) - rect_y;
+		texturep->setSubImage(mCompositeRaw, rect_x, rect_y, rect_width, rect_height);
 	}
-	texturep->setSubImage(raw, tex_x_begin, tex_y_begin, tex_x_end - tex_x_begin, tex_y_end - tex_y_begin);
 
 	for (S32 i = 0; i < 4; i++)
 	{
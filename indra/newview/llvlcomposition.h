@@ -43,7 +43,8 @@ class LLVLComposition final : public LLViewerLayer
 	// Viewer side hack to generate composition values
 	BOOL generateHeights(const F32 x, const F32 y, const F32 width, const F32 height);
 	BOOL generateComposition();
-	// Generate texture from composition values.
+	// Generate texture from composition values.  Only tiles whose composition
+	// values or detail textures changed are rebuilt, all dirty tiles at once.
 	BOOL generateTexture(const F32 x, const F32 y, const F32 width, const F32 height);		
 
 	// Use these as indeces ito the get/setters below that use 'corner'
@@ -69,6 +70,11 @@ class LLVLComposition final : public LLViewerLayer
 	void setParamsReady()		{ mParamsReady = TRUE; }
 	BOOL getParamsReady() const	{ return mParamsReady; }
 protected:
+	// Flag the texture tiles sampling composition values in
+	// [x_begin, x_end) x [y_begin, y_end) for rebuilding
+	void dirtyTiles(S32 x_begin, S32 y_begin, S32 x_end, S32 y_end);
+	void dirtyAllTiles();
+
 	BOOL mParamsReady;
 	LLSurface *mSurfacep;
 	BOOL mTexturesLoaded;
@@ -81,6 +87,13 @@ class LLVLComposition final : public LLViewerLayer
 
 	F32 mTexScaleX;
 	F32 mTexScaleY;
+
+	// Composited surface texture, kept so that clean tiles don't have
+	// to be rebuilt when a neighbouring patch changes.
+	LLPointer<LLImageRaw> mCompositeRaw;
+	std::vector<U8> mDirtyTiles;
+	S32 mTilesX;
+	S32 mTilesY;
 };
 
 #endif //LL_LLVLCOMPOSITION_H
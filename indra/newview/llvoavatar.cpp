@@ -99,6 +99,7 @@
 #include "llvoavatarself.h"
 #include "llvovolume.h"
 #include "llworld.h"
+#include "parallelfor.h"
 #include "pipeline.h"
 #include "llviewershadermgr.h"
 #include "llsky.h"
@@ -608,6 +609,7 @@ bool LLVOAvatar::sLimitNonImpostors = false; // True unless RenderAvatarMaxNonIm
 F32 LLVOAvatar::sRenderDistance = 256.f;
 S32	LLVOAvatar::sNumVisibleAvatars = 0;
 S32	LLVOAvatar::sNumLODChangesThisFrame = 0;
+std::vector<LLPointer<LLVOAvatar> > LLVOAvatar::sPendingPoseAvatars;
 
 const LLUUID LLVOAvatar::sStepSoundOnLand("e8af4a28-aa83-4310-a7c4-c047e15ea0df");
 const LLUUID LLVOAvatar::sStepSounds[LL_MCODE_END] =
@@ -2669,7 +2671,21 @@ void LLVOAvatar::idleUpdate(LLAgent &agent, const F64 &time)
 	// store off last frame's root position to be consistent with camera position
 	mLastRootPos = mRoot->getWorldPosition();
 	BOOL detailed_update = updateCharacter(agent);
+	if (mPosePending)
+	{
+		// finished by updatePendingPoses() once the pose has been applied
+		return;
+	}
 
+	idleUpdateAfterPose(detailed_update);
+}
+
+//------------------------------------------------------------------------
+// idleUpdateAfterPose()
+// The part of idleUpdate() that needs this frame's animated skeleton
+//------------------------------------------------------------------------
+void LLVOAvatar::idleUpdateAfterPose(bool detailed_update)
+{
 	static LLUICachedControl<bool> visualizers_in_calls("ShowVoiceVisualizersInCalls", false);
 	bool voice_enabled = (visualizers_in_calls || LLVoiceClient::getInstance()->inProximalChannel()) &&
 						 LLVoiceClient::getInstance()->getVoiceEnabled(mID);
@@ -4900,8 +4916,45 @@ bool LLVOAvatar::updateCharacter(LLAgent &agent)
 	}
 	else
 	{
+		// Keyframe evaluation and blending for other avatars can wait for
+		// updatePendingPoses(), which runs them on the job pool.
+		static LLCachedControl<bool> parallel_animation(gSavedSettings, "AvatarParallelAnimation");
+		mMotionController.setDeferPose(parallel_animation && !isSelf());
+
 		// Might be better to do HIDDEN_UPDATE if cloud
 		updateMotions(LLCharacter::NORMAL_UPDATE);
+
+		mMotionController.setDeferPose(false);
+	}
+
+	if (mMotionController.hasDeferredPose())
+	{
+		mPosePending = true;
+		mPendingPoseSitGroundConstrained = was_sit_ground_constrained;
+		sPendingPoseAvatars.push_back(this);
+		return visible;
+	}
+
+	updatePose(was_sit_ground_constrained);
+	finishCharacterUpdate(visible);
+
+	return visible;
+}
+
+//-----------------------------------------------------------------------------
+// updatePose()
+// Applies the animation pose and updates the skeleton. Writes only this
+// avatar's motions and joints. Besides those it reads the avatar's hover
+// offset and sitting state, and the frame delta LLSmoothInterpolation
+// keeps for the constraint weights. Motions that need the ground, which
+// is looked up through gAgent and LLWorld, are never deferred to here
+// (see LLKeyframeMotion::canDeferPose()), so this is safe on a worker.
+//-----------------------------------------------------------------------------
+void LLVOAvatar::updatePose(bool was_sit_ground_constrained)
+{
+	if (mMotionController.hasDeferredPose())
+	{
+		mMotionController.applyDeferredPose();
 	}
 
 	// Special handling for sitting on ground.
@@ -4919,22 +4972,66 @@ bool LLVOAvatar::updateCharacter(LLAgent &agent)
 		}
 	}
 
+	// Update child joints as needed.
+	mRoot->updateWorldMatrixChildren();
+}
+
+//-----------------------------------------------------------------------------
+// finishCharacterUpdate()
+//-----------------------------------------------------------------------------
+void LLVOAvatar::finishCharacterUpdate(bool visible)
+{
 	// update head position
 	updateHeadOffset();
 
 	// Generate footstep sounds when feet hit the ground
     updateFootstepSounds();
 
-	// Update child joints as needed.
-	mRoot->updateWorldMatrixChildren();
-
     if (visible)
     {
 		// System avatar mesh vertices need to be reskinned.
 		mNeedsSkin = TRUE;
     }
+}
 
-	return visible;
+//-----------------------------------------------------------------------------
+// updatePendingPoses()
+// Join point for avatars whose pose was deferred by updateCharacter(): the
+// poses are evaluated as independent jobs, then the rest of each avatar's
+// idle update runs on the main thread in the order they were deferred.
+//-----------------------------------------------------------------------------
+// static
+void LLVOAvatar::updatePendingPoses()
+{
+    LL_PROFILE_ZONE_SCOPED_CATEGORY_AVATAR;
+	if (sPendingPoseAvatars.empty())
+	{
+		return;
+	}
+
+	LL::parallel_for(sPendingPoseAvatars.size(), 1, [](size_t begin, size_t end)
+	{
+		for (size_t i = begin; i < end; ++i)
+		{
+			LLVOAvatar* avatarp = sPendingPoseAvatars[i];
+			if (!avatarp->isDead())
+			{
+				avatarp->updatePose(avatarp->mPendingPoseSitGroundConstrained);
+			}
+		}
+	});
+
+	for (LLVOAvatar* avatarp : sPendingPoseAvatars)
+	{
+		avatarp->mPosePending = false;
+		if (!avatarp->isDead())
+		{
+			// only visible avatars defer their pose
+			avatarp->finishCharacterUpdate(true);
+			avatarp->idleUpdateAfterPose(true);
+		}
+	}
+	sPendingPoseAvatars.clear();
 }
 
 //-----------------------------------------------------------------------------
@@ -287,7 +287,13 @@ class LLVOAvatar :
     void			updateOrientation(LLAgent &agent, F32 speed, F32 delta_time);
     void			updateTimeStep();
     void			updateRootPositionAndRotation(LLAgent &agent, F32 speed, bool was_sit_ground_constrained);
+    void			updatePose(bool was_sit_ground_constrained);
+    void			finishCharacterUpdate(bool visible);
+
+	// Called once per frame after the object idle updates
+	static void		updatePendingPoses();
     
+	void 			idleUpdateAfterPose(bool detailed_update);
 	void 			idleUpdateVoiceVisualizer(bool voice_enabled);
 	void 			idleUpdateMisc(bool detailed_update);
 	virtual void	idleUpdateAppearanceAnimation();
@@ -567,6 +573,9 @@ class LLVOAvatar :
 	bool		shouldAlphaMask();
 
 	BOOL 		mNeedsSkin; // avatar has been animated and verts have not been updated
+	bool		mPosePending = false; // waiting on updatePendingPoses()
+	bool		mPendingPoseSitGroundConstrained = false;
+	static std::vector<LLPointer<LLVOAvatar> > sPendingPoseAvatars;
 	F32			mLastSkinTime; //value of gFrameTimeSeconds at last skin update
 
 	S32	 		mUpdatePeriod;
@@ -33,6 +33,20 @@
 #include "llviewerregion.h"
 #include "llagentcamera.h"
 #include "llsdserialize.h"
+#include "llmemorystream.h"
+
+#include "threadpool.h"
+
+#include "boost/unordered/unordered_flat_map.hpp"
+
+#if LL_WINDOWS
+#include "llwin32headerslean.h"
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 //static variables
 U32 LLVOCacheEntry::sMinFrameRange = 0;
@@ -42,7 +56,6 @@ F32 LLVOCacheEntry::sFrontPixelThreshold = 1.0f;
 F32 LLVOCacheEntry::sRearPixelThreshold = 1.0f;
 BOOL LLVOCachePartition::sNeedsOcclusionCheck = FALSE;
 
-const S32 ENTRY_HEADER_SIZE = 6 * sizeof(S32);
 const S32 MAX_ENTRY_BODY_SIZE = 10000;
 
 BOOL check_read(LLAPRFile* apr_file, void* src, S32 n_bytes) 
@@ -188,69 +201,23 @@ LLVOCacheEntry::LLVOCacheEntry()
 	mDP.assignBuffer(mBuffer, 0);
 }
 
-LLVOCacheEntry::LLVOCacheEntry(LLAPRFile* apr_file)
-:	LLViewerOctreeEntryData(LLViewerOctreeEntry::LLVOCACHEENTRY), 
-	mBuffer(NULL),
+LLVOCacheEntry::LLVOCacheEntry(const CacheRecord& record, const U8* body)
+:	LLViewerOctreeEntryData(LLViewerOctreeEntry::LLVOCACHEENTRY),
+	mLocalID(record.mLocalID),
+	mCRC(record.mCRC),
 	mUpdateFlags(-1),
+	mHitCount(record.mHitCount),
+	mDupeCount(record.mDupeCount),
+	mCRCChangeCount(record.mCRCChangeCount),
 	mState(INACTIVE),
 	mSceneContrib(0.f),
 	mValid(FALSE),
 	mParentID(0),
 	mBSphereRadius(-1.0f)
 {
-	S32 size = -1;
-	BOOL success;
-    static U8 data_buffer[ENTRY_HEADER_SIZE];
-
-	mDP.assignBuffer(mBuffer, 0);
-
-    success = check_read(apr_file, (void *)data_buffer, ENTRY_HEADER_SIZE);
-    if (success)
-    {
-        memcpy(&mLocalID, data_buffer, sizeof(U32));
-        memcpy(&mCRC, data_buffer + sizeof(U32), sizeof(U32));
-        memcpy(&mHitCount, data_buffer + (2 * sizeof(U32)), sizeof(S32));
-        memcpy(&mDupeCount, data_buffer + (3 * sizeof(U32)), sizeof(S32));
-        memcpy(&mCRCChangeCount, data_buffer + (4 * sizeof(U32)), sizeof(S32));
-        memcpy(&size, data_buffer + (5 * sizeof(U32)), sizeof(S32));
-
-		// Corruption in the cache entries
-		if ((size > MAX_ENTRY_BODY_SIZE) || (size < 1))
-		{
-			// We've got a bogus size, skip reading it.
-			// We won't bother seeking, because the rest of this file
-			// is likely bogus, and will be tossed anyway.
-			LL_WARNS() << "Bogus cache entry, size " << size << ", aborting!" << LL_ENDL;
-			success = FALSE;
-		}
-	}
-	if(success && size > 0)
-	{
-		mBuffer = new U8[size];
-		success = check_read(apr_file, mBuffer, size);
-
-		if(success)
-		{
-			mDP.assignBuffer(mBuffer, size);
-		}
-		else
-		{
-			delete[] mBuffer ;
-			mBuffer = NULL ;
-		}
-	}
-
-	if(!success)
-	{
-		mLocalID = 0;
-		mCRC = 0;
-		mHitCount = 0;
-		mDupeCount = 0;
-		mCRCChangeCount = 0;
-		mBuffer = NULL;
-		mEntry = NULL;
-		mState = INACTIVE;
-	}
+	mBuffer = new U8[record.mSize];
+	memcpy(mBuffer, body, record.mSize);
+	mDP.assignBuffer(mBuffer, record.mSize);
 }
 
 LLVOCacheEntry::~LLVOCacheEntry()
@@ -424,25 +391,15 @@ void LLVOCacheEntry::dump() const
 		<< LL_ENDL;
 }
 
-S32 LLVOCacheEntry::writeToBuffer(U8 *data_buffer) const
+void LLVOCacheEntry::getCacheRecord(CacheRecord& record) const
 {
-    S32 size = mDP.getBufferSize();
-
-    if (size > MAX_ENTRY_BODY_SIZE)
-    {
-        LL_WARNS() << "Failed to write entry with size above allowed limit: " << size << LL_ENDL;
-        return 0;
-    }
-
-    memcpy(data_buffer, &mLocalID, sizeof(U32));
-    memcpy(data_buffer + sizeof(U32), &mCRC, sizeof(U32));
-    memcpy(data_buffer + (2 * sizeof(U32)), &mHitCount, sizeof(S32));
-    memcpy(data_buffer + (3 * sizeof(U32)), &mDupeCount, sizeof(S32));
-    memcpy(data_buffer + (4 * sizeof(U32)), &mCRCChangeCount, sizeof(S32));
-    memcpy(data_buffer + (5 * sizeof(U32)), &size, sizeof(S32));
-    memcpy(data_buffer + ENTRY_HEADER_SIZE, (void*)mBuffer, size);
-
-    return ENTRY_HEADER_SIZE + size;
+	record.mLocalID = mLocalID;
+	record.mCRC = mCRC;
+	record.mHitCount = mHitCount;
+	record.mDupeCount = mDupeCount;
+	record.mCRCChangeCount = mCRCChangeCount;
+	record.mSize = mDP.getBufferSize();
+	record.mOffset = 0;
 }
 
 #ifndef LL_TEST
@@ -800,6 +757,18 @@ class LLVOCacheOctreeCull final : public LLViewerOctreeCull
 		return res;
 	}
 
+	virtual void frustumCheckBatch(const LLViewerOctreeGroup* const* groups, U32 count, S32* results)
+	{
+		AABBInRegionFrustumNoFarClipGroupBounds(groups, count, results);
+		for (U32 i = 0; i < count; i++)
+		{
+			if (results[i] != 0)
+			{
+				results[i] = llmin(results[i], AABBRegionSphereIntersectGroupExtents(groups[i], mLocalShift));
+			}
+		}
+	}
+
 	virtual S32 frustumCheckObjects(const LLViewerOctreeGroup* group)
 	{
 #if 0
@@ -1117,6 +1086,135 @@ const U32 INVALID_TIME = 0 ;
 const char* object_cache_dirname = "objectcache";
 const char* header_filename = "object.cache";
 
+// Region cache files (objects_X_Y.slc):
+//  RegionCacheHeader
+//  entry bodies, appended when an entry is new or its CRC changed
+//  the table of LLVOCacheEntry::CacheRecord the header points at
+// Loading a region maps the file and copies the bodies out of the mapping.
+// Saving appends the bodies the file does not have yet followed by a new
+// table, then rewrites the header last so an interrupted save leaves the
+// previous contents readable. Once superseded bodies and tables take more
+// room than the live data the file is written again from scratch.
+//
+// Extras files (objects_X_Y_extras.slec) use the same header without a
+// table: each entry is a U32 size followed by that many bytes of binary LLSD.
+const U32 REGION_CACHE_MAGIC = 0x52434f56; // 'VOCR'
+const U32 REGION_EXTRAS_MAGIC = 0x58434f56; // 'VOCX'
+const U32 REGION_CACHE_VERSION = 1;
+const U64 REGION_CACHE_MIN_GARBAGE = 64 * 1024;
+const size_t VOCACHE_READ_BATCH_SIZE = 512;
+
+struct RegionCacheHeader
+{
+	U32 mMagic;
+	U32 mVersion;
+	U8  mRegionID[UUID_BYTES];
+	U32 mNumEntries;
+	U32 mPad;
+	U64 mTableOffset;
+	U64 mLiveBytes; // bodies referenced by the table
+};
+
+static_assert(sizeof(RegionCacheHeader) == 48, "RegionCacheHeader is part of the file format");
+static_assert(sizeof(LLVOCacheEntry::CacheRecord) == 32, "CacheRecord is part of the file format");
+
+// Read only view of a whole cache file
+class LLVOCacheFileMapping
+{
+public:
+	LLVOCacheFileMapping(const std::string& filename)
+	{
+#if LL_WINDOWS
+		HANDLE file = CreateFileW(ll_convert_string_to_wide(filename).c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+								  nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (file == INVALID_HANDLE_VALUE)
+		{
+			return;
+		}
+
+		LARGE_INTEGER file_size;
+		if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart <= 0 || file_size.QuadPart > S32_MAX)
+		{
+			CloseHandle(file);
+			return;
+		}
+
+		HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		CloseHandle(file);
+		if (!mapping)
+		{
+			return;
+		}
+
+		// The view keeps the mapping object alive
+		void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+		CloseHandle(mapping);
+		if (view)
+		{
+			mData = (const U8*)view;
+			mSize = (size_t)file_size.QuadPart;
+		}
+#else
+		int fd = ::open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+		if (fd < 0)
+		{
+			return;
+		}
+
+		struct stat file_stat;
+		if (fstat(fd, &file_stat) != 0 || file_stat.st_size <= 0 || file_stat.st_size > S32_MAX)
+		{
+			::close(fd);
+			return;
+		}
+
+		void* view = mmap(nullptr, (size_t)file_stat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		::close(fd);
+		if (view != MAP_FAILED)
+		{
+			// Every body gets copied out right away
+			madvise(view, (size_t)file_stat.st_size, MADV_SEQUENTIAL | MADV_WILLNEED);
+			mData = (const U8*)view;
+			mSize = (size_t)file_stat.st_size;
+		}
+#endif
+	}
+
+	~LLVOCacheFileMapping()
+	{
+		if (mData)
+		{
+#if LL_WINDOWS
+			UnmapViewOfFile(mData);
+#else
+			munmap((void*)mData, mSize);
+#endif
+		}
+	}
+
+	// NULL if the file is missing, empty or too short to hold a header
+	const RegionCacheHeader* getHeader(U32 magic) const
+	{
+		if (mSize < sizeof(RegionCacheHeader))
+		{
+			return NULL;
+		}
+		const RegionCacheHeader* header = (const RegionCacheHeader*)mData;
+		if (header->mMagic != magic || header->mVersion != REGION_CACHE_VERSION)
+		{
+			return NULL;
+		}
+		return header;
+	}
+
+	const U8* getData() const { return mData; }
+	size_t getSize() const { return mSize; }
+
+private:
+	const U8* mData = nullptr;
+	size_t mSize = 0;
+};
+
 
 LLVOCache::LLVOCache(bool read_only) :
 	mInitialized(false),
@@ -1133,6 +1231,11 @@ LLVOCache::LLVOCache(bool read_only) :
 
 LLVOCache::~LLVOCache()
 {
+	if (mThreadPool)
+	{
+		// Finishes the writes still queued
+		mThreadPool->close();
+	}
 	if(mEnabled)
 	{
 		writeCacheHeader();
@@ -1167,6 +1270,8 @@ void LLVOCache::initCache(ELLPath location, U32 size, U32 cache_version)
 	{
 		LLFile::mkdir(mObjectCacheDirName);
 	}
+	mThreadPool.reset(new LL::ThreadPool("VOCache", 1));
+	mThreadPool->start();
 	mCacheSize = llclamp(size, MIN_ENTRIES_TO_PURGE, MAX_NUM_OBJECT_ENTRIES);
 	mMetaInfo.mVersion = cache_version;
 
@@ -1326,7 +1431,13 @@ void LLVOCache::removeFromCache(HeaderEntryInfo* entry)
 
 	std::string filename;
 	getObjectCacheFilename(entry->mHandle, filename);
-	LLAPRFile::remove(filename, mLocalAPRFilePoolp);
+	std::string extras_filename = getObjectCacheExtrasFilename(entry->mHandle);
+	// Queued behind any pending write of the same files
+	postIO([filename, extras_filename]()
+	{
+		LLFile::remove(filename, ENOENT);
+		LLFile::remove(extras_filename, ENOENT);
+	});
 	entry->mTime = INVALID_TIME ;
 	updateEntry(entry) ; //update the head file.
 }
@@ -1474,138 +1585,132 @@ BOOL LLVOCache::updateEntry(const HeaderEntryInfo* entry)
 	return check_write(&apr_file, (void*)entry, sizeof(HeaderEntryInfo)) ;
 }
 
-void LLVOCache::readFromCache(U64 handle, const LLUUID& id, LLVOCacheEntry::vocache_entry_map_t& cache_entry_map) 
+// Region file I/O below runs on the VOCache thread pool, or inline if the
+// pool is gone, and must not touch LLVOCache members.
+
+// Everything a region file write needs, collected on the main thread.
+// Record offsets point into mBodies until the bodies are written.
+struct LLVOCache::RegionSnapshot
 {
-	if(!mEnabled)
-	{
-		LL_WARNS() << "Not reading cache for handle " << handle << "): Cache is currently disabled." << LL_ENDL;
-		return ;
-	}
-	llassert_always(mInitialized);
+	std::vector<LLVOCacheEntry::CacheRecord> mRecords;
+	std::vector<U8> mBodies;
+};
 
-	handle_entry_map_t::iterator iter = mHandleEntryMap.find(handle) ;
-	if(iter == mHandleEntryMap.end()) //no cache
+// Returns false if the file is missing or unusable. Entries are passed to
+// on_batch batch_size at a time, on_batch may keep the map contents.
+static bool read_region_file(const std::string& filename, const LLUUID& id, size_t batch_size,
+							 const std::function<void(LLVOCacheEntry::vocache_entry_map_t&)>& on_batch)
+{
+	LL_PROFILE_ZONE_SCOPED;
+	LLVOCacheFileMapping mapping(filename);
+
+	const RegionCacheHeader* header = mapping.getHeader(REGION_CACHE_MAGIC);
+	const U64 table_size = header ? (U64)header->mNumEntries * sizeof(LLVOCacheEntry::CacheRecord) : 0;
+	if (!header
+		|| header->mTableOffset < sizeof(RegionCacheHeader)
+		|| header->mTableOffset % alignof(LLVOCacheEntry::CacheRecord)
+		|| header->mTableOffset + table_size > mapping.getSize())
 	{
-		LL_WARNS() << "No handle map entry for " << handle << LL_ENDL;
-		return ;
+		LL_WARNS() << "Bad or outdated object cache file " << filename << LL_ENDL;
+		return false;
 	}
-
-	bool success = true ;
+	if (memcmp(header->mRegionID, id.mData, UUID_BYTES))
 	{
-		std::string filename;
-		LLUUID cache_id;
-		getObjectCacheFilename(handle, filename);
-		LLAPRFile apr_file(filename, APR_READ|APR_BINARY, mLocalAPRFilePoolp);
-	
-		success = check_read(&apr_file, cache_id.mData, UUID_BYTES);
-	
-		if(success)
-		{		
-			if(cache_id != id)
-			{
-				LL_INFOS() << "Cache ID doesn't match for this region, discarding"<< LL_ENDL;
-				success = false ;
-			}
-
-			if(success)
-			{
-				S32 num_entries;  // if removal was enabled during write num_entries might be wrong
-				success = check_read(&apr_file, &num_entries, sizeof(S32)) ;
-	
-				if(success)
-				{
-					for (S32 i = 0; i < num_entries && apr_file.eof() != APR_EOF; i++)
-					{
-						LLPointer<LLVOCacheEntry> entry = new LLVOCacheEntry(&apr_file);
-						if (!entry->getLocalID())
-						{
-							LL_WARNS() << "Aborting cache file load for " << filename << ", cache file corruption!" << LL_ENDL;
-							success = false ;
-							break ;
-						}
-						cache_entry_map[entry->getLocalID()] = entry;
-					}
-				}
-			}
-		}		
+		LL_INFOS() << "Cache ID doesn't match for this region, discarding"<< LL_ENDL;
+		return false;
 	}
-	
-	if(!success)
+
+	bool success = true;
+	LLVOCacheEntry::vocache_entry_map_t batch;
+	const LLVOCacheEntry::CacheRecord* records = (const LLVOCacheEntry::CacheRecord*)(mapping.getData() + header->mTableOffset);
+	for (U32 i = 0; i < header->mNumEntries; i++)
 	{
-		if(cache_entry_map.empty())
+		const LLVOCacheEntry::CacheRecord& record = records[i];
+		if (!record.mLocalID
+			|| record.mSize < 1 || record.mSize > MAX_ENTRY_BODY_SIZE
+			|| record.mOffset < sizeof(RegionCacheHeader)
+			|| record.mOffset + record.mSize > header->mTableOffset)
 		{
-			removeEntry(iter->second) ;
+			LL_WARNS() << "Aborting cache file load for " << filename << ", cache file corruption!" << LL_ENDL;
+			success = false;
+			break;
+		}
+		batch[record.mLocalID] = new LLVOCacheEntry(record, mapping.getData() + record.mOffset);
+		if (batch.size() >= batch_size)
+		{
+			on_batch(batch);
+			batch.clear();
 		}
 	}
 
-	return ;
+	if (!batch.empty())
+	{
+		on_batch(batch);
+	}
+	return success;
 }
 
-void LLVOCache::readGenericExtrasFromCache(U64 handle, const LLUUID& id, LLVOCacheEntry::vocache_gltf_overrides_map_t& cache_extras_entry_map)
+// Runs on the IO pool, so only checks the header and copies the file out.
+// The entries are LLSD, which is not thread safe, and parse_extras() reads
+// them on the main thread.
+static bool read_extras_file(const std::string& filename, const LLUUID& id, std::vector<U8>& data)
 {
-    if(!mEnabled)
-    {
-        LL_WARNS() << "Not reading cache for handle " << handle << "): Cache is currently disabled." << LL_ENDL;
-        return ;
-    }
-    llassert_always(mInitialized);
-
-    handle_entry_map_t::iterator iter = mHandleEntryMap.find(handle) ;
-    if(iter == mHandleEntryMap.end()) //no cache
-    {
-        LL_WARNS() << "No handle map entry for " << handle << LL_ENDL;
-        return;
-    }
-
-    std::string filename(getObjectCacheExtrasFilename(handle));
-    llifstream in(filename, std::ios::in | std::ios::binary);
-
-    std::string line;
-    std::getline(in, line);
-    if(!in.good()) {
-        LL_WARNS() << "Failed reading extras cache for handle " << handle << LL_ENDL;
-        return;
-    }
-
-    if(!LLUUID::validate(line))
+    LL_PROFILE_ZONE_SCOPED;
+    LLVOCacheFileMapping mapping(filename);
+    const RegionCacheHeader* header = mapping.getHeader(REGION_EXTRAS_MAGIC);
+    if (!header)
     {
-        LL_WARNS() << "Failed reading extras cache for handle" << handle << ". invalid uuid line: '" << line << "'" << LL_ENDL;
-        return;
+        LL_WARNS() << "Failed reading extras cache " << filename << LL_ENDL;
+        return false;
     }
 
-    LLUUID cache_id(line);
-    if(cache_id != id)
+    if (memcmp(header->mRegionID, id.mData, UUID_BYTES))
     {
         LL_INFOS() << "Cache ID doesn't match for this region, discarding" << LL_ENDL;
-        return;
+        return false;
     }
 
-    U32 num_entries;  // if removal was enabled during write num_entries might be wrong
-    std::getline(in, line);
-    if(!in.good()) {
-        LL_WARNS() << "Failed reading extras cache for handle " << handle << LL_ENDL;
-        return;
-    }
-    try {
-        num_entries = std::stol(line);
-    }
-    catch(const std::logic_error&)  // either invalid_argument or out_of_range
+    data.assign(mapping.getData(), mapping.getData() + mapping.getSize());
+    return true;
+}
+
+static bool parse_extras(const std::string& filename, const std::vector<U8>& data, LLVOCacheEntry::vocache_gltf_overrides_map_t& cache_extras_entry_map)
+{
+    LL_PROFILE_ZONE_SCOPED;
+    if (data.size() < sizeof(RegionCacheHeader))
     {
-        LL_WARNS() << "Failed reading extras cache for handle " << handle << ". unreadable num_entries" << LL_ENDL;
-        return;
+        return false;
     }
 
-    LL_DEBUGS("GLTF") << "Beginning reading extras cache for handle " << handle << ", " << num_entries << " entries" << LL_ENDL;
+    RegionCacheHeader header;
+    memcpy(&header, data.data(), sizeof(RegionCacheHeader));
+    U32 num_entries = header.mNumEntries;
+    LL_DEBUGS("GLTF") << "Beginning reading extras cache " << filename << ", " << num_entries << " entries" << LL_ENDL;
 
+    size_t offset = sizeof(RegionCacheHeader);
     LLSD entry_llsd;
-    for (U32 i = 0; i < num_entries && !in.eof(); i++)
+    for (U32 i = 0; i < num_entries; i++)
     {
-        static const U32 max_size = 4096;
-        bool success = LLSDSerialize::deserialize(entry_llsd, in, max_size);
-        // check bool(in) this time since eof is not a failure condition here
-        if(!success || !in) {
-            LL_WARNS() << "Failed reading extras cache for handle " << handle << ", entry number " << i << LL_ENDL;
-            return;
+        U32 size = 0;
+        if (offset + sizeof(U32) > data.size())
+        {
+            LL_WARNS() << "Failed reading extras cache " << filename << ", entry number " << i << LL_ENDL;
+            return false;
+        }
+        memcpy(&size, data.data() + offset, sizeof(U32));
+        offset += sizeof(U32);
+        if (!size || offset + size > data.size())
+        {
+            LL_WARNS() << "Failed reading extras cache " << filename << ", entry number " << i << LL_ENDL;
+            return false;
+        }
+
+        LLMemoryStream in(data.data() + offset, size);
+        offset += size;
+        if (LLSDSerialize::fromBinary(entry_llsd, in, size) == LLSDParser::PARSE_FAILURE)
+        {
+            LL_WARNS() << "Failed reading extras cache " << filename << ", entry number " << i << LL_ENDL;
+            return false;
         }
 
         LLGLTFOverrideCacheEntry entry;
@@ -1614,7 +1719,235 @@ void LLVOCache::readGenericExtrasFromCache(U64 handle, const LLUUID& id, LLVOCac
         cache_extras_entry_map[local_id] = entry;
     }
 
-    LL_DEBUGS("GLTF") << "Completed reading extras cache for handle " << handle << ", " << num_entries << " entries" << LL_ENDL;
+    LL_DEBUGS("GLTF") << "Completed reading extras cache " << filename << ", " << num_entries << " entries" << LL_ENDL;
+    return true;
+}
+
+static bool write_region_file(const std::string& filename, const LLUUID& id, LLVOCache::RegionSnapshot& snapshot)
+{
+	LL_PROFILE_ZONE_SCOPED;
+	// Bodies the file already holds, by local id
+	boost::unordered_flat_map<U32, LLVOCacheEntry::CacheRecord> stored;
+	U64 file_size = 0;
+
+	RegionCacheHeader header;
+	LLFILE* fp = LLFile::fopen(filename, "r+b");
+	if (fp)
+	{
+		bool valid = fread(&header, sizeof(header), 1, fp) == 1
+			&& header.mMagic == REGION_CACHE_MAGIC
+			&& header.mVersion == REGION_CACHE_VERSION
+			&& !memcmp(header.mRegionID, id.mData, UUID_BYTES)
+			&& fseek(fp, 0, SEEK_END) == 0;
+		if (valid)
+		{
+			file_size = (U64)ftell(fp);
+			valid = header.mTableOffset + (U64)header.mNumEntries * sizeof(LLVOCacheEntry::CacheRecord) <= file_size
+				&& fseek(fp, (long)header.mTableOffset, SEEK_SET) == 0;
+		}
+		if (valid)
+		{
+			std::vector<LLVOCacheEntry::CacheRecord> records(header.mNumEntries);
+			valid = records.empty() || fread(records.data(), sizeof(LLVOCacheEntry::CacheRecord), records.size(), fp) == records.size();
+			for (U32 i = 0; valid && i < records.size(); i++)
+			{
+				stored[records[i].mLocalID] = records[i];
+			}
+		}
+		if (!valid)
+		{
+			LLFile::close(fp);
+			fp = NULL;
+		}
+	}
+
+	std::vector<LLVOCacheEntry::CacheRecord>& records = snapshot.mRecords;
+	std::vector<const U8*> bodies(records.size());
+	std::vector<bool> stored_bodies(records.size(), false);
+	U64 live_bytes = 0;
+	U64 new_bytes = 0;
+	for (size_t i = 0; i < records.size(); i++)
+	{
+		bodies[i] = snapshot.mBodies.data() + records[i].mOffset;
+		auto stored_iter = stored.find(records[i].mLocalID);
+		if (stored_iter != stored.end() && stored_iter->second.mCRC == records[i].mCRC && stored_iter->second.mSize == records[i].mSize)
+		{
+			stored_bodies[i] = true;
+		}
+		else
+		{
+			new_bytes += records[i].mSize;
+		}
+		live_bytes += records[i].mSize;
+	}
+
+	const U64 table_size = records.size() * sizeof(LLVOCacheEntry::CacheRecord);
+	bool rewrite = !fp || file_size + new_bytes + table_size > 2 * (live_bytes + table_size) + REGION_CACHE_MIN_GARBAGE;
+	std::string temp_filename = filename + ".tmp";
+	if (rewrite)
+	{
+		if (fp)
+		{
+			LLFile::close(fp);
+		}
+		fp = LLFile::fopen(temp_filename, "wb");
+		if (!fp)
+		{
+			return false;
+		}
+		file_size = sizeof(RegionCacheHeader);
+	}
+
+	// Bodies, then the table on an aligned offset
+	bool success = fseek(fp, (long)file_size, SEEK_SET) == 0;
+	U64 offset = file_size;
+	for (size_t i = 0; success && i < records.size(); i++)
+	{
+		if (!rewrite && stored_bodies[i])
+		{
+			records[i].mOffset = stored[records[i].mLocalID].mOffset;
+			continue;
+		}
+		records[i].mOffset = offset;
+		success = fwrite(bodies[i], 1, records[i].mSize, fp) == (size_t)records[i].mSize;
+		offset += records[i].mSize;
+	}
+
+	const U64 padding = (alignof(LLVOCacheEntry::CacheRecord) - offset % alignof(LLVOCacheEntry::CacheRecord)) % alignof(LLVOCacheEntry::CacheRecord);
+	static const U8 zeroes[alignof(LLVOCacheEntry::CacheRecord)] = {};
+	success = success && (!padding || fwrite(zeroes, 1, padding, fp) == padding);
+	offset += padding;
+	success = success && (records.empty() || fwrite(records.data(), sizeof(LLVOCacheEntry::CacheRecord), records.size(), fp) == records.size());
+
+	// The header goes last, it is what makes the new table visible
+	memset(&header, 0, sizeof(header));
+	header.mMagic = REGION_CACHE_MAGIC;
+	header.mVersion = REGION_CACHE_VERSION;
+	memcpy(header.mRegionID, id.mData, UUID_BYTES);
+	header.mNumEntries = records.size();
+	header.mTableOffset = offset;
+	header.mLiveBytes = live_bytes;
+	success = success && fflush(fp) == 0
+		&& fseek(fp, 0, SEEK_SET) == 0
+		&& fwrite(&header, sizeof(header), 1, fp) == 1;
+	success = LLFile::close(fp) == 0 && success;
+
+	if (rewrite)
+	{
+		if (!success || LLFile::rename(temp_filename, filename) != 0)
+		{
+			LLFile::remove(temp_filename, ENOENT);
+			return false;
+		}
+	}
+	return success;
+}
+
+static bool write_extras_file(const std::string& filename, const LLUUID& id, U32 num_entries, const std::string& data)
+{
+    LL_PROFILE_ZONE_SCOPED;
+    RegionCacheHeader header;
+    memset(&header, 0, sizeof(header));
+    header.mMagic = REGION_EXTRAS_MAGIC;
+    header.mVersion = REGION_CACHE_VERSION;
+    memcpy(header.mRegionID, id.mData, UUID_BYTES);
+    header.mNumEntries = num_entries;
+
+    std::string temp_filename = filename + ".tmp";
+    LLFILE* fp = LLFile::fopen(temp_filename, "wb");
+    if (!fp)
+    {
+        return false;
+    }
+
+    bool success = fwrite(&header, sizeof(header), 1, fp) == 1
+        && (data.empty() || fwrite(data.data(), 1, data.size(), fp) == data.size());
+    success = LLFile::close(fp) == 0 && success;
+    if (!success || LLFile::rename(temp_filename, filename) != 0)
+    {
+        LLFile::remove(temp_filename, ENOENT);
+        return false;
+    }
+    return true;
+}
+
+void LLVOCache::postIO(const LL::WorkQueue::Work& work)
+{
+	if (!mThreadPool || !mThreadPool->getQueue().post(work))
+	{
+		// Shutting down, the pool has stopped taking work
+		work();
+	}
+}
+
+// static
+void LLVOCache::postToMainLoop(const LL::WorkQueue::Work& work)
+{
+	LL::WorkQueue::ptr_t main_queue = LL::WorkQueue::getInstance("mainloop");
+	if (!main_queue || on_main_thread())
+	{
+		// Called inline by postIO() on the main thread
+		work();
+	}
+	else
+	{
+		main_queue->post(work);
+	}
+}
+
+void LLVOCache::readFromCacheAsync(U64 handle, const LLUUID& id, read_callback_t callback)
+{
+	if(!mEnabled || !mInitialized || mHandleEntryMap.find(handle) == mHandleEntryMap.end())
+	{
+		LLVOCacheEntry::vocache_entry_map_t entries;
+		LLVOCacheEntry::vocache_gltf_overrides_map_t extras;
+		callback(entries, extras, true);
+		return;
+	}
+
+	std::string filename;
+	getObjectCacheFilename(handle, filename);
+	std::string extras_filename = getObjectCacheExtrasFilename(handle);
+	postIO([handle, id, filename, extras_filename, callback]()
+	{
+		// Hand entries over as they are decoded so the region can start
+		// using them before the whole file is done
+		bool delivered = false;
+		bool success = read_region_file(filename, id, VOCACHE_READ_BATCH_SIZE,
+			[&delivered, callback](LLVOCacheEntry::vocache_entry_map_t& batch)
+			{
+				delivered = true;
+				auto entries = std::make_shared<LLVOCacheEntry::vocache_entry_map_t>();
+				entries->swap(batch);
+				postToMainLoop([entries, callback]()
+				{
+					LLVOCacheEntry::vocache_gltf_overrides_map_t extras;
+					callback(*entries, extras, false);
+				});
+			});
+
+		auto extras_data = std::make_shared<std::vector<U8>>();
+		if (success)
+		{
+			read_extras_file(extras_filename, id, *extras_data);
+		}
+
+		bool remove = !success && !delivered;
+		postToMainLoop([handle, remove, extras_filename, extras_data, callback]()
+		{
+			if (remove && LLVOCache::instanceExists())
+			{
+				LLVOCache::instance().removeEntry(handle);
+			}
+			LLVOCacheEntry::vocache_entry_map_t entries;
+			LLVOCacheEntry::vocache_gltf_overrides_map_t extras;
+			if (!extras_data->empty())
+			{
+				parse_extras(extras_filename, *extras_data, extras);
+			}
+			callback(entries, extras, true);
+		});
+	});
 }
 
 void LLVOCache::purgeEntries(U32 size)
@@ -1627,7 +1960,6 @@ void LLVOCache::purgeEntries(U32 size)
 		mHeaderEntryQueue.erase(iter) ;
 		removeFromCache(entry) ;
 		delete entry;
-        // TODO also delete extras
 	}
 	mNumEntries = mHandleEntryMap.size() ;
 }
@@ -1688,71 +2020,46 @@ void LLVOCache::writeToCache(U64 handle, const LLUUID& id, const LLVOCacheEntry:
 		return ; //nothing changed, no need to update.
 	}
 
-	//write to cache file
-	bool success = true ;
+	// Copy what the write needs, the entries stay with the main thread
+	auto snapshot = std::make_shared<RegionSnapshot>();
+	snapshot->mRecords.reserve(cache_entry_map.size());
+	for (LLVOCacheEntry::vocache_entry_map_t::const_iterator iter = cache_entry_map.begin(); iter != cache_entry_map.end(); ++iter)
 	{
-		std::string filename;
-		getObjectCacheFilename(handle, filename);
-		LLAPRFile apr_file(filename, APR_FOPEN_CREATE|APR_FOPEN_WRITE|APR_FOPEN_BINARY|APR_FOPEN_TRUNCATE, mLocalAPRFilePoolp);
-	
-		success = check_write(&apr_file, (void*)id.mData, UUID_BYTES);
-	
-		if(success)
+		if (removal_enabled && !iter->second->isValid())
 		{
-			S32 num_entries = cache_entry_map.size(); // if removal is enabled num_entries might be wrong
-			success = check_write(&apr_file, &num_entries, sizeof(S32));
-            if (success)
-            {
-                const S32 buffer_size = 32768; //should be large enough for couple MAX_ENTRY_BODY_SIZE
-                U8 data_buffer[buffer_size]; // generaly entries are fairly small, so collect them and drop onto disk in one go
-                S32 size_in_buffer = 0;
-
-                // This can have a lot of entries, so might be better to dump them into buffer first and write in one go.
-                for (LLVOCacheEntry::vocache_entry_map_t::const_iterator iter = cache_entry_map.begin(); success && iter != cache_entry_map.end(); ++iter)
-                {
-                    if (!removal_enabled || iter->second->isValid())
-                    {
-                        S32 size = iter->second->writeToBuffer(data_buffer + size_in_buffer);
-
-                        if (size > ENTRY_HEADER_SIZE) // body is minimum of 1
-                        {
-                            size_in_buffer += size;
-                        }
-                        else
-                        {
-                            success = false;
-                            break;
-                        }
-
-                        // Make sure we have space in buffer for next element
-                        if (buffer_size - size_in_buffer < MAX_ENTRY_BODY_SIZE + ENTRY_HEADER_SIZE)
-                        {
-                            success = check_write(&apr_file, (void*)data_buffer, size_in_buffer);
-                            size_in_buffer = 0;
-                            if (!success)
-                            {
-                                break;
-                            }
-                        }
-                    }
-                }
-
-                if (success && size_in_buffer > 0)
-                {
-                    // final write
-                    success = check_write(&apr_file, (void*)data_buffer, size_in_buffer);
-                    size_in_buffer = 0;
-                }
-            }
+			continue;
 		}
-	}
 
-	if(!success)
-	{
-		removeEntry(entry) ;
+		LLVOCacheEntry::CacheRecord record;
+		iter->second->getCacheRecord(record);
+		if (record.mSize < 1 || record.mSize > MAX_ENTRY_BODY_SIZE || !iter->second->getBody())
+		{
+			LL_WARNS() << "Not caching entry " << record.mLocalID << " with size " << record.mSize << LL_ENDL;
+			continue;
+		}
+
+		record.mOffset = snapshot->mBodies.size();
+		snapshot->mBodies.insert(snapshot->mBodies.end(), iter->second->getBody(), iter->second->getBody() + record.mSize);
+		snapshot->mRecords.push_back(record);
 	}
 
-	return ;
+	//write to cache file
+	std::string filename;
+	getObjectCacheFilename(handle, filename);
+	postIO([handle, id, filename, snapshot]()
+	{
+		if (!write_region_file(filename, id, *snapshot))
+		{
+			LL_WARNS() << "Failed to write object cache file " << filename << LL_ENDL;
+			postToMainLoop([handle]()
+			{
+				if (LLVOCache::instanceExists())
+				{
+					LLVOCache::instance().removeEntry(handle);
+				}
+			});
+		}
+	});
 }
 
 void LLVOCache::writeGenericExtrasToCache(U64 handle, const LLUUID& id, const LLVOCacheEntry::vocache_gltf_overrides_map_t& cache_extras_entry_map, BOOL dirty_cache, bool removal_enabled)
@@ -1770,46 +2077,32 @@ void LLVOCache::writeGenericExtrasToCache(U64 handle, const LLUUID& id, const LL
         return;
     }
 
-    std::string filename(getObjectCacheExtrasFilename(handle));
-    llofstream out(filename, std::ios::out | std::ios::binary);
-    if(!out.good())
-    {
-        LL_WARNS() << "Failed writing extras cache for handle " << handle << LL_ENDL;
-        return;
-        // TODO - clean up broken cache file
-    }
-
-    out << id << '\n';
-    if(!out.good())
-    {
-        LL_WARNS() << "Failed writing extras cache for handle " << handle << LL_ENDL;
-        return;
-        // TODO - clean up broken cache file
-    }
-
+    // LLSD is not thread safe, serialize here and only write on the pool
+    std::ostringstream out;
     U32 num_entries = cache_extras_entry_map.size();
-    out << num_entries << '\n';
-    if(!out.good())
-    {
-        LL_WARNS() << "Failed writing extras cache for handle " << handle << LL_ENDL;
-        return;
-        // TODO - clean up broken cache file
-    }
-
     for (auto const & entry : cache_extras_entry_map)
     {
         S32 local_id = entry.first;
         LLSD entry_llsd = entry.second.toLLSD();
         entry_llsd["local_id"] = local_id;
-        LLSDSerialize::serialize(entry_llsd, out, LLSDSerialize::LLSD_XML);
-        out << '\n';
-        if(!out.good())
+
+        std::ostringstream entry_out;
+        LLSDSerialize::toBinary(entry_llsd, entry_out);
+        std::string data = entry_out.str();
+        U32 size = data.size();
+        out.write((const char*)&size, sizeof(U32));
+        out.write(data.data(), size);
+    }
+
+    auto data = std::make_shared<std::string>(out.str());
+    std::string filename(getObjectCacheExtrasFilename(handle));
+    postIO([handle, id, filename, num_entries, data]()
+    {
+        if (!write_extras_file(filename, id, num_entries, *data))
         {
             LL_WARNS() << "Failed writing extras cache for handle " << handle << LL_ENDL;
             return;
-            // TODO - clean up broken cache file
         }
-    }
-
-    LL_DEBUGS("GLTF") << "Completed writing extras cache for handle " << handle << ", " << num_entries << " entries" << LL_ENDL;
+        LL_DEBUGS("GLTF") << "Completed writing extras cache for handle " << handle << ", " << num_entries << " entries" << LL_ENDL;
+    });
 }
@@ -33,6 +33,8 @@
 #include "llvieweroctree.h"
 #include "llapr.h"
 #include "llgltfmaterial.h"
+#include "threadpool_fwd.h"
+#include "workqueue.h"
 
 #include <unordered_map>
 
@@ -102,11 +104,23 @@ class LLVOCacheEntry final
         std::string extras_raw;
     };
 
+    // Fixed size part of an entry as stored in a region cache file
+    struct CacheRecord
+    {
+        U32 mLocalID;
+        U32 mCRC;
+        S32 mHitCount;
+        S32 mDupeCount;
+        S32 mCRCChangeCount;
+        S32 mSize;   // of the body
+        U64 mOffset; // of the body in the file
+    };
+
 protected:
 	~LLVOCacheEntry();
 public:
 	LLVOCacheEntry(U32 local_id, U32 crc, LLDataPackerBinaryBuffer &dp);
-	LLVOCacheEntry(LLAPRFile* apr_file);
+	LLVOCacheEntry(const CacheRecord& record, const U8* body);
 	LLVOCacheEntry();	
 
 	void updateEntry(U32 crc, LLDataPackerBinaryBuffer &dp);
@@ -129,7 +143,8 @@ class LLVOCacheEntry final
 	F32 getSceneContribution() const             { return mSceneContrib;}
 
 	void dump() const;
-	S32 writeToBuffer(U8 *data_buffer) const;
+	void getCacheRecord(CacheRecord& record) const;
+	const U8* getBody() const { return mBuffer; }
 	LLDataPackerBinaryBuffer *getDP() const;
 	void recordHit();
 	void recordDupe() { mDupeCount++; }
@@ -250,7 +265,8 @@ class LLVOCachePartition final : public LLViewerOctreePartition
 };
 
 //
-//Note: LLVOCache is not thread-safe
+//Note: LLVOCache is not thread-safe, call it from the main thread only.
+//Region file I/O is done on the "VOCache" thread pool.
 //
 class LLVOCache final : public LLParamSingleton<LLVOCache>
 {
@@ -290,12 +306,21 @@ class LLVOCache final : public LLParamSingleton<LLVOCache>
 	typedef std::map<U64, HeaderEntryInfo*> handle_entry_map_t;
 
 public:
+	struct RegionSnapshot;
+
+	// Called on the main thread, once per batch of entries read and a last
+	// time with done set and the extras.
+	typedef std::function<void(LLVOCacheEntry::vocache_entry_map_t& entries,
+							   LLVOCacheEntry::vocache_gltf_overrides_map_t& extras,
+							   bool done)> read_callback_t;
+
 	// We need this init to be separate from constructor, since we might construct cache, purge it, then init.
 	void initCache(ELLPath location, U32 size, U32 cache_version);
 	void removeCache(ELLPath location, bool started = false) ;
 
-	void readFromCache(U64 handle, const LLUUID& id, LLVOCacheEntry::vocache_entry_map_t& cache_entry_map) ;
-    void readGenericExtrasFromCache(U64 handle, const LLUUID& id, LLVOCacheEntry::vocache_gltf_overrides_map_t& cache_extras_entry_map);
+	// Reads both without blocking, callback may run before this returns
+	// if there is nothing to read.
+	void readFromCacheAsync(U64 handle, const LLUUID& id, read_callback_t callback);
 
 	void writeToCache(U64 handle, const LLUUID& id, const LLVOCacheEntry::vocache_entry_map_t& cache_entry_map, BOOL dirty_cache, bool removal_enabled);
     void writeGenericExtrasToCache(U64 handle, const LLUUID& id, const LLVOCacheEntry::vocache_gltf_overrides_map_t& cache_extras_entry_map, BOOL dirty_cache, bool removal_enabled);
@@ -317,6 +342,8 @@ class LLVOCache final : public LLParamSingleton<LLVOCache>
 	void removeEntry(HeaderEntryInfo* entry) ;
 	void purgeEntries(U32 size);
 	BOOL updateEntry(const HeaderEntryInfo* entry);
+	void postIO(const LL::WorkQueue::Work& work);
+	static void postToMainLoop(const LL::WorkQueue::Work& work);
 	
 private:
 	bool                 mEnabled;
@@ -328,6 +355,7 @@ class LLVOCache final : public LLParamSingleton<LLVOCache>
 	std::string          mHeaderFileName ;
 	std::string          mObjectCacheDirName;
 	LLVolatileAPRPool*   mLocalAPRFilePoolp ; 	
+	std::unique_ptr<LL::ThreadPool> mThreadPool;
 	header_entry_queue_t mHeaderEntryQueue;
 	handle_entry_map_t   mHandleEntryMap;	
 };
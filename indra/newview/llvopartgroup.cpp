@@ -135,7 +135,9 @@ bool ll_is_part_idx_allocated(S32 idx, S32* start, S32* end)
 
 LLVOPartGroup::LLVOPartGroup(const LLUUID &id, const LLPCode pcode, LLViewerRegion *regionp)
 	:	LLAlphaObject(id, pcode, regionp),
-		mViewerPartGroupp(NULL)
+		mViewerPartGroupp(NULL),
+		mBillboardSerial(0),
+		mHasBillboards(false)
 {
 	setNumTEs(1);
 	setTETexture(0, LLUUID::null);
@@ -325,14 +327,18 @@ BOOL LLVOPartGroup::updateGeometry(LLDrawable *drawable)
 	
 	F32 max_scale = 0.f;
 
+	// positions, scales and colors straight from the simulation arrays
+	const LLViewerPartArrays& arrays = mViewerPartGroupp->mArrays;
 
 	for (i = 0 ; i < (S32)mViewerPartGroupp->mParticles.size(); i++)
 	{
 		const LLViewerPart *part = mViewerPartGroupp->mParticles[i];
-
+		const F32 scale_x = arrays.mScale[0][i];
+		const F32 scale_y = arrays.mScale[1][i];
+		const LLVector3 part_pos_agent(arrays.mPos[VX][i], arrays.mPos[VY][i], arrays.mPos[VZ][i]);
 
 		//remember the largest particle
-		max_scale = llmax(max_scale, part->mScale.mV[0], part->mScale.mV[1]);
+		max_scale = llmax(max_scale, scale_x, scale_y);
 
 		if (part->mFlags & LLPartData::LL_PART_RIBBON_MASK)
 		{ //include ribbon segment length in scale
@@ -348,13 +354,12 @@ BOOL LLVOPartGroup::updateGeometry(LLDrawable *drawable)
 
 			if (pos_agent)
 			{
-				F32 dist = (*pos_agent-part->mPosAgent).length();
+				F32 dist = (*pos_agent-part_pos_agent).length();
 
 				max_scale = llmax(max_scale, dist);
 			}
 		}
 
-		LLVector3 part_pos_agent(part->mPosAgent);
 		LLVector3 at(part_pos_agent - camera_agent);
 
 		
@@ -368,7 +373,7 @@ BOOL LLVOPartGroup::updateGeometry(LLDrawable *drawable)
 		llassert(llfinite(inv_camera_dist_squared));
 		llassert(!llisnan(inv_camera_dist_squared));
 
-		F32 area = part->mScale.mV[0] * part->mScale.mV[1] * inv_camera_dist_squared;
+		F32 area = scale_x * scale_y * inv_camera_dist_squared;
 		tot_area = llmax(tot_area, area);
  		
 		if (tot_area > max_area)
@@ -408,8 +413,8 @@ BOOL LLVOPartGroup::updateGeometry(LLDrawable *drawable)
 			facep->clearState(LLFace::FULLBRIGHT);
 		}
 
-		facep->mCenterLocal = part->mPosAgent;
-		facep->setFaceColor(part->mColor);
+		facep->mCenterLocal = part_pos_agent;
+		facep->setFaceColor(LLColor4(arrays.mColor[0][i], arrays.mColor[1][i], arrays.mColor[2][i], arrays.mColor[3][i]));
 		facep->setTexture(part->mImagep);
 			
 		//check if this particle texture is replaced by a parcel media texture.
@@ -500,6 +505,15 @@ BOOL LLVOPartGroup::lineSegmentIntersect(const LLVector4a& start, const LLVector
 
 void LLVOPartGroup::getGeometry(const LLViewerPart& part,
 								LLStrider<LLVector4a>& verticesp)
+{
+	LLVector4a camera_agent;
+	camera_agent.load3(getCameraPosition().mV);
+	getGeometry(part, camera_agent, verticesp);
+}
+
+void LLVOPartGroup::getGeometry(const LLViewerPart& part,
+								const LLVector4a& camera_agent,
+								LLStrider<LLVector4a>& verticesp)
 {
 	if (part.mFlags & LLPartData::LL_PART_RIBBON_MASK)
 	{
@@ -555,75 +569,8 @@ void LLVOPartGroup::getGeometry(const LLViewerPart& part,
 	}
 	else
 	{
-		LLVector4a part_pos_agent;
-		part_pos_agent.load3(part.mPosAgent.mV);
-		LLVector4a camera_agent;
-		camera_agent.load3(getCameraPosition().mV); 
-		LLVector4a at;
-		at.setSub(part_pos_agent, camera_agent);
-		LLVector4a up(0, 0, 1);
-		LLVector4a right;
-
-		right.setCross3(at, up);
-		right.normalize3fast();
-
-		up.setCross3(right, at);
-		up.normalize3fast();
-
-		if (part.mFlags & LLPartData::LL_PART_FOLLOW_VELOCITY_MASK && !part.mVelocity.isExactlyZero())
-		{
-			LLVector4a normvel;
-			normvel.load3(part.mVelocity.mV);
-			normvel.normalize3fast();
-			LLVector2 up_fracs;
-			up_fracs.mV[0] = normvel.dot3(right).getF32();
-			up_fracs.mV[1] = normvel.dot3(up).getF32();
-			up_fracs.normalize();
-			LLVector4a new_up;
-			LLVector4a new_right;
-
-			//new_up = up_fracs.mV[0] * right + up_fracs.mV[1]*up;
-			LLVector4a t = right;
-			t.mul(up_fracs.mV[0]);
-			new_up = up;
-			new_up.mul(up_fracs.mV[1]);
-			new_up.add(t);
-
-			//new_right = up_fracs.mV[1] * right - up_fracs.mV[0]*up;
-			t = right;
-			t.mul(up_fracs.mV[1]);
-			new_right = up;
-			new_right.mul(up_fracs.mV[0]);
-			t.sub(new_right);
-
-			up = new_up;
-			right = t;
-			up.normalize3fast();
-			right.normalize3fast();
-		}
-
-		right.mul(0.5f*part.mScale.mV[0]);
-		up.mul(0.5f*part.mScale.mV[1]);
-
-
-		//HACK -- the verticesp->mV[3] = 0.f here are to set the texture index to 0 (particles don't use texture batching, maybe they should)
-		// this works because there is actually a 4th float stored after the vertex position which is used as a texture index
-		// also, somebody please VECTORIZE THIS
-
-		LLVector4a ppapu;
-		LLVector4a ppamu;
-
-		ppapu.setAdd(part_pos_agent, up);
-		ppamu.setSub(part_pos_agent, up);
-
-		verticesp->setSub(ppapu, right);
-		(*verticesp++).getF32ptr()[3] = 0.f;
-		verticesp->setSub(ppamu, right);
-		(*verticesp++).getF32ptr()[3] = 0.f;
-		verticesp->setAdd(ppapu, right);
-		(*verticesp++).getF32ptr()[3] = 0.f;
-		verticesp->setAdd(ppamu, right);
-		(*verticesp++).getF32ptr()[3] = 0.f;
+		ll_part_billboard(verticesp.get(), part.mPosAgent, part.mVelocity, part.mScale, part.mFlags, camera_agent);
+		verticesp += 4;
 	}
 }
 
@@ -644,8 +591,59 @@ void LLVOPartGroup::getGeometry(S32 idx,
 	
 	const LLViewerPart &part = *((LLViewerPart*) (mViewerPartGroupp->mParticles[idx]));
 
-	getGeometry(part, verticesp);
+	if (hasCurrentBillboards())
+	{ //copy what generateBillboards made earlier this frame
+		const U32 first = idx * 4;
+		for (U32 i = first; i < first + 4; i++)
+		{
+			*verticesp++ = mBillboardVertices[i];
+			*colorsp++ = mBillboardColors[i];
+		}
+
+		if (mBillboardHasGlow[idx])
+		{
+			for (U32 i = first; i < first + 4; i++)
+			{
+				*emissivep++ = mBillboardGlow[i];
+			}
+		}
+	}
+	else
+	{
+		getGeometry(part, verticesp);
+
+		LLColor4U colors[4];
+		LLColor4U glow[4];
+		bool has_glow = getColors(part, colors, glow);
+
+		for (U32 i = 0; i < 4; i++)
+		{
+			*colorsp++ = colors[i];
+		}
+
+		//Only add emissive attributes if glowing (doing it for all particles is INCREDIBLY inefficient as it leads to a second, slower, render pass.)
+		if (has_glow)
+		{ //only write glow if it is not zero
+			for (U32 i = 0; i < 4; i++)
+			{
+				*emissivep++ = glow[i];
+			}
+		}
+	}
 
+	if (!(part.mFlags & LLPartData::LL_PART_EMISSIVE_MASK))
+	{ //not fullbright, needs normal
+		LLVector3 normal = -LLViewerCamera::getInstance()->getXAxis();
+		*normalsp++   = normal;
+		*normalsp++   = normal;
+		*normalsp++   = normal;
+		*normalsp++   = normal;
+	}
+}
+
+//static
+bool LLVOPartGroup::getColors(const LLViewerPart& part, LLColor4U* colors, LLColor4U* glow)
+{
 	LLColor4U pcolor;
 	LLColor4U color = part.mColor;
 
@@ -670,29 +668,53 @@ void LLVOPartGroup::getGeometry(S32 idx,
 		pcolor = color;
 	}
 
-	*colorsp++ = pcolor;
-	*colorsp++ = pcolor;
-	*colorsp++ = color;
-	*colorsp++ = color;
-
-	//Only add emissive attributes if glowing (doing it for all particles is INCREDIBLY inefficient as it leads to a second, slower, render pass.)
-	if (pglow.mV[3] > 0 || part.mGlow.mV[3] > 0)
-	{ //only write glow if it is not zero
-		*emissivep++ = pglow;
-		*emissivep++ = pglow;
-		*emissivep++ = part.mGlow;
-		*emissivep++ = part.mGlow;
-	}
+	colors[0] = pcolor;
+	colors[1] = pcolor;
+	colors[2] = color;
+	colors[3] = color;
 
+	glow[0] = pglow;
+	glow[1] = pglow;
+	glow[2] = part.mGlow;
+	glow[3] = part.mGlow;
 
-	if (!(part.mFlags & LLPartData::LL_PART_EMISSIVE_MASK))
-	{ //not fullbright, needs normal
-		LLVector3 normal = -LLViewerCamera::getInstance()->getXAxis();
-		*normalsp++   = normal;
-		*normalsp++   = normal;
-		*normalsp++   = normal;
-		*normalsp++   = normal;
+	return pglow.mV[3] > 0 || part.mGlow.mV[3] > 0;
+}
+
+bool LLVOPartGroup::hasCurrentBillboards() const
+{
+	return mHasBillboards && mViewerPartGroupp &&
+		mBillboardSerial == mViewerPartGroupp->getGeometrySerial() &&
+		mBillboardHasGlow.size() == mViewerPartGroupp->mParticles.size();
+}
+
+// Must not touch anything outside this group's particles and their
+// sources, this runs on a worker thread while the main thread waits.
+void LLVOPartGroup::generateBillboards(const LLVector3& camera_agent)
+{
+	const LLViewerPartGroup::part_list_t& particles = mViewerPartGroupp->mParticles;
+	const U32 count = (U32)particles.size();
+
+	mBillboardVertices.resize(count * 4);
+	mBillboardColors.resize(count * 4);
+	mBillboardGlow.resize(count * 4);
+	mBillboardHasGlow.resize(count);
+
+	LLVector4a camera;
+	camera.load3(camera_agent.mV);
+
+	LLStrider<LLVector4a> verticesp;
+	verticesp = mBillboardVertices.data();
+
+	for (U32 i = 0; i < count; i++)
+	{
+		const LLViewerPart& part = *particles[i];
+		getGeometry(part, camera, verticesp);
+		mBillboardHasGlow[i] = getColors(part, &mBillboardColors[i * 4], &mBillboardGlow[i * 4]);
 	}
+
+	mBillboardSerial = mViewerPartGroupp->getGeometrySerial();
+	mHasBillboards = true;
 }
 
 U32 LLVOPartGroup::getPartitionType() const
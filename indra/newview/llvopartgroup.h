@@ -81,6 +81,9 @@ class LLVOPartGroup : public LLAlphaObject
 	/*virtual*/ BOOL        updateGeometry(LLDrawable *drawable) override;
 	void		getGeometry(const LLViewerPart& part,							
 								LLStrider<LLVector4a>& verticesp);
+	void		getGeometry(const LLViewerPart& part,
+								const LLVector4a& camera_agent,
+								LLStrider<LLVector4a>& verticesp);
 				
 				void		getGeometry(S32 idx,
 								LLStrider<LLVector4a>& verticesp,
@@ -99,12 +102,27 @@ class LLVOPartGroup : public LLAlphaObject
 	void setViewerPartGroup(LLViewerPartGroup *part_groupp)		{ mViewerPartGroupp = part_groupp; }
 	LLViewerPartGroup* getViewerPartGroup()	{ return mViewerPartGroupp; }
 
+	// Billboard vertices and colors for every particle, generated ahead of
+	// the partition rebuild (possibly on a worker thread) and copied by
+	// getGeometry() while the particles haven't changed since.
+	bool hasCurrentBillboards() const;
+	void generateBillboards(const LLVector3& camera_agent);
+	virtual LLVector3 getCameraPosition() const;
+
 protected:
 	~LLVOPartGroup();
 
+	// fills 4 vertex colors and 4 glow colors, returns true if the particle glows
+	static bool getColors(const LLViewerPart& part, LLColor4U* colors, LLColor4U* glow);
+
 	LLViewerPartGroup *mViewerPartGroupp;
 
-	virtual LLVector3 getCameraPosition() const;
+	std::vector<LLVector4a> mBillboardVertices;
+	std::vector<LLColor4U> mBillboardColors;
+	std::vector<LLColor4U> mBillboardGlow;
+	std::vector<U8> mBillboardHasGlow;
+	U32 mBillboardSerial;
+	bool mHasBillboards;
 
 };
 
@@ -116,10 +134,12 @@ class LLVOHUDPartGroup final : public LLVOPartGroup
 	  LLVOPartGroup(id, pcode, regionp)   
 	{
 	}
+
+	virtual LLVector3 getCameraPosition() const override;
+
 protected:
 	LLDrawable* createDrawable(LLPipeline *pipeline) override;
 	U32 getPartitionType() const override;
-	virtual LLVector3 getCameraPosition() const override;
 };
 
 #endif // LL_LLVOPARTGROUP_H
@@ -91,6 +91,7 @@
 #include "llavatarappearancedefines.h"
 #include "llgltfmateriallist.h"
 #include "lltoolmgr.h"
+#include "parallelfor.h"
 // [RLVa:KB] - Checked: RLVa-2.0.0
 #include "rlvactions.h"
 #include "rlvlocks.h"
@@ -5015,7 +5016,8 @@ void LLRiggedVolume::update(
             if (rebuild_face_octrees)
 			{
                 dst_face.destroyOctree();
-                dst_face.createOctree();
+                dst_face.destroyBVH();
+                dst_face.createBVH();
 			}
 		}
 	}
@@ -5144,6 +5146,12 @@ LLFace** LLVolumeGeometryManager::sSpecFaces[2] = { NULL };
 LLFace** LLVolumeGeometryManager::sNormSpecFaces[2] = { NULL };
 LLFace** LLVolumeGeometryManager::sPbrFaces[2] = { NULL };
 LLFace** LLVolumeGeometryManager::sAlphaFaces[2] = { NULL };
+bool LLVolumeGeometryManager::sDeferGeometry = false;
+std::vector<LLVolumeGeometryManager::PendingGeometry> LLVolumeGeometryManager::sPendingGeometry;
+std::vector<LLPointer<LLVertexBuffer> > LLVolumeGeometryManager::sPendingBuffers;
+
+// faces per job when generating vertex data in parallel
+const static size_t GEOMETRY_JOB_GRAIN = 4;
 
 LLVolumeGeometryManager::LLVolumeGeometryManager()
 	: LLGeometryManager()
@@ -5980,6 +5988,12 @@ void LLVolumeGeometryManager::rebuildGeom(LLSpatialGroup* group)
 
 	U32 geometryBytes = 0;
 
+    // with RenderParallelGeometry, genDrawInfo only lays out the buffers and
+    // the vertex data of the whole group is generated at once further down.
+    // gDebugGL validates indices as draw infos are made, so it needs them now.
+    static LLCachedControl<bool> parallel_geometry(gSavedSettings, "RenderParallelGeometry", true);
+    sDeferGeometry = parallel_geometry && !gDebugGL;
+
     // generate render batches for static geometry
     U32 extra_mask = LLVertexBuffer::MAP_TEXTURE_INDEX;
     BOOL alpha_sort = TRUE;
@@ -6000,6 +6014,12 @@ void LLVolumeGeometryManager::rebuildGeom(LLSpatialGroup* group)
         rigged = TRUE;
     }
 
+	if (sDeferGeometry)
+	{
+		generatePendingGeometry();
+		sDeferGeometry = false;
+	}
+
 	group->mGeometryBytes = geometryBytes;
 
 	{
@@ -6434,22 +6454,30 @@ U32 LLVolumeGeometryManager::genDrawInfo(LLSpatialGroup* group, U32 mask, LLFace
 					LLVOVolume* vobj = drawablep->getVOVolume();
 					LLVolume* volume = vobj->getVolume();
 
-					if (drawablep->isState(LLDrawable::ANIMATED_CHILD))
-					{
-						vobj->updateRelativeXform(true);
-					}
-
 					U32 te_idx = facep->getTEOffset();
 
-					if (!facep->getGeometryVolume(*volume, te_idx, 
-						vobj->getRelativeXform(), vobj->getRelativeXformInvTrans(), index_offset,true))
-					{
-						LL_WARNS() << "Failed to get geometry for face!" << LL_ENDL;
+					if (sDeferGeometry && !drawablep->isState(LLDrawable::ANIMATED_CHILD))
+					{ //animated children swap their relative transform around the copy, so only they stay here
+						facep->prepareGeometryVolume(te_idx);
+						sPendingGeometry.push_back({ facep, index_offset });
 					}
-
-					if (drawablep->isState(LLDrawable::ANIMATED_CHILD))
+					else
 					{
-						vobj->updateRelativeXform(false);
+						if (drawablep->isState(LLDrawable::ANIMATED_CHILD))
+						{
+							vobj->updateRelativeXform(true);
+						}
+
+						if (!facep->getGeometryVolume(*volume, te_idx, 
+							vobj->getRelativeXform(), vobj->getRelativeXformInvTrans(), index_offset,true))
+						{
+							LL_WARNS() << "Failed to get geometry for face!" << LL_ENDL;
+						}
+
+						if (drawablep->isState(LLDrawable::ANIMATED_CHILD))
+						{
+							vobj->updateRelativeXform(false);
+						}
 					}
 				}
 			}
@@ -6800,7 +6828,14 @@ U32 LLVolumeGeometryManager::genDrawInfo(LLSpatialGroup* group, U32 mask, LLFace
 
 		if (buffer)
 		{
-			buffer->unmapBuffer();
+			if (sDeferGeometry)
+			{
+				sPendingBuffers.push_back(buffer);
+			}
+			else
+			{
+				buffer->unmapBuffer();
+			}
 		}
 	}
 
@@ -6813,6 +6848,47 @@ U32 LLVolumeGeometryManager::genDrawInfo(LLSpatialGroup* group, U32 mask, LLFace
 	return geometryBytes;
 }
 
+void LLVolumeGeometryManager::generatePendingGeometry()
+{
+    LL_PROFILE_ZONE_SCOPED_CATEGORY_VOLUME;
+
+	// every face of these buffers is written below, flag them as mapped up
+	// front so the jobs don't have to track regions
+	for (LLVertexBuffer* buffer : sPendingBuffers)
+	{
+		buffer->mapAll();
+	}
+
+	{
+        LL_PROFILE_ZONE_NAMED("generatePendingGeometry - jobs");
+		LL::parallel_for(sPendingGeometry.size(), GEOMETRY_JOB_GRAIN, [](size_t begin, size_t end)
+			{
+				for (size_t i = begin; i < end; ++i)
+				{
+					LLFace* facep = sPendingGeometry[i].mFace;
+					LLVOVolume* vobj = facep->getDrawable()->getVOVolume();
+
+					if (!facep->getGeometryVolume(*vobj->getVolume(), facep->getTEOffset(),
+						vobj->getRelativeXform(), vobj->getRelativeXformInvTrans(), sPendingGeometry[i].mIndexOffset, true))
+					{
+						LL_WARNS() << "Failed to get geometry for face!" << LL_ENDL;
+					}
+				}
+			});
+	}
+
+	{
+        LL_PROFILE_ZONE_NAMED("generatePendingGeometry - flush");
+		for (LLVertexBuffer* buffer : sPendingBuffers)
+		{
+			buffer->unmapBuffer();
+		}
+	}
+
+	sPendingGeometry.clear();
+	sPendingBuffers.clear();
+}
+
 void LLVolumeGeometryManager::addGeometryCount(LLSpatialGroup* group, U32& vertex_count, U32& index_count)
 {
     //for each drawable
@@ -38,6 +38,8 @@
 #include "llnamevalue.h"
 #include "llpointer.h"
 #include "llprimitive.h"
+#include "llsdserialize.h"
+#include "llsdutil_math.h"
 #include "llvolume.h"
 #include "material_codes.h"
 #include "v3color.h"
@@ -46,6 +48,7 @@
 #include "llrender.h"
 #include "llstartup.h"
 #include "llwindow.h"	// swapBuffers()
+#include "parallelfor.h"
 
 // newview includes
 #include "llagent.h"
@@ -502,6 +505,7 @@ void LLPipeline::init()
 	connectRefreshCachedSettingsSafe("RenderAutoMaskAlphaDeferred");
 	connectRefreshCachedSettingsSafe("RenderAutoMaskAlphaNonDeferred");
 	connectRefreshCachedSettingsSafe("RenderUseFarClip");
+	connectRefreshCachedSettingsSafe("RenderBatchFrustumCull");
 	connectRefreshCachedSettingsSafe("RenderAvatarMaxNonImpostors");
 	connectRefreshCachedSettingsSafe("UseOcclusion");
 	// DEPRECATED -- connectRefreshCachedSettingsSafe("WindLightUseAtmosShaders");
@@ -1031,6 +1035,7 @@ void LLPipeline::refreshCachedSettings()
 	LLPipeline::sAutoMaskAlphaDeferred = gSavedSettings.getBOOL("RenderAutoMaskAlphaDeferred");
 	LLPipeline::sAutoMaskAlphaNonDeferred = gSavedSettings.getBOOL("RenderAutoMaskAlphaNonDeferred");
 	LLPipeline::sUseFarClip = gSavedSettings.getBOOL("RenderUseFarClip");
+	LLViewerOctreeCull::sBatchFrustumCheck = gSavedSettings.getBOOL("RenderBatchFrustumCull");
 	LLVOAvatar::sMaxNonImpostors = gSavedSettings.getU32("RenderAvatarMaxNonImpostors");
 	LLVOAvatar::updateImpostorRendering(LLVOAvatar::sMaxNonImpostors);
 	LLPipeline::sRenderAttachedLights = gSavedSettings.getBOOL("RenderAttachedLights");
@@ -2416,31 +2421,46 @@ void LLPipeline::updateCull(LLCamera& camera, LLCullResult& result)
 
 	sCull->clear();
 
-	for (LLWorld::region_list_t::const_iterator iter = LLWorld::getInstance()->getRegionList().begin(); 
-			iter != LLWorld::getInstance()->getRegionList().end(); ++iter)
+	static LLCachedControl<bool> parallel_cull(gSavedSettings, "RenderParallelCull", true);
+	if (parallel_cull && sUseOcclusion == 0)
+	{ //shadow, probe and HUD passes never touch occlusion state, so the traversals can be split up
+		cullPartitionsParallel(camera);
+	}
+	else
 	{
-		LLViewerRegion* region = *iter;
-
-		for (U32 i = 0; i < LLViewerRegion::NUM_PARTITIONS; i++)
+		for (LLWorld::region_list_t::const_iterator iter = LLWorld::getInstance()->getRegionList().begin(); 
+				iter != LLWorld::getInstance()->getRegionList().end(); ++iter)
 		{
-			LLSpatialPartition* part = region->getSpatialPartition(i);
-			if (part)
+			LLViewerRegion* region = *iter;
+
+			for (U32 i = 0; i < LLViewerRegion::NUM_PARTITIONS; i++)
 			{
-				if (hasRenderType(part->mDrawableType))
+				LLSpatialPartition* part = region->getSpatialPartition(i);
+				if (part)
 				{
-					part->cull(camera);
+					if (hasRenderType(part->mDrawableType))
+					{
+						part->cull(camera);
+					}
 				}
 			}
-		}
 
-		//scan the VO Cache tree
-		LLVOCachePartition* vo_part = region->getVOCachePartition();
-		if(vo_part)
-		{
-			vo_part->cull(camera, sUseOcclusion > 0);
+			//scan the VO Cache tree
+			LLVOCachePartition* vo_part = region->getVOCachePartition();
+			if(vo_part)
+			{
+				vo_part->cull(camera, sUseOcclusion > 0);
+			}
 		}
 	}
 
+	static LLCachedControl<bool> cull_snapshot(gSavedSettings, "RenderCullSnapshot", false);
+	if (cull_snapshot && LLViewerCamera::sCurCameraID == LLViewerCamera::CAMERA_WORLD)
+	{
+		gSavedSettings.setBOOL("RenderCullSnapshot", FALSE);
+		writeCullSnapshot(camera);
+	}
+
 	if (hasRenderType(LLPipeline::RENDER_TYPE_SKY) && 
 		gSky.mVOSkyp.notNull() && 
 		gSky.mVOSkyp->mDrawable.notNull())
@@ -2461,6 +2481,136 @@ void LLPipeline::updateCull(LLCamera& camera, LLCullResult& result)
     }
 }
 
+static void append_octree_bounds(const OctreeNode* node, S32 parent, LLSD& nodes)
+{
+	const LLViewerOctreeGroup* group = (const LLViewerOctreeGroup*) node->getListener(0);
+	const LLVector4a* bounds = group->getBounds();
+
+	S32 index = nodes.size();
+	LLSD entry;
+	for (U32 i = 0; i < 2; i++)
+	{
+		for (U32 j = 0; j < 3; j++)
+		{
+			entry.append(bounds[i][j]);
+		}
+	}
+	entry.append(parent);
+	nodes.append(entry);
+
+	for (U32 i = 0; i < node->getChildCount(); i++)
+	{
+		append_octree_bounds(node->getChild(i), index, nodes);
+	}
+}
+
+void LLPipeline::cullPartitionsParallel(LLCamera& camera)
+{
+	LL_PROFILE_ZONE_SCOPED_CATEGORY_PIPELINE;
+	llassert(sUseOcclusion == 0);
+
+	const LLWorld::region_list_t& regions = LLWorld::getInstance()->getRegionList();
+
+	// rebound on the main thread; after this the octrees are read only until
+	// the results are marked below
+	std::vector<LLSpatialPartition*> parts;
+	std::vector<U32> region_end;
+	region_end.reserve(regions.size());
+	for (LLViewerRegion* region : regions)
+	{
+		for (U32 i = 0; i < LLViewerRegion::NUM_PARTITIONS; i++)
+		{
+			LLSpatialPartition* part = region->getSpatialPartition(i);
+			if (part && hasRenderType(part->mDrawableType))
+			{
+				part->prepareCull();
+				parts.push_back(part);
+			}
+		}
+		region_end.push_back((U32)parts.size());
+	}
+
+	std::vector<std::vector<LLSpatialGroup*> > visible(parts.size());
+	LL::parallel_for(parts.size(), 1, [&](size_t begin, size_t end)
+		{
+			for (size_t i = begin; i < end; ++i)
+			{
+				parts[i]->collectCull(camera, visible[i]);
+			}
+		});
+
+	// mark in the same order as the serial cull so the cull result is identical
+	U32 idx = 0;
+	U32 r = 0;
+	for (LLViewerRegion* region : regions)
+	{
+		for (; idx < region_end[r]; ++idx)
+		{
+			for (LLSpatialGroup* group : visible[idx])
+			{
+				markNotCulled(group, camera);
+			}
+		}
+		++r;
+
+		//scan the VO Cache tree
+		LLVOCachePartition* vo_part = region->getVOCachePartition();
+		if (vo_part)
+		{
+			vo_part->cull(camera, false);
+		}
+	}
+}
+
+void LLPipeline::writeCullSnapshot(LLCamera& camera)
+{
+	// Format read by integration_tests/llcull_libtest: the 8 frustum
+	// corners, the user clip plane if any, and for each partition a list of
+	// octree nodes as [center x y z, radius x y z, parent index] in depth
+	// first order
+	LLSD snapshot;
+	for (U32 i = 0; i < LLCamera::AGENT_FRUSTRUM_NUM; i++)
+	{
+		snapshot["frustum"].append(ll_sd_from_vector3(camera.mAgentFrustum[i]));
+	}
+
+	if (isWaterClip())
+	{
+		LLPlane plane = camera.getUserClipPlane();
+		for (U32 i = 0; i < 4; i++)
+		{
+			snapshot["user_clip"].append(plane[i]);
+		}
+	}
+
+	snapshot["partitions"] = LLSD::emptyArray();
+	for (LLViewerRegion* region : LLWorld::getInstance()->getRegionList())
+	{
+		for (U32 i = 0; i < LLViewerRegion::NUM_PARTITIONS; i++)
+		{
+			LLSpatialPartition* part = region->getSpatialPartition(i);
+			if (part && part->mOctree && hasRenderType(part->mDrawableType))
+			{
+				LLSD nodes = LLSD::emptyArray();
+				append_octree_bounds(part->mOctree, -1, nodes);
+				snapshot["partitions"].append(nodes);
+			}
+		}
+	}
+
+	std::string filename = gDirUtilp->getExpandedFilename(LL_PATH_LOGS, "cull_snapshot.llsd");
+	llofstream file(filename.c_str(), std::ios::out | std::ios::binary);
+	if (file.is_open())
+	{
+		LLSDSerialize::toBinary(snapshot, file);
+		LL_INFOS() << "Wrote " << snapshot["partitions"].size() << " partitions to " << filename << LL_ENDL;
+	}
+	else
+	{
+		LL_WARNS() << "Unable to write cull snapshot to " << filename << LL_ENDL;
+	}
+}
+
 void LLPipeline::markNotCulled(LLSpatialGroup* group, LLCamera& camera)
 {
 	if (group->isEmpty())
@@ -3202,6 +3352,8 @@ void LLPipeline::stateSort(LLDrawable* drawablep, LLCamera& camera)
 				drawablep->updateDistance(camera, force_update); // calls vobj->updateLOD() which calls LLVOAvatar::updateVisibility()
 			}
 		}
+
+		gTextureList.addVisibleFaces(drawablep);
 	}
 
 	if (!drawablep->getVOVolume())
@@ -235,6 +235,12 @@ class LLPipeline
 
     // Populate given LLCullResult with results of a frustum cull of the entire scene against the given LLCamera
 	void updateCull(LLCamera& camera, LLCullResult& result);
+	// Traverse the spatial partitions of every region for a pass without
+	// occlusion culling, one partition per job, then mark the results in order
+	void cullPartitionsParallel(LLCamera& camera);
+	// Save the camera frustum and the bounds of every spatial partition
+	// octree for offline cull benchmarks
+	void writeCullSnapshot(LLCamera& camera);
 	void createObjects(F32 max_dtime);
 	void createObject(LLViewerObject* vobj);
 	void processPartitionQ();
@@ -26,13 +26,17 @@
 
 S32 AABBSphereIntersect(const LLVector4a& min, const LLVector4a& max, const LLVector3 &origin, const F32 &rad) { return 0; }
 
-void LLViewerOctreeCull::traverse(const LLOctreeNode<LLViewerOctreeEntry, LLPointer<LLViewerOctreeEntry> >* node) { }
 void LLViewerOctreeCull::visit(const LLOctreeNode<LLViewerOctreeEntry, LLPointer<LLViewerOctreeEntry> >* node) { }
 void LLViewerOctreeCull::preprocess(LLViewerOctreeGroup* group) {}
 bool LLViewerOctreeCull::earlyFail(LLViewerOctreeGroup* group) { return false; }
 bool LLViewerOctreeCull::checkProjectionArea(const LLVector4a& center, const LLVector4a& size, const LLVector3& shift, F32 pixel_threshold, F32 near_radius) { return false; }
 bool LLViewerOctreeCull::checkObjects(const OctreeNode* branch, const LLViewerOctreeGroup* group) { return false; }
 void LLViewerOctreeCull::processGroup(LLViewerOctreeGroup* group) {}
+void LLViewerOctreeCull::frustumCheckBatch(const LLViewerOctreeGroup* const* groups, U32 count, S32* results) {}
+bool LLViewerOctreeCull::earlyFailNode(const OctreeNode* n) { return false; }
+bool LLViewerOctreeCull::skipFrustumCheckNode(const OctreeNode* n) { return false; }
+S32 LLViewerOctreeCull::frustumCheckNode(const OctreeNode* n) { return 0; }
+void LLViewerOctreeCull::frustumCheckNodes(const OctreeNode* const* nodes, U32 count, S32* results) {}
 
 
 bool LLViewerOctreeGroup::boundObjects(BOOL empty, LLVector4a& minOut, LLVector4a& maxOut) { return false; }
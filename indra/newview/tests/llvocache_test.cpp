@@ -141,6 +141,18 @@ namespace tut
         U64 region_handle = to_region_handle(140, 81);
         LLUUID region_id = LLUUID::generateNewID();
 
-        LLVOCache::instance().readGenericExtrasFromCache(region_handle, region_id, extras);
+        bool done = false;
+        LLVOCache::instance().readFromCacheAsync(region_handle, region_id,
+            [&](LLVOCacheEntry::vocache_entry_map_t& entries,
+                LLVOCacheEntry::vocache_gltf_overrides_map_t& read_extras,
+                bool last)
+            {
+                done = last;
+                extras.swap(read_extras);
+            });
+
+        // Nothing cached for this region, so the answer comes back at once
+        ensure("read finished", done);
+        ensure("no extras", extras.empty());
     }
 }